@@ -0,0 +1,288 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "../losm/include/losm.h"
+#include "../losm/include/losm_graph.h"
+#include "../losm/include/losm_graph_replicas.h"
+#include "../losm/include/losm_memory.h"
+#include "../losm/include/losm_query_context.h"
+#include "../losm/include/losm_compressed_graph.h"
+#include "../losm/include/losm_compressed_query_context.h"
+#include "../losm/include/losm_exception.h"
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <functional>
+#include <cstdlib>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+/**
+ * The number of times each thread walks the adjacency of every node.
+ */
+static const unsigned int NUM_NEIGHBOR_PASSES = 10;
+
+/**
+ * Pin the calling thread to one processor, so that it stays on one NUMA node.
+ * @param	thread	The index of the thread; threads are spread round robin over the processors.
+ */
+static void pin_thread(unsigned int thread)
+{
+#ifdef __linux__
+	cpu_set_t cpus;
+	CPU_ZERO(&cpus);
+	CPU_SET(thread % std::max(1u, std::thread::hardware_concurrency()), &cpus);
+	sched_setaffinity(0, sizeof(cpus), &cpus);
+#endif
+}
+
+/**
+ * Run a task on pinned threads and time it.
+ * @param	numThreads	The number of threads.
+ * @param	task		The task, called with the index of the thread.
+ * @return	The time (in seconds) until every thread finished.
+ */
+static double run_threads(unsigned int numThreads, std::function<void (unsigned int)> task)
+{
+	std::vector<std::thread> threads;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	for (unsigned int i = 0; i < numThreads; i++) {
+		threads.push_back(std::thread([&task, i]() {
+			pin_thread(i);
+			task(i);
+		}));
+	}
+
+	for (std::thread &thread : threads) {
+		thread.join();
+	}
+
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Measure the throughput of walking the adjacency of the nodes in a random order, as a search does.
+ * @param	graphs		The graph each thread walks, given the index of the thread.
+ * @param	numThreads	The number of threads.
+ * @return	The throughput (in millions of adjacency slots per second).
+ */
+static double benchmark_neighbors(std::function<std::shared_ptr<const LOSMGraph> ()> graphs, unsigned int numThreads)
+{
+	std::vector<unsigned long> checksums(numThreads, 0);
+	unsigned long numSlots = 0;
+
+	double seconds = run_threads(numThreads, [&](unsigned int thread) {
+		std::shared_ptr<const LOSMGraph> graph = graphs();
+
+		std::vector<unsigned int> order(graph->get_num_nodes());
+		for (unsigned int i = 0; i < order.size(); i++) {
+			order[i] = i;
+		}
+		std::shuffle(order.begin(), order.end(), std::mt19937(thread));
+
+		const unsigned int *offsets = graph->get_adjacency_offsets_array();
+		const unsigned int *neighbors = graph->get_adjacent_nodes_array();
+		const int *fixedX = graph->get_fixed_x_array();
+
+		unsigned long checksum = 0;
+		for (unsigned int pass = 0; pass < NUM_NEIGHBOR_PASSES; pass++) {
+			for (unsigned int node : order) {
+				for (unsigned int slot = offsets[node]; slot < offsets[node + 1]; slot++) {
+					checksum += fixedX[neighbors[slot]];
+				}
+			}
+		}
+		checksums[thread] = checksum;
+
+		if (thread == 0) {
+			numSlots = (unsigned long)offsets[graph->get_num_nodes()];
+		}
+	});
+
+	// Use the checksums, so that the walks are not optimized away.
+	unsigned long checksum = 0;
+	for (unsigned long value : checksums) {
+		checksum ^= value;
+	}
+	if (checksum == 1) {
+		std::cerr << " ";
+	}
+
+	return (double)numSlots * NUM_NEIGHBOR_PASSES * numThreads / seconds / 1000000.0;
+}
+
+/**
+ * Measure the throughput of random quickest route queries, each in a thread's own query context.
+ * @param	graphs		The graph each thread searches, given the index of the thread.
+ * @param	numThreads	The number of threads.
+ * @param	numQueries	The number of queries of each thread.
+ * @return	The throughput (in queries per second).
+ */
+static double benchmark_routes(std::function<std::shared_ptr<const LOSMGraph> ()> graphs, unsigned int numThreads,
+		unsigned int numQueries)
+{
+	double seconds = run_threads(numThreads, [&](unsigned int thread) {
+		LOSMQueryContext context(graphs());
+
+		std::mt19937 random(thread);
+		std::uniform_int_distribution<unsigned int> nodes(0, context.get_graph()->get_num_nodes() - 1);
+
+		for (unsigned int i = 0; i < numQueries; i++) {
+			context.search(nodes(random), nodes(random), LOSMCost::TRAVEL_TIME);
+		}
+	});
+
+	return (double)numQueries * numThreads / seconds;
+}
+
+/**
+ * Measure the throughput of random quickest route queries over a compressed graph, each in a
+ * thread's own query context.
+ * @param	graph		The compressed graph.
+ * @param	numThreads	The number of threads.
+ * @param	numQueries	The number of queries of each thread.
+ * @return	The throughput (in queries per second).
+ */
+static double benchmark_compressed_routes(std::shared_ptr<const LOSMCompressedGraph> graph, unsigned int numThreads,
+		unsigned int numQueries)
+{
+	double seconds = run_threads(numThreads, [&](unsigned int thread) {
+		LOSMCompressedQueryContext context(graph);
+
+		std::mt19937 random(thread);
+		std::uniform_int_distribution<unsigned int> nodes(0, graph->get_num_nodes() - 1);
+
+		for (unsigned int i = 0; i < numQueries; i++) {
+			context.search(nodes(random), nodes(random), LOSMCost::TRAVEL_TIME);
+		}
+	});
+
+	return (double)numQueries * numThreads / seconds;
+}
+
+/**
+ * Get the name of a page mode.
+ * @param	pages	The page mode.
+ * @return	The name of the page mode.
+ */
+static const char *get_page_mode_name(LOSMPageMode pages)
+{
+	switch (pages) {
+	case LOSMPageMode::TRANSPARENT:
+		return "transparent";
+	case LOSMPageMode::EXPLICIT:
+		return "explicit";
+	default:
+		return "default";
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 2) {
+		std::cerr << "Usage: losm_graph_benchmark <prefix> [<threads> [<queries per thread>]]" << std::endl;
+		return 1;
+	}
+
+	std::string prefix = argv[1];
+	unsigned int numThreads = (argc > 2) ? std::atoi(argv[2]) : std::max(1u, std::thread::hardware_concurrency());
+	unsigned int numQueries = (argc > 3) ? std::atoi(argv[3]) : 100;
+
+	std::shared_ptr<LOSMGraph> base;
+	try {
+		std::shared_ptr<LOSM> losm = std::make_shared<LOSM>(prefix + "nodes.dat", prefix + "edges.dat",
+				prefix + "landmarks.dat");
+		base = std::make_shared<LOSMGraph>(losm);
+	} catch (const LOSMException &e) {
+		return 1;
+	}
+
+	if (base->get_num_nodes() == 0) {
+		std::cerr << "The map has no nodes." << std::endl;
+		return 1;
+	}
+
+	std::cout << base->get_num_nodes() << " nodes, " << base->get_num_edges() << " edges, " <<
+			numThreads << " threads, " << get_num_numa_nodes() << " NUMA nodes, " <<
+			(get_huge_page_size() >> 10) << " KB huge pages" << std::endl << std::endl;
+
+	std::cout << std::left << std::setw(14) << "pages" << std::setw(14) << "placement" <<
+			std::right << std::setw(18) << "neighbors (M/s)" << std::setw(18) << "routes (1/s)" << std::endl;
+
+	std::cout << std::fixed << std::setprecision(1);
+
+	for (LOSMPageMode pages : {LOSMPageMode::DEFAULT, LOSMPageMode::TRANSPARENT, LOSMPageMode::EXPLICIT}) {
+		// One copy, placed wherever its pages were first touched, i.e., the node of the main thread.
+		std::shared_ptr<const LOSMGraph> shared = std::make_shared<LOSMGraph>(*base, LOSMStorageOptions(pages));
+		std::function<std::shared_ptr<const LOSMGraph> ()> sharedGraphs = [&shared]() {
+			return shared;
+		};
+
+		std::cout << std::left << std::setw(14) << get_page_mode_name(pages) << std::setw(14) << "shared" <<
+				std::right << std::setw(18) << benchmark_neighbors(sharedGraphs, numThreads) <<
+				std::setw(18) << benchmark_routes(sharedGraphs, numThreads, numQueries) << std::endl;
+
+		shared.reset();
+
+		if (get_num_numa_nodes() == 1) {
+			continue;
+		}
+
+		// One copy on each NUMA node, each thread walking the one local to it.
+		LOSMGraphReplicas replicas(base, pages);
+		std::function<std::shared_ptr<const LOSMGraph> ()> localGraphs = [&replicas]() {
+			return replicas.get_local_replica();
+		};
+
+		std::cout << std::left << std::setw(14) << get_page_mode_name(pages) << std::setw(14) << "replicated" <<
+				std::right << std::setw(18) << benchmark_neighbors(localGraphs, numThreads) <<
+				std::setw(18) << benchmark_routes(localGraphs, numThreads, numQueries) << std::endl;
+	}
+
+	// The compressed graph is read from the files directly, as it would be for a map too large
+	// for the uncompressed one.
+	std::shared_ptr<const LOSMCompressedGraph> compressed;
+	try {
+		compressed = std::make_shared<LOSMCompressedGraph>(prefix + "nodes.dat", prefix + "edges.dat");
+	} catch (const LOSMException &e) {
+		return 1;
+	}
+
+	std::cout << std::left << std::setw(14) << "default" << std::setw(14) << "compressed" <<
+			std::right << std::setw(18) << "-" <<
+			std::setw(18) << benchmark_compressed_routes(compressed, numThreads, numQueries) << std::endl << std::endl;
+
+	compressed->report_memory_usage(*base, std::cout);
+
+	return 0;
+}
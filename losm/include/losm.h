@@ -36,6 +36,10 @@
 
 /**
  * A class which loads and stores Light-OSM objects.
+ *
+ * Once loaded, the const methods only read the LOSM object, so they may be called concurrently
+ * from many threads; load() must not run concurrently with anything else. For graph queries
+ * from many threads, build a LOSMGraph snapshot of the LOSM object instead.
  */
 class LOSM {
 public:
@@ -54,13 +58,25 @@ public:
 	 */
 	LOSM(std::string nodesFilename, std::string edgesFilename, std::string landmarksFilename);
 
+	/**
+	 * The constructor for the LOSM class which takes ownership of nodes, edges, and landmarks
+	 * already in memory, e.g., those of a subgraph. The endpoints of every edge must be among
+	 * the nodes provided, and all the objects are deleted with this LOSM object.
+	 * @param	nodes		The list of nodes.
+	 * @param	edges		The list of edges.
+	 * @param	landmarks	The list of landmarks.
+	 */
+	LOSM(const std::vector<const LOSMNode *> &nodes, const std::vector<const LOSMEdge *> &edges,
+			const std::vector<const LOSMLandmark *> &landmarks);
+
 	/**
 	 * The default deconstructor for the LOSM class.
 	 */
 	virtual ~LOSM();
 
 	/**
-	 * Load the files specified which contain nodes, edges, and landmarks.
+	 * Load the files specified which contain nodes, edges, and landmarks, replacing the objects
+	 * loaded before. If a file is invalid, the objects loaded before remain.
 	 * @param	nodesFilename		The nodes' filename.
 	 * @param	edgesFilename		The edges' filename.
 	 * @param	landmarksFilename	The landmarks' filename.
@@ -87,13 +103,19 @@ public:
 	const std::vector<const LOSMLandmark *> &get_landmarks() const;
 
 	/**
-	 * Get the neighbors of a node.
+	 * Get the neighbors of a node. This copies the neighbors into the list provided, which
+	 * must not be shared between threads; LOSMGraph offers the same adjacency without copies.
 	 * @param	The node in question.
 	 * @param	The list of neighbors of the node provided. This will be modified.
 	 */
 	void get_neighbors(const LOSMNode *node, std::vector<const LOSMNode *> &neighbors) const;
 
 private:
+	/**
+	 * Delete all the nodes, edges, and landmarks, and clear the neighbors.
+	 */
+	void clear();
+
 	/**
 	 * The list of nodes.
 	 */
@@ -0,0 +1,275 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef LOSM_BUILDER_H
+#define LOSM_BUILDER_H
+
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <istream>
+#include <functional>
+#include <unordered_map>
+
+#include "losm.h"
+
+/**
+ * A class which builds a LOSM object in memory, without writing and parsing the text files.
+ * Nodes, edges, and landmarks are added one at a time, as parallel arrays, or as lines in the
+ * file formats read from any stream, e.g., a pipe; nodes must be added before the edges which
+ * refer to them. Each is validated as it is added, and a rejected one leaves the builder as it
+ * was. The records are kept compactly until finalize() allocates every object at once.
+ *
+ * A LOSMBuilder is not thread-safe.
+ */
+class LOSMBuilder {
+public:
+	/**
+	 * The default constructor for the LOSMBuilder class.
+	 */
+	LOSMBuilder();
+
+	/**
+	 * The default deconstructor for the LOSMBuilder class.
+	 */
+	virtual ~LOSMBuilder();
+
+	/**
+	 * Reserve space for a number of nodes, edges, and landmarks, e.g., if they are known in advance.
+	 * @param	numNodes		The number of nodes.
+	 * @param	numEdges		The number of edges.
+	 * @param	numLandmarks	The number of landmarks.
+	 */
+	void reserve(size_t numNodes, size_t numEdges, size_t numLandmarks);
+
+	/**
+	 * Get the number of nodes added so far.
+	 * @return	The number of nodes.
+	 */
+	size_t get_num_nodes() const;
+
+	/**
+	 * Get the number of edges added so far.
+	 * @return	The number of edges.
+	 */
+	size_t get_num_edges() const;
+
+	/**
+	 * Get the number of landmarks added so far.
+	 * @return	The number of landmarks.
+	 */
+	size_t get_num_landmarks() const;
+
+	/**
+	 * Add a node whose degree is counted from the edges added.
+	 * @param	uid				The unique identifier of the node.
+	 * @param	x				The x coordinate (latitude).
+	 * @param	y				The y coordinate (longitude).
+	 * @throw	LOSMException	The identifier was already used, or the coordinate was invalid.
+	 */
+	void add_node(unsigned long uid, double x, double y);
+
+	/**
+	 * Add a node with a given degree.
+	 * @param	uid				The unique identifier of the node.
+	 * @param	x				The x coordinate (latitude).
+	 * @param	y				The y coordinate (longitude).
+	 * @param	degree			The degree of the node.
+	 * @throw	LOSMException	The identifier was already used, or the coordinate was invalid.
+	 */
+	void add_node(unsigned long uid, double x, double y, unsigned int degree);
+
+	/**
+	 * Add an edge between two nodes added before.
+	 * @param	uid1			The unique identifier of the first node.
+	 * @param	uid2			The unique identifier of the second node.
+	 * @param	name			The name of the edge, meaning the street name.
+	 * @param	distance		The distance of the edge (in miles).
+	 * @param	speedLimit		The speed limit of the edge.
+	 * @param	lanes			The total number of lanes (all directions).
+	 * @throw	LOSMException	A node was not found, or the distance was negative or not finite.
+	 */
+	void add_edge(unsigned long uid1, unsigned long uid2, std::string name, float distance,
+			unsigned int speedLimit, unsigned int lanes);
+
+	/**
+	 * Add a landmark.
+	 * @param	uid				The unique identifier of the landmark.
+	 * @param	x				The x coordinate (latitude).
+	 * @param	y				The y coordinate (longitude).
+	 * @param	name			The name of the landmark.
+	 * @throw	LOSMException	The coordinate was invalid.
+	 */
+	void add_landmark(unsigned long uid, double x, double y, std::string name);
+
+	/**
+	 * Add nodes whose degrees are counted from the edges added. The nodes are validated before
+	 * any is added, so on an error none are.
+	 * @param	count			The number of nodes.
+	 * @param	uids			The unique identifier of each node.
+	 * @param	x				The x coordinate (latitude) of each node.
+	 * @param	y				The y coordinate (longitude) of each node.
+	 * @throw	LOSMException	An identifier was used twice, or a coordinate was invalid.
+	 */
+	void add_nodes(size_t count, const unsigned long *uids, const double *x, const double *y);
+
+	/**
+	 * Add edges between nodes added before. The edges are validated before any is added, so on
+	 * an error none are.
+	 * @param	count			The number of edges.
+	 * @param	uids1			The unique identifier of the first node of each edge.
+	 * @param	uids2			The unique identifier of the second node of each edge.
+	 * @param	names			The name of each edge, or null to leave them empty.
+	 * @param	distances		The distance of each edge (in miles).
+	 * @param	speedLimits		The speed limit of each edge.
+	 * @param	lanes			The total number of lanes of each edge.
+	 * @throw	LOSMException	A node was not found, or a distance was negative or not finite.
+	 */
+	void add_edges(size_t count, const unsigned long *uids1, const unsigned long *uids2, const std::string *names,
+			const float *distances, const unsigned int *speedLimits, const unsigned int *lanes);
+
+	/**
+	 * Add the nodes read from a stream, with one node per line as in the nodes' file.
+	 * @param	stream			The stream.
+	 * @throw	LOSMException	A line was invalid; the nodes of the lines before it remain.
+	 */
+	void read_nodes(std::istream &stream);
+
+	/**
+	 * Add the edges read from a stream, with one edge per line as in the edges' file.
+	 * @param	stream			The stream.
+	 * @throw	LOSMException	A line was invalid; the edges of the lines before it remain.
+	 */
+	void read_edges(std::istream &stream);
+
+	/**
+	 * Add the landmarks read from a stream, with one landmark per line as in the landmarks' file.
+	 * @param	stream			The stream.
+	 * @throw	LOSMException	A line was invalid; the landmarks of the lines before it remain.
+	 */
+	void read_landmarks(std::istream &stream);
+
+	/**
+	 * Create the LOSM object from everything added, then empty the builder.
+	 * @return	The LOSM object, which owns its nodes, edges, and landmarks.
+	 */
+	std::shared_ptr<LOSM> finalize();
+
+	/**
+	 * Discard everything added so far.
+	 */
+	void clear();
+
+private:
+	/**
+	 * The degree of a node which is counted from the edges.
+	 */
+	static const unsigned int COUNTED_DEGREE = (unsigned int)-1;
+
+	/**
+	 * A node added to the builder.
+	 */
+	struct NodeRecord {
+		unsigned long uid;
+		double x;
+		double y;
+		unsigned int degree;
+	};
+
+	/**
+	 * An edge added to the builder, with the indices of its nodes.
+	 */
+	struct EdgeRecord {
+		unsigned int node1;
+		unsigned int node2;
+		std::string name;
+		float distance;
+		unsigned int speedLimit;
+		unsigned int lanes;
+	};
+
+	/**
+	 * A landmark added to the builder.
+	 */
+	struct LandmarkRecord {
+		unsigned long uid;
+		double x;
+		double y;
+		std::string name;
+	};
+
+	/**
+	 * Check a coordinate.
+	 * @param	x				The x coordinate (latitude).
+	 * @param	y				The y coordinate (longitude).
+	 * @param	method			The name of the calling method, for the error message.
+	 * @throw	LOSMException	The coordinate was not finite or out of range.
+	 */
+	static void check_coordinate(double x, double y, const char *method);
+
+	/**
+	 * Find the index of a node added before.
+	 * @param	uid				The unique identifier of the node.
+	 * @param	method			The name of the calling method, for the error message.
+	 * @return	The index of the node.
+	 * @throw	LOSMException	No node had this identifier.
+	 */
+	unsigned int find_node(unsigned long uid, const char *method) const;
+
+	/**
+	 * Check a distance.
+	 * @param	distance		The distance.
+	 * @param	method			The name of the calling method, for the error message.
+	 * @throw	LOSMException	The distance was negative or not finite.
+	 */
+	static void check_distance(float distance, const char *method);
+
+	/**
+	 * Read a stream line by line, passing the comma-delimited items of each to a function.
+	 * @param	stream			The stream.
+	 * @param	numItems		The number of items each line must have.
+	 * @param	method			The name of the calling method, for the error message.
+	 * @param	add				The function which adds the items of a line.
+	 * @throw	LOSMException	A line was invalid, or the stream could not be read.
+	 */
+	static void read_lines(std::istream &stream, unsigned int numItems, const char *method,
+			std::function<void (const std::vector<std::string> &)> add);
+
+	/**
+	 * The nodes, edges, and landmarks added so far.
+	 */
+	std::vector<NodeRecord> nodes;
+	std::vector<EdgeRecord> edges;
+	std::vector<LandmarkRecord> landmarks;
+
+	/**
+	 * A mapping from the unique identifier of each node to its index.
+	 */
+	std::unordered_map<unsigned long, unsigned int> nodeIndices;
+
+};
+
+
+#endif // LOSM_BUILDER_H
@@ -0,0 +1,380 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef LOSM_COMPRESSED_GRAPH_H
+#define LOSM_COMPRESSED_GRAPH_H
+
+
+#include <vector>
+#include <string>
+#include <utility>
+#include <ostream>
+#include <cstdint>
+
+#include "losm_graph.h"
+
+/**
+ * A compressed, standalone copy of a LOSMGraph for maps too large to hold uncompressed. It keeps
+ * everything needed for routing, i.e., unique identifiers, coordinates, adjacency, distances,
+ * speed limits, and lanes, but not the LOSM objects or street names. It may be built directly
+ * from the map's files, so that neither the LOSM objects nor a LOSMGraph ever exist, and
+ * LOSMCompressedQueryContext routes over it.
+ *
+ * Nodes are renumbered along a Hilbert curve over their coordinates, so neighbors have nearby
+ * indices. Edges are renumbered in order of their lower endpoint, so each node owns a contiguous
+ * range of edges. Each node's adjacency is a byte string of varint-encoded neighbor deltas in
+ * which the edge of a neighbor is implicit for owned edges, and a small rank within the
+ * neighbor's range otherwise. Speed limits and lanes are stored in one byte each, and the unique
+ * identifiers in blocks of delta-encoded varints. The original index of each node and edge is
+ * kept bit-packed, so results map back to the LOSMGraph or the lines of the files.
+ *
+ * Like LOSMGraph, nothing is modified after construction, so any number of threads may query
+ * the same LOSMCompressedGraph concurrently.
+ */
+class LOSMCompressedGraph {
+public:
+	/**
+	 * An iterator which decodes the adjacency of one node in place.
+	 */
+	class NeighborIterator {
+	public:
+		/**
+		 * Decode the next neighbor.
+		 * @param	neighbor	The index of the neighboring node. This will be modified.
+		 * @param	edge		The index of the edge to the neighbor. This will be modified.
+		 * @return	True if there was another neighbor, false otherwise.
+		 */
+		bool next(unsigned int &neighbor, unsigned int &edge);
+
+	private:
+		friend class LOSMCompressedGraph;
+
+		/**
+		 * The graph being iterated over.
+		 */
+		const LOSMCompressedGraph *graph;
+
+		/**
+		 * The node whose neighbors are decoded.
+		 */
+		unsigned int node;
+
+		/**
+		 * The current and end positions in the adjacency bytes.
+		 */
+		const unsigned char *current;
+		const unsigned char *end;
+
+		/**
+		 * The previous neighbor decoded, or the node itself before the first.
+		 */
+		unsigned int previous;
+
+		/**
+		 * If no neighbor has been decoded yet.
+		 */
+		bool first;
+
+		/**
+		 * The number of neighbors equal to the node itself (two per self-loop) decoded so far.
+		 */
+		unsigned int selfLoops;
+
+		/**
+		 * The number of owned neighbors (greater than the node itself) decoded so far.
+		 */
+		unsigned int owned;
+	};
+
+	/**
+	 * The constructor for the LOSMCompressedGraph class, which compresses a LOSMGraph.
+	 * @param	graph			The graph to compress.
+	 * @throw	LOSMException	The adjacency exceeded 4 GB once compressed.
+	 */
+	LOSMCompressedGraph(const LOSMGraph &graph);
+
+	/**
+	 * A constructor for the LOSMCompressedGraph class, which reads the nodes and edges of a map
+	 * into flat arrays and compresses them. The original indices are the lines of the files.
+	 * @param	nodesFilename	The nodes' filename.
+	 * @param	edgesFilename	The edges' filename.
+	 * @throw	LOSMException	A file could not be read or was invalid, or the adjacency exceeded
+	 * 							4 GB once compressed.
+	 */
+	LOSMCompressedGraph(std::string nodesFilename, std::string edgesFilename);
+
+	/**
+	 * The default deconstructor for the LOSMCompressedGraph class.
+	 */
+	virtual ~LOSMCompressedGraph();
+
+	/**
+	 * Get the number of nodes.
+	 * @return	The number of nodes.
+	 */
+	unsigned int get_num_nodes() const;
+
+	/**
+	 * Get the number of edges.
+	 * @return	The number of edges.
+	 */
+	unsigned int get_num_edges() const;
+
+	/**
+	 * Get the unique identifier of a node.
+	 * @param	node	The index of the node.
+	 * @return	The unique identifier of the node.
+	 */
+	unsigned long get_uid(unsigned int node) const;
+
+	/**
+	 * Get the index of a node given its unique identifier.
+	 * @param	uid		The unique identifier of the node.
+	 * @return	The index of the node, or LOSMGraph::INVALID_INDEX if no node has this identifier.
+	 */
+	unsigned int find_node_index(unsigned long uid) const;
+
+	/**
+	 * Get the index a node had before it was renumbered.
+	 * @param	node	The index of the node.
+	 * @return	The index of the node in the LOSMGraph, or its line in the nodes' file, from zero.
+	 */
+	unsigned int get_original_node(unsigned int node) const;
+
+	/**
+	 * Get the index an edge had before it was renumbered.
+	 * @param	edge	The index of the edge.
+	 * @return	The index of the edge in the LOSMGraph, or its line in the edges' file, from zero.
+	 */
+	unsigned int get_original_edge(unsigned int edge) const;
+
+	/**
+	 * Get the x coordinate (latitude) of a node in fixed point.
+	 * @param	node	The index of the node.
+	 * @return	The latitude in fixed point.
+	 */
+	int get_fixed_x(unsigned int node) const;
+
+	/**
+	 * Get the y coordinate (longitude) of a node in fixed point.
+	 * @param	node	The index of the node.
+	 * @return	The longitude in fixed point.
+	 */
+	int get_fixed_y(unsigned int node) const;
+
+	/**
+	 * Get an iterator over the neighbors of a node, in increasing order of index.
+	 * @param	node	The index of the node.
+	 * @return	The iterator, positioned before the first neighbor.
+	 */
+	NeighborIterator get_neighbors(unsigned int node) const;
+
+	/**
+	 * Get the distance (in miles) of an edge.
+	 * @param	edge	The index of the edge.
+	 * @return	The distance of the edge.
+	 */
+	float get_distance(unsigned int edge) const;
+
+	/**
+	 * Get the speed limit of an edge, clamped to 255.
+	 * @param	edge	The index of the edge.
+	 * @return	The speed limit of the edge.
+	 */
+	unsigned int get_speed_limit(unsigned int edge) const;
+
+	/**
+	 * Get the number of lanes of an edge, clamped to 255.
+	 * @param	edge	The index of the edge.
+	 * @return	The number of lanes of the edge.
+	 */
+	unsigned int get_lanes(unsigned int edge) const;
+
+	/**
+	 * Get the cost of an edge, computed as in LOSMGraph::get_edge_cost().
+	 * @param	edge	The index of the edge.
+	 * @param	cost	The type of cost.
+	 * @return	The cost of the edge.
+	 */
+	float get_edge_cost(unsigned int edge, LOSMCost cost) const;
+
+	/**
+	 * Get the memory used by the compressed graph.
+	 * @return	The memory used by each part of the compressed graph.
+	 */
+	LOSMMemoryUsage get_memory_usage() const;
+
+	/**
+	 * Write a table comparing the memory used by the compressed graph with an uncompressed one.
+	 * @param	uncompressed	The uncompressed graph, e.g., the one this was built from.
+	 * @param	stream			The stream to write the table to.
+	 */
+	void report_memory_usage(const LOSMGraph &uncompressed, std::ostream &stream) const;
+
+private:
+	/**
+	 * The number of unique identifiers in each delta-encoded block.
+	 */
+	static const unsigned int UID_BLOCK_SIZE = 64;
+
+	/**
+	 * The uncompressed nodes and edges, in their original order, from which the graph is built.
+	 */
+	struct Source {
+		std::vector<unsigned long> uids;
+		std::vector<int> fixedX;
+		std::vector<int> fixedY;
+		std::vector<unsigned int> edgeNodes;
+		std::vector<float> distances;
+		std::vector<unsigned int> speedLimits;
+		std::vector<unsigned int> lanes;
+	};
+
+	/**
+	 * Read the nodes and edges of a map's files.
+	 * @param	nodesFilename	The nodes' filename.
+	 * @param	edgesFilename	The edges' filename.
+	 * @param	source			The nodes and edges. This will be modified.
+	 * @throw	LOSMException	A file could not be read or was invalid.
+	 */
+	static void load_source(std::string nodesFilename, std::string edgesFilename, Source &source);
+
+	/**
+	 * Compress the nodes and edges.
+	 * @param	source			The nodes and edges. Its arrays are released as they are used.
+	 * @throw	LOSMException	The adjacency exceeded 4 GB once compressed.
+	 */
+	void compress(Source &source);
+
+	/**
+	 * Get the number of bits needed for every index below a count.
+	 * @param	count	The count.
+	 * @return	The number of bits, at least one.
+	 */
+	static unsigned int get_index_bits(unsigned int count);
+
+	/**
+	 * Read a bit-packed value.
+	 * @param	packed	The bit-packed words.
+	 * @param	bits	The number of bits of each value.
+	 * @param	index	The index of the value.
+	 * @return	The value.
+	 */
+	static unsigned int get_packed(const std::vector<uint64_t> &packed, unsigned int bits, unsigned int index);
+
+	/**
+	 * The adjacency bytes of all nodes, concatenated.
+	 */
+	std::vector<unsigned char> adjacency;
+
+	/**
+	 * The first adjacency byte of each node, followed by the total number of bytes.
+	 */
+	std::vector<unsigned int> adjacencyOffsets;
+
+	/**
+	 * The first edge owned by each node, followed by the number of edges. A node owns the edges
+	 * of which it is the lower endpoint.
+	 */
+	std::vector<unsigned int> ownedEdges;
+
+	/**
+	 * The distance (in miles) of each edge.
+	 */
+	std::vector<float> distances;
+
+	/**
+	 * The index of each edge's speed limit in speedLimits.
+	 */
+	std::vector<unsigned char> speedClasses;
+
+	/**
+	 * The number of lanes of each edge.
+	 */
+	std::vector<unsigned char> lanes;
+
+	/**
+	 * The distinct speed limits, indexed by speed class.
+	 */
+	std::vector<unsigned int> speedLimits;
+
+	/**
+	 * The hours per mile of each speed class, so that travel time is one multiplication.
+	 */
+	std::vector<float> hoursPerMile;
+
+	/**
+	 * The x and y coordinates of each node in fixed point.
+	 */
+	std::vector<int> fixedX;
+	std::vector<int> fixedY;
+
+	/**
+	 * The first unique identifier of each block of the sorted unique identifiers.
+	 */
+	std::vector<unsigned long> uidBlockFirsts;
+
+	/**
+	 * The first byte of each block in uidDeltas.
+	 */
+	std::vector<unsigned int> uidBlockOffsets;
+
+	/**
+	 * The varint-encoded differences between consecutive sorted unique identifiers, excluding
+	 * the first of each block.
+	 */
+	std::vector<unsigned char> uidDeltas;
+
+	/**
+	 * The node index of each sorted unique identifier, bit-packed.
+	 */
+	std::vector<uint64_t> uidNodes;
+
+	/**
+	 * The rank of each node's unique identifier among the sorted ones, bit-packed.
+	 */
+	std::vector<uint64_t> nodeUIDRanks;
+
+	/**
+	 * The original index of each node and edge, bit-packed.
+	 */
+	std::vector<uint64_t> originalNodes;
+	std::vector<uint64_t> originalEdges;
+
+	/**
+	 * The number of bits of each bit-packed node index or rank, and of each edge index.
+	 */
+	unsigned int indexBits;
+	unsigned int edgeBits;
+
+	/**
+	 * The number of nodes and edges.
+	 */
+	unsigned int numNodes;
+	unsigned int numEdges;
+
+};
+
+
+#endif // LOSM_COMPRESSED_GRAPH_H
@@ -0,0 +1,165 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef LOSM_COMPRESSED_QUERY_CONTEXT_H
+#define LOSM_COMPRESSED_QUERY_CONTEXT_H
+
+
+#include <memory>
+#include <vector>
+#include <utility>
+
+#include "losm_compressed_graph.h"
+
+/**
+ * The cheapest route over a LOSMCompressedGraph, in terms of the original map.
+ */
+struct LOSMCompressedRoute {
+	/**
+	 * If a route was found.
+	 */
+	bool found;
+
+	/**
+	 * The total cost of the route, or infinity if no route was found.
+	 */
+	float cost;
+
+	/**
+	 * The unique identifiers of the nodes visited, from the source to the target.
+	 */
+	std::vector<unsigned long> uids;
+
+	/**
+	 * The original indices of the edges traversed, with one fewer element than uids.
+	 */
+	std::vector<unsigned int> edges;
+};
+
+/**
+ * The scratch memory for queries over a shared LOSMCompressedGraph, which decodes each node's
+ * adjacency in place as the search reaches it. Like LOSMQueryContext, it is not thread-safe, so
+ * each thread must use its own, and its memory is reused from one query to the next.
+ */
+class LOSMCompressedQueryContext {
+public:
+	/**
+	 * The constructor for the LOSMCompressedQueryContext class.
+	 * @param	graph			The graph to query.
+	 * @throw	LOSMException	The graph was null.
+	 */
+	LOSMCompressedQueryContext(std::shared_ptr<const LOSMCompressedGraph> graph);
+
+	/**
+	 * The default deconstructor for the LOSMCompressedQueryContext class.
+	 */
+	virtual ~LOSMCompressedQueryContext();
+
+	/**
+	 * Get the graph this context queries.
+	 * @return	The graph.
+	 */
+	const LOSMCompressedGraph *get_graph() const;
+
+	/**
+	 * Find the cost of the cheapest route between two nodes.
+	 * @param	sourceUID		The unique identifier of the source node.
+	 * @param	targetUID		The unique identifier of the target node.
+	 * @param	cost			The type of cost.
+	 * @return	The cost of the cheapest route, or infinity if the target is unreachable.
+	 * @throw	LOSMException	No node has one of the unique identifiers.
+	 */
+	float find_distance(unsigned long sourceUID, unsigned long targetUID, LOSMCost cost);
+
+	/**
+	 * Find the cheapest route between two nodes.
+	 * @param	sourceUID		The unique identifier of the source node.
+	 * @param	targetUID		The unique identifier of the target node.
+	 * @param	cost			The type of cost.
+	 * @param	route			The resulting route. This will be modified.
+	 * @throw	LOSMException	No node has one of the unique identifiers.
+	 */
+	void find_route(unsigned long sourceUID, unsigned long targetUID, LOSMCost cost, LOSMCompressedRoute &route);
+
+	/**
+	 * Run Dijkstra's algorithm from a source node index until the target node index is settled.
+	 * Afterwards, get_cost() describes every settled node.
+	 * @param	source	The index of the source node.
+	 * @param	target	The index of the target node, or LOSMGraph::INVALID_INDEX to settle all.
+	 * @param	cost	The type of cost.
+	 * @return	The cost of the target, or infinity if it is unreachable or no target was given.
+	 */
+	float search(unsigned int source, unsigned int target, LOSMCost cost);
+
+	/**
+	 * Get the cost of a node found by the last search.
+	 * @param	node	The index of the node.
+	 * @return	The cost of the node, or infinity if the last search did not reach it.
+	 */
+	float get_cost(unsigned int node) const;
+
+private:
+	/**
+	 * Get the index of a node given its unique identifier.
+	 * @param	uid				The unique identifier of the node.
+	 * @return	The index of the node.
+	 * @throw	LOSMException	No node has the unique identifier.
+	 */
+	unsigned int get_node_index(unsigned long uid) const;
+
+	/**
+	 * The graph being queried.
+	 */
+	std::shared_ptr<const LOSMCompressedGraph> graph;
+
+	/**
+	 * The tentative cost of each node; only valid if the node's stamp is the current stamp.
+	 */
+	std::vector<float> costs;
+
+	/**
+	 * The node and edge through which each node was reached, for rebuilding routes.
+	 */
+	std::vector<unsigned int> parentNodes;
+	std::vector<unsigned int> parentEdges;
+
+	/**
+	 * The search which last wrote each node's cost; this avoids clearing costs between searches.
+	 */
+	std::vector<unsigned int> stamps;
+
+	/**
+	 * The stamp of the current search.
+	 */
+	unsigned int currentStamp;
+
+	/**
+	 * The binary heap of (cost, node index) pairs, with the cheapest on top.
+	 */
+	std::vector<std::pair<float, unsigned int> > heap;
+
+};
+
+
+#endif // LOSM_COMPRESSED_QUERY_CONTEXT_H
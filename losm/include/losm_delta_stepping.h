@@ -0,0 +1,162 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef LOSM_DELTA_STEPPING_H
+#define LOSM_DELTA_STEPPING_H
+
+
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+
+#include "losm_graph.h"
+#include "losm_thread_pool.h"
+
+/**
+ * A parallel single-source shortest path search over a LOSMGraph by delta-stepping, for when
+ * the costs of every node are wanted, e.g., to initialize a value function.
+ *
+ * Tentative costs are grouped into buckets of width delta. The nodes of the lowest bucket are
+ * relaxed in parallel along their light edges (cost at most delta), which may refill the same
+ * bucket, until it is empty; then their heavy edges are relaxed once. Each worker keeps its own
+ * buckets, so relaxations never lock, and takes the frontier in batches of nodes.
+ *
+ * Each node's cost and parent edge are updated together by one atomic minimum over the pair,
+ * so the costs are exactly those of Dijkstra's algorithm (the minimum over paths of the sums
+ * of their edge costs in order), and ties between parents always go to the lowest edge index.
+ * One search runs at a time per LOSMDeltaStepping.
+ */
+class LOSMDeltaStepping {
+public:
+	/**
+	 * The constructor for the LOSMDeltaStepping class.
+	 * @param	graph			The graph to search.
+	 * @param	numThreads		The number of workers. Zero uses the hardware concurrency.
+	 * @throw	LOSMException	The graph was null.
+	 */
+	LOSMDeltaStepping(std::shared_ptr<const LOSMGraph> graph, unsigned int numThreads = 0);
+
+	/**
+	 * The deconstructor for the LOSMDeltaStepping class.
+	 */
+	virtual ~LOSMDeltaStepping();
+
+	/**
+	 * Get the bucket width chosen for a type of cost: a multiple of the mean edge cost.
+	 * @param	cost	The type of cost.
+	 * @return	The bucket width.
+	 */
+	float get_default_delta(LOSMCost cost) const;
+
+	/**
+	 * Find the cost of the cheapest route from a source to every node.
+	 * @param	source			The index of the source node.
+	 * @param	cost			The type of cost.
+	 * @param	costs			The cost of each node, or infinity if it is unreachable. This
+	 * 							will be modified.
+	 * @param	parentEdges		The edge through which each node is reached, or
+	 * 							LOSMGraph::INVALID_INDEX for the source and unreachable nodes.
+	 * 							This will be modified.
+	 * @param	delta			The bucket width, or zero for get_default_delta(cost). It is widened
+	 * 							if the largest edge cost would span too many buckets.
+	 * @throw	LOSMException	The source was not a node of the graph.
+	 */
+	void search(unsigned int source, LOSMCost cost, std::vector<float> &costs,
+			std::vector<unsigned int> &parentEdges, float delta = 0.0f);
+
+private:
+	/**
+	 * The number of frontier nodes each task relaxes.
+	 */
+	static const unsigned int BATCH_SIZE = 256;
+
+	/**
+	 * The maximum number of buckets of each worker.
+	 */
+	static const unsigned int MAX_BUCKETS = 1 << 16;
+
+	/**
+	 * The default bucket width, as a multiple of the mean edge cost.
+	 */
+	static const float DELTA_FACTOR;
+
+	/**
+	 * The buckets of one worker. Buckets are reused cyclically, since every tentative cost is
+	 * within the largest edge cost of the current bucket.
+	 */
+	struct Buckets {
+		std::vector<std::vector<unsigned int> > nodes;
+		std::vector<unsigned int> settled;
+	};
+
+	/**
+	 * Relax the edges of a batch of frontier nodes.
+	 * @param	frontier	The frontier nodes.
+	 * @param	first		The first frontier node of the batch.
+	 * @param	last		One past the last frontier node of the batch.
+	 * @param	heavy		True to relax the heavy edges, false for the light ones.
+	 * @param	worker		The worker whose buckets receive the relaxed nodes.
+	 */
+	void relax(const std::vector<unsigned int> &frontier, unsigned int first, unsigned int last,
+			bool heavy, unsigned int worker);
+
+	/**
+	 * The graph being searched.
+	 */
+	std::shared_ptr<const LOSMGraph> graph;
+
+	/**
+	 * The mean and maximum edge cost, for each type of cost.
+	 */
+	float meanCosts[2];
+	float maxCosts[2];
+
+	/**
+	 * The packed cost (the high 32 bits, as a float) and parent edge (the low 32 bits) of each
+	 * node in the current search; comparing them as integers orders by cost, then edge.
+	 */
+	std::unique_ptr<std::atomic<uint64_t>[]> states;
+
+	/**
+	 * The buckets of each worker, and of the calling thread last.
+	 */
+	std::vector<Buckets> buckets;
+
+	/**
+	 * The type of cost, bucket width, and current bucket of the current search.
+	 */
+	LOSMCost currentCost;
+	float currentDelta;
+	unsigned long currentBucket;
+
+	/**
+	 * The pool of workers, declared last so that it is destroyed first.
+	 */
+	std::unique_ptr<LOSMThreadPool> pool;
+
+};
+
+
+#endif // LOSM_DELTA_STEPPING_H
@@ -0,0 +1,108 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef LOSM_DISTANCE_H
+#define LOSM_DISTANCE_H
+
+
+/**
+ * The radius of the Earth (in miles), matching the Python converter.
+ */
+const double LOSM_EARTH_RADIUS_IN_MILES = 3959.0;
+
+/**
+ * Compute the Haversine distance (in miles) between two coordinates in fixed point.
+ * @param	x1	The first latitude in fixed point.
+ * @param	y1	The first longitude in fixed point.
+ * @param	x2	The second latitude in fixed point.
+ * @param	y2	The second longitude in fixed point.
+ * @return	The distance (in miles).
+ */
+float haversine_distance(int x1, int y1, int x2, int y2);
+
+/**
+ * Compute the equirectangular approximation of the distance (in miles) between two coordinates
+ * in fixed point. This is within a fraction of a percent of the Haversine distance for the
+ * lengths of road segments, and much cheaper.
+ * @param	x1	The first latitude in fixed point.
+ * @param	y1	The first longitude in fixed point.
+ * @param	x2	The second latitude in fixed point.
+ * @param	y2	The second longitude in fixed point.
+ * @return	The distance (in miles).
+ */
+float equirectangular_distance(int x1, int y1, int x2, int y2);
+
+/**
+ * Compute the Haversine distances (in miles) between pairs of coordinates in fixed point, such
+ * that result[i] is the distance from (x1[i], y1[i]) to (x2[i], y2[i]). This uses AVX2 when
+ * the processor supports it (in single precision), and a scalar loop in double precision otherwise.
+ * @param	count	The number of pairs.
+ * @param	x1		The first latitudes in fixed point.
+ * @param	y1		The first longitudes in fixed point.
+ * @param	x2		The second latitudes in fixed point.
+ * @param	y2		The second longitudes in fixed point.
+ * @param	result	The resultant distances (in miles). This will be modified.
+ */
+void haversine_distances(unsigned int count, const int *x1, const int *y1, const int *x2, const int *y2,
+		float *result);
+
+/**
+ * Compute the Haversine distances (in miles) from one coordinate to many coordinates in fixed
+ * point, such that result[i] is the distance from (x, y) to (xs[i], ys[i]).
+ * @param	x		The latitude in fixed point.
+ * @param	y		The longitude in fixed point.
+ * @param	count	The number of coordinates.
+ * @param	xs		The latitudes in fixed point.
+ * @param	ys		The longitudes in fixed point.
+ * @param	result	The resultant distances (in miles). This will be modified.
+ */
+void haversine_distances(int x, int y, unsigned int count, const int *xs, const int *ys, float *result);
+
+/**
+ * Compute the equirectangular distances (in miles) between pairs of coordinates in fixed point,
+ * such that result[i] is the distance from (x1[i], y1[i]) to (x2[i], y2[i]).
+ * @param	count	The number of pairs.
+ * @param	x1		The first latitudes in fixed point.
+ * @param	y1		The first longitudes in fixed point.
+ * @param	x2		The second latitudes in fixed point.
+ * @param	y2		The second longitudes in fixed point.
+ * @param	result	The resultant distances (in miles). This will be modified.
+ */
+void equirectangular_distances(unsigned int count, const int *x1, const int *y1, const int *x2, const int *y2,
+		float *result);
+
+/**
+ * Compute the equirectangular distances (in miles) from one coordinate to many coordinates in
+ * fixed point, such that result[i] is the distance from (x, y) to (xs[i], ys[i]).
+ * @param	x		The latitude in fixed point.
+ * @param	y		The longitude in fixed point.
+ * @param	count	The number of coordinates.
+ * @param	xs		The latitudes in fixed point.
+ * @param	ys		The longitudes in fixed point.
+ * @param	result	The resultant distances (in miles). This will be modified.
+ */
+void equirectangular_distances(int x, int y, unsigned int count, const int *xs, const int *ys, float *result);
+
+
+#endif // LOSM_DISTANCE_H
@@ -0,0 +1,301 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef LOSM_EDGE_INDEX_H
+#define LOSM_EDGE_INDEX_H
+
+
+#include <memory>
+#include <vector>
+#include <cstddef>
+
+#include "losm_graph.h"
+
+/**
+ * The closest point on an edge to a coordinate.
+ */
+struct LOSMEdgeProjection {
+	/**
+	 * The index of the edge, or LOSMGraph::INVALID_INDEX if there are no edges.
+	 */
+	unsigned int edge;
+
+	/**
+	 * The fraction of the way along the edge from its first node to its second node.
+	 */
+	float fraction;
+
+	/**
+	 * The distance (in miles) from the coordinate to the closest point.
+	 */
+	float distance;
+
+	/**
+	 * The x coordinate (latitude) of the closest point.
+	 */
+	float x;
+
+	/**
+	 * The y coordinate (longitude) of the closest point.
+	 */
+	float y;
+};
+
+/**
+ * A packed R-tree over the edges of a LOSMGraph, as straight segments between their nodes, for
+ * snapping coordinates onto the closest point of the closest edge rather than the nearest node.
+ *
+ * The tree is bulk-loaded with Sort-Tile-Recursive: the segments are sorted into vertical slices
+ * by the centers of their bounding boxes, then by their centers within each slice, and every
+ * NODE_SIZE consecutive entries form a node of the next level, which is tiled in turn until a
+ * single root remains. Each node holds a contiguous range of children, so the whole tree is two
+ * flat arrays.
+ *
+ * Distances are measured in the equirectangular projection around each query coordinate, in
+ * which the projection onto a segment is exact; nodes are pruned by the distance to their boxes
+ * in the same projection, so the results are exact as well, with ties broken by edge index.
+ *
+ * Nothing is modified after construction, so any number of threads may query the same index
+ * concurrently.
+ */
+class LOSMEdgeIndex {
+public:
+	/**
+	 * The constructor for the LOSMEdgeIndex class, which bulk-loads the tree.
+	 * @param	graph			The graph whose edges to index.
+	 * @throw	LOSMException	The graph was null.
+	 */
+	LOSMEdgeIndex(std::shared_ptr<const LOSMGraph> graph);
+
+	/**
+	 * The default deconstructor for the LOSMEdgeIndex class.
+	 */
+	virtual ~LOSMEdgeIndex();
+
+	/**
+	 * Get the graph whose edges are indexed.
+	 * @return	The graph.
+	 */
+	std::shared_ptr<const LOSMGraph> get_graph() const;
+
+	/**
+	 * Find the closest point on the closest edge to a coordinate.
+	 * @param	x		The x coordinate (latitude).
+	 * @param	y		The y coordinate (longitude).
+	 * @param	result	The closest point. This will be modified.
+	 */
+	void find_nearest_edge(float x, float y, LOSMEdgeProjection &result) const;
+
+	/**
+	 * Find the closest points on the closest edges to a coordinate.
+	 * @param	x		The x coordinate (latitude).
+	 * @param	y		The y coordinate (longitude).
+	 * @param	k		The number of edges.
+	 * @param	result	The closest points on the k closest edges (or all of them, if there are
+	 * 					fewer), nearest first. This will be modified.
+	 */
+	void find_nearest_edges(float x, float y, unsigned int k, std::vector<LOSMEdgeProjection> &result) const;
+
+	/**
+	 * Find the closest point on the closest edge to each of many coordinates. The coordinates
+	 * are visited along a Hilbert curve, and the closest edge of the previous one bounds each
+	 * search, which is much faster than separate queries for coordinates near each other.
+	 * @param	count	The number of coordinates.
+	 * @param	x		The x coordinates (latitudes).
+	 * @param	y		The y coordinates (longitudes).
+	 * @param	result	The closest point for each coordinate, in order. This will be modified.
+	 */
+	void find_nearest_edges(unsigned int count, const float *x, const float *y, LOSMEdgeProjection *result) const;
+
+	/**
+	 * Find the closest points on the closest edges to each of many coordinates.
+	 * @param	count	The number of coordinates.
+	 * @param	x		The x coordinates (latitudes).
+	 * @param	y		The y coordinates (longitudes).
+	 * @param	k		The number of edges for each coordinate.
+	 * @param	result	The closest points on the k closest edges of each coordinate, nearest
+	 * 					first, such that those of coordinate i start at i * k. Where there are
+	 * 					fewer than k edges, the rest have an edge of LOSMGraph::INVALID_INDEX.
+	 * 					This will be modified.
+	 */
+	void find_nearest_edges(unsigned int count, const float *x, const float *y, unsigned int k,
+			std::vector<LOSMEdgeProjection> &result) const;
+
+	/**
+	 * Get the memory used by the tree.
+	 * @return	The number of bytes used.
+	 */
+	size_t get_memory_usage() const;
+
+private:
+	/**
+	 * A bounding box of a segment or node in fixed point, with the range of its children.
+	 */
+	struct Box {
+		int minX;
+		int minY;
+		int maxX;
+		int maxY;
+
+		/**
+		 * The first child, and one past the last child. The children of leaf nodes are
+		 * segments; those of other nodes are nodes.
+		 */
+		unsigned int first;
+		unsigned int last;
+	};
+
+	/**
+	 * An entry of the queue of a k-nearest search: a node or segment and its distance.
+	 */
+	struct QueueEntry {
+		/**
+		 * The squared distance (in square miles) to the node's box or the segment.
+		 */
+		float distanceSq;
+
+		/**
+		 * The index of the node or segment.
+		 */
+		unsigned int index;
+
+		/**
+		 * If this is a segment.
+		 */
+		bool segment;
+	};
+
+	/**
+	 * The maximum number of children of each node.
+	 */
+	static const unsigned int NODE_SIZE = 8;
+
+	/**
+	 * The maximum depth of the stack of a nearest search: at most NODE_SIZE - 1 siblings wait
+	 * on each of the levels of a tree over 2^32 segments.
+	 */
+	static const unsigned int MAX_STACK_SIZE = 256;
+
+	/**
+	 * Sort boxes with Sort-Tile-Recursive, so that every NODE_SIZE consecutive boxes are close.
+	 * @param	boxes	The boxes to sort. This will be modified.
+	 */
+	static void sort_tiles(std::vector<Box> &boxes);
+
+	/**
+	 * Compute the squared distance from a coordinate to a box, in the local projection.
+	 * @param	box		The box.
+	 * @param	px		The x coordinate in fixed point.
+	 * @param	py		The y coordinate in fixed point.
+	 * @param	scaleY	The miles per unit of fixed-point longitude at the coordinate.
+	 * @return	The squared distance (in square miles), or zero within the box.
+	 */
+	float compute_box_distance(const Box &box, int px, int py, float scaleY) const;
+
+	/**
+	 * Project a coordinate onto a segment, in the local projection.
+	 * @param	segment		The position of the segment.
+	 * @param	px			The x coordinate in fixed point.
+	 * @param	py			The y coordinate in fixed point.
+	 * @param	scaleY		The miles per unit of fixed-point longitude at the coordinate.
+	 * @param	fraction	The fraction of the way along the segment to the closest point. This
+	 * 						will be modified.
+	 * @return	The squared distance (in square miles) to the closest point.
+	 */
+	float project(unsigned int segment, int px, int py, float scaleY, float &fraction) const;
+
+	/**
+	 * Find the closest segment to a coordinate by a depth-first branch-and-bound search.
+	 * @param	px			The x coordinate in fixed point.
+	 * @param	py			The y coordinate in fixed point.
+	 * @param	hint		A segment which bounds the search, e.g., the closest segment of a
+	 * 						nearby coordinate, or INVALID_INDEX for none.
+	 * @param	result		The closest point. This will be modified.
+	 * @return	The position of the closest segment, or INVALID_INDEX if there are none.
+	 */
+	unsigned int search_nearest(int px, int py, unsigned int hint, LOSMEdgeProjection &result) const;
+
+	/**
+	 * Find the closest segments to a coordinate by a best-first search.
+	 * @param	px		The x coordinate in fixed point.
+	 * @param	py		The y coordinate in fixed point.
+	 * @param	k		The number of segments.
+	 * @param	queue	The queue of the search, kept between calls to save allocations. This
+	 * 					will be modified.
+	 * @param	result	The closest points, appended nearest first. This will be modified.
+	 */
+	void search_k_nearest(int px, int py, unsigned int k, std::vector<QueueEntry> &queue,
+			std::vector<LOSMEdgeProjection> &result) const;
+
+	/**
+	 * Fill in the projection of a coordinate onto a segment.
+	 * @param	segment		The position of the segment.
+	 * @param	fraction	The fraction of the way along the segment to the closest point.
+	 * @param	distanceSq	The squared distance (in square miles) to the closest point.
+	 * @param	result		The closest point. This will be modified.
+	 */
+	void fill_projection(unsigned int segment, float fraction, float distanceSq, LOSMEdgeProjection &result) const;
+
+	/**
+	 * Compute the miles per unit of fixed-point longitude at a latitude.
+	 * @param	px	The x coordinate (latitude) in fixed point.
+	 * @return	The miles per unit of fixed-point longitude.
+	 */
+	float get_scale_y(int px) const;
+
+	/**
+	 * The graph whose edges are indexed.
+	 */
+	std::shared_ptr<const LOSMGraph> graph;
+
+	/**
+	 * The nodes of the tree, level by level from the leaves, with the root last.
+	 */
+	std::vector<Box> nodes;
+
+	/**
+	 * The number of leaf nodes, which come first in nodes.
+	 */
+	unsigned int numLeaves;
+
+	/**
+	 * The edge of each segment, in the order of the tree.
+	 */
+	std::vector<unsigned int> segmentEdges;
+
+	/**
+	 * The endpoints of each segment in fixed point, i.e., x1, y1, x2, and y2, in the order of
+	 * the tree, so the leaves are scanned without touching the graph.
+	 */
+	std::vector<int> segmentCoordinates;
+
+	/**
+	 * The miles per unit of fixed-point latitude.
+	 */
+	float scaleX;
+
+};
+
+
+#endif // LOSM_EDGE_INDEX_H
@@ -0,0 +1,586 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef LOSM_GRAPH_H
+#define LOSM_GRAPH_H
+
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <utility>
+#include <ostream>
+
+#include "losm.h"
+#include "losm_memory.h"
+
+/**
+ * The cost used to weight each edge when searching a LOSMGraph.
+ */
+enum class LOSMCost {
+	DISTANCE,		// The edge's distance (in miles).
+	TRAVEL_TIME		// The edge's distance divided by its speed limit (in hours).
+};
+
+/**
+ * The approximate memory (in bytes) used by the parts of a graph representation.
+ */
+struct LOSMMemoryUsage {
+	/**
+	 * The adjacency structure, i.e., offsets, neighbors, and the edge of each neighbor.
+	 */
+	size_t adjacency;
+
+	/**
+	 * The per-edge attributes used when searching, such as distances and speed limits.
+	 */
+	size_t edgeAttributes;
+
+	/**
+	 * The per-node and per-landmark coordinates.
+	 */
+	size_t coordinates;
+
+	/**
+	 * The unique identifiers, and the table mapping them to indices.
+	 */
+	size_t indices;
+
+	/**
+	 * The spatial indexes used to find nearest nodes and landmarks.
+	 */
+	size_t spatialIndex;
+
+	/**
+	 * The LOSMNode, LOSMEdge, and LOSMLandmark objects which the representation requires.
+	 */
+	size_t objects;
+};
+
+/**
+ * An immutable snapshot of a LOSM object, stored as flat arrays for fast graph queries. Nodes
+ * and edges are identified by their index in LOSM::get_nodes() and LOSM::get_edges(), and the
+ * adjacency is a compressed sparse row structure over these indices.
+ *
+ * Nothing is modified after construction, so any number of threads may query the same
+ * LOSMGraph concurrently without synchronization. Per-query scratch memory lives in a
+ * LOSMQueryContext instead, one for each thread.
+ */
+class LOSMGraph {
+public:
+	/**
+	 * The index returned when a node or edge does not exist.
+	 */
+	static const unsigned int INVALID_INDEX = 0xFFFFFFFF;
+
+	/**
+	 * The speed limit (in miles per hour) assumed for edges with a speed limit of zero.
+	 */
+	static const unsigned int DEFAULT_SPEED_LIMIT = 25;
+
+	/**
+	 * The constructor for the LOSMGraph class, which builds the snapshot of the LOSM object
+	 * provided. The LOSM object is kept alive by the snapshot and must not be loaded again.
+	 * @param	losm			The LOSM object, which must have been loaded.
+	 * @param	options			Where and how to allocate the arrays, e.g., on huge pages.
+	 * @throw	LOSMException	The LOSM object was null or inconsistent.
+	 */
+	LOSMGraph(std::shared_ptr<const LOSM> losm, const LOSMStorageOptions &options = LOSMStorageOptions());
+
+	/**
+	 * A constructor for the LOSMGraph class which restores the snapshot of the LOSM object
+	 * provided from the indexes written by save(). Nothing is built or copied: the arrays view
+	 * the saved indexes in place, and the snapshot keeps the memory holding them alive.
+	 * @param	losm			The LOSM object, which must have been loaded from the same files as
+	 * 							the one the indexes were saved from.
+	 * @param	memory			The memory holding the saved indexes, e.g., a mapped file.
+	 * @param	data			The saved indexes within the memory, aligned to eight bytes.
+	 * @param	size			The number of bytes of data.
+	 * @throw	LOSMException	The LOSM object was null, or the data was invalid or did not match it.
+	 */
+	LOSMGraph(std::shared_ptr<const LOSM> losm, std::shared_ptr<const void> memory, const char *data, size_t size);
+
+	/**
+	 * A constructor for the LOSMGraph class which copies another snapshot into arrays allocated
+	 * differently, e.g., a replica on another NUMA node. The copy shares the LOSM object.
+	 * @param	graph	The snapshot to copy.
+	 * @param	options	Where and how to allocate the arrays.
+	 */
+	LOSMGraph(const LOSMGraph &graph, const LOSMStorageOptions &options);
+
+	/**
+	 * Snapshots are only copied with the options of the copy, since their arrays may view another's.
+	 */
+	LOSMGraph(const LOSMGraph &graph) = delete;
+
+	/**
+	 * Snapshots are immutable, so they are never assigned.
+	 */
+	LOSMGraph &operator=(const LOSMGraph &graph) = delete;
+
+	/**
+	 * The default deconstructor for the LOSMGraph class.
+	 */
+	virtual ~LOSMGraph();
+
+	/**
+	 * Get where and how the arrays were allocated.
+	 * @return	The options the arrays were allocated with.
+	 */
+	const LOSMStorageOptions &get_storage_options() const;
+
+	/**
+	 * Get the LOSM object this snapshot was built from.
+	 * @return	The LOSM object.
+	 */
+	std::shared_ptr<const LOSM> get_losm() const;
+
+	/**
+	 * Get the number of nodes.
+	 * @return	The number of nodes.
+	 */
+	unsigned int get_num_nodes() const;
+
+	/**
+	 * Get the number of edges.
+	 * @return	The number of edges.
+	 */
+	unsigned int get_num_edges() const;
+
+	/**
+	 * Get a node by its index.
+	 * @param	index	The index of the node.
+	 * @return	The node.
+	 */
+	const LOSMNode *get_node(unsigned int index) const;
+
+	/**
+	 * Get an edge by its index.
+	 * @param	index	The index of the edge.
+	 * @return	The edge.
+	 */
+	const LOSMEdge *get_edge(unsigned int index) const;
+
+	/**
+	 * Get the index of a node, found by its unique identifier.
+	 * @param	node			The node in question.
+	 * @return	The index of the node.
+	 * @throw	LOSMException	The node does not belong to this graph, or an earlier node has its unique identifier.
+	 */
+	unsigned int get_node_index(const LOSMNode *node) const;
+
+	/**
+	 * Get the index of a node given its unique identifier.
+	 * @param	uid		The unique identifier of the node.
+	 * @return	The index of the node, or INVALID_INDEX if no node has this unique identifier.
+	 */
+	unsigned int find_node_index(unsigned long uid) const;
+
+	/**
+	 * Get the first adjacency slot of a node. The slots of a node are the contiguous range
+	 * [get_adjacency_begin(node), get_adjacency_end(node)).
+	 * @param	node	The index of the node.
+	 * @return	The first adjacency slot of the node.
+	 */
+	unsigned int get_adjacency_begin(unsigned int node) const;
+
+	/**
+	 * Get one past the last adjacency slot of a node.
+	 * @param	node	The index of the node.
+	 * @return	One past the last adjacency slot of the node.
+	 */
+	unsigned int get_adjacency_end(unsigned int node) const;
+
+	/**
+	 * Get the index of the neighboring node stored in an adjacency slot.
+	 * @param	slot	The adjacency slot.
+	 * @return	The index of the neighboring node.
+	 */
+	unsigned int get_adjacent_node(unsigned int slot) const;
+
+	/**
+	 * Get the index of the edge stored in an adjacency slot.
+	 * @param	slot	The adjacency slot.
+	 * @return	The index of the edge connecting the node to its neighbor.
+	 */
+	unsigned int get_adjacent_edge(unsigned int slot) const;
+
+	/**
+	 * Get the cost of an edge.
+	 * @param	edge	The index of the edge.
+	 * @param	cost	The type of cost.
+	 * @return	The cost of the edge.
+	 */
+	float get_edge_cost(unsigned int edge, LOSMCost cost) const;
+
+	/**
+	 * Get the x coordinate (latitude) of every node in fixed point, as one contiguous array.
+	 * @return	The array of latitudes in fixed point, indexed by node.
+	 */
+	const int *get_fixed_x_array() const;
+
+	/**
+	 * Get the y coordinate (longitude) of every node in fixed point, as one contiguous array.
+	 * @return	The array of longitudes in fixed point, indexed by node.
+	 */
+	const int *get_fixed_y_array() const;
+
+	/**
+	 * Get the unique identifier of every node, as a contiguous array indexed by node.
+	 * @return	The array of unique identifiers.
+	 */
+	const unsigned long *get_uid_array() const;
+
+	/**
+	 * Get the indices of the first and second node of every edge, as a contiguous array in
+	 * which edge i occupies positions 2 * i and 2 * i + 1.
+	 * @return	The array of edge endpoints.
+	 */
+	const unsigned int *get_edge_nodes_array() const;
+
+	/**
+	 * Get the distance (in miles) of every edge, as a contiguous array indexed by edge.
+	 * @return	The array of edge distances.
+	 */
+	const float *get_edge_distances_array() const;
+
+	/**
+	 * Get the travel time (in hours) of every edge, as a contiguous array indexed by edge.
+	 * @return	The array of edge travel times.
+	 */
+	const float *get_edge_travel_times_array() const;
+
+	/**
+	 * Get the speed limit of every edge, as a contiguous array indexed by edge.
+	 * @return	The array of speed limits.
+	 */
+	const unsigned int *get_speed_limit_array() const;
+
+	/**
+	 * Get the number of lanes of every edge, as a contiguous array indexed by edge.
+	 * @return	The array of lanes.
+	 */
+	const unsigned int *get_lanes_array() const;
+
+	/**
+	 * Get the first adjacency slot of every node, followed by the total number of slots, as a
+	 * contiguous array.
+	 * @return	The array of adjacency offsets.
+	 */
+	const unsigned int *get_adjacency_offsets_array() const;
+
+	/**
+	 * Get the neighboring node of every adjacency slot, as a contiguous array.
+	 * @return	The array of adjacent nodes.
+	 */
+	const unsigned int *get_adjacent_nodes_array() const;
+
+	/**
+	 * Get the edge of every adjacency slot, as a contiguous array.
+	 * @return	The array of adjacent edges.
+	 */
+	const unsigned int *get_adjacent_edges_array() const;
+
+	/**
+	 * Recompute the distance of every edge from the coordinates of its nodes, using the
+	 * Haversine formula like the Python converter.
+	 * @param	result	The distance (in miles) of each edge. This will be modified.
+	 */
+	void compute_edge_distances(std::vector<float> &result) const;
+
+	/**
+	 * Compute the Haversine distance from one node to every node, e.g., as a heuristic towards
+	 * a target node.
+	 * @param	node	The index of the node.
+	 * @param	result	The distance (in miles) to each node. This will be modified.
+	 */
+	void compute_node_distances(unsigned int node, std::vector<float> &result) const;
+
+	/**
+	 * Find the node which is nearest to the coordinate provided. The nearest few candidates are
+	 * found with the equirectangular projection, then refined by their Haversine distance.
+	 * @param	x	The x coordinate (latitude).
+	 * @param	y	The y coordinate (longitude).
+	 * @return	The index of the nearest node, or INVALID_INDEX if there are no nodes.
+	 */
+	unsigned int find_nearest_node(float x, float y) const;
+
+	/**
+	 * Find the nodes within a box, in time proportional to the number found.
+	 * @param	minX	The minimum x coordinate (latitude).
+	 * @param	minY	The minimum y coordinate (longitude).
+	 * @param	maxX	The maximum x coordinate (latitude).
+	 * @param	maxY	The maximum y coordinate (longitude).
+	 * @param	result	The indices of the nodes within the box, in no particular order. This
+	 * 					will be modified.
+	 */
+	void find_nodes_in_box(float minX, float minY, float maxX, float maxY, std::vector<unsigned int> &result) const;
+
+	/**
+	 * Find the landmarks within a box, in time proportional to the number found.
+	 * @param	minX	The minimum x coordinate (latitude).
+	 * @param	minY	The minimum y coordinate (longitude).
+	 * @param	maxX	The maximum x coordinate (latitude).
+	 * @param	maxY	The maximum y coordinate (longitude).
+	 * @param	result	The indices in LOSM::get_landmarks() of the landmarks within the box, in
+	 * 					no particular order. This will be modified.
+	 */
+	void find_landmarks_in_box(float minX, float minY, float maxX, float maxY, std::vector<unsigned int> &result) const;
+
+	/**
+	 * Estimate the memory used by this snapshot, including the LOSM object it keeps alive.
+	 * @return	The memory used by each part of the snapshot.
+	 */
+	LOSMMemoryUsage get_memory_usage() const;
+
+	/**
+	 * Write the indexes of this snapshot in binary, in the native byte order, so that they may be
+	 * restored for the same LOSM object without building them again. Each array is padded to eight
+	 * bytes, so that all are aligned if the stream's position is.
+	 * @param	stream	The stream to write the indexes to.
+	 */
+	void save(std::ostream &stream) const;
+
+private:
+	/**
+	 * The arrays of a snapshot which was built or copied, rather than restored in place. Each is
+	 * viewed by the LOSMGraph member of the same name.
+	 */
+	struct Storage {
+		LOSMArray<unsigned int> adjacencyOffsets;
+		LOSMArray<unsigned int> adjacencyNodes;
+		LOSMArray<unsigned int> adjacencyEdges;
+		LOSMArray<float> edgeDistances;
+		LOSMArray<float> edgeTravelTimes;
+		LOSMArray<int> fixedX;
+		LOSMArray<int> fixedY;
+		LOSMArray<unsigned long> uids;
+		LOSMArray<unsigned int> edgeNodes;
+		LOSMArray<unsigned int> edgeSpeedLimits;
+		LOSMArray<unsigned int> edgeLanes;
+		LOSMArray<unsigned int> kdTree;
+		LOSMArray<unsigned long> uidTableKeys;
+		LOSMArray<unsigned int> uidTableNodes;
+		LOSMArray<int> landmarkFixedX;
+		LOSMArray<int> landmarkFixedY;
+		LOSMArray<unsigned int> landmarkKdTree;
+	};
+
+	/**
+	 * Replace every array of the storage with an empty one which allocates with the options given.
+	 * @param	options	Where and how to allocate the arrays.
+	 */
+	void set_storage(const LOSMStorageOptions &options);
+
+	/**
+	 * Point every array at the one of the same name in the storage, once the storage is filled in.
+	 */
+	void view_storage();
+
+	/**
+	 * Copy the unique identifiers, endpoints, speed limits, and lanes out of the LOSM object
+	 * into the storage, and build the table of unique identifiers.
+	 * @param	nodeIndices		A mapping from each node to its index.
+	 */
+	void copy_attributes(const std::unordered_map<const LOSMNode *, unsigned int> &nodeIndices);
+
+	/**
+	 * Recursively build a k-d tree over the points within [first, last) of the tree.
+	 * @param	tree	The indices of the points, which will be ordered as the k-d tree.
+	 * @param	x		The x coordinate of each point in fixed point.
+	 * @param	y		The y coordinate of each point in fixed point.
+	 * @param	first	The first position in the tree.
+	 * @param	last	One past the last position in the tree.
+	 * @param	depth	The depth of the subtree; even depths split on x, odd on y.
+	 */
+	static void build_kd_tree(LOSMArray<unsigned int> &tree, const LOSMArray<int> &x, const LOSMArray<int> &y,
+			unsigned int first, unsigned int last, unsigned int depth);
+
+	/**
+	 * Recursively search the k-d tree for the nearest nodes to a point in fixed point.
+	 * @param	first		The first position in kdTree.
+	 * @param	last		One past the last position in kdTree.
+	 * @param	depth		The depth of the subtree.
+	 * @param	px			The x coordinate of the point in fixed point.
+	 * @param	py			The y coordinate of the point in fixed point.
+	 * @param	candidates	The max-heap of the nearest (squared projected distance, node index)
+	 * 						pairs found so far, of at most NUM_NEAREST_CANDIDATES elements.
+	 * 						This will be modified.
+	 */
+	void search_kd_tree(unsigned int first, unsigned int last, unsigned int depth,
+			int px, int py, std::vector<std::pair<float, unsigned int> > &candidates) const;
+
+	/**
+	 * Recursively search a k-d tree for the points within a box in fixed point.
+	 * @param	tree	The indices of the points, ordered as the k-d tree.
+	 * @param	x		The x coordinate of each point in fixed point.
+	 * @param	y		The y coordinate of each point in fixed point.
+	 * @param	first	The first position in the tree.
+	 * @param	last	One past the last position in the tree.
+	 * @param	depth	The depth of the subtree.
+	 * @param	minX	The minimum x coordinate in fixed point.
+	 * @param	minY	The minimum y coordinate in fixed point.
+	 * @param	maxX	The maximum x coordinate in fixed point.
+	 * @param	maxY	The maximum y coordinate in fixed point.
+	 * @param	result	The indices of the points found so far. This will be modified.
+	 */
+	static void search_kd_tree_box(const LOSMSpan<unsigned int> &tree, const LOSMSpan<int> &x,
+			const LOSMSpan<int> &y, unsigned int first, unsigned int last, unsigned int depth,
+			int minX, int minY, int maxX, int maxY, std::vector<unsigned int> &result);
+
+	/**
+	 * The number of candidates find_nearest_node() refines by their Haversine distance.
+	 */
+	static const unsigned int NUM_NEAREST_CANDIDATES = 8;
+
+	/**
+	 * The identifying bytes at the start of the saved indexes, including the format version.
+	 */
+	static const char SAVED_MAGIC[8];
+
+	/**
+	 * The slot of the table of unique identifiers at which to start looking for one.
+	 * @param	uid		The unique identifier.
+	 * @param	mask	The number of slots in the table minus one.
+	 * @return	The first slot to probe.
+	 */
+	static size_t hash_uid(unsigned long uid, size_t mask);
+
+	/**
+	 * The LOSM object this snapshot was built from.
+	 */
+	std::shared_ptr<const LOSM> losm;
+
+	/**
+	 * Where and how the arrays were allocated.
+	 */
+	LOSMStorageOptions options;
+
+	/**
+	 * The arrays, unless they were restored in place.
+	 */
+	Storage storage;
+
+	/**
+	 * The memory holding the arrays if they were restored in place, e.g., a mapped file, and
+	 * null otherwise.
+	 */
+	std::shared_ptr<const void> memory;
+
+	/**
+	 * The first adjacency slot of each node, followed by the total number of slots.
+	 */
+	LOSMSpan<unsigned int> adjacencyOffsets;
+
+	/**
+	 * The neighboring node of each adjacency slot.
+	 */
+	LOSMSpan<unsigned int> adjacencyNodes;
+
+	/**
+	 * The edge of each adjacency slot.
+	 */
+	LOSMSpan<unsigned int> adjacencyEdges;
+
+	/**
+	 * The distance (in miles) of each edge.
+	 */
+	LOSMSpan<float> edgeDistances;
+
+	/**
+	 * The travel time (in hours) of each edge.
+	 */
+	LOSMSpan<float> edgeTravelTimes;
+
+	/**
+	 * The x coordinate (latitude) of each node in fixed point.
+	 */
+	LOSMSpan<int> fixedX;
+
+	/**
+	 * The y coordinate (longitude) of each node in fixed point.
+	 */
+	LOSMSpan<int> fixedY;
+
+	/**
+	 * The unique identifier of each node.
+	 */
+	LOSMSpan<unsigned long> uids;
+
+	/**
+	 * The indices of the first and second node of each edge, interleaved.
+	 */
+	LOSMSpan<unsigned int> edgeNodes;
+
+	/**
+	 * The speed limit of each edge, as loaded.
+	 */
+	LOSMSpan<unsigned int> edgeSpeedLimits;
+
+	/**
+	 * The number of lanes of each edge.
+	 */
+	LOSMSpan<unsigned int> edgeLanes;
+
+	/**
+	 * The cosine of the mean latitude, which scales longitudes so that the Euclidean distance
+	 * of fixed-point coordinates approximates the true distance.
+	 */
+	float projectionScale;
+
+	/**
+	 * The node indices ordered as an implicit k-d tree, in which the median of every range
+	 * is the splitting node of that range.
+	 */
+	LOSMSpan<unsigned int> kdTree;
+
+	/**
+	 * The unique identifier in each slot of an open-addressing hash table with linear probing,
+	 * whose number of slots is a power of two and at least twice the number of nodes.
+	 */
+	LOSMSpan<unsigned long> uidTableKeys;
+
+	/**
+	 * The index of the node whose unique identifier is in each slot of the table, or
+	 * INVALID_INDEX for an empty slot.
+	 */
+	LOSMSpan<unsigned int> uidTableNodes;
+
+	/**
+	 * The x and y coordinates of each landmark in fixed point, in the order of
+	 * LOSM::get_landmarks().
+	 */
+	LOSMSpan<int> landmarkFixedX;
+	LOSMSpan<int> landmarkFixedY;
+
+	/**
+	 * The landmark indices ordered as an implicit k-d tree, like kdTree.
+	 */
+	LOSMSpan<unsigned int> landmarkKdTree;
+
+};
+
+
+#endif // LOSM_GRAPH_H
@@ -0,0 +1,101 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef LOSM_GRAPH_REPLICAS_H
+#define LOSM_GRAPH_REPLICAS_H
+
+
+#include <memory>
+#include <vector>
+
+#include "losm_graph.h"
+#include "losm_memory.h"
+
+/**
+ * Copies of a LOSMGraph, one on each NUMA node with memory, so that every querying thread can
+ * walk a graph in local memory. A thread should take the replica of the node it runs on when it
+ * creates its LOSMQueryContext, and is best pinned to that node; otherwise, it is only as local as
+ * the scheduler keeps it. On a machine with a single NUMA node, the graph itself is the only
+ * replica.
+ *
+ * The replicas share the LOSM object, so only the flat arrays which queries walk are replicated.
+ */
+class LOSMGraphReplicas {
+public:
+	/**
+	 * The constructor for the LOSMGraphReplicas class, which copies the graph to every NUMA node
+	 * with memory, as given by get_numa_nodes().
+	 * @param	graph			The graph to replicate.
+	 * @param	pages			The pages backing each replica.
+	 * @throw	LOSMException	The graph was null.
+	 */
+	LOSMGraphReplicas(std::shared_ptr<const LOSMGraph> graph, LOSMPageMode pages = LOSMPageMode::DEFAULT);
+
+	/**
+	 * The default deconstructor for the LOSMGraphReplicas class.
+	 */
+	virtual ~LOSMGraphReplicas();
+
+	/**
+	 * Get the number of replicas, i.e., the number of NUMA nodes with memory.
+	 * @return	The number of replicas.
+	 */
+	unsigned int get_num_replicas() const;
+
+	/**
+	 * Get the NUMA nodes which have a replica. These need not be numbered contiguously.
+	 * @return	The NUMA node of each replica.
+	 */
+	const std::vector<unsigned int> &get_numa_nodes() const;
+
+	/**
+	 * Get the replica on a NUMA node.
+	 * @param	numaNode		The NUMA node.
+	 * @throw	LOSMException	The NUMA node has no replica, e.g., it has no memory.
+	 * @return	The replica.
+	 */
+	std::shared_ptr<const LOSMGraph> get_replica(unsigned int numaNode) const;
+
+	/**
+	 * Get the replica on the NUMA node the calling thread is running on, or the first replica if
+	 * that node has none.
+	 * @return	The replica.
+	 */
+	std::shared_ptr<const LOSMGraph> get_local_replica() const;
+
+private:
+	/**
+	 * The NUMA node of each replica.
+	 */
+	std::vector<unsigned int> numaNodes;
+
+	/**
+	 * The replica on each NUMA node.
+	 */
+	std::vector<std::shared_ptr<const LOSMGraph> > replicas;
+
+};
+
+
+#endif // LOSM_GRAPH_REPLICAS_H
@@ -0,0 +1,208 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef LOSM_HUB_LABELS_H
+#define LOSM_HUB_LABELS_H
+
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include "losm_graph.h"
+
+/**
+ * A hub labeling (2-hop labeling) of a LOSMGraph, which answers the cost of the cheapest route
+ * between any two nodes by merging two short sorted arrays, without searching the graph.
+ *
+ * Every node has a label of (hub, cost) pairs such that for any two nodes, some hub on a
+ * cheapest route between them is in both labels; the cost of the route is then the minimum over
+ * their common hubs of the sum of the costs. The labels are built by pruned landmark labeling:
+ * nodes are ranked by how many sampled shortest paths pass through them, and a pruned Dijkstra
+ * from each node in rank order adds it as a hub only where no higher-ranked hub already covers
+ * the route. Costs are sums of single-precision edge costs, so they agree with Dijkstra's
+ * algorithm up to rounding.
+ *
+ * Hubs are numbered by rank, and each label is stored as an array of hubs and a parallel array
+ * of costs, both starting on a 64-byte boundary and terminated by LOSMGraph::INVALID_INDEX, so
+ * the merge runs without bounds checks over contiguous memory. The saved file is exactly the
+ * in-memory layout, so it is memory-mapped rather than read. Nothing is modified after
+ * construction, so any number of threads may query the same LOSMHubLabels concurrently.
+ */
+class LOSMHubLabels {
+public:
+	/**
+	 * The constructor for the LOSMHubLabels class, which labels a graph.
+	 * @param	graph	The graph to label.
+	 * @param	cost	The type of cost.
+	 */
+	LOSMHubLabels(const LOSMGraph &graph, LOSMCost cost);
+
+	/**
+	 * The constructor for the LOSMHubLabels class, which memory-maps labels saved by save().
+	 * @param	filename		The name of the file.
+	 * @throw	LOSMException	The file could not be mapped, or was not valid.
+	 */
+	LOSMHubLabels(std::string filename);
+
+	/**
+	 * The deconstructor for the LOSMHubLabels class, which unmaps the file, if any.
+	 */
+	virtual ~LOSMHubLabels();
+
+	/**
+	 * Get the number of nodes.
+	 * @return	The number of nodes.
+	 */
+	unsigned int get_num_nodes() const;
+
+	/**
+	 * Get the type of cost.
+	 * @return	The type of cost.
+	 */
+	LOSMCost get_cost() const;
+
+	/**
+	 * Get the total number of (hub, cost) pairs over all labels, excluding padding.
+	 * @return	The number of pairs.
+	 */
+	unsigned long long get_num_pairs() const;
+
+	/**
+	 * Get the memory used by the labels (in bytes), including padding.
+	 * @return	The memory used by the labels.
+	 */
+	size_t get_memory_usage() const;
+
+	/**
+	 * Find the cost of the cheapest route between two nodes.
+	 * @param	source	The index of the source node.
+	 * @param	target	The index of the target node.
+	 * @return	The cost of the cheapest route, or infinity if the target is unreachable.
+	 */
+	float find_distance(unsigned int source, unsigned int target) const;
+
+	/**
+	 * Find the cost of the cheapest route for each pair of nodes, such that result[i] is the cost
+	 * from sources[i] to targets[i]. The labels of upcoming pairs are prefetched while the
+	 * current pair is merged.
+	 * @param	count		The number of pairs.
+	 * @param	sources		The indices of the source nodes.
+	 * @param	targets		The indices of the target nodes.
+	 * @param	result		The resultant costs. This will be modified.
+	 */
+	void find_distances(unsigned int count, const unsigned int *sources, const unsigned int *targets,
+			float *result) const;
+
+	/**
+	 * Find the cost of the cheapest route from one node to each of many nodes.
+	 * @param	source		The index of the source node.
+	 * @param	count		The number of targets.
+	 * @param	targets		The indices of the target nodes.
+	 * @param	result		The resultant costs. This will be modified.
+	 */
+	void find_distances(unsigned int source, unsigned int count, const unsigned int *targets,
+			float *result) const;
+
+	/**
+	 * Write the labels to a file, which the filename constructor maps.
+	 * @param	filename		The name of the file.
+	 * @throw	LOSMException	The file could not be written.
+	 */
+	void save(std::string filename) const;
+
+private:
+	/**
+	 * The number of sampled shortest path trees used to rank the nodes.
+	 */
+	static const unsigned int NUM_RANKING_SAMPLES = 64;
+
+	/**
+	 * The alignment (in bytes) of every label and array.
+	 */
+	static const unsigned int ALIGNMENT = 64;
+
+	/**
+	 * The magic number at the start of a saved file.
+	 */
+	static const char SAVED_MAGIC[8];
+
+	/**
+	 * Rank the nodes by the number of sampled shortest paths which pass through them.
+	 * @param	graph	The graph.
+	 * @param	order	The nodes, from the highest rank to the lowest. This will be modified.
+	 */
+	void rank_nodes(const LOSMGraph &graph, std::vector<unsigned int> &order) const;
+
+	/**
+	 * Point the arrays into an image of the saved layout, checking its header, its alignment, and
+	 * that every label is aligned, sorted, and terminated.
+	 * @param	data	The image.
+	 * @param	size	The size of the image (in bytes).
+	 * @return	True if the image was valid, false otherwise.
+	 */
+	bool attach(const char *data, size_t size);
+
+	/**
+	 * The number of nodes, and the type of cost.
+	 */
+	unsigned int numNodes;
+	LOSMCost cost;
+
+	/**
+	 * The number of (hub, cost) pairs, excluding padding.
+	 */
+	unsigned long long numPairs;
+
+	/**
+	 * The first slot of each node's label, followed by the total number of slots.
+	 */
+	const uint64_t *offsets;
+
+	/**
+	 * The hub (as a rank) and cost of each slot.
+	 */
+	const uint32_t *hubs;
+	const float *costs;
+
+	/**
+	 * The image of the saved layout, either owned or memory-mapped.
+	 */
+	const char *image;
+	size_t imageSize;
+
+	/**
+	 * The owned image, over-allocated so that it can be aligned.
+	 */
+	std::vector<char> buffer;
+
+	/**
+	 * The memory-mapped image, or null.
+	 */
+	void *mapping;
+
+};
+
+
+#endif // LOSM_HUB_LABELS_H
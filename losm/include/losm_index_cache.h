@@ -0,0 +1,201 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef LOSM_INDEX_CACHE_H
+#define LOSM_INDEX_CACHE_H
+
+
+#include <string>
+#include <memory>
+#include <ostream>
+
+#include "losm.h"
+#include "losm_graph.h"
+
+/**
+ * The fingerprint of an input file, used to decide if indexes derived from it are still valid.
+ * Its metadata catches a file which was replaced or visibly rewritten without comparing the
+ * contents; the hash of the contents catches one rewritten in place with the same size and a
+ * coarse or preserved modification time, e.g., by "cp -p" or rsync.
+ */
+struct LOSMFileFingerprint {
+	/**
+	 * The size of the file (in bytes).
+	 */
+	unsigned long long size;
+
+	/**
+	 * The time the file was last modified (in nanoseconds since the epoch).
+	 */
+	long long modified;
+
+	/**
+	 * The device containing the file.
+	 */
+	unsigned long long device;
+
+	/**
+	 * The inode of the file.
+	 */
+	unsigned long long inode;
+
+	/**
+	 * A 64-bit hash of the whole contents of the file.
+	 */
+	unsigned long long contents;
+};
+
+/**
+ * A directory of LOSM objects and their graphs' indexes, so that processes loading the same
+ * files do not have to parse them or build the indexes again. Each cache file is named after a
+ * hash of the fingerprints of the nodes, edges, and landmarks files, and begins with the
+ * fingerprints themselves, which are compared in full before it is used. Then follow the nodes,
+ * edges, and landmarks in binary, and the graph's indexes, which a restored graph views in the
+ * mapped cache file instead of copying. A cache file which is missing, stale, or corrupt is
+ * simply rebuilt.
+ *
+ * Cache files are written to a temporary file and renamed into place, so processes may share
+ * the same directory, and a mapped cache file is never modified.
+ */
+class LOSMIndexCache {
+public:
+	/**
+	 * The constructor for the LOSMIndexCache class, which creates the directory if needed.
+	 * @param	directory		The cache directory.
+	 * @throw	LOSMException	The directory could not be created.
+	 */
+	LOSMIndexCache(std::string directory);
+
+	/**
+	 * The default deconstructor for the LOSMIndexCache class.
+	 */
+	virtual ~LOSMIndexCache();
+
+	/**
+	 * Get the cache directory.
+	 * @return	The cache directory.
+	 */
+	std::string get_directory() const;
+
+	/**
+	 * Load the LOSM files and their graph. If they are in the cache, the files are not read: the
+	 * LOSM object is restored from the cache, and the graph views its indexes in place. Otherwise,
+	 * the files are loaded and saved to the cache.
+	 * @param	nodesFilename		The name of the file containing the nodes.
+	 * @param	edgesFilename		The name of the file containing the edges.
+	 * @param	landmarksFilename	The name of the file containing the landmarks.
+	 * @return	The graph, which keeps the loaded LOSM object alive.
+	 * @throw	LOSMException		The files could not be loaded.
+	 */
+	std::shared_ptr<const LOSMGraph> load(std::string nodesFilename, std::string edgesFilename,
+			std::string landmarksFilename) const;
+
+	/**
+	 * Get the graph of a LOSM object, restoring its indexes from the cache if they are there,
+	 * and saving them to the cache otherwise.
+	 * @param	losm				The LOSM object, which must have been loaded from the files.
+	 * @param	nodesFilename		The name of the file containing the nodes.
+	 * @param	edgesFilename		The name of the file containing the edges.
+	 * @param	landmarksFilename	The name of the file containing the landmarks.
+	 * @return	The graph of the LOSM object.
+	 * @throw	LOSMException		The LOSM object was null or a file could not be read.
+	 */
+	std::shared_ptr<const LOSMGraph> load_graph(std::shared_ptr<const LOSM> losm, std::string nodesFilename,
+			std::string edgesFilename, std::string landmarksFilename) const;
+
+	/**
+	 * Compute the fingerprint of a file from its metadata and a hash of its contents.
+	 * @param	filename		The name of the file.
+	 * @return	The fingerprint of the file.
+	 * @throw	LOSMException	The file could not be read.
+	 */
+	static LOSMFileFingerprint compute_fingerprint(std::string filename);
+
+private:
+	/**
+	 * Build the graph of a LOSM object, and save both to the cache.
+	 * @param	losm			The LOSM object.
+	 * @param	fingerprints	The fingerprints of the nodes, edges, and landmarks files.
+	 * @param	filename		The name of the cache file.
+	 * @return	The graph of the LOSM object.
+	 */
+	std::shared_ptr<const LOSMGraph> build_graph(std::shared_ptr<const LOSM> losm,
+			const LOSMFileFingerprint fingerprints[3], std::string filename) const;
+
+	/**
+	 * Attempt to restore a graph from a cache file, which remains mapped while the graph lives.
+	 * @param	losm			The LOSM object, or null to restore it from the cache file as well.
+	 * @param	fingerprints	The fingerprints of the nodes, edges, and landmarks files.
+	 * @param	filename		The name of the cache file.
+	 * @return	The graph, or null if the cache file was missing, stale, or corrupt.
+	 */
+	std::shared_ptr<const LOSMGraph> restore_graph(std::shared_ptr<const LOSM> losm,
+			const LOSMFileFingerprint fingerprints[3], std::string filename) const;
+
+	/**
+	 * Attempt to save a graph and its LOSM object to a cache file.
+	 * @param	graph			The graph.
+	 * @param	fingerprints	The fingerprints of the nodes, edges, and landmarks files.
+	 * @param	filename		The name of the cache file.
+	 * @return	True if the cache file was written, false otherwise.
+	 */
+	bool save_graph(const LOSMGraph &graph, const LOSMFileFingerprint fingerprints[3], std::string filename) const;
+
+	/**
+	 * Restore the nodes, edges, and landmarks of a LOSM object written by save_losm().
+	 * @param	data	The saved LOSM object.
+	 * @param	size	The number of bytes of data.
+	 * @return	The LOSM object, or null if the data was corrupt.
+	 */
+	static std::shared_ptr<const LOSM> restore_losm(const char *data, size_t size);
+
+	/**
+	 * Write the nodes, edges, and landmarks of a graph's LOSM object in binary, in the native byte
+	 * order. Edges refer to their nodes by index.
+	 * @param	graph	The graph.
+	 * @param	stream	The stream to write the LOSM object to.
+	 */
+	static void save_losm(const LOSMGraph &graph, std::ostream &stream);
+
+	/**
+	 * Get the name of the cache file for the fingerprints of a set of files.
+	 * @param	fingerprints	The fingerprints of the nodes, edges, and landmarks files.
+	 * @return	The name of the cache file.
+	 */
+	std::string get_cache_filename(const LOSMFileFingerprint fingerprints[3]) const;
+
+	/**
+	 * The identifying bytes at the start of each cache file, including the format version.
+	 */
+	static const char CACHE_MAGIC[8];
+
+	/**
+	 * The cache directory.
+	 */
+	std::string directory;
+
+};
+
+
+#endif // LOSM_INDEX_CACHE_H
@@ -0,0 +1,304 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef LOSM_INSTRUMENTATION_H
+#define LOSM_INSTRUMENTATION_H
+
+
+#include <ostream>
+#include <cstdint>
+
+/**
+ * The operations which are instrumented.
+ */
+enum class LOSMOperation {
+	GET_NEIGHBORS,				// LOSM::get_neighbors().
+	FIND_NODE_INDEX,			// LOSMGraph::get_node_index() and LOSMGraph::find_node_index().
+	FIND_NEAREST_NODE,			// LOSMGraph::find_nearest_node() and LOSMGraph::find_nodes_in_box().
+	FIND_NEAREST_EDGE,			// LOSMEdgeIndex::find_nearest_edge(), and find_nearest_edges() for one coordinate.
+	SEARCH,						// LOSMQueryContext::search().
+	SEARCH_TIME_DEPENDENT,		// LOSMQueryContext::search_time_dependent().
+	SEARCH_BOUNDED,				// LOSMQueryContext::search_bounded().
+	FIND_LEXICOGRAPHIC_ROUTE,	// LOSMQueryContext::find_lexicographic_route().
+	FIND_K_SHORTEST_ROUTES,		// LOSMQueryContext::find_k_shortest_routes().
+	FIND_ALTERNATIVE_ROUTES		// LOSMQueryContext::find_alternative_routes().
+};
+
+/**
+ * The number of instrumented operations.
+ */
+const unsigned int LOSM_NUM_OPERATIONS = 10;
+
+/**
+ * A histogram of latencies (in nanoseconds) in the style of HdrHistogram. Values below 32 have
+ * a bucket each; above that, every power of two is split into 32 buckets, so a value is known
+ * to within about 3% over the whole range with a fixed, small number of buckets.
+ */
+class LOSMHistogram {
+public:
+	/**
+	 * The default constructor for the LOSMHistogram class, which creates an empty histogram.
+	 */
+	LOSMHistogram();
+
+	/**
+	 * The default deconstructor for the LOSMHistogram class.
+	 */
+	virtual ~LOSMHistogram();
+
+	/**
+	 * Record a value.
+	 * @param	value	The value (in nanoseconds).
+	 */
+	void record(uint64_t value);
+
+	/**
+	 * Add every value of another histogram to this one.
+	 * @param	other	The other histogram.
+	 */
+	void merge(const LOSMHistogram &other);
+
+	/**
+	 * Remove every value.
+	 */
+	void clear();
+
+	/**
+	 * Get the number of values recorded.
+	 * @return	The number of values.
+	 */
+	uint64_t get_count() const;
+
+	/**
+	 * Get the smallest value recorded.
+	 * @return	The smallest value, or zero if there are none.
+	 */
+	uint64_t get_min() const;
+
+	/**
+	 * Get the largest value recorded.
+	 * @return	The largest value, or zero if there are none.
+	 */
+	uint64_t get_max() const;
+
+	/**
+	 * Get the mean of the values recorded.
+	 * @return	The mean, or zero if there are none.
+	 */
+	double get_mean() const;
+
+	/**
+	 * Get a percentile of the values recorded, to within the precision of the buckets.
+	 * @param	percentile	The percentile in [0, 100].
+	 * @return	The largest value equivalent to the percentile, or zero if there are none.
+	 */
+	uint64_t get_percentile(double percentile) const;
+
+	/**
+	 * The number of bits of the sub-buckets of each power of two.
+	 */
+	static const unsigned int SUB_BUCKET_BITS = 5;
+
+	/**
+	 * The number of buckets, which cover values up to 2^48 nanoseconds (about three days);
+	 * larger values go in the last bucket.
+	 */
+	static const unsigned int NUM_BUCKETS = (1 << SUB_BUCKET_BITS) * (48 - SUB_BUCKET_BITS + 1);
+
+	/**
+	 * Get the bucket of a value.
+	 * @param	value	The value.
+	 * @return	The index of the bucket.
+	 */
+	static unsigned int get_bucket(uint64_t value);
+
+	/**
+	 * Get the largest value in a bucket.
+	 * @param	bucket	The index of the bucket.
+	 * @return	The largest value in the bucket.
+	 */
+	static uint64_t get_bucket_max(unsigned int bucket);
+
+private:
+	friend class LOSMInstrumentation;
+
+	/**
+	 * The number of values in each bucket.
+	 */
+	uint64_t counts[NUM_BUCKETS];
+
+	/**
+	 * The number, sum, smallest, and largest of the values.
+	 */
+	uint64_t count;
+	uint64_t total;
+	uint64_t min;
+	uint64_t max;
+
+};
+
+/**
+ * Opt-in instrumentation of the query APIs: a counter and a latency histogram per operation,
+ * and sampled spans which are exported as Chrome trace-event JSON (for chrome://tracing or
+ * Perfetto).
+ *
+ * The library records nothing unless it is compiled with LOSM_INSTRUMENTATION defined, in which
+ * case LOSM_INSTRUMENT() expands to nothing at all; when compiled in, recording still starts
+ * disabled until set_enabled(true). Each thread records into its own histograms with relaxed
+ * atomic stores and no locks, which are merged when read; the data of threads which exit is
+ * folded into a shared total. Reads are exact once the threads are quiescent, and otherwise
+ * may miss operations in progress.
+ */
+class LOSMInstrumentation {
+public:
+	/**
+	 * Check if the library was compiled with instrumentation.
+	 * @return	True if LOSM_INSTRUMENTATION was defined, false otherwise.
+	 */
+	static bool is_compiled();
+
+	/**
+	 * Enable or disable recording. This has no effect unless the library was compiled with
+	 * instrumentation.
+	 * @param	enabled		True to record, false otherwise.
+	 */
+	static void set_enabled(bool enabled);
+
+	/**
+	 * Check if recording is enabled.
+	 * @return	True if recording is enabled, false otherwise.
+	 */
+	static bool is_enabled();
+
+	/**
+	 * Set how often operations are recorded as spans for the trace: every interval-th operation
+	 * of each thread. Spans beyond MAX_SPANS per thread are dropped.
+	 * @param	interval	The sampling interval, or zero to record no spans (the default).
+	 */
+	static void set_sampling_interval(unsigned int interval);
+
+	/**
+	 * Get the name of an operation, as used in the report and the trace.
+	 * @param	operation	The operation.
+	 * @return	The name of the operation.
+	 */
+	static const char *get_operation_name(LOSMOperation operation);
+
+	/**
+	 * Get the latencies of an operation over all threads.
+	 * @param	operation	The operation.
+	 * @param	result		The merged histogram. This will be modified.
+	 */
+	static void get_histogram(LOSMOperation operation, LOSMHistogram &result);
+
+	/**
+	 * Get the number of spans dropped because a thread's buffer was full.
+	 * @return	The number of dropped spans.
+	 */
+	static uint64_t get_num_dropped_spans();
+
+	/**
+	 * Discard every latency and span recorded so far. It is safe while threads are recording: each
+	 * live thread discards its own latencies when it next records, and until then they are not read.
+	 * An operation which finishes during the reset may be counted on either side of it.
+	 */
+	static void reset();
+
+	/**
+	 * Write a table of the count and latency percentiles (in microseconds) of each operation
+	 * which was recorded.
+	 * @param	stream	The stream to write the table to.
+	 */
+	static void report(std::ostream &stream);
+
+	/**
+	 * Write the sampled spans as Chrome trace-event JSON, with one complete ("X") event per span.
+	 * @param	stream	The stream to write the trace to.
+	 */
+	static void write_trace(std::ostream &stream);
+
+	/**
+	 * Get the time (in nanoseconds) since the first call, from a monotonic clock.
+	 * @return	The time (in nanoseconds).
+	 */
+	static uint64_t get_time();
+
+	/**
+	 * Record one operation for the calling thread.
+	 * @param	operation	The operation.
+	 * @param	start		The time at which it started, from get_time().
+	 * @param	duration	Its duration (in nanoseconds).
+	 */
+	static void record(LOSMOperation operation, uint64_t start, uint64_t duration);
+
+	/**
+	 * The maximum number of spans buffered per thread.
+	 */
+	static const unsigned int MAX_SPANS = 1 << 16;
+
+};
+
+/**
+ * A guard which records the time from its construction to its destruction as one operation,
+ * if recording is enabled. Use it through LOSM_INSTRUMENT().
+ */
+class LOSMInstrumentationScope {
+public:
+	/**
+	 * The constructor for the LOSMInstrumentationScope class, which starts timing.
+	 * @param	operation	The operation being timed.
+	 */
+	LOSMInstrumentationScope(LOSMOperation operation);
+
+	/**
+	 * The deconstructor for the LOSMInstrumentationScope class, which records the operation.
+	 */
+	virtual ~LOSMInstrumentationScope();
+
+private:
+	/**
+	 * The operation being timed.
+	 */
+	LOSMOperation operation;
+
+	/**
+	 * If recording was enabled at construction.
+	 */
+	bool active;
+
+	/**
+	 * The time at which the operation started.
+	 */
+	uint64_t start;
+
+};
+
+#ifdef LOSM_INSTRUMENTATION
+#define LOSM_INSTRUMENT(operation) LOSMInstrumentationScope losmInstrumentationScope(operation)
+#else
+#define LOSM_INSTRUMENT(operation)
+#endif
+
+
+#endif // LOSM_INSTRUMENTATION_H
@@ -43,7 +43,7 @@ public:
 	 * @param	y		The y coordinate (longitude).
 	 * @param	name	The name of the landmark.
 	 */
-	LOSMLandmark(unsigned long uid, float x, float y, std::string name);
+	LOSMLandmark(unsigned long uid, double x, double y, std::string name);
 
 	/**
 	 * The default deconstructor for the LOSMLandmark class.
@@ -68,6 +68,18 @@ public:
 	 */
 	float get_y() const;
 
+	/**
+	 * Get the x coordinate (latitude) in fixed-point units of 1e-7 degrees.
+	 * @return	The x-coordinate (latitude) in fixed point.
+	 */
+	int get_fixed_x() const;
+
+	/**
+	 * Get the y coordinate (longitude) in fixed-point units of 1e-7 degrees.
+	 * @return	The y-coordinate (longitude) in fixed point.
+	 */
+	int get_fixed_y() const;
+
 	/**
 	 * Get the name of the landmark.
 	 * @param	The name of the landmark.
@@ -88,14 +100,14 @@ private:
 	unsigned long uid;
 
 	/**
-	 * The x coordinate (latitude).
+	 * The x coordinate (latitude) in fixed-point units of 1e-7 degrees.
 	 */
-	float x;
+	int x;
 
 	/**
-	 * The y coordinate (longitude).
+	 * The y coordinate (longitude) in fixed-point units of 1e-7 degrees.
 	 */
-	float y;
+	int y;
 
 	/**
 	 * The name of the landmark.
@@ -0,0 +1,213 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef LOSM_LANDMARK_TABLE_H
+#define LOSM_LANDMARK_TABLE_H
+
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <cstdint>
+
+#include "losm_graph.h"
+#include "losm_edge_index.h"
+
+/**
+ * The costs of the cheapest routes between every pair of landmarks of a LOSMGraph, so that a
+ * query from one landmark to another is a single lookup. Build it once after loading, or save
+ * it and load it with the map.
+ *
+ * Each landmark is attached to the closest point on the closest edge, and routes start and end
+ * at these points: leaving a landmark costs the part of its edge to whichever end the route
+ * takes, and two landmarks on the same edge may also go directly along it. The costs do not
+ * include the straight-line distance from a landmark to its attachment, which is kept
+ * separately. One Dijkstra search per landmark and type of cost runs on a thread pool, and
+ * stops once the attachments of every later landmark are settled.
+ *
+ * Routes are undirected, so only the pairs of distinct landmarks are stored, as the upper
+ * triangle of each matrix in single precision. Nothing is modified after construction, so any
+ * number of threads may query the same LOSMLandmarkTable concurrently.
+ */
+class LOSMLandmarkTable {
+public:
+	/**
+	 * The constructor for the LOSMLandmarkTable class, which attaches the graph's landmarks and
+	 * computes the costs between them.
+	 * @param	graph			The graph, whose LOSM object provides the landmarks.
+	 * @param	numThreads		The number of workers. Zero uses the hardware concurrency.
+	 * @throw	LOSMException	The graph was null.
+	 */
+	LOSMLandmarkTable(std::shared_ptr<const LOSMGraph> graph, unsigned int numThreads = 0);
+
+	/**
+	 * The constructor for the LOSMLandmarkTable class, which reads a table written by save().
+	 * @param	graph			The graph, which must have been loaded from the same files as the
+	 * 							one the table was saved from.
+	 * @param	filename		The name of the file.
+	 * @throw	LOSMException	The file could not be read, was not valid, or was of a different map.
+	 */
+	LOSMLandmarkTable(std::shared_ptr<const LOSMGraph> graph, std::string filename);
+
+	/**
+	 * The default deconstructor for the LOSMLandmarkTable class.
+	 */
+	virtual ~LOSMLandmarkTable();
+
+	/**
+	 * Get the graph the landmarks are attached to.
+	 * @return	The graph.
+	 */
+	std::shared_ptr<const LOSMGraph> get_graph() const;
+
+	/**
+	 * Get the number of landmarks.
+	 * @return	The number of landmarks.
+	 */
+	unsigned int get_num_landmarks() const;
+
+	/**
+	 * Get a landmark, in the order of the LOSM object.
+	 * @param	index	The index of the landmark.
+	 * @return	The landmark.
+	 */
+	const LOSMLandmark *get_landmark(unsigned int index) const;
+
+	/**
+	 * Get the index of a landmark.
+	 * @param	landmark		The landmark.
+	 * @return	The index of the landmark.
+	 * @throw	LOSMException	The landmark was not one of the graph's.
+	 */
+	unsigned int get_landmark_index(const LOSMLandmark *landmark) const;
+
+	/**
+	 * Get the point on the road network a landmark is attached to.
+	 * @param	index	The index of the landmark.
+	 * @return	The closest point on the closest edge to the landmark. Its edge is
+	 * 			LOSMGraph::INVALID_INDEX if the graph has no edges.
+	 */
+	const LOSMEdgeProjection &get_attachment(unsigned int index) const;
+
+	/**
+	 * Get the cost of the cheapest route between two landmarks.
+	 * @param	source	The index of the source landmark.
+	 * @param	target	The index of the target landmark.
+	 * @param	cost	The type of cost.
+	 * @return	The cost of the cheapest route, or infinity if the target is unreachable.
+	 */
+	float get_cost(unsigned int source, unsigned int target, LOSMCost cost) const;
+
+	/**
+	 * Get the cost of the cheapest route between two landmarks.
+	 * @param	source			The source landmark.
+	 * @param	target			The target landmark.
+	 * @param	cost			The type of cost.
+	 * @return	The cost of the cheapest route, or infinity if the target is unreachable.
+	 * @throw	LOSMException	A landmark was not one of the graph's.
+	 */
+	float get_cost(const LOSMLandmark *source, const LOSMLandmark *target, LOSMCost cost) const;
+
+	/**
+	 * Get the memory used by the attachments and costs (in bytes).
+	 * @return	The memory used by the table.
+	 */
+	size_t get_memory_usage() const;
+
+	/**
+	 * Write the table to a file, which the filename constructor reads.
+	 * @param	filename		The name of the file.
+	 * @throw	LOSMException	The file could not be written.
+	 */
+	void save(std::string filename) const;
+
+private:
+	/**
+	 * The magic number at the start of a saved file.
+	 */
+	static const char SAVED_MAGIC[8];
+
+	/**
+	 * The scratch space of one worker's searches.
+	 */
+	struct Search {
+		std::vector<float> costs;
+		std::vector<unsigned int> targets;
+		std::vector<unsigned int> touched;
+		std::vector<std::pair<float, unsigned int> > heap;
+	};
+
+	/**
+	 * Index the landmarks of the graph's LOSM object.
+	 * @throw	LOSMException	The graph was null.
+	 */
+	void index_landmarks();
+
+	/**
+	 * Compute the costs from one landmark to every later landmark.
+	 * @param	source	The index of the source landmark.
+	 * @param	cost	The type of cost.
+	 * @param	search	The scratch space of the calling worker.
+	 */
+	void compute_costs(unsigned int source, LOSMCost cost, Search &search);
+
+	/**
+	 * Get the position of a pair of distinct landmarks in the upper triangle.
+	 * @param	i	The index of the lower landmark.
+	 * @param	j	The index of the higher landmark.
+	 * @return	The position of the pair.
+	 */
+	size_t get_pair(unsigned int i, unsigned int j) const;
+
+	/**
+	 * The graph the landmarks are attached to.
+	 */
+	std::shared_ptr<const LOSMGraph> graph;
+
+	/**
+	 * The landmarks, in the order of the LOSM object.
+	 */
+	std::vector<const LOSMLandmark *> landmarks;
+
+	/**
+	 * A mapping from each landmark to its index.
+	 */
+	std::unordered_map<const LOSMLandmark *, unsigned int> landmarkIndices;
+
+	/**
+	 * The attachment of each landmark.
+	 */
+	std::vector<LOSMEdgeProjection> attachments;
+
+	/**
+	 * The cost of each pair of distinct landmarks, as the upper triangle of a matrix, for each
+	 * type of cost.
+	 */
+	std::vector<float> costs[2];
+
+};
+
+
+#endif // LOSM_LANDMARK_TABLE_H
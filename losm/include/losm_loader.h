@@ -0,0 +1,279 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef LOSM_LOADER_H
+#define LOSM_LOADER_H
+
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <mutex>
+#include <future>
+#include <functional>
+
+#include "losm.h"
+
+/**
+ * The files of a map.
+ */
+enum class LOSMLoadFile {
+	NODES,			// The nodes' file.
+	EDGES,			// The edges' file.
+	LANDMARKS		// The landmarks' file.
+};
+
+/**
+ * The outcome of a load.
+ */
+enum class LOSMLoadStatus {
+	LOADED,			// Every file was loaded.
+	FAILED,			// A file did not exist or was invalid.
+	CANCELLED		// The load was cancelled.
+};
+
+/**
+ * The progress of a load through one of its files.
+ */
+struct LOSMLoadProgress {
+	/**
+	 * The file being loaded.
+	 */
+	LOSMLoadFile file;
+
+	/**
+	 * The name of the file being loaded.
+	 */
+	std::string filename;
+
+	/**
+	 * The number of bytes of the file processed so far.
+	 */
+	unsigned long long bytesProcessed;
+
+	/**
+	 * The size of the file (in bytes).
+	 */
+	unsigned long long totalBytes;
+
+	/**
+	 * The number of lines of the file processed so far.
+	 */
+	unsigned long long linesProcessed;
+
+	/**
+	 * If the whole file has been processed.
+	 */
+	bool finished;
+};
+
+/**
+ * Where and why a load failed.
+ */
+struct LOSMLoadError {
+	/**
+	 * The file which failed to load.
+	 */
+	LOSMLoadFile file;
+
+	/**
+	 * The name of the file which failed to load.
+	 */
+	std::string filename;
+
+	/**
+	 * The line which was invalid, starting at one, or zero if the file could not be read at all.
+	 */
+	unsigned long long line;
+
+	/**
+	 * The field which was invalid, e.g., "uid" or "speed_limit", or empty if the line as a
+	 * whole was invalid.
+	 */
+	std::string field;
+
+	/**
+	 * A description of the error.
+	 */
+	std::string message;
+};
+
+/**
+ * The result of a load.
+ */
+struct LOSMLoadResult {
+	/**
+	 * The outcome of the load.
+	 */
+	LOSMLoadStatus status;
+
+	/**
+	 * The LOSM object loaded, or null unless the status is LOADED.
+	 */
+	std::shared_ptr<LOSM> losm;
+
+	/**
+	 * Where and why the load failed, if the status is FAILED.
+	 */
+	LOSMLoadError error;
+};
+
+/**
+ * A class which loads the files of a map on a background thread, for interactive tools and
+ * services which cannot block for the whole parse. Progress through each file is reported to a
+ * callback, loads may be cancelled between lines, and failures are returned as a LOSMLoadError
+ * describing the file, line, and field, rather than printed and thrown.
+ *
+ * Nodes are found by unique identifier through a hash map while the edges are loaded, so the
+ * parse is linear in the size of the files. A node whose unique identifier was already loaded,
+ * or a coordinate which is not a latitude and longitude, fails the load.
+ */
+class LOSMLoader {
+public:
+	/**
+	 * The signature of the progress callback. It is called on the loading thread, every
+	 * PROGRESS_INTERVAL lines and once at the end of each file.
+	 */
+	typedef std::function<void (const LOSMLoadProgress &)> ProgressCallback;
+
+	/**
+	 * The default constructor for the LOSMLoader class.
+	 */
+	LOSMLoader();
+
+	/**
+	 * The default deconstructor for the LOSMLoader class. Pending loads continue, and their
+	 * futures remain valid.
+	 */
+	virtual ~LOSMLoader();
+
+	/**
+	 * Load the files specified which contain nodes, edges, and landmarks, on a new thread.
+	 * @param	nodesFilename		The nodes' filename.
+	 * @param	edgesFilename		The edges' filename.
+	 * @param	landmarksFilename	The landmarks' filename.
+	 * @param	callback			The progress callback, or null for none.
+	 * @return	The future of the result of the load.
+	 */
+	std::future<LOSMLoadResult> load(std::string nodesFilename, std::string edgesFilename,
+			std::string landmarksFilename, ProgressCallback callback = nullptr);
+
+	/**
+	 * Cancel every load started so far which has not finished. Their results have a status of
+	 * CANCELLED, unless they finish first. Later loads are not affected.
+	 */
+	void cancel();
+
+	/**
+	 * Load the files specified which contain nodes, edges, and landmarks, on the calling thread.
+	 * @param	nodesFilename		The nodes' filename.
+	 * @param	edgesFilename		The edges' filename.
+	 * @param	landmarksFilename	The landmarks' filename.
+	 * @param	callback			The progress callback, or null for none.
+	 * @param	cancelled			The flag which cancels the load once set, or null for none.
+	 * @return	The result of the load.
+	 */
+	static LOSMLoadResult load_files(std::string nodesFilename, std::string edgesFilename,
+			std::string landmarksFilename, ProgressCallback callback = nullptr,
+			const std::atomic<bool> *cancelled = nullptr);
+
+	/**
+	 * The number of lines between progress reports and checks for cancellation.
+	 */
+	static const unsigned int PROGRESS_INTERVAL = 4096;
+
+private:
+	/**
+	 * The signature of the function which parses the comma-delimited items of one line. It
+	 * returns false and fills in the line, field, and message of the error if they are invalid.
+	 */
+	typedef std::function<bool (const std::vector<std::string> &, LOSMLoadError &)> LineParser;
+
+	/**
+	 * Convert an item to an unsigned integer, which must make up the whole item.
+	 * @param	items	The comma-delimited items of a line.
+	 * @param	index	The index of the item.
+	 * @param	field	The name of the field, for the error.
+	 * @param	value	The integer. This will be modified.
+	 * @param	error	The field and message of the error, if the item is invalid. This will be
+	 * 					modified.
+	 * @return	True if the item was converted, false otherwise.
+	 */
+	static bool parse_integer(const std::vector<std::string> &items, unsigned int index, const char *field,
+			unsigned long &value, LOSMLoadError &error);
+
+	/**
+	 * Convert an item to a float, which must make up the whole item.
+	 * @param	items	The comma-delimited items of a line.
+	 * @param	index	The index of the item.
+	 * @param	field	The name of the field, for the error.
+	 * @param	value	The float. This will be modified.
+	 * @param	error	The field and message of the error, if the item is invalid. This will be
+	 * 					modified.
+	 * @return	True if the item was converted, false otherwise.
+	 */
+	static bool parse_float(const std::vector<std::string> &items, unsigned int index, const char *field,
+			double &value, LOSMLoadError &error);
+
+	/**
+	 * Check that the coordinate of a node or landmark is a valid latitude and longitude.
+	 * @param	items	The items of the line, whose second and third are the coordinate.
+	 * @param	x		The latitude (in degrees).
+	 * @param	y		The longitude (in degrees).
+	 * @param	error	The field and message of the error, if the coordinate is invalid. This
+	 * 					will be modified.
+	 * @return	True if the coordinate was valid, false otherwise.
+	 */
+	static bool check_coordinate(const std::vector<std::string> &items, double x, double y, LOSMLoadError &error);
+
+	/**
+	 * Read a file line by line, reporting progress and checking for cancellation.
+	 * @param	file		The file being loaded.
+	 * @param	filename	The name of the file.
+	 * @param	numItems	The number of comma-delimited items on each line.
+	 * @param	parser		The function which parses each line.
+	 * @param	callback	The progress callback, or null for none.
+	 * @param	cancelled	The flag which cancels the load once set, or null for none.
+	 * @param	error		Where and why the file failed to load. This will be modified.
+	 * @return	The outcome of reading the file.
+	 */
+	static LOSMLoadStatus read_file(LOSMLoadFile file, std::string filename, unsigned int numItems,
+			LineParser parser, ProgressCallback callback, const std::atomic<bool> *cancelled,
+			LOSMLoadError &error);
+
+	/**
+	 * The flag shared with the loads started since the last cancellation.
+	 */
+	std::shared_ptr<std::atomic<bool> > cancelled;
+
+	/**
+	 * The mutex which protects the flag.
+	 */
+	std::mutex mutex;
+
+};
+
+
+#endif // LOSM_LOADER_H
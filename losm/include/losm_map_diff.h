@@ -0,0 +1,326 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef LOSM_MAP_DIFF_H
+#define LOSM_MAP_DIFF_H
+
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <functional>
+#include <utility>
+#include <cstdint>
+
+#include "losm.h"
+#include "losm_graph.h"
+#include "losm_thread_pool.h"
+
+/**
+ * The attributes of a node which may change between two versions of a map.
+ */
+const unsigned int LOSM_NODE_CHANGED_COORDINATES = 1;
+const unsigned int LOSM_NODE_CHANGED_DEGREE = 2;
+
+/**
+ * The attributes of an edge which may change between two versions of a map.
+ */
+const unsigned int LOSM_EDGE_CHANGED_NAME = 1;
+const unsigned int LOSM_EDGE_CHANGED_DISTANCE = 2;
+const unsigned int LOSM_EDGE_CHANGED_SPEED_LIMIT = 4;
+const unsigned int LOSM_EDGE_CHANGED_LANES = 8;
+
+/**
+ * A node which was added, removed, or modified.
+ */
+struct LOSMNodeChange {
+	/**
+	 * The unique identifier of the node.
+	 */
+	unsigned long uid;
+
+	/**
+	 * The LOSM_NODE_CHANGED_* attributes which changed, or zero if the node was added or removed.
+	 */
+	unsigned int attributes;
+};
+
+/**
+ * An edge which was added, removed, or modified. Edges are undirected, so an edge is identified
+ * by the unique identifiers of its nodes, the smaller first.
+ */
+struct LOSMEdgeChange {
+	/**
+	 * The smaller unique identifier of the edge's nodes.
+	 */
+	unsigned long uid1;
+
+	/**
+	 * The larger unique identifier of the edge's nodes.
+	 */
+	unsigned long uid2;
+
+	/**
+	 * The LOSM_EDGE_CHANGED_* attributes which changed, or zero if the edge was added or removed.
+	 */
+	unsigned int attributes;
+};
+
+/**
+ * The differences between two versions of a map, each sorted by unique identifiers.
+ */
+struct LOSMMapDiff {
+	/**
+	 * The nodes only in the new version, only in the old version, and in both but different.
+	 */
+	std::vector<LOSMNodeChange> addedNodes;
+	std::vector<LOSMNodeChange> removedNodes;
+	std::vector<LOSMNodeChange> modifiedNodes;
+
+	/**
+	 * The edges only in the new version, only in the old version, and in both but different.
+	 */
+	std::vector<LOSMEdgeChange> addedEdges;
+	std::vector<LOSMEdgeChange> removedEdges;
+	std::vector<LOSMEdgeChange> modifiedEdges;
+};
+
+/**
+ * A comparison of two versions of a map, e.g., a fresh export against the one routing data was
+ * computed for. Nodes are matched by unique identifier, and edges by the unique identifiers of
+ * their nodes; where several edges join the same nodes, identical ones are matched first.
+ *
+ * Nodes and edges are hashed into partitions by their identifiers, and the partitions are
+ * sorted and merged in parallel. The files of a map are streamed rather than loaded, in as many
+ * passes over them as it takes to keep the partitions of each pass within a memory budget, so
+ * maps far larger than memory can be compared. Street names are compared by a 64-bit hash.
+ */
+class LOSMMapDiffer {
+public:
+	/**
+	 * The default memory budget (in bytes) of the partitions of one pass.
+	 */
+	static const size_t DEFAULT_MEMORY_BUDGET = (size_t)256 * 1024 * 1024;
+
+	/**
+	 * The constructor for the LOSMMapDiffer class.
+	 * @param	memoryBudget	The approximate memory (in bytes) the partitions of one pass may use.
+	 * @param	numThreads		The number of workers. Zero uses the hardware concurrency.
+	 */
+	LOSMMapDiffer(size_t memoryBudget = DEFAULT_MEMORY_BUDGET, unsigned int numThreads = 0);
+
+	/**
+	 * The deconstructor for the LOSMMapDiffer class, which waits for the workers.
+	 */
+	virtual ~LOSMMapDiffer();
+
+	/**
+	 * Compare two loaded versions of a map.
+	 * @param	before			The old version.
+	 * @param	after			The new version.
+	 * @param	result			The differences. This will be modified.
+	 */
+	void compare(const LOSM &before, const LOSM &after, LOSMMapDiff &result);
+
+	/**
+	 * Compare two versions of a map given by their files, without loading either.
+	 * @param	nodesBefore		The nodes file of the old version.
+	 * @param	edgesBefore		The edges file of the old version.
+	 * @param	nodesAfter		The nodes file of the new version.
+	 * @param	edgesAfter		The edges file of the new version.
+	 * @param	result			The differences. This will be modified.
+	 * @throw	LOSMException	A file could not be read or had an invalid line.
+	 */
+	void compare(std::string nodesBefore, std::string edgesBefore, std::string nodesAfter,
+			std::string edgesAfter, LOSMMapDiff &result);
+
+private:
+	/**
+	 * The attributes of a node which are compared.
+	 */
+	struct NodeRecord {
+		/**
+		 * Get the identifiers by which the node is matched.
+		 * @return	The unique identifier of the node, and zero.
+		 */
+		std::pair<unsigned long, unsigned long> get_key() const;
+
+		/**
+		 * Find the attributes which differ from those of another version of the node.
+		 * @param	other	The other version of the node.
+		 * @return	The LOSM_NODE_CHANGED_* attributes which differ.
+		 */
+		unsigned int compare(const NodeRecord &other) const;
+
+		/**
+		 * Describe a change of the node.
+		 * @param	attributes	The attributes which changed.
+		 * @return	The change.
+		 */
+		LOSMNodeChange get_change(unsigned int attributes) const;
+
+		/**
+		 * Order records by their keys, then by their attributes.
+		 * @param	other	The other record.
+		 * @return	True if this record is ordered before the other, false otherwise.
+		 */
+		bool operator<(const NodeRecord &other) const;
+
+		unsigned long uid;
+		int x;
+		int y;
+		unsigned int degree;
+	};
+
+	/**
+	 * The attributes of an edge which are compared, with its nodes' identifiers in order.
+	 */
+	struct EdgeRecord {
+		/**
+		 * Get the identifiers by which the edge is matched.
+		 * @return	The unique identifiers of the nodes of the edge.
+		 */
+		std::pair<unsigned long, unsigned long> get_key() const;
+
+		/**
+		 * Find the attributes which differ from those of another version of the edge.
+		 * @param	other	The other version of the edge.
+		 * @return	The LOSM_EDGE_CHANGED_* attributes which differ.
+		 */
+		unsigned int compare(const EdgeRecord &other) const;
+
+		/**
+		 * Describe a change of the edge.
+		 * @param	attributes	The attributes which changed.
+		 * @return	The change.
+		 */
+		LOSMEdgeChange get_change(unsigned int attributes) const;
+
+		/**
+		 * Order records by their keys, then by their attributes.
+		 * @param	other	The other record.
+		 * @return	True if this record is ordered before the other, false otherwise.
+		 */
+		bool operator<(const EdgeRecord &other) const;
+
+		unsigned long uid1;
+		unsigned long uid2;
+		uint64_t nameHash;
+		float distance;
+		unsigned int speedLimit;
+		unsigned int lanes;
+	};
+
+	/**
+	 * The partitions of one pass, holding the records of each version which hash into them.
+	 */
+	class Pass {
+	public:
+		/**
+		 * The constructor for the Pass class.
+		 * @param	first			The first partition of the pass.
+		 * @param	numPartitions	The number of partitions of the pass.
+		 * @param	total			The number of partitions of all passes.
+		 */
+		Pass(unsigned int first, unsigned int numPartitions, unsigned int total);
+
+		/**
+		 * Get the partition of this pass a node hashes into.
+		 * @param	uid		The unique identifier of the node.
+		 * @return	The partition within this pass, or LOSMGraph::INVALID_INDEX if it is in another pass.
+		 */
+		unsigned int find_node_partition(unsigned long uid) const;
+
+		/**
+		 * Get the partition of this pass an edge hashes into.
+		 * @param	uid1	The unique identifier of one node of the edge.
+		 * @param	uid2	The unique identifier of the other node of the edge.
+		 * @return	The partition within this pass, or LOSMGraph::INVALID_INDEX if it is in another pass.
+		 */
+		unsigned int find_edge_partition(unsigned long uid1, unsigned long uid2) const;
+
+		/**
+		 * The first partition of the pass, the number of partitions of the pass, and of all passes.
+		 */
+		unsigned int first;
+		unsigned int numPartitions;
+		unsigned int total;
+
+		/**
+		 * The records of the old (0) and new (1) versions in each partition.
+		 */
+		std::vector<std::vector<NodeRecord> > nodes[2];
+		std::vector<std::vector<EdgeRecord> > edges[2];
+	};
+
+	/**
+	 * A function which adds the records of one version (0 for old, 1 for new) in a pass.
+	 */
+	typedef std::function<void (unsigned int version, Pass &pass)> Reader;
+
+	/**
+	 * Compare two versions in as many passes as the memory budget requires.
+	 * @param	size	An estimate of the memory (in bytes) the records of both versions use.
+	 * @param	read	The function which adds the records of a version in a pass.
+	 * @param	result	The differences. This will be modified.
+	 */
+	void compare(size_t size, Reader read, LOSMMapDiff &result);
+
+	/**
+	 * Add the records of a nodes file and an edges file in a pass.
+	 * @param	nodesFilename	The nodes file.
+	 * @param	edgesFilename	The edges file.
+	 * @param	version			The version of the files.
+	 * @param	pass			The pass. This will be modified.
+	 * @throw	LOSMException	A file could not be read or had an invalid line.
+	 */
+	static void read_files(const std::string &nodesFilename, const std::string &edgesFilename,
+			unsigned int version, Pass &pass);
+
+	/**
+	 * Compute the hash of a street name, which is the same on every platform and run.
+	 * @param	name	The name.
+	 * @return	The 64-bit FNV-1a hash of the name.
+	 */
+	static uint64_t hash_name(const std::string &name);
+
+	/**
+	 * The number of partitions of each pass per worker, so that idle workers can take more.
+	 */
+	static const unsigned int PARTITIONS_PER_THREAD = 4;
+
+	/**
+	 * The approximate memory (in bytes) the partitions of one pass may use.
+	 */
+	size_t memoryBudget;
+
+	/**
+	 * The pool of workers.
+	 */
+	std::unique_ptr<LOSMThreadPool> pool;
+
+};
+
+
+#endif // LOSM_MAP_DIFF_H
@@ -0,0 +1,271 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef LOSM_MAP_HANDLE_H
+#define LOSM_MAP_HANDLE_H
+
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <future>
+#include <utility>
+
+#include "losm.h"
+#include "losm_graph.h"
+
+/**
+ * A version of the map published by a LOSMMapHandle: a LOSM object and its LOSMGraph snapshot.
+ */
+struct LOSMMapVersion {
+	/**
+	 * The number of the version, starting at one and increasing with each publication.
+	 */
+	unsigned long long number;
+
+	/**
+	 * The LOSM object.
+	 */
+	std::shared_ptr<const LOSM> losm;
+
+	/**
+	 * The graph snapshot of the LOSM object.
+	 */
+	std::shared_ptr<const LOSMGraph> graph;
+};
+
+/**
+ * A handle to the current version of a map for long-running services, which replaces the map
+ * while queries continue on it. A new map is loaded and its graph built in the background, then
+ * published with one atomic store; queries which started before keep the version they began
+ * with, and later ones see the new version, so there is no gap in service.
+ *
+ * Readers are tracked with epochs, as in read-copy-update: a Reader claims a slot with one
+ * compare-and-swap, announcing the epoch at which it read the current version, and releases it
+ * with one store. Neither ever waits. A replaced version is retired with the epoch of its
+ * replacement, and deleted by the background thread once every slot is idle or announces a
+ * later epoch. A reader which needs the map for longer may copy its shared pointers instead.
+ */
+class LOSMMapHandle {
+public:
+	/**
+	 * A guard which holds the current version of the map for the duration of a query. Readers
+	 * are meant to be short-lived and kept on the stack; each occupies one slot of the handle.
+	 */
+	class Reader {
+	public:
+		/**
+		 * The constructor for the Reader class, which acquires the current version.
+		 * @param	handle			The handle to read.
+		 * @throw	LOSMException	Every slot of the handle was occupied by another reader.
+		 */
+		Reader(const LOSMMapHandle &handle);
+
+		/**
+		 * The deconstructor for the Reader class, which releases the version.
+		 */
+		virtual ~Reader();
+
+		/**
+		 * Get the version acquired.
+		 * @return	The version.
+		 */
+		const LOSMMapVersion &get_version() const;
+
+		/**
+		 * Get the LOSM object of the version acquired.
+		 * @return	The LOSM object.
+		 */
+		const LOSM &get_losm() const;
+
+		/**
+		 * Get the graph of the version acquired.
+		 * @return	The graph.
+		 */
+		const LOSMGraph &get_graph() const;
+
+	private:
+		/**
+		 * Readers may not be copied, since each occupies its own slot.
+		 */
+		Reader(const Reader &other) = delete;
+		Reader &operator=(const Reader &other) = delete;
+
+		/**
+		 * The handle read.
+		 */
+		const LOSMMapHandle &handle;
+
+		/**
+		 * The slot occupied.
+		 */
+		unsigned int slot;
+
+		/**
+		 * The version acquired.
+		 */
+		const LOSMMapVersion *version;
+	};
+
+	/**
+	 * The constructor for the LOSMMapHandle class, which publishes the first version.
+	 * @param	losm			The first LOSM object.
+	 * @param	maxReaders		The maximum number of concurrent readers. Zero uses sixteen times
+	 * 							the hardware concurrency.
+	 * @throw	LOSMException	The LOSM object was null.
+	 */
+	LOSMMapHandle(std::shared_ptr<const LOSM> losm, unsigned int maxReaders = 0);
+
+	/**
+	 * The deconstructor for the LOSMMapHandle class, which waits for a pending reload. No reader
+	 * may remain.
+	 */
+	virtual ~LOSMMapHandle();
+
+	/**
+	 * Get the number of the current version.
+	 * @return	The number of the current version.
+	 */
+	unsigned long long get_version_number() const;
+
+	/**
+	 * Get the number of replaced versions which are not yet deleted.
+	 * @return	The number of retired versions.
+	 */
+	unsigned int get_num_retired() const;
+
+	/**
+	 * Build the graph of a LOSM object and publish it as the new version, on the calling thread.
+	 * @param	losm			The new LOSM object.
+	 * @return	The number of the new version.
+	 * @throw	LOSMException	The LOSM object was null.
+	 */
+	unsigned long long publish(std::shared_ptr<const LOSM> losm);
+
+	/**
+	 * Load the files specified and publish them as the new version, in the background. Once
+	 * published, the same thread deletes the versions replaced as their readers finish. A
+	 * reload begins loading once the previous one has published.
+	 * @param	nodesFilename		The nodes' filename.
+	 * @param	edgesFilename		The edges' filename.
+	 * @param	landmarksFilename	The landmarks' filename.
+	 * @return	The future of the number of the new version. If a file did not exist or was
+	 * 			invalid, then the future holds a LOSMException instead, and the current version
+	 * 			remains.
+	 */
+	std::future<unsigned long long> reload(std::string nodesFilename, std::string edgesFilename,
+			std::string landmarksFilename);
+
+	/**
+	 * Delete the retired versions which no reader can still hold.
+	 * @return	True if no retired version remains, false otherwise.
+	 */
+	bool reclaim();
+
+private:
+	/**
+	 * A reader slot, padded to its own cache line so that readers do not contend.
+	 */
+	struct Slot {
+		/**
+		 * The epoch announced by the reader in this slot, or zero if it is idle.
+		 */
+		std::atomic<unsigned long long> epoch;
+
+		/**
+		 * The padding to the end of the cache line.
+		 */
+		char padding[64 - sizeof(std::atomic<unsigned long long>)];
+	};
+
+	/**
+	 * The interval (in milliseconds) at which the background thread retries reclamation.
+	 */
+	static const unsigned int RECLAIM_INTERVAL = 1;
+
+	/**
+	 * Publish a version and retire the one it replaces.
+	 * @param	version		The new version, with its number not yet assigned.
+	 * @return	The number of the new version.
+	 */
+	unsigned long long publish_version(LOSMMapVersion *version);
+
+	/**
+	 * The current version.
+	 */
+	std::atomic<const LOSMMapVersion *> current;
+
+	/**
+	 * The global epoch, which starts at one and increases with each publication, so it is also
+	 * the number of the current version once a publication completes.
+	 */
+	std::atomic<unsigned long long> epoch;
+
+	/**
+	 * The reader slots.
+	 */
+	std::unique_ptr<Slot[]> slots;
+
+	/**
+	 * The number of reader slots.
+	 */
+	unsigned int numSlots;
+
+	/**
+	 * The retired versions with the epochs at which they were replaced.
+	 */
+	std::vector<std::pair<unsigned long long, const LOSMMapVersion *> > retired;
+
+	/**
+	 * The mutex which serializes publications and reclamations. Readers never take it.
+	 */
+	mutable std::mutex writerMutex;
+
+	/**
+	 * The mutex which serializes starting reloads.
+	 */
+	std::mutex reloadMutex;
+
+	/**
+	 * The background thread of the last reload.
+	 */
+	std::thread worker;
+
+	/**
+	 * The number of reloads started.
+	 */
+	std::atomic<unsigned long long> numReloads;
+
+	/**
+	 * If the handle is being destroyed, so that the background thread stops reclaiming.
+	 */
+	std::atomic<bool> stopping;
+
+};
+
+
+#endif // LOSM_MAP_HANDLE_H
@@ -0,0 +1,368 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef LOSM_MAP_MATCHER_H
+#define LOSM_MAP_MATCHER_H
+
+
+#include <memory>
+#include <vector>
+#include <deque>
+#include <future>
+
+#include "losm_graph.h"
+#include "losm_query_context.h"
+#include "losm_thread_pool.h"
+
+/**
+ * A GPS fix of a trace.
+ */
+struct LOSMGPSFix {
+	/**
+	 * The x coordinate (latitude).
+	 */
+	float x;
+
+	/**
+	 * The y coordinate (longitude).
+	 */
+	float y;
+};
+
+/**
+ * The point on an edge to which a GPS fix was matched.
+ */
+struct LOSMMatchedFix {
+	/**
+	 * The index of the edge, or LOSMGraph::INVALID_INDEX if no edge was near the fix.
+	 */
+	unsigned int edge;
+
+	/**
+	 * The fraction of the way along the edge from its first node to its second node.
+	 */
+	float fraction;
+
+	/**
+	 * The distance (in miles) from the fix to the point on the edge.
+	 */
+	float offset;
+};
+
+/**
+ * A hidden Markov model which matches GPS traces onto the edges of a LOSMGraph. The candidates
+ * of a fix are the nearest edges within a search radius, found with a uniform grid over the
+ * edges. A candidate is scored by a Gaussian of its distance to the fix, and a transition by
+ * an exponential of the difference between the road distance and the great-circle distance of
+ * consecutive fixes, as in Newson and Krumm (2009). Road distances come from bounded searches,
+ * so that implausible detours are never explored.
+ *
+ * The matcher itself is immutable, so any number of LOSMMapMatchSession objects may use it
+ * concurrently. It also matches batches of whole traces on its own thread pool.
+ */
+class LOSMMapMatcher {
+public:
+	/**
+	 * The constructor for the LOSMMapMatcher class.
+	 * @param	graph			The graph to match onto.
+	 * @param	gpsSigma		The standard deviation (in miles) of the GPS error.
+	 * @param	transitionBeta	The scale (in miles) of the difference between road and
+	 * 							great-circle distances of consecutive fixes.
+	 * @param	searchRadius	The maximum distance (in miles) from a fix to its candidates.
+	 * @param	maxCandidates	The maximum number of candidates of each fix.
+	 * @param	windowSize		The maximum number of fixes a session holds before the oldest
+	 * 							is decided, regardless of whether the paths have converged.
+	 * @param	numThreads		The number of workers for batches. Zero uses the hardware
+	 * 							concurrency.
+	 * @throw	LOSMException	The graph was null, or a parameter was not positive.
+	 */
+	LOSMMapMatcher(std::shared_ptr<const LOSMGraph> graph, float gpsSigma = 0.003f,
+			float transitionBeta = 0.005f, float searchRadius = 0.06f, unsigned int maxCandidates = 8,
+			unsigned int windowSize = 32, unsigned int numThreads = 0);
+
+	/**
+	 * The deconstructor for the LOSMMapMatcher class, which waits for all pending batches.
+	 */
+	virtual ~LOSMMapMatcher();
+
+	/**
+	 * Get the graph being matched onto.
+	 * @return	The graph.
+	 */
+	std::shared_ptr<const LOSMGraph> get_graph() const;
+
+	/**
+	 * Get the standard deviation (in miles) of the GPS error.
+	 * @return	The standard deviation of the GPS error.
+	 */
+	float get_gps_sigma() const;
+
+	/**
+	 * Get the scale (in miles) of the transition distance differences.
+	 * @return	The scale of the transition distance differences.
+	 */
+	float get_transition_beta() const;
+
+	/**
+	 * Get the maximum distance (in miles) from a fix to its candidates.
+	 * @return	The search radius.
+	 */
+	float get_search_radius() const;
+
+	/**
+	 * Get the maximum number of fixes a session holds.
+	 * @return	The window size.
+	 */
+	unsigned int get_window_size() const;
+
+	/**
+	 * Find the candidate edges of a fix: the nearest edges within the search radius, each
+	 * projected onto at its nearest point.
+	 * @param	fix		The GPS fix.
+	 * @param	result	The candidates, nearest first. This will be modified.
+	 */
+	void find_candidates(const LOSMGPSFix &fix, std::vector<LOSMMatchedFix> &result) const;
+
+	/**
+	 * Compute the great-circle distance (in miles) between two fixes.
+	 * @param	a	The first fix.
+	 * @param	b	The second fix.
+	 * @return	The distance (in miles).
+	 */
+	float compute_fix_distance(const LOSMGPSFix &a, const LOSMGPSFix &b) const;
+
+	/**
+	 * Match each trace in a batch, with one session per trace.
+	 * @param	traces	The traces.
+	 * @return	The future of the matched fixes of each trace, in order.
+	 */
+	std::future<std::vector<std::vector<LOSMMatchedFix> > > match_traces(
+			const std::vector<std::vector<LOSMGPSFix> > &traces);
+
+private:
+	/**
+	 * Build the key of a grid cell from its row and column.
+	 * @param	row		The row of the cell.
+	 * @param	column	The column of the cell.
+	 * @return	The key of the cell.
+	 */
+	static long long get_cell_key(int row, int column);
+
+	/**
+	 * Add an edge to every grid cell its segment crosses, walking the segment one row at a time,
+	 * so that the number of cells is proportional to its length rather than to the area it spans.
+	 * @param	x1		The x coordinate of the first node in fixed point.
+	 * @param	y1		The y coordinate of the first node in fixed point.
+	 * @param	x2		The x coordinate of the second node in fixed point.
+	 * @param	y2		The y coordinate of the second node in fixed point.
+	 * @param	edge	The index of the edge.
+	 * @param	cells	The (cell key, edge index) pairs. This will be modified.
+	 */
+	void rasterize_segment(int x1, int y1, int x2, int y2, unsigned int edge,
+			std::vector<std::pair<long long, unsigned int> > &cells) const;
+
+	/**
+	 * Sessions read the parameters directly.
+	 */
+	friend class LOSMMapMatchSession;
+
+	/**
+	 * The graph being matched onto.
+	 */
+	std::shared_ptr<const LOSMGraph> graph;
+
+	/**
+	 * The parameters given to the constructor.
+	 */
+	float gpsSigma;
+	float transitionBeta;
+	float searchRadius;
+	unsigned int maxCandidates;
+	unsigned int windowSize;
+
+	/**
+	 * The miles per unit of fixed-point latitude and longitude, near the mean latitude.
+	 */
+	float milesPerFixedX;
+	float milesPerFixedY;
+
+	/**
+	 * The size of a grid cell in fixed point, at least the search radius along each axis.
+	 */
+	int cellSizeX;
+	int cellSizeY;
+
+	/**
+	 * The keys of the non-empty grid cells, sorted.
+	 */
+	std::vector<long long> cellKeys;
+
+	/**
+	 * The first position in cellEdges of each non-empty cell, followed by the number of positions.
+	 */
+	std::vector<unsigned int> cellOffsets;
+
+	/**
+	 * The edges overlapping each non-empty cell.
+	 */
+	std::vector<unsigned int> cellEdges;
+
+	/**
+	 * The query context of each worker.
+	 */
+	std::vector<std::unique_ptr<LOSMQueryContext> > contexts;
+
+	/**
+	 * The pool of workers, declared last so that it is destroyed before the contexts.
+	 */
+	std::unique_ptr<LOSMThreadPool> pool;
+
+};
+
+/**
+ * The incremental matching of one trace, which holds at most a window of fixes. Each fix is
+ * decided as soon as every path through the window agrees on it, or once the window is full,
+ * so arbitrarily long traces are matched in constant memory. Where no candidate is reachable
+ * from the previous fix, the trace is split and matched in two parts.
+ *
+ * A session is not thread-safe; each trace being matched concurrently needs its own.
+ */
+class LOSMMapMatchSession {
+public:
+	/**
+	 * The constructor for the LOSMMapMatchSession class, which allocates its own query context.
+	 * @param	matcher		The matcher, which must outlive the session.
+	 */
+	LOSMMapMatchSession(const LOSMMapMatcher &matcher);
+
+	/**
+	 * The constructor for the LOSMMapMatchSession class which borrows a query context, e.g., to
+	 * share one among the sessions of a thread.
+	 * @param	matcher		The matcher, which must outlive the session.
+	 * @param	context		The query context of the matcher's graph, which must outlive the
+	 * 						session and must not be used by another thread meanwhile.
+	 */
+	LOSMMapMatchSession(const LOSMMapMatcher &matcher, LOSMQueryContext &context);
+
+	/**
+	 * The default deconstructor for the LOSMMapMatchSession class.
+	 */
+	virtual ~LOSMMapMatchSession();
+
+	/**
+	 * Add the next fix of the trace, and append the fixes which were decided as a result.
+	 * @param	fix		The GPS fix.
+	 * @param	matched	The matched fixes, in the order they were added. This will be modified.
+	 */
+	void push(const LOSMGPSFix &fix, std::vector<LOSMMatchedFix> &matched);
+
+	/**
+	 * Decide every remaining fix, ending the trace. The session may then start another trace.
+	 * @param	matched	The matched fixes, in the order they were added. This will be modified.
+	 */
+	void finish(std::vector<LOSMMatchedFix> &matched);
+
+private:
+	/**
+	 * A fix in the window, with its candidates and their Viterbi scores.
+	 */
+	struct Step {
+		/**
+		 * The GPS fix.
+		 */
+		LOSMGPSFix fix;
+
+		/**
+		 * The candidates of the fix.
+		 */
+		std::vector<LOSMMatchedFix> candidates;
+
+		/**
+		 * The log-probability of the best path ending at each candidate, up to a constant.
+		 */
+		std::vector<float> scores;
+
+		/**
+		 * The candidate of the previous step on the best path ending at each candidate.
+		 */
+		std::vector<unsigned int> parents;
+	};
+
+	/**
+	 * Compute the scores of a new step from the last step in the window.
+	 * @param	step	The new step. This will be modified.
+	 * @return	True if any candidate of the new step is reachable, false otherwise.
+	 */
+	bool transition(Step &step);
+
+	/**
+	 * Decide every step in the window up to and including one, following the parents back
+	 * from one of its candidates, then remove them from the window.
+	 * @param	last		The position of the step in the window.
+	 * @param	candidate	The candidate of the step.
+	 * @param	matched		The matched fixes. This will be modified.
+	 */
+	void decide(unsigned int last, unsigned int candidate, std::vector<LOSMMatchedFix> &matched);
+
+	/**
+	 * Decide the steps on which every path through the window agrees.
+	 * @param	matched		The matched fixes. This will be modified.
+	 */
+	void decide_converged(std::vector<LOSMMatchedFix> &matched);
+
+	/**
+	 * Get the candidate of the last step in the window with the best score.
+	 * @return	The best candidate of the last step.
+	 */
+	unsigned int get_best_candidate() const;
+
+	/**
+	 * The matcher.
+	 */
+	const LOSMMapMatcher *matcher;
+
+	/**
+	 * The query context used for the bounded searches.
+	 */
+	LOSMQueryContext *context;
+
+	/**
+	 * The query context, if the session allocated its own.
+	 */
+	std::unique_ptr<LOSMQueryContext> ownedContext;
+
+	/**
+	 * The undecided fixes.
+	 */
+	std::deque<Step> window;
+
+	/**
+	 * The road distances (in miles) between the candidates of consecutive steps.
+	 */
+	std::vector<float> routeDistances;
+
+};
+
+
+#endif // LOSM_MAP_MATCHER_H
@@ -0,0 +1,304 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef LOSM_MEMORY_H
+#define LOSM_MEMORY_H
+
+
+#include <cstddef>
+#include <new>
+#include <vector>
+#include <type_traits>
+
+/**
+ * The pages backing large arrays, such as those of a LOSMGraph.
+ */
+enum class LOSMPageMode {
+	DEFAULT,		// Ordinary pages from the heap.
+	TRANSPARENT,	// Huge-page aligned mappings which the kernel is advised to back with transparent huge pages.
+	EXPLICIT		// Mappings from the reserved huge page pool, or TRANSPARENT if the pool is exhausted.
+};
+
+/**
+ * Where and how to allocate large arrays.
+ */
+struct LOSMStorageOptions {
+	/**
+	 * The default constructor for the LOSMStorageOptions struct, for ordinary pages on any NUMA node.
+	 */
+	LOSMStorageOptions();
+
+	/**
+	 * A constructor for the LOSMStorageOptions struct.
+	 * @param	pages		The pages backing the arrays.
+	 * @param	numaNode	The NUMA node to place the arrays on, or -1 for any.
+	 */
+	LOSMStorageOptions(LOSMPageMode pages, int numaNode = -1);
+
+	/**
+	 * The pages backing the arrays.
+	 */
+	LOSMPageMode pages;
+
+	/**
+	 * The NUMA node to place the arrays on, or -1 to leave it to the kernel's first touch policy.
+	 */
+	int numaNode;
+};
+
+/**
+ * Allocate memory for an array. Arrays smaller than LOSM_MIN_MAPPED_SIZE, and all arrays with the
+ * default options, come from the heap; the others are mapped directly so that their pages and NUMA
+ * node may be chosen. A NUMA node is a preference, so memory is still allocated if it is full.
+ * @param	size			The number of bytes.
+ * @param	options			Where and how to allocate the memory.
+ * @throw	std::bad_alloc	The memory could not be allocated.
+ * @return	The memory.
+ */
+void *allocate_storage(size_t size, const LOSMStorageOptions &options);
+
+/**
+ * Free memory from allocate_storage().
+ * @param	data	The memory.
+ * @param	size	The number of bytes, as allocated.
+ * @param	options	The options it was allocated with.
+ */
+void free_storage(void *data, size_t size, const LOSMStorageOptions &options);
+
+/**
+ * Get the size of an explicit huge page, i.e., "Hugepagesize" in /proc/meminfo.
+ * @return	The size of a huge page (in bytes); 2 MB if it is unknown.
+ */
+size_t get_huge_page_size();
+
+/**
+ * Get the NUMA nodes of the machine which are online and have memory, i.e., those listed in
+ * /sys/devices/system/node/has_memory, or in /sys/devices/system/node/online if it is missing.
+ * @return	The NUMA nodes, in increasing order; only node 0 if the topology is unknown.
+ */
+const std::vector<unsigned int> &get_numa_nodes();
+
+/**
+ * Get the number of NUMA nodes of the machine which have memory.
+ * @return	The number of NUMA nodes; 1 if the topology is unknown.
+ */
+unsigned int get_num_numa_nodes();
+
+/**
+ * Get the NUMA node on which the calling thread is currently running. Unless the thread is pinned,
+ * this may change at any time, but rarely does. The node may have no memory of its own.
+ * @return	The NUMA node; 0 if it is unknown.
+ */
+unsigned int get_current_numa_node();
+
+/**
+ * The smallest array (in bytes) which allocate_storage() maps directly.
+ */
+const size_t LOSM_MIN_MAPPED_SIZE = 64 * 1024;
+
+/**
+ * An allocator for standard containers which allocates with allocate_storage(). The options are
+ * part of the allocator's state, so they follow a container when it is copied, moved, or swapped.
+ */
+template <typename T>
+class LOSMAllocator {
+public:
+	typedef T value_type;
+	typedef std::true_type propagate_on_container_copy_assignment;
+	typedef std::true_type propagate_on_container_move_assignment;
+	typedef std::true_type propagate_on_container_swap;
+
+	/**
+	 * The constructor for the LOSMAllocator class.
+	 * @param	options	Where and how to allocate memory.
+	 */
+	LOSMAllocator(const LOSMStorageOptions &options = LOSMStorageOptions()) : options(options)
+	{ }
+
+	/**
+	 * A constructor for the LOSMAllocator class which copies the options of an allocator of another type.
+	 * @param	other	The other allocator.
+	 */
+	template <typename U>
+	LOSMAllocator(const LOSMAllocator<U> &other) : options(other.get_options())
+	{ }
+
+	/**
+	 * Allocate an array.
+	 * @param	count			The number of elements.
+	 * @throw	std::bad_alloc	The memory could not be allocated.
+	 * @return	The array.
+	 */
+	T *allocate(size_t count)
+	{
+		return (T *)allocate_storage(count * sizeof(T), options);
+	}
+
+	/**
+	 * Free an array.
+	 * @param	data	The array.
+	 * @param	count	The number of elements, as allocated.
+	 */
+	void deallocate(T *data, size_t count)
+	{
+		free_storage(data, count * sizeof(T), options);
+	}
+
+	/**
+	 * Get the options with which memory is allocated.
+	 * @return	The options.
+	 */
+	const LOSMStorageOptions &get_options() const
+	{
+		return options;
+	}
+
+private:
+	/**
+	 * Where and how to allocate memory.
+	 */
+	LOSMStorageOptions options;
+
+};
+
+/**
+ * Allocators are interchangeable if they free memory the same way, i.e., have the same options.
+ */
+template <typename T, typename U>
+bool operator==(const LOSMAllocator<T> &a, const LOSMAllocator<U> &b)
+{
+	return (a.get_options().pages == b.get_options().pages && a.get_options().numaNode == b.get_options().numaNode);
+}
+
+template <typename T, typename U>
+bool operator!=(const LOSMAllocator<T> &a, const LOSMAllocator<U> &b)
+{
+	return !(a == b);
+}
+
+/**
+ * A contiguous array allocated with allocate_storage().
+ */
+template <typename T>
+using LOSMArray = std::vector<T, LOSMAllocator<T> >;
+
+/**
+ * A read-only view of a contiguous array which something else owns, e.g., a LOSMArray or a
+ * mapped file. The owner must outlive the view.
+ */
+template <typename T>
+class LOSMSpan {
+public:
+	/**
+	 * The default constructor for the LOSMSpan class, for an empty view.
+	 */
+	LOSMSpan() : values(nullptr), count(0)
+	{ }
+
+	/**
+	 * A constructor for the LOSMSpan class.
+	 * @param	values	The first element.
+	 * @param	count	The number of elements.
+	 */
+	LOSMSpan(const T *values, size_t count) : values(values), count(count)
+	{ }
+
+	/**
+	 * A constructor for the LOSMSpan class which views all of a vector.
+	 * @param	array	The vector.
+	 */
+	template <typename A>
+	LOSMSpan(const std::vector<T, A> &array) : values(array.data()), count(array.size())
+	{ }
+
+	/**
+	 * Get an element.
+	 * @param	index	The index of the element.
+	 * @return	The element.
+	 */
+	const T &operator[](size_t index) const
+	{
+		return values[index];
+	}
+
+	/**
+	 * Get the first element, e.g., to pass the array to a kernel.
+	 * @return	The first element.
+	 */
+	const T *data() const
+	{
+		return values;
+	}
+
+	/**
+	 * Get the number of elements.
+	 * @return	The number of elements.
+	 */
+	size_t size() const
+	{
+		return count;
+	}
+
+	/**
+	 * Check if there are no elements.
+	 * @return	True if there are no elements, false otherwise.
+	 */
+	bool empty() const
+	{
+		return (count == 0);
+	}
+
+	/**
+	 * Get the first element, for iteration.
+	 * @return	The first element.
+	 */
+	const T *begin() const
+	{
+		return values;
+	}
+
+	/**
+	 * Get one past the last element, for iteration.
+	 * @return	One past the last element.
+	 */
+	const T *end() const
+	{
+		return values + count;
+	}
+
+private:
+	/**
+	 * The first element.
+	 */
+	const T *values;
+
+	/**
+	 * The number of elements.
+	 */
+	size_t count;
+
+};
+
+
+#endif // LOSM_MEMORY_H
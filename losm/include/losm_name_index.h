@@ -0,0 +1,248 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef LOSM_NAME_INDEX_H
+#define LOSM_NAME_INDEX_H
+
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <cstddef>
+
+#include "losm_graph.h"
+
+/**
+ * A name found by a search of a LOSMNameIndex.
+ */
+struct LOSMNameMatch {
+	/**
+	 * The index of the name.
+	 */
+	unsigned int name;
+
+	/**
+	 * The number of edits (insertions, deletions, or substitutions of a character) between the
+	 * query and the name, or the word of the name at which the match begins.
+	 */
+	unsigned int edits;
+};
+
+/**
+ * An index of the distinct names of the edges and landmarks of a LOSMGraph, for resolving
+ * geocoding-style input such as "Main St" or "library" to edges and landmarks.
+ *
+ * Names are case-folded into keys: ASCII letters are lowered, every run of other ASCII
+ * characters which are not letters or digits becomes one space, and leading and trailing spaces
+ * are removed, so "Main St." and "main  st" have the same key. Every suffix of a key which starts
+ * a word is an entry of one sorted table, so a query may match a name from any of its words.
+ *
+ * Exact and prefix searches are binary searches of the table. A fuzzy search walks the table as
+ * an implicit trie, reusing the rows of the edit distance computation shared by consecutive keys
+ * and skipping all keys with a prefix which can no longer match.
+ *
+ * Nothing is modified after construction, so any number of threads may search the same index
+ * concurrently.
+ */
+class LOSMNameIndex {
+public:
+	/**
+	 * The constructor for the LOSMNameIndex class, which indexes the names of a graph's edges
+	 * and its LOSM object's landmarks.
+	 * @param	graph			The graph.
+	 * @throw	LOSMException	The graph was null.
+	 */
+	LOSMNameIndex(std::shared_ptr<const LOSMGraph> graph);
+
+	/**
+	 * The default deconstructor for the LOSMNameIndex class.
+	 */
+	virtual ~LOSMNameIndex();
+
+	/**
+	 * Get the number of distinct names, i.e., of distinct keys.
+	 * @return	The number of names.
+	 */
+	unsigned int get_num_names() const;
+
+	/**
+	 * Get a name, spelled as it was first found.
+	 * @param	name	The index of the name.
+	 * @return	The name.
+	 */
+	std::string get_name(unsigned int name) const;
+
+	/**
+	 * Get the edges with a name.
+	 * @param	name	The index of the name.
+	 * @param	result	The indices of the edges in the graph, in increasing order. This will be
+	 * 					modified.
+	 */
+	void get_edges(unsigned int name, std::vector<unsigned int> &result) const;
+
+	/**
+	 * Get the landmarks with a name.
+	 * @param	name	The index of the name.
+	 * @param	result	The indices of the landmarks in the LOSM object's list, in increasing
+	 * 					order. This will be modified.
+	 */
+	void get_landmarks(unsigned int name, std::vector<unsigned int> &result) const;
+
+	/**
+	 * Fold a string into a key, as the names are.
+	 * @param	text	The string.
+	 * @return	The key.
+	 */
+	static std::string fold(const std::string &text);
+
+	/**
+	 * Find the name whose whole key equals the query's.
+	 * @param	query	The query.
+	 * @return	The index of the name, or LOSMGraph::INVALID_INDEX if there is none.
+	 */
+	unsigned int find_exact(const std::string &query) const;
+
+	/**
+	 * Find the names with a word at which the key continues with the query's key, e.g., "main"
+	 * finds "Main St" and "North Main St". Names which begin with the query come first, then
+	 * shorter names.
+	 * @param	query		The query.
+	 * @param	maxResults	The maximum number of names found.
+	 * @param	result		The names found, each with zero edits. This will be modified.
+	 */
+	void find_prefix(const std::string &query, unsigned int maxResults, std::vector<LOSMNameMatch> &result) const;
+
+	/**
+	 * Find the names with a word from which the rest of the key is within a number of edits of
+	 * the query's key, e.g., "mian st" finds "Main St" and "libary" finds "Jones Library". Names
+	 * with fewer edits come first, then names which begin with the match, then shorter names.
+	 * @param	query		The query.
+	 * @param	maxEdits	The maximum number of edits.
+	 * @param	maxResults	The maximum number of names found.
+	 * @param	result		The names found, with the fewest edits of each. This will be modified.
+	 */
+	void find_fuzzy(const std::string &query, unsigned int maxEdits, unsigned int maxResults,
+			std::vector<LOSMNameMatch> &result) const;
+
+	/**
+	 * Get the memory used by the index.
+	 * @return	The number of bytes used.
+	 */
+	size_t get_memory_usage() const;
+
+private:
+	/**
+	 * An entry of the sorted table: the suffix of a name's key from the start of a word.
+	 */
+	struct Entry {
+		/**
+		 * The index of the name.
+		 */
+		unsigned int name;
+
+		/**
+		 * The position in the name's key at which the suffix starts.
+		 */
+		unsigned int start;
+	};
+
+	/**
+	 * Get the key of an entry.
+	 * @param	entry	The entry.
+	 * @param	length	The length of the key. This will be modified.
+	 * @return	The first character of the key, which is not null-terminated.
+	 */
+	const char *get_key(const Entry &entry, unsigned int &length) const;
+
+	/**
+	 * Find the first entry whose key is not less than a string, compared on at most a number of
+	 * characters.
+	 * @param	first	The first entry to consider.
+	 * @param	text	The string.
+	 * @param	length	The length of the string.
+	 * @param	upper	If true, find the first entry whose key's first length characters are
+	 * 					greater than the string instead.
+	 * @return	The position of the entry, or the number of entries if there is none.
+	 */
+	unsigned int search(unsigned int first, const char *text, unsigned int length, bool upper) const;
+
+	/**
+	 * Sort the matches, keep the fewest edits of each name, and truncate them.
+	 * @param	matches		The matches with the positions at which they start. This will be modified.
+	 * @param	maxResults	The maximum number of names.
+	 * @param	result		The names. This will be modified.
+	 */
+	void rank(std::vector<std::pair<LOSMNameMatch, unsigned int> > &matches, unsigned int maxResults,
+			std::vector<LOSMNameMatch> &result) const;
+
+	/**
+	 * The graph indexed.
+	 */
+	std::shared_ptr<const LOSMGraph> graph;
+
+	/**
+	 * The keys of the names, concatenated.
+	 */
+	std::string keys;
+
+	/**
+	 * The first character of each name's key in keys, followed by the total length.
+	 */
+	std::vector<unsigned int> keyOffsets;
+
+	/**
+	 * The edge or landmark whose spelling of each name was found first, where landmarks are
+	 * numbered after the edges.
+	 */
+	std::vector<unsigned int> spellings;
+
+	/**
+	 * The entries, sorted by key, then by name.
+	 */
+	std::vector<Entry> entries;
+
+	/**
+	 * The first edge of each name in edges, followed by the number of edges.
+	 */
+	std::vector<unsigned int> edgeOffsets;
+
+	/**
+	 * The edges of each name.
+	 */
+	std::vector<unsigned int> edges;
+
+	/**
+	 * The first landmark of each name in landmarks, followed by the number of landmarks.
+	 */
+	std::vector<unsigned int> landmarkOffsets;
+
+	/**
+	 * The landmarks of each name.
+	 */
+	std::vector<unsigned int> landmarks;
+
+};
+
+
+#endif // LOSM_NAME_INDEX_H
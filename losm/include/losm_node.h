@@ -43,7 +43,7 @@ public:
 	 * @param	y		The y coordinate (longitude).
 	 * @param	degree	The degree of the node, meaning how many edges involve it.
 	 */
-	LOSMNode(unsigned long uid, float x, float y, unsigned int degree);
+	LOSMNode(unsigned long uid, double x, double y, unsigned int degree);
 
 	/**
 	 * The default deconstructor for the LOSMNode class.
@@ -68,6 +68,18 @@ public:
 	 */
 	float get_y() const;
 
+	/**
+	 * Get the x coordinate (latitude) in fixed-point units of 1e-7 degrees.
+	 * @return	The x-coordinate (latitude) in fixed point.
+	 */
+	int get_fixed_x() const;
+
+	/**
+	 * Get the y coordinate (longitude) in fixed-point units of 1e-7 degrees.
+	 * @return	The y-coordinate (longitude) in fixed point.
+	 */
+	int get_fixed_y() const;
+
 	/**
 	 * Get the degree of the node.
 	 * @return	The degree of the node.
@@ -89,14 +101,14 @@ private:
 	unsigned long uid;
 
 	/**
-	 * The x coordinate (latitude).
+	 * The x coordinate (latitude) in fixed-point units of 1e-7 degrees.
 	 */
-	float x;
+	int x;
 
 	/**
-	 * The y coordinate (longitude).
+	 * The y coordinate (longitude) in fixed-point units of 1e-7 degrees.
 	 */
-	float y;
+	int y;
 
 	/**
 	 * The degree of the node, meaning how many edges involve it.
@@ -0,0 +1,153 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef LOSM_OVERLAY_H
+#define LOSM_OVERLAY_H
+
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+
+#include "losm_graph.h"
+#include "losm_query_context.h"
+
+/**
+ * The cost of a route from a node to a boundary node of its cell.
+ */
+struct LOSMBoundaryCost {
+	/**
+	 * The unique identifier of the boundary node.
+	 */
+	unsigned long uid;
+
+	/**
+	 * The cost of the route.
+	 */
+	float cost;
+};
+
+/**
+ * The overlay written by LOSMPartition::save(), which connects the shards of a partitioned map.
+ * Its nodes are the boundary nodes of every cell, and its edges are the edges between cells and
+ * the cheapest routes within each cell between its boundary nodes.
+ *
+ * A route between nodes of different cells leaves the source's cell at one of its boundary
+ * nodes and enters the target's cell at one of its boundary nodes, so its cost is found from
+ * the costs from the source to its cell's boundary nodes (computed on the source's shard), the
+ * same for the target on its shard, and a search of the overlay between them. For nodes of the
+ * same cell, the cheapest route may also stay within the cell, so the shard's own cost must be
+ * compared as well. Nothing is modified after loading, so any number of threads may query the
+ * same LOSMOverlay concurrently.
+ */
+class LOSMOverlay {
+public:
+	/**
+	 * The constructor for the LOSMOverlay class, which loads the overlay files of a directory.
+	 * @param	directory		The directory written by LOSMPartition::save().
+	 * @throw	LOSMException	The files could not be loaded.
+	 */
+	LOSMOverlay(std::string directory);
+
+	/**
+	 * The default deconstructor for the LOSMOverlay class.
+	 */
+	virtual ~LOSMOverlay();
+
+	/**
+	 * Get the number of boundary nodes.
+	 * @return	The number of boundary nodes.
+	 */
+	unsigned int get_num_nodes() const;
+
+	/**
+	 * Get the number of overlay edges.
+	 * @return	The number of overlay edges.
+	 */
+	unsigned int get_num_edges() const;
+
+	/**
+	 * Get the cell of a boundary node.
+	 * @param	uid		The unique identifier of the node.
+	 * @return	The cell of the node, or LOSMGraph::INVALID_INDEX if it is not a boundary node.
+	 */
+	unsigned int get_cell(unsigned long uid) const;
+
+	/**
+	 * Find the costs from a node to the boundary nodes of its cell, on the cell's shard.
+	 * @param	shard			A query context of the shard of the node's cell.
+	 * @param	node			The node.
+	 * @param	cost			The type of cost.
+	 * @param	result			The costs to the reachable boundary nodes. This will be modified.
+	 * @throw	LOSMException	The node does not belong to the shard.
+	 */
+	void find_boundary_costs(LOSMQueryContext &shard, const LOSMNode *node, LOSMCost cost,
+			std::vector<LOSMBoundaryCost> &result) const;
+
+	/**
+	 * Find the cost of the cheapest route through the overlay between the boundary nodes of a
+	 * source and those of a target.
+	 * @param	sourceCosts		The costs from the source to the boundary nodes of its cell.
+	 * @param	targetCosts		The costs from the target to the boundary nodes of its cell.
+	 * @param	cost			The type of cost.
+	 * @return	The cost of the cheapest route, or infinity if there is none.
+	 */
+	float find_distance(const std::vector<LOSMBoundaryCost> &sourceCosts,
+			const std::vector<LOSMBoundaryCost> &targetCosts, LOSMCost cost) const;
+
+private:
+	/**
+	 * Get the index of a boundary node.
+	 * @param	uid		The unique identifier of the node.
+	 * @return	The index of the node, or LOSMGraph::INVALID_INDEX if it is not a boundary node.
+	 */
+	unsigned int get_node_index(unsigned long uid) const;
+
+	/**
+	 * The index of each boundary node's unique identifier.
+	 */
+	std::unordered_map<unsigned long, unsigned int> nodeIndices;
+
+	/**
+	 * The cell of each boundary node.
+	 */
+	std::vector<unsigned int> cells;
+
+	/**
+	 * The adjacency of each boundary node as a compressed sparse row: the neighbors of node i
+	 * are adjacentNodes[offsets[i]] to adjacentNodes[offsets[i + 1] - 1].
+	 */
+	std::vector<unsigned int> offsets;
+	std::vector<unsigned int> adjacentNodes;
+
+	/**
+	 * The distance (in miles) and travel time (in hours) of each adjacency slot.
+	 */
+	std::vector<float> adjacentDistances;
+	std::vector<float> adjacentTravelTimes;
+
+};
+
+
+#endif // LOSM_OVERLAY_H
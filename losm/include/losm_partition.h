@@ -0,0 +1,158 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef LOSM_PARTITION_H
+#define LOSM_PARTITION_H
+
+
+#include <memory>
+#include <vector>
+#include <string>
+
+#include "losm_graph.h"
+
+/**
+ * A partition of a LOSMGraph into balanced, geographically compact cells with few edges between
+ * them, so that a map too large for one process can be served as shards.
+ *
+ * The cells are found by recursive bisection: each set of nodes is sorted by its coordinates
+ * along whichever of four directions (north, east, and the two diagonals) cuts the fewest edges,
+ * and split so that the number of nodes on each side is proportional to its number of cells.
+ * A node with an edge to another cell is a boundary node.
+ *
+ * save() writes each cell as a shard of nodes, edges, and landmarks files in the LOSM format,
+ * holding the edges within the cell, together with the overlay files read by LOSMOverlay:
+ *  - "overlay_nodes.dat", with lines "boundary node UID, cell";
+ *  - "overlay_edges.dat", with lines "node UID 1, node UID 2, distance, travel time, cell". A
+ *    line with a cell of -1 is an edge between cells; otherwise, it is the cheapest route within
+ *    the cell between two of its boundary nodes, in distance (miles) and travel time (hours).
+ */
+class LOSMPartition {
+public:
+	/**
+	 * The constructor for the LOSMPartition class, which partitions a graph.
+	 * @param	graph			The graph to partition.
+	 * @param	numCells		The number of cells.
+	 * @throw	LOSMException	The graph was null, or the number of cells was zero.
+	 */
+	LOSMPartition(std::shared_ptr<const LOSMGraph> graph, unsigned int numCells);
+
+	/**
+	 * The default deconstructor for the LOSMPartition class.
+	 */
+	virtual ~LOSMPartition();
+
+	/**
+	 * Get the number of cells.
+	 * @return	The number of cells.
+	 */
+	unsigned int get_num_cells() const;
+
+	/**
+	 * Get the cell of a node.
+	 * @param	node	The index of the node.
+	 * @return	The cell of the node.
+	 */
+	unsigned int get_cell(unsigned int node) const;
+
+	/**
+	 * Get the nodes of a cell.
+	 * @param	cell	The cell.
+	 * @return	The indices of the nodes of the cell, in increasing order.
+	 */
+	const std::vector<unsigned int> &get_nodes(unsigned int cell) const;
+
+	/**
+	 * Get the boundary nodes of a cell.
+	 * @param	cell	The cell.
+	 * @return	The indices of the boundary nodes of the cell, in increasing order.
+	 */
+	const std::vector<unsigned int> &get_boundary_nodes(unsigned int cell) const;
+
+	/**
+	 * Get the edges between cells.
+	 * @return	The indices of the edges between cells, in increasing order.
+	 */
+	const std::vector<unsigned int> &get_cut_edges() const;
+
+	/**
+	 * Write the shard of every cell and the overlay to a directory, creating it if necessary.
+	 * The shard of cell c is "cell<c>_nodes.dat", "cell<c>_edges.dat", and
+	 * "cell<c>_landmarks.dat"; each landmark goes to the cell of its nearest node.
+	 * @param	directory		The directory.
+	 * @throw	LOSMException	A file could not be written.
+	 */
+	void save(std::string directory) const;
+
+private:
+	/**
+	 * Split a set of nodes into cells, recursively.
+	 * @param	nodes		The nodes to split. This will be reordered.
+	 * @param	first		The first of the nodes to split.
+	 * @param	last		One past the last of the nodes to split.
+	 * @param	numCells	The number of cells to split them into.
+	 * @param	firstCell	The first of those cells.
+	 * @param	sides		The side of each node in the set being split, or -1 for nodes
+	 * 						outside it. This is restored before returning.
+	 */
+	void bisect(std::vector<unsigned int> &nodes, unsigned int first, unsigned int last,
+			unsigned int numCells, unsigned int firstCell, std::vector<int> &sides);
+
+	/**
+	 * Find the cheapest routes within a cell from one of its boundary nodes to the others.
+	 * @param	source		The index of the boundary node.
+	 * @param	cost		The type of cost.
+	 * @param	costs		The cost of each node, or infinity if unreachable within the cell.
+	 * 						This must have one element per node, all infinity. This will be
+	 * 						modified, and the caller must restore it using reached.
+	 * @param	reached		The nodes reached. This will be modified.
+	 */
+	void search_cell(unsigned int source, LOSMCost cost, std::vector<float> &costs,
+			std::vector<unsigned int> &reached) const;
+
+	/**
+	 * The graph being partitioned.
+	 */
+	std::shared_ptr<const LOSMGraph> graph;
+
+	/**
+	 * The cell of each node.
+	 */
+	std::vector<unsigned int> cells;
+
+	/**
+	 * The nodes and boundary nodes of each cell.
+	 */
+	std::vector<std::vector<unsigned int> > cellNodes;
+	std::vector<std::vector<unsigned int> > boundaryNodes;
+
+	/**
+	 * The edges between cells.
+	 */
+	std::vector<unsigned int> cutEdges;
+
+};
+
+
+#endif // LOSM_PARTITION_H
@@ -0,0 +1,652 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef LOSM_QUERY_CONTEXT_H
+#define LOSM_QUERY_CONTEXT_H
+
+
+#include <memory>
+#include <vector>
+#include <utility>
+
+#include "losm_graph.h"
+#include "losm_speed_profiles.h"
+
+/**
+ * A route through a LOSMGraph.
+ */
+struct LOSMRoute {
+	/**
+	 * If a route was found.
+	 */
+	bool found;
+
+	/**
+	 * The total cost of the route, or infinity if no route was found.
+	 */
+	float cost;
+
+	/**
+	 * The nodes visited, from the source to the target.
+	 */
+	std::vector<const LOSMNode *> nodes;
+
+	/**
+	 * The edges traversed, with one fewer element than nodes.
+	 */
+	std::vector<const LOSMEdge *> edges;
+};
+
+/**
+ * A request for every node reachable from a source within a budget.
+ */
+struct LOSMReachabilityRequest {
+	/**
+	 * The source node.
+	 */
+	const LOSMNode *source;
+
+	/**
+	 * The budget, in miles for distance or hours for travel time.
+	 */
+	float budget;
+
+	/**
+	 * The type of cost the budget bounds.
+	 */
+	LOSMCost cost;
+
+	/**
+	 * If the cost of each reachable node is wanted.
+	 */
+	bool includeCosts;
+
+	/**
+	 * If the edges leaving the reachable region are wanted.
+	 */
+	bool includeBoundaryEdges;
+};
+
+/**
+ * The nodes reachable from a source within a budget, as indices in the LOSMGraph.
+ */
+struct LOSMReachability {
+	/**
+	 * The reachable nodes, in order of nondecreasing cost from the source.
+	 */
+	std::vector<unsigned int> nodes;
+
+	/**
+	 * The cost of each reachable node, if requested, or empty otherwise.
+	 */
+	std::vector<float> costs;
+
+	/**
+	 * The edges from a reachable node to an unreachable one, if requested, or empty otherwise.
+	 */
+	std::vector<unsigned int> boundaryEdges;
+};
+
+/**
+ * One objective of a lexicographic route search.
+ */
+struct LOSMObjective {
+	/**
+	 * The type of cost, used if edgeCosts is null.
+	 */
+	LOSMCost cost;
+
+	/**
+	 * The non-negative cost of each edge, e.g., a penalty on roads which are not autonomy-capable,
+	 * or null to use cost instead. This must outlive the search.
+	 */
+	const std::vector<float> *edgeCosts;
+
+	/**
+	 * The slack: how much more than its optimal cost a route may have in this objective so as
+	 * to reduce the cost of later ones.
+	 */
+	float slack;
+};
+
+/**
+ * A request for the lexicographically optimal route between two nodes.
+ */
+struct LOSMLexicographicRequest {
+	/**
+	 * The source node.
+	 */
+	const LOSMNode *source;
+
+	/**
+	 * The target node.
+	 */
+	const LOSMNode *target;
+
+	/**
+	 * The objectives, in order of priority. The slack of the last one is unused.
+	 */
+	std::vector<LOSMObjective> objectives;
+
+	/**
+	 * The maximum number of labels created in any one stage, or zero for no limit.
+	 */
+	unsigned int maxLabels;
+};
+
+/**
+ * A lexicographically optimal route through a LOSMGraph.
+ */
+struct LOSMLexicographicRoute {
+	/**
+	 * If a route was found; false if the target is unreachable or the label limit was hit.
+	 */
+	bool found;
+
+	/**
+	 * The cost of the route in each objective, or empty if no route was found.
+	 */
+	std::vector<float> costs;
+
+	/**
+	 * The nodes visited, from the source to the target.
+	 */
+	std::vector<const LOSMNode *> nodes;
+
+	/**
+	 * The edges traversed, with one fewer element than nodes.
+	 */
+	std::vector<const LOSMEdge *> edges;
+};
+
+/**
+ * A request for the k cheapest loopless routes between two nodes.
+ */
+struct LOSMKShortestRequest {
+	/**
+	 * The source node.
+	 */
+	const LOSMNode *source;
+
+	/**
+	 * The target node.
+	 */
+	const LOSMNode *target;
+
+	/**
+	 * The type of cost to minimize.
+	 */
+	LOSMCost cost;
+
+	/**
+	 * The number of routes wanted.
+	 */
+	unsigned int k;
+};
+
+/**
+ * A request for the cheapest route between two nodes and diverse alternatives to it.
+ */
+struct LOSMAlternativeRequest {
+	/**
+	 * The source node.
+	 */
+	const LOSMNode *source;
+
+	/**
+	 * The target node.
+	 */
+	const LOSMNode *target;
+
+	/**
+	 * The type of cost to minimize.
+	 */
+	LOSMCost cost;
+
+	/**
+	 * The maximum number of routes, including the cheapest one.
+	 */
+	unsigned int maxRoutes;
+
+	/**
+	 * The maximum cost of an alternative, as a multiple of the cheapest route's cost, e.g., 1.25.
+	 */
+	float maxStretch;
+
+	/**
+	 * The maximum fraction of an alternative's cost which it may share with any route found
+	 * before it, e.g., 0.6; lower values give more diverse routes.
+	 */
+	float maxSharing;
+
+	/**
+	 * The fraction by which the costs of the edges of found routes are raised, each time they
+	 * are found, when searching for more alternatives than the plateaus provide, e.g., 0.5.
+	 */
+	float penalty;
+};
+
+/**
+ * The scratch memory for queries over a shared LOSMGraph. A LOSMQueryContext is not thread-safe,
+ * so each thread must use its own; the memory is reused from one query to the next, so that a
+ * query only touches the part of the graph it explores.
+ */
+class LOSMQueryContext {
+public:
+	/**
+	 * The constructor for the LOSMQueryContext class.
+	 * @param	graph			The graph to query.
+	 * @throw	LOSMException	The graph was null.
+	 */
+	LOSMQueryContext(std::shared_ptr<const LOSMGraph> graph);
+
+	/**
+	 * The default deconstructor for the LOSMQueryContext class.
+	 */
+	virtual ~LOSMQueryContext();
+
+	/**
+	 * Get the graph this context queries.
+	 * @return	The graph.
+	 */
+	const LOSMGraph *get_graph() const;
+
+	/**
+	 * Find the node nearest to the coordinate provided.
+	 * @param	x	The x coordinate (latitude).
+	 * @param	y	The y coordinate (longitude).
+	 * @return	The nearest node, or nullptr if the graph has no nodes.
+	 */
+	const LOSMNode *find_nearest_node(float x, float y);
+
+	/**
+	 * Find the cost of the cheapest route between two nodes.
+	 * @param	source			The source node.
+	 * @param	target			The target node.
+	 * @param	cost			The type of cost.
+	 * @return	The cost of the cheapest route, or infinity if the target is unreachable.
+	 * @throw	LOSMException	One of the nodes does not belong to the graph.
+	 */
+	float find_distance(const LOSMNode *source, const LOSMNode *target, LOSMCost cost);
+
+	/**
+	 * Find the cheapest route between two nodes.
+	 * @param	source			The source node.
+	 * @param	target			The target node.
+	 * @param	cost			The type of cost.
+	 * @param	route			The resultant route. This will be modified.
+	 * @throw	LOSMException	One of the nodes does not belong to the graph.
+	 */
+	void find_route(const LOSMNode *source, const LOSMNode *target, LOSMCost cost, LOSMRoute &route);
+
+	/**
+	 * Find the quickest route between two nodes for a time of departure, with the travel time of
+	 * each edge given by speed profiles when the vehicle enters it.
+	 * @param	source			The source node.
+	 * @param	target			The target node.
+	 * @param	profiles		The speed profiles of the graph's edges.
+	 * @param	departure		The time of departure (in hours since midnight).
+	 * @param	route			The resultant route, whose cost is its travel time (in hours).
+	 * 							This will be modified.
+	 * @throw	LOSMException	One of the nodes does not belong to the graph, or the profiles
+	 * 							are of a different graph.
+	 */
+	void find_time_dependent_route(const LOSMNode *source, const LOSMNode *target,
+			const LOSMSpeedProfiles &profiles, float departure, LOSMRoute &route);
+
+	/**
+	 * Find every node reachable from a source within a budget.
+	 * @param	request			The request.
+	 * @param	result			The resultant reachable nodes. This will be modified.
+	 * @throw	LOSMException	The source does not belong to the graph.
+	 */
+	void find_reachable(const LOSMReachabilityRequest &request, LOSMReachability &result);
+
+	/**
+	 * Find the lexicographically optimal route between two nodes with slack. With OPT(i) the
+	 * cheapest cost in objective i over the routes within the slack of every earlier objective,
+	 * i.e., whose cost in each objective j < i is at most OPT(j) + slack(j), this finds a route
+	 * of cost OPT(i) in the last objective.
+	 *
+	 * The bounds on each objective are computed by Dijkstra's algorithm from the target; the
+	 * nodes from which the first objective cannot be met are pruned. Each later objective is
+	 * then a multi-criteria label-setting search, ordered by the objective plus its bound, which
+	 * keeps only the labels that are not dominated in the objectives so far and that can still
+	 * meet the earlier limits.
+	 * @param	request			The request.
+	 * @param	route			The resultant route. This will be modified.
+	 * @throw	LOSMException	A node does not belong to the graph, there were no objectives,
+	 * 							or an objective had the wrong number of edge costs.
+	 */
+	void find_lexicographic_route(const LOSMLexicographicRequest &request, LOSMLexicographicRoute &route);
+
+	/**
+	 * Find the k cheapest loopless routes between two nodes with Yen's algorithm. Each spur
+	 * search is an A* search guided by the exact costs to the target from one reverse search,
+	 * and only deviates from a route after the point where that route deviated from its parent.
+	 * @param	request		The request.
+	 * @param	routes		The routes, in order of nondecreasing cost; fewer than k if there are
+	 * 						not that many. This will be modified.
+	 */
+	void find_k_shortest_routes(const LOSMKShortestRequest &request, std::vector<LOSMRoute> &routes);
+
+	/**
+	 * Find the cheapest route between two nodes and alternatives to it. Candidates are first
+	 * taken from the plateaus of the forward and reverse shortest path trees, i.e., the stretches
+	 * shared by both trees, longest first; each is the cheapest route through its plateau. If
+	 * these do not yield enough routes, the edges of the routes found so far are penalized and
+	 * the search is repeated. A candidate is kept only if it has no loops, its cost is within
+	 * the stretch bound, and it shares at most the allowed fraction of its cost with each route
+	 * kept before it.
+	 * @param	request		The request.
+	 * @param	routes		The cheapest route followed by the alternatives, in order of
+	 * 						nondecreasing cost, or empty if the target is unreachable. This
+	 * 						will be modified.
+	 */
+	void find_alternative_routes(const LOSMAlternativeRequest &request, std::vector<LOSMRoute> &routes);
+
+	/**
+	 * Run Dijkstra's algorithm from a source node index until the target node index is settled.
+	 * Afterwards, get_cost() and get_parent_edge() describe every settled node.
+	 * @param	source	The index of the source node.
+	 * @param	target	The index of the target node, or LOSMGraph::INVALID_INDEX to settle all.
+	 * @param	cost	The type of cost.
+	 * @return	The cost of the target, or infinity if it is unreachable or no target was given.
+	 */
+	float search(unsigned int source, unsigned int target, LOSMCost cost);
+
+	/**
+	 * Run the time-dependent variant of Dijkstra's algorithm from a source node index until the
+	 * target node index is settled, with the cost of each node the travel time to it. Given a
+	 * target, the search is directed by A* with the great-circle distance at the fastest speed of
+	 * the profiles. Afterwards, get_cost() and get_parent_edge() describe every settled node.
+	 * @param	source		The index of the source node.
+	 * @param	target		The index of the target node, or LOSMGraph::INVALID_INDEX to settle all.
+	 * @param	profiles	The speed profiles of the graph's edges.
+	 * @param	departure	The time of departure (in hours since midnight).
+	 * @return	The travel time to the target, or infinity if it is unreachable or no target was given.
+	 */
+	float search_time_dependent(unsigned int source, unsigned int target, const LOSMSpeedProfiles &profiles,
+			float departure);
+
+	/**
+	 * Run Dijkstra's algorithm from a source node index, settling only the nodes whose cost is
+	 * within a budget. Afterwards, get_settled_nodes() lists them, and get_cost() and
+	 * get_parent_edge() describe them; every other node is unreached.
+	 * @param	source	The index of the source node.
+	 * @param	budget	The maximum cost of a settled node.
+	 * @param	cost	The type of cost.
+	 */
+	void search_bounded(unsigned int source, float budget, LOSMCost cost);
+
+	/**
+	 * Get the nodes settled by the last bounded search.
+	 * @return	The indices of the settled nodes, in order of nondecreasing cost.
+	 */
+	const std::vector<unsigned int> &get_settled_nodes() const;
+
+	/**
+	 * Get the cost of a node found by the last search.
+	 * @param	node	The index of the node.
+	 * @return	The cost of the node, or infinity if the last search did not reach it.
+	 */
+	float get_cost(unsigned int node) const;
+
+	/**
+	 * Get the edge through which the last search reached a node.
+	 * @param	node	The index of the node.
+	 * @return	The index of the edge, or LOSMGraph::INVALID_INDEX for the source or
+	 * 			unreached nodes.
+	 */
+	unsigned int get_parent_edge(unsigned int node) const;
+
+private:
+	/**
+	 * A label of the lexicographic search: a route from the source to a node, whose costs are
+	 * stored separately in labelCosts.
+	 */
+	struct Label {
+		/**
+		 * The node at which the route ends.
+		 */
+		unsigned int node;
+
+		/**
+		 * The label this extends, or LOSMGraph::INVALID_INDEX for the source.
+		 */
+		unsigned int parent;
+
+		/**
+		 * The edge from the parent's node to this node.
+		 */
+		unsigned int edge;
+
+		/**
+		 * The next label at the same node, or LOSMGraph::INVALID_INDEX.
+		 */
+		unsigned int next;
+
+		/**
+		 * If the label has not been dominated.
+		 */
+		bool live;
+	};
+
+	/**
+	 * A loopless route found by the k-shortest or alternative route search.
+	 */
+	struct Path {
+		/**
+		 * The nodes visited, from the source to the target.
+		 */
+		std::vector<unsigned int> nodes;
+
+		/**
+		 * The edges traversed, with one fewer element than nodes.
+		 */
+		std::vector<unsigned int> edges;
+
+		/**
+		 * The total cost of the route.
+		 */
+		float cost;
+
+		/**
+		 * The position of the node at which the route deviates from the route it was spurred
+		 * from, or zero.
+		 */
+		unsigned int deviation;
+	};
+
+	/**
+	 * Run Dijkstra's algorithm from a target node index into the reverse costs and parent edges,
+	 * settling only the nodes whose cost is within a budget.
+	 * @param	target	The index of the target node.
+	 * @param	budget	The maximum cost of a settled node, or infinity to settle all.
+	 * @param	cost	The type of cost.
+	 */
+	void search_reverse(unsigned int target, float budget, LOSMCost cost);
+
+	/**
+	 * Run A* from a source node index to the target node index of the last reverse search,
+	 * guided by its costs, which are exact lower bounds. Nodes and edges whose block stamp is
+	 * the current block stamp are avoided, the cost of each edge is scaled by its edge factor,
+	 * and nodes the reverse search did not settle are never entered. Afterwards, the costs and
+	 * parent edges describe the route found, as after search().
+	 * @param	source	The index of the source node.
+	 * @param	target	The index of the target node.
+	 * @param	cost	The type of cost.
+	 * @return	The scaled cost of the target, or infinity if it is unreachable.
+	 */
+	float search_guided(unsigned int source, unsigned int target, LOSMCost cost);
+
+	/**
+	 * Append the route of the last search from a source to a target to a path.
+	 * @param	source	The index of the source node.
+	 * @param	target	The index of the target node, which the last search reached.
+	 * @param	path	The path, whose last node must be the source. This will be modified.
+	 */
+	void append_path(unsigned int source, unsigned int target, Path &path) const;
+
+	/**
+	 * Advance the block stamp, so that no node or edge is blocked.
+	 */
+	void clear_blocks();
+
+	/**
+	 * Convert a path into a route.
+	 * @param	path	The path.
+	 * @param	route	The route. This will be modified.
+	 */
+	void convert_path(const Path &path, LOSMRoute &route) const;
+
+	/**
+	 * Follow the parent edges of the last search back from a target to build a route.
+	 * @param	source	The index of the source node.
+	 * @param	target	The index of the target node, which the last search reached.
+	 * @param	route	The route, whose nodes and edges are appended. This will be modified.
+	 */
+	void build_route(unsigned int source, unsigned int target, LOSMRoute &route) const;
+
+	/**
+	 * Get the cost of an edge in an objective.
+	 * @param	objective	The objective.
+	 * @param	edge		The index of the edge.
+	 * @return	The cost of the edge.
+	 */
+	float get_objective_cost(const LOSMObjective &objective, unsigned int edge) const;
+
+	/**
+	 * Compute the bounds of every objective from the target, over the nodes from which the
+	 * first objective's limit can be met, and set that limit.
+	 * @param	source		The index of the source node.
+	 * @param	target		The index of the target node.
+	 * @param	objectives	The objectives.
+	 * @param	limits		The limit of each objective. This will be modified.
+	 * @return	True if the target is reachable from the source, false otherwise.
+	 */
+	bool compute_bounds(unsigned int source, unsigned int target, const std::vector<LOSMObjective> &objectives,
+			std::vector<float> &limits);
+
+	/**
+	 * Search for the cheapest route in one objective which meets the limits of the earlier ones.
+	 * @param	source		The index of the source node.
+	 * @param	target		The index of the target node.
+	 * @param	objectives	The objectives.
+	 * @param	stage		The objective to minimize.
+	 * @param	limits		The limit of each earlier objective.
+	 * @param	maxLabels	The maximum number of labels, or zero for no limit.
+	 * @return	The label which reached the target, or LOSMGraph::INVALID_INDEX if none did.
+	 */
+	unsigned int search_labels(unsigned int source, unsigned int target, const std::vector<LOSMObjective> &objectives,
+			unsigned int stage, const std::vector<float> &limits, unsigned int maxLabels);
+
+	/**
+	 * The graph being queried.
+	 */
+	std::shared_ptr<const LOSMGraph> graph;
+
+	/**
+	 * The tentative cost of each node; only valid if the node's stamp is the current stamp.
+	 */
+	std::vector<float> costs;
+
+	/**
+	 * The edge through which each node was reached.
+	 */
+	std::vector<unsigned int> parentEdges;
+
+	/**
+	 * The search which last wrote each node's cost; this avoids clearing costs between searches.
+	 */
+	std::vector<unsigned int> stamps;
+
+	/**
+	 * The stamp of the current search.
+	 */
+	unsigned int currentStamp;
+
+	/**
+	 * The binary heap of (cost, node index) pairs, with the cheapest on top.
+	 */
+	std::vector<std::pair<float, unsigned int> > heap;
+
+	/**
+	 * The nodes settled by the last bounded search, in order.
+	 */
+	std::vector<unsigned int> settled;
+
+	/**
+	 * The cost to the target of each node in the last reverse search, the edge through which
+	 * it was reached from the target, and the reverse search which last wrote it.
+	 */
+	std::vector<float> reverseCosts;
+	std::vector<unsigned int> reverseParentEdges;
+	std::vector<unsigned int> reverseStamps;
+	unsigned int currentReverseStamp;
+
+	/**
+	 * The spur search which last blocked each node and edge, and the current one.
+	 */
+	std::vector<unsigned int> nodeBlocks;
+	std::vector<unsigned int> edgeBlocks;
+	unsigned int currentBlock;
+
+	/**
+	 * The factor by which each edge's cost is scaled in guided searches, which is one outside
+	 * the penalty search of find_alternative_routes().
+	 */
+	std::vector<float> edgeFactors;
+
+	/**
+	 * The bound of each objective at each node, indexed by objective * nodes + node; only valid
+	 * if the node's bound stamp is the current bound stamp.
+	 */
+	std::vector<float> bounds;
+
+	/**
+	 * The lexicographic search which last bounded each node, and the current one.
+	 */
+	std::vector<unsigned int> boundStamps;
+	unsigned int currentBoundStamp;
+
+	/**
+	 * The labels of the current stage of the lexicographic search.
+	 */
+	std::vector<Label> labels;
+
+	/**
+	 * The costs of each label, with one element per objective.
+	 */
+	std::vector<float> labelCosts;
+
+	/**
+	 * The first label at each node; only valid if the node's stamp is the current stamp.
+	 */
+	std::vector<unsigned int> labelHeads;
+
+};
+
+
+#endif // LOSM_QUERY_CONTEXT_H
@@ -0,0 +1,303 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef LOSM_QUERY_EXECUTOR_H
+#define LOSM_QUERY_EXECUTOR_H
+
+
+#include <memory>
+#include <vector>
+#include <future>
+#include <functional>
+#include <exception>
+
+#include "losm_graph.h"
+#include "losm_query_context.h"
+#include "losm_thread_pool.h"
+#include "losm_edge_index.h"
+
+/**
+ * A request for the node nearest to a coordinate.
+ */
+struct LOSMNearestNodeRequest {
+	/**
+	 * The x coordinate (latitude).
+	 */
+	float x;
+
+	/**
+	 * The y coordinate (longitude).
+	 */
+	float y;
+};
+
+/**
+ * A request for the route, or only its cost, between two nodes.
+ */
+struct LOSMRouteRequest {
+	/**
+	 * The source node.
+	 */
+	const LOSMNode *source;
+
+	/**
+	 * The target node.
+	 */
+	const LOSMNode *target;
+
+	/**
+	 * The type of cost to minimize.
+	 */
+	LOSMCost cost;
+};
+
+/**
+ * A request for the quickest route between two nodes for a time of departure.
+ */
+struct LOSMTimeDependentRouteRequest {
+	/**
+	 * The source node.
+	 */
+	const LOSMNode *source;
+
+	/**
+	 * The target node.
+	 */
+	const LOSMNode *target;
+
+	/**
+	 * The time of departure (in hours since midnight).
+	 */
+	float departure;
+};
+
+/**
+ * A class which answers batches of queries over a shared LOSMGraph on a work-stealing thread
+ * pool, with one LOSMQueryContext per worker. Every method returns immediately; the results
+ * are delivered through a future or, for the callback variants, as each request completes.
+ * The methods themselves may be called from any number of threads.
+ */
+class LOSMQueryExecutor {
+public:
+	/**
+	 * The constructor for the LOSMQueryExecutor class.
+	 * @param	graph			The graph to query.
+	 * @param	numThreads		The number of workers. Zero uses the hardware concurrency.
+	 * @throw	LOSMException	The graph was null.
+	 */
+	LOSMQueryExecutor(std::shared_ptr<const LOSMGraph> graph, unsigned int numThreads = 0);
+
+	/**
+	 * The deconstructor for the LOSMQueryExecutor class, which waits for all pending requests.
+	 */
+	virtual ~LOSMQueryExecutor();
+
+	/**
+	 * Get the graph being queried.
+	 * @return	The graph.
+	 */
+	std::shared_ptr<const LOSMGraph> get_graph() const;
+
+	/**
+	 * Find the nearest node for each request.
+	 * @param	requests	The requests.
+	 * @return	The future of the nearest node for each request, in order.
+	 */
+	std::future<std::vector<const LOSMNode *> > find_nearest_nodes(
+			const std::vector<LOSMNearestNodeRequest> &requests);
+
+	/**
+	 * Find the closest point on the closest edge for each request.
+	 * @param	requests	The requests.
+	 * @param	index		The R-tree over the graph's edges.
+	 * @return	The future of the closest point for each request, in order. If the index is of
+	 * 			a different graph, then the future holds a LOSMException instead.
+	 */
+	std::future<std::vector<LOSMEdgeProjection> > find_nearest_edges(
+			const std::vector<LOSMNearestNodeRequest> &requests, std::shared_ptr<const LOSMEdgeIndex> index);
+
+	/**
+	 * Find the cheapest route for each request.
+	 * @param	requests	The requests.
+	 * @return	The future of the route for each request, in order. If a request refers to
+	 * 			a node not in the graph, then the future holds a LOSMException instead.
+	 */
+	std::future<std::vector<LOSMRoute> > find_routes(const std::vector<LOSMRouteRequest> &requests);
+
+	/**
+	 * Find the cost of the cheapest route for each request.
+	 * @param	requests	The requests.
+	 * @return	The future of the cost for each request, in order, with infinity for
+	 * 			unreachable targets. If a request refers to a node not in the graph, then the
+	 * 			future holds a LOSMException instead.
+	 */
+	std::future<std::vector<float> > find_distances(const std::vector<LOSMRouteRequest> &requests);
+
+	/**
+	 * Find the cheapest route for each request, calling a callback as each one completes.
+	 * The callback is called concurrently from the workers, and must not throw.
+	 * @param	requests	The requests.
+	 * @param	callback	The callback of the request's index and its route.
+	 * @return	The future which is ready once every callback has returned.
+	 */
+	std::future<void> find_routes(const std::vector<LOSMRouteRequest> &requests,
+			std::function<void (unsigned int, const LOSMRoute &)> callback);
+
+	/**
+	 * Find the cost of the cheapest route for each request, calling a callback as each one
+	 * completes. The callback is called concurrently from the workers, and must not throw.
+	 * @param	requests	The requests.
+	 * @param	callback	The callback of the request's index and its cost.
+	 * @return	The future which is ready once every callback has returned.
+	 */
+	std::future<void> find_distances(const std::vector<LOSMRouteRequest> &requests,
+			std::function<void (unsigned int, float)> callback);
+
+	/**
+	 * Find the quickest route for each request, given the speed profiles of the edges.
+	 * @param	requests	The requests.
+	 * @param	profiles	The speed profiles of the graph's edges.
+	 * @return	The future of the route for each request, in order, with costs in hours. If a
+	 * 			request refers to a node not in the graph, or the profiles are null or of a
+	 * 			different graph, then the future holds a LOSMException instead.
+	 */
+	std::future<std::vector<LOSMRoute> > find_time_dependent_routes(
+			const std::vector<LOSMTimeDependentRouteRequest> &requests,
+			std::shared_ptr<const LOSMSpeedProfiles> profiles);
+
+	/**
+	 * Find every node reachable within the budget of each request.
+	 * @param	requests	The requests.
+	 * @return	The future of the reachable nodes for each request, in order. If a request
+	 * 			refers to a node not in the graph, then the future holds a LOSMException instead.
+	 */
+	std::future<std::vector<LOSMReachability> > find_reachable(
+			const std::vector<LOSMReachabilityRequest> &requests);
+
+	/**
+	 * Find every node reachable within the budget of each request, calling a callback as each
+	 * one completes. The callback is called concurrently from the workers, and must not throw.
+	 * @param	requests	The requests.
+	 * @param	callback	The callback of the request's index and its reachable nodes.
+	 * @return	The future which is ready once every callback has returned.
+	 */
+	std::future<void> find_reachable(const std::vector<LOSMReachabilityRequest> &requests,
+			std::function<void (unsigned int, const LOSMReachability &)> callback);
+
+	/**
+	 * Find the lexicographically optimal route for each request. The edge costs of the
+	 * requests' objectives must outlive the returned future.
+	 * @param	requests	The requests.
+	 * @return	The future of the route for each request, in order. If a request is invalid,
+	 * 			then the future holds a LOSMException instead.
+	 */
+	std::future<std::vector<LOSMLexicographicRoute> > find_lexicographic_routes(
+			const std::vector<LOSMLexicographicRequest> &requests);
+
+	/**
+	 * Find the lexicographically optimal route for each request, calling a callback as each one
+	 * completes. The callback is called concurrently from the workers, and must not throw.
+	 * @param	requests	The requests.
+	 * @param	callback	The callback of the request's index and its route.
+	 * @return	The future which is ready once every callback has returned.
+	 */
+	std::future<void> find_lexicographic_routes(const std::vector<LOSMLexicographicRequest> &requests,
+			std::function<void (unsigned int, const LOSMLexicographicRoute &)> callback);
+
+	/**
+	 * Find the k cheapest loopless routes for each request.
+	 * @param	requests	The requests.
+	 * @return	The future of the routes for each request, in order. If a request refers to
+	 * 			a node not in the graph, then the future holds a LOSMException instead.
+	 */
+	std::future<std::vector<std::vector<LOSMRoute> > > find_k_shortest_routes(
+			const std::vector<LOSMKShortestRequest> &requests);
+
+	/**
+	 * Find the cheapest route and alternatives to it for each request.
+	 * @param	requests	The requests.
+	 * @return	The future of the routes for each request, in order. If a request refers to
+	 * 			a node not in the graph, then the future holds a LOSMException instead.
+	 */
+	std::future<std::vector<std::vector<LOSMRoute> > > find_alternative_routes(
+			const std::vector<LOSMAlternativeRequest> &requests);
+
+private:
+	/**
+	 * Run f(index, context, result) for every index in [0, count) on the workers, collecting
+	 * one result per request.
+	 * @param	count	The number of requests.
+	 * @param	f		The function of the request's index, the worker's context, and the result.
+	 * @return	The future of the results, in order, or of the first exception thrown by f.
+	 */
+	template <typename T, typename F>
+	std::future<std::vector<T> > run_batch(unsigned int count, F f);
+
+	/**
+	 * Run f(index, context) for every index in [0, count) on the workers.
+	 * @param	count	The number of requests.
+	 * @param	f		The function of the request's index and the worker's context.
+	 * @return	The future which is ready once every request is complete, or which holds the
+	 * 			first exception thrown by f.
+	 */
+	template <typename F>
+	std::future<void> run_batch(unsigned int count, F f);
+
+	/**
+	 * The graph being queried.
+	 */
+	std::shared_ptr<const LOSMGraph> graph;
+
+	/**
+	 * The query context of each worker.
+	 */
+	std::vector<std::unique_ptr<LOSMQueryContext> > contexts;
+
+	/**
+	 * The pool of workers. This is declared last so that it is destroyed, draining every
+	 * pending request, before the contexts it uses.
+	 */
+	std::unique_ptr<LOSMThreadPool> pool;
+
+};
+
+
+template <typename T, typename F>
+std::future<std::vector<T> > LOSMQueryExecutor::run_batch(unsigned int count, F f)
+{
+	return pool->run_batch<T>(count, [this, f](unsigned int i, unsigned int worker, T &result) {
+		f(i, *contexts[worker], result);
+	});
+}
+
+template <typename F>
+std::future<void> LOSMQueryExecutor::run_batch(unsigned int count, F f)
+{
+	return pool->run_batch(count, [this, f](unsigned int i, unsigned int worker) {
+		f(i, *contexts[worker]);
+	});
+}
+
+
+#endif // LOSM_QUERY_EXECUTOR_H
@@ -0,0 +1,236 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef LOSM_RENDER_GEOMETRY_H
+#define LOSM_RENDER_GEOMETRY_H
+
+
+#include <memory>
+#include <vector>
+#include <string>
+
+#include "losm_graph.h"
+
+/**
+ * The colors (as 0xRRGGBBAA) of edges in the layers computed from an LMDP policy.
+ */
+struct LOSMRenderPalette {
+	/**
+	 * The color of ordinary roads.
+	 */
+	unsigned int roadColor;
+
+	/**
+	 * The color of roads with a speed limit of at least autonomySpeedLimit.
+	 */
+	unsigned int autonomyCapableColor;
+
+	/**
+	 * The color of roads the policy drives along without autonomy.
+	 */
+	unsigned int policyColor;
+
+	/**
+	 * The color of roads the policy drives along with autonomy.
+	 */
+	unsigned int policyAutonomyColor;
+
+	/**
+	 * The minimum speed limit of autonomy-capable roads.
+	 */
+	unsigned int autonomySpeedLimit;
+};
+
+/**
+ * Line geometry of a LOSMGraph prepared for rendering, so the visualizer only has to draw it.
+ *
+ * Coordinates are projected into the unit square of the map's bounds, with u increasing with
+ * longitude and v increasing southward, as the visualizer draws them. Maximal chains of edges
+ * through degree-2 nodes with identical colors are merged into polylines, which are then
+ * simplified with Douglas-Peucker at several levels of detail; level 0 is exact. The segments
+ * of each level are bucketed into a grid of tiles, each a line list (two vertices per segment)
+ * with one color per vertex for each layer, e.g., one layer per (tiredness, autonomy) policy.
+ *
+ * The file written by save() is, in the native byte order:
+ *  - the magic "LOSMRG01", then as 32-bit unsigned integers the number of levels, the tile
+ *    resolution, the number of layers, and zero;
+ *  - the bounds as 32-bit floats: minimum and maximum latitude, then longitude;
+ *  - the tolerance of each level as a 32-bit float;
+ *  - for each level, for each tile, its byte offset as a 64-bit unsigned integer and its number
+ *    of vertices as a 64-bit unsigned integer;
+ *  - at each tile's offset, its (u, v) positions as 32-bit floats, followed by the colors of
+ *    its vertices as 32-bit unsigned integers for each layer in turn.
+ *
+ * Tiles are ordered by column, then row, matching the visualizer's texture elements.
+ */
+class LOSMRenderGeometry {
+public:
+	/**
+	 * The constructor for the LOSMRenderGeometry class.
+	 * @param	graph			The graph to render.
+	 * @param	tileResolution	The number of tiles along each axis.
+	 * @param	numLevels		The number of levels of detail.
+	 * @param	tolerance		The tolerance of level 1 in the unit square; each further level
+	 * 							quadruples it.
+	 * @throw	LOSMException	The graph was null, or a parameter was zero.
+	 */
+	LOSMRenderGeometry(std::shared_ptr<const LOSMGraph> graph, unsigned int tileResolution = 10,
+			unsigned int numLevels = 4, float tolerance = 0.0005f);
+
+	/**
+	 * The default deconstructor for the LOSMRenderGeometry class.
+	 */
+	virtual ~LOSMRenderGeometry();
+
+	/**
+	 * Add a layer of edge colors. Layers must be added before build().
+	 * @param	edgeColors		The color (as 0xRRGGBBAA) of each edge.
+	 * @return	The index of the layer.
+	 * @throw	LOSMException	The number of colors did not match the number of edges.
+	 */
+	unsigned int add_layer(const std::vector<unsigned int> &edgeColors);
+
+	/**
+	 * Add the four layers of an LMDP policy, in the order (tiredness, autonomy) = (0, 0),
+	 * (0, 1), (1, 0), (1, 1). Each edge the policy drives along in a layer is colored by the
+	 * policy, and the rest by their speed limit.
+	 * @param	policyFilename	The policy file, with lines of the form "previous node UID,
+	 * 							current node UID, tiredness, autonomy, next node UID, next
+	 * 							autonomy, values...". Blank lines and lines starting with
+	 * 							'#' are skipped.
+	 * @param	palette			The colors of the layers.
+	 * @throw	LOSMException	The policy file could not be loaded.
+	 */
+	void add_policy_layers(std::string policyFilename, const LOSMRenderPalette &palette);
+
+	/**
+	 * Merge, simplify, and bucket the geometry of every level.
+	 */
+	void build();
+
+	/**
+	 * Write the geometry built by build() in the format above.
+	 * @param	filename		The name of the file.
+	 * @throw	LOSMException	The file could not be written.
+	 */
+	void save(std::string filename) const;
+
+	/**
+	 * Get the number of layers.
+	 * @return	The number of layers.
+	 */
+	unsigned int get_num_layers() const;
+
+	/**
+	 * Get the number of levels of detail.
+	 * @return	The number of levels.
+	 */
+	unsigned int get_num_levels() const;
+
+	/**
+	 * Get the number of tiles along each axis.
+	 * @return	The tile resolution.
+	 */
+	unsigned int get_tile_resolution() const;
+
+	/**
+	 * Get the (u, v) positions of the vertices of a tile, two per segment.
+	 * @param	level	The level of detail.
+	 * @param	tile	The tile, i.e., column * resolution + row.
+	 * @return	The interleaved positions.
+	 */
+	const std::vector<float> &get_positions(unsigned int level, unsigned int tile) const;
+
+	/**
+	 * Get the colors of the vertices of a tile in a layer.
+	 * @param	level	The level of detail.
+	 * @param	tile	The tile, i.e., column * resolution + row.
+	 * @param	layer	The layer.
+	 * @return	The color of each vertex.
+	 */
+	const std::vector<unsigned int> &get_colors(unsigned int level, unsigned int tile, unsigned int layer) const;
+
+private:
+	/**
+	 * Find the chains of edges to merge into polylines.
+	 * @param	chains	The nodes of each chain, in order. This will be modified.
+	 * @param	edges	The first edge of each chain, whose colors the chain takes. This will be
+	 * 					modified.
+	 */
+	void find_chains(std::vector<std::vector<unsigned int> > &chains, std::vector<unsigned int> &edges) const;
+
+	/**
+	 * Simplify a polyline with the Douglas-Peucker algorithm.
+	 * @param	points		The interleaved (u, v) points of the polyline.
+	 * @param	tolerance	The maximum distance of a removed point from the simplified polyline.
+	 * @param	result		The indices of the points which are kept, in order. This will be
+	 * 						modified.
+	 */
+	static void simplify(const std::vector<float> &points, float tolerance, std::vector<unsigned int> &result);
+
+	/**
+	 * The graph to render.
+	 */
+	std::shared_ptr<const LOSMGraph> graph;
+
+	/**
+	 * The number of tiles along each axis, and the number of levels of detail.
+	 */
+	unsigned int tileResolution;
+	unsigned int numLevels;
+
+	/**
+	 * The tolerance of each level.
+	 */
+	std::vector<float> tolerances;
+
+	/**
+	 * The bounds of the map (in degrees), over the nodes and landmarks.
+	 */
+	float minX;
+	float maxX;
+	float minY;
+	float maxY;
+
+	/**
+	 * The color of each edge in each layer.
+	 */
+	std::vector<std::vector<unsigned int> > layers;
+
+	/**
+	 * The positions of the vertices of each tile of each level, indexed by
+	 * level * tiles + tile.
+	 */
+	std::vector<std::vector<float> > positions;
+
+	/**
+	 * The colors of the vertices of each tile of each level in each layer, indexed by
+	 * (level * tiles + tile) * layers + layer.
+	 */
+	std::vector<std::vector<unsigned int> > colors;
+
+};
+
+
+#endif // LOSM_RENDER_GEOMETRY_H
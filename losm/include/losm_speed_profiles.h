@@ -0,0 +1,144 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef LOSM_SPEED_PROFILES_H
+#define LOSM_SPEED_PROFILES_H
+
+
+#include <memory>
+#include <vector>
+#include <string>
+
+#include "losm_graph.h"
+
+/**
+ * Daily speed profiles of the edges of a LOSMGraph, for routes whose travel time depends on the
+ * time of departure, e.g., in rush hour.
+ *
+ * A profile divides the day into equal slots, e.g., 96 slots of fifteen minutes, each with its
+ * own speed. A vehicle drives along an edge at the speed of the slot it is in, changing speed as
+ * it crosses into the next slot, so the travel time of an edge is a continuous, piecewise-linear
+ * function of the departure time, and departing later never means arriving earlier (the FIFO
+ * property). Edges with identical profiles share one copy, so each edge only costs the index of
+ * its profile; edges without a profile always travel at their speed limit.
+ */
+class LOSMSpeedProfiles {
+public:
+	/**
+	 * The number of hours in a day, over which the profiles repeat.
+	 */
+	static const float HOURS_PER_DAY;
+
+	/**
+	 * The constructor for the LOSMSpeedProfiles class, which loads a profiles file. Each line
+	 * has the form "node UID 1, node UID 2, speed of slot 1, ..., speed of slot n" with speeds
+	 * in miles per hour, and every line must have the same number of slots. The profile applies
+	 * to every edge between the two nodes.
+	 * @param	graph			The graph whose edges the profiles describe.
+	 * @param	filename		The profiles file, e.g., "profiles.dat" next to "edges.dat".
+	 * @throw	LOSMException	The graph was null, or the file could not be loaded.
+	 */
+	LOSMSpeedProfiles(std::shared_ptr<const LOSMGraph> graph, std::string filename);
+
+	/**
+	 * The default deconstructor for the LOSMSpeedProfiles class.
+	 */
+	virtual ~LOSMSpeedProfiles();
+
+	/**
+	 * Get the graph whose edges the profiles describe.
+	 * @return	The graph.
+	 */
+	const LOSMGraph *get_graph() const;
+
+	/**
+	 * Get the number of slots in a day.
+	 * @return	The number of slots, or zero if the file had no profiles.
+	 */
+	unsigned int get_num_slots() const;
+
+	/**
+	 * Get the number of distinct profiles.
+	 * @return	The number of distinct profiles.
+	 */
+	unsigned int get_num_profiles() const;
+
+	/**
+	 * Get the profile of an edge.
+	 * @param	edge	The index of the edge.
+	 * @return	The index of the profile, or LOSMGraph::INVALID_INDEX if the edge has none.
+	 */
+	unsigned int get_profile(unsigned int edge) const;
+
+	/**
+	 * Get the fastest speed of any edge at any time, e.g., for a lower bound on travel times.
+	 * @return	The fastest speed (in miles per hour).
+	 */
+	float get_max_speed() const;
+
+	/**
+	 * Get the travel time of an edge.
+	 * @param	edge		The index of the edge.
+	 * @param	departure	The time of departure (in hours since midnight; it may exceed a day).
+	 * @return	The travel time (in hours).
+	 */
+	float get_travel_time(unsigned int edge, float departure) const;
+
+	/**
+	 * Get the memory used by the profiles (in bytes).
+	 * @return	The memory used by the profiles.
+	 */
+	size_t get_memory_usage() const;
+
+private:
+	/**
+	 * The graph whose edges the profiles describe.
+	 */
+	std::shared_ptr<const LOSMGraph> graph;
+
+	/**
+	 * The number of slots in a day, and the length of each (in hours).
+	 */
+	unsigned int numSlots;
+	float slotLength;
+
+	/**
+	 * The hours per mile of each slot of each profile, indexed by profile * slots + slot.
+	 */
+	std::vector<float> paces;
+
+	/**
+	 * The profile of each edge, or LOSMGraph::INVALID_INDEX.
+	 */
+	std::vector<unsigned int> edgeProfiles;
+
+	/**
+	 * The fastest speed of any edge at any time.
+	 */
+	float maxSpeed;
+
+};
+
+
+#endif // LOSM_SPEED_PROFILES_H
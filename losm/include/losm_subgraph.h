@@ -0,0 +1,193 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef LOSM_SUBGRAPH_H
+#define LOSM_SUBGRAPH_H
+
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <utility>
+
+#include "losm_graph.h"
+
+/**
+ * The subgraph of a LOSMGraph induced by the nodes within a region, i.e., a box or a polygon,
+ * together with the edges between them and the landmarks within the region, so that a small
+ * working area may be cut out of a large map without converting it again.
+ *
+ * The nodes and landmarks within the region are found with the k-d trees of the graph, so the
+ * cost is proportional to the size of the subgraph rather than the map. A region often splits
+ * roads which only meet outside of it; with a positive number of expansion hops, nodes outside the
+ * region are added along the fewest-edge routes which reconnect pieces of the subgraph while
+ * staying within that many edges of the region.
+ *
+ * The degree of each node is recomputed from the edges kept. The subgraph may be turned into a
+ * new, self-contained LOSM object, or saved as nodes, edges, and landmarks files.
+ */
+class LOSMSubgraph {
+public:
+	/**
+	 * The constructor for the LOSMSubgraph class, which extracts the subgraph within a box.
+	 * @param	graph			The graph to extract the subgraph from.
+	 * @param	minX			The minimum x coordinate (latitude).
+	 * @param	minY			The minimum y coordinate (longitude).
+	 * @param	maxX			The maximum x coordinate (latitude).
+	 * @param	maxY			The maximum y coordinate (longitude).
+	 * @param	expansionHops	The number of edges outside the box that routes reconnecting the
+	 * 							subgraph may reach; zero keeps only the nodes within the box.
+	 * @throw	LOSMException	The graph was null.
+	 */
+	LOSMSubgraph(std::shared_ptr<const LOSMGraph> graph, float minX, float minY, float maxX, float maxY,
+			unsigned int expansionHops = 0);
+
+	/**
+	 * The constructor for the LOSMSubgraph class, which extracts the subgraph within a polygon.
+	 * @param	graph			The graph to extract the subgraph from.
+	 * @param	polygon			The (x, y) coordinates (latitude, longitude) of the polygon's
+	 * 							vertices, in order; the last is joined to the first.
+	 * @param	expansionHops	The number of edges outside the polygon that routes reconnecting
+	 * 							the subgraph may reach; zero keeps only the nodes within it.
+	 * @throw	LOSMException	The graph was null, or the polygon had fewer than three vertices.
+	 */
+	LOSMSubgraph(std::shared_ptr<const LOSMGraph> graph, const std::vector<std::pair<float, float> > &polygon,
+			unsigned int expansionHops = 0);
+
+	/**
+	 * The default deconstructor for the LOSMSubgraph class.
+	 */
+	virtual ~LOSMSubgraph();
+
+	/**
+	 * Get the nodes of the subgraph, in increasing order of index.
+	 * @return	The indices of the nodes in the graph.
+	 */
+	const std::vector<unsigned int> &get_nodes() const;
+
+	/**
+	 * Get the edges of the subgraph, in increasing order of index.
+	 * @return	The indices of the edges in the graph.
+	 */
+	const std::vector<unsigned int> &get_edges() const;
+
+	/**
+	 * Get the landmarks within the region.
+	 * @return	The landmarks, owned by the graph's LOSM object.
+	 */
+	const std::vector<const LOSMLandmark *> &get_landmarks() const;
+
+	/**
+	 * Get the degree of a node within the subgraph.
+	 * @param	node	The position of the node in get_nodes().
+	 * @return	The number of edges of the subgraph incident to the node.
+	 */
+	unsigned int get_degree(unsigned int node) const;
+
+	/**
+	 * Create a new LOSM object holding copies of the subgraph's nodes, edges, and landmarks,
+	 * which does not depend on the graph it was extracted from.
+	 * @return	The new LOSM object.
+	 */
+	std::shared_ptr<LOSM> create_losm() const;
+
+	/**
+	 * Save the subgraph in the LOSM format, so that it may be loaded like any other map.
+	 * @param	nodesFilename		The nodes' filename.
+	 * @param	edgesFilename		The edges' filename.
+	 * @param	landmarksFilename	The landmarks' filename.
+	 * @throw	LOSMException		One of the files could not be written.
+	 */
+	void save(std::string nodesFilename, std::string edgesFilename, std::string landmarksFilename) const;
+
+private:
+	/**
+	 * Check if a coordinate is within the region.
+	 * @param	x	The x coordinate in fixed point.
+	 * @param	y	The y coordinate in fixed point.
+	 * @return	True if the coordinate is within the region, false otherwise.
+	 */
+	bool contains(int x, int y) const;
+
+	/**
+	 * Extract the subgraph: find the nodes within the region, add the nodes reconnecting it,
+	 * then collect the edges between the nodes kept and the landmarks within the region.
+	 * @param	minX			The minimum x coordinate of the region (latitude).
+	 * @param	minY			The minimum y coordinate of the region (longitude).
+	 * @param	maxX			The maximum x coordinate of the region (latitude).
+	 * @param	maxY			The maximum y coordinate of the region (longitude).
+	 * @param	expansionHops	The number of edges outside the region reconnecting routes may reach.
+	 */
+	void extract(float minX, float minY, float maxX, float maxY, unsigned int expansionHops);
+
+	/**
+	 * Add the nodes outside the region on the fewest-edge routes which reconnect pieces of the
+	 * subgraph, found by a breadth-first search from all nodes kept at once.
+	 * @param	expansionHops	The number of edges outside the region reconnecting routes may reach.
+	 */
+	void expand(unsigned int expansionHops);
+
+	/**
+	 * The graph the subgraph was extracted from.
+	 */
+	std::shared_ptr<const LOSMGraph> graph;
+
+	/**
+	 * The x and y coordinates of the polygon's vertices in fixed point, or empty for a box.
+	 */
+	std::vector<int> polygonX;
+	std::vector<int> polygonY;
+
+	/**
+	 * The box in fixed point: the region itself, or the bounds of the polygon.
+	 */
+	int boxMinX;
+	int boxMinY;
+	int boxMaxX;
+	int boxMaxY;
+
+	/**
+	 * The indices of the nodes of the subgraph, sorted.
+	 */
+	std::vector<unsigned int> nodes;
+
+	/**
+	 * The indices of the edges of the subgraph, sorted.
+	 */
+	std::vector<unsigned int> edges;
+
+	/**
+	 * The degree of each node within the subgraph.
+	 */
+	std::vector<unsigned int> degrees;
+
+	/**
+	 * The landmarks within the region.
+	 */
+	std::vector<const LOSMLandmark *> landmarks;
+
+};
+
+
+#endif // LOSM_SUBGRAPH_H
@@ -0,0 +1,246 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef LOSM_THREAD_POOL_H
+#define LOSM_THREAD_POOL_H
+
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <future>
+#include <functional>
+#include <memory>
+#include <exception>
+
+/**
+ * A work-stealing thread pool. Each worker owns a queue of tasks; it runs its own tasks
+ * newest first and, once its queue is empty, steals the oldest tasks of the other workers.
+ */
+class LOSMThreadPool {
+public:
+	/**
+	 * The constructor for the LOSMThreadPool class, which starts the workers.
+	 * @param	numThreads	The number of workers. Zero uses the hardware concurrency.
+	 */
+	LOSMThreadPool(unsigned int numThreads = 0);
+
+	/**
+	 * The deconstructor for the LOSMThreadPool class, which runs every remaining task and
+	 * then joins the workers.
+	 */
+	virtual ~LOSMThreadPool();
+
+	/**
+	 * Get the number of workers.
+	 * @return	The number of workers.
+	 */
+	unsigned int get_num_threads() const;
+
+	/**
+	 * Get the index of the worker calling this method.
+	 * @return	The index of the calling worker in [0, get_num_threads()), or get_num_threads()
+	 * 			if the caller is not a worker of this pool.
+	 */
+	unsigned int get_worker_index() const;
+
+	/**
+	 * Add a task to the pool. Tasks added by a worker go to its own queue, and others are
+	 * distributed over the workers in turn.
+	 * @param	task	The task to run.
+	 */
+	void execute(std::function<void ()> task);
+
+	/**
+	 * Add a task to the pool and obtain a future for its result.
+	 * @param	f	The callable to run.
+	 * @return	The future holding the result of the callable.
+	 */
+	template <typename F>
+	std::future<typename std::result_of<F ()>::type> submit(F f);
+
+	/**
+	 * Run f(index, worker) for every index in [0, count) on the workers, without blocking,
+	 * and call done once all of them have finished. The indices are split into chunks so
+	 * that idle workers can steal part of the range.
+	 * @param	count	The number of indices.
+	 * @param	f		The function of the index and the index of the worker running it.
+	 * @param	done	The function called exactly once, on a worker, after all indices.
+	 */
+	void parallel_for_async(unsigned int count, std::function<void (unsigned int, unsigned int)> f,
+			std::function<void ()> done);
+
+	/**
+	 * Run f(index, worker) for every index in [0, count) on the workers and wait for all of
+	 * them. If called from a worker, then it runs other tasks while waiting.
+	 * @param	count	The number of indices.
+	 * @param	f		The function of the index and the index of the worker running it.
+	 */
+	void parallel_for(unsigned int count, std::function<void (unsigned int, unsigned int)> f);
+
+	/**
+	 * Run f(index, worker, result) for every index in [0, count) on the workers, without
+	 * blocking, collecting one result per index.
+	 * @param	count	The number of indices.
+	 * @param	f		The function of the index, the index of the worker running it, and the
+	 * 					result to fill in.
+	 * @return	The future of the results, in order. If f throws, then the future holds the first
+	 * 			exception thrown instead, once every index has run.
+	 */
+	template <typename T, typename F>
+	std::future<std::vector<T> > run_batch(unsigned int count, F f);
+
+	/**
+	 * Run f(index, worker) for every index in [0, count) on the workers, without blocking.
+	 * @param	count	The number of indices.
+	 * @param	f		The function of the index and the index of the worker running it.
+	 * @return	The future which is ready once every index has run. If f throws, then the future
+	 * 			holds the first exception thrown instead.
+	 */
+	template <typename F>
+	std::future<void> run_batch(unsigned int count, F f);
+
+private:
+	/**
+	 * Run f(index, worker) for every index in [0, count) on the workers, without blocking, and
+	 * call done with the first exception thrown by f, or with a null exception if there was none.
+	 * @param	count	The number of indices.
+	 * @param	f		The function of the index and the index of the worker running it.
+	 * @param	done	The function called exactly once, on a worker, after all indices.
+	 */
+	void dispatch(unsigned int count, std::function<void (unsigned int, unsigned int)> f,
+			std::function<void (std::exception_ptr)> done);
+
+	/**
+	 * The loop run by each worker.
+	 * @param	worker	The index of the worker.
+	 */
+	void run(unsigned int worker);
+
+	/**
+	 * Take a task from the worker's own queue, or steal one from another worker.
+	 * @param	worker	The index of the worker, used to choose which queue is its own.
+	 * @param	task	The task taken. This will be modified.
+	 * @return	True if a task was taken, false otherwise.
+	 */
+	bool take(unsigned int worker, std::function<void ()> &task);
+
+	/**
+	 * The queue of tasks owned by one worker.
+	 */
+	struct Queue {
+		std::mutex mutex;
+		std::deque<std::function<void ()> > tasks;
+	};
+
+	/**
+	 * The queue of each worker.
+	 */
+	std::vector<std::unique_ptr<Queue> > queues;
+
+	/**
+	 * The workers.
+	 */
+	std::vector<std::thread> threads;
+
+	/**
+	 * The number of tasks in all queues.
+	 */
+	std::atomic<unsigned int> pending;
+
+	/**
+	 * The queue to which the next task from a non-worker goes.
+	 */
+	std::atomic<unsigned int> nextQueue;
+
+	/**
+	 * If the pool is shutting down.
+	 */
+	bool stopping;
+
+	/**
+	 * The mutex and condition variable with which idle workers sleep.
+	 */
+	std::mutex sleepMutex;
+	std::condition_variable sleepCondition;
+
+};
+
+
+template <typename F>
+std::future<typename std::result_of<F ()>::type> LOSMThreadPool::submit(F f)
+{
+	typedef typename std::result_of<F ()>::type R;
+
+	std::shared_ptr<std::packaged_task<R ()> > task(new std::packaged_task<R ()>(f));
+	std::future<R> result = task->get_future();
+
+	execute([task]() { (*task)(); });
+
+	return result;
+}
+
+template <typename T, typename F>
+std::future<std::vector<T> > LOSMThreadPool::run_batch(unsigned int count, F f)
+{
+	std::shared_ptr<std::vector<T> > output(new std::vector<T>(count));
+	std::shared_ptr<std::promise<std::vector<T> > > promise(new std::promise<std::vector<T> >());
+
+	dispatch(count,
+		[f, output](unsigned int i, unsigned int worker) {
+			f(i, worker, (*output)[i]);
+		},
+		[output, promise](std::exception_ptr error) {
+			if (error) {
+				promise->set_exception(error);
+			} else {
+				promise->set_value(std::move(*output));
+			}
+		});
+
+	return promise->get_future();
+}
+
+template <typename F>
+std::future<void> LOSMThreadPool::run_batch(unsigned int count, F f)
+{
+	std::shared_ptr<std::promise<void> > promise(new std::promise<void>());
+
+	dispatch(count, f,
+		[promise](std::exception_ptr error) {
+			if (error) {
+				promise->set_exception(error);
+			} else {
+				promise->set_value();
+			}
+		});
+
+	return promise->get_future();
+}
+
+
+#endif // LOSM_THREAD_POOL_H
@@ -29,6 +29,7 @@
 #include <sstream>
 #include <string>
 #include <vector>
+#include <cstdint>
 
 /**
  * Trim the left and right sides of a string, removing the whitespace.
@@ -44,5 +45,68 @@ void trim_whitespace(std::string &item);
  */
 std::vector<std::string> split_string_by_comma(std::string item);
 
+/**
+ * Parse an unsigned integer which must make up the whole item.
+ * @param	item	The item.
+ * @param	value	The value. This will be modified.
+ * @return	True if the item was an unsigned integer, false otherwise.
+ */
+bool parse_unsigned(const std::string &item, unsigned long &value);
+
+/**
+ * Parse a floating point number which must make up the whole item.
+ * @param	item	The item.
+ * @param	value	The value. This will be modified.
+ * @return	True if the item was a number, false otherwise.
+ */
+bool parse_double(const std::string &item, double &value);
+
+/**
+ * Write a file in full.
+ * @param	filename		The filename.
+ * @param	contents		The contents of the file.
+ * @throw	LOSMException	The file could not be written.
+ */
+void write_file(std::string filename, const std::string &contents);
+
+/**
+ * The number of fixed-point units in one degree. One unit is 1e-7 degrees, or about 1.1 cm,
+ * and every longitude in [-180, 180] fits within a 32-bit integer.
+ */
+const double LOSM_FIXED_POINT_SCALE = 1e7;
+
+/**
+ * Check that a coordinate is a valid latitude and longitude.
+ * @param	x	The latitude (in degrees).
+ * @param	y	The longitude (in degrees).
+ * @return	True if the latitude is in [-90, 90] and the longitude in [-180, 180], false otherwise,
+ * 			including if either is not a number.
+ */
+bool is_valid_coordinate(double x, double y);
+
+/**
+ * Convert a coordinate in degrees to fixed point, rounding to the nearest unit. Coordinates
+ * outside [-180, 180] are clamped to it, and one which is not a number becomes zero.
+ * @param	degrees		The coordinate (in degrees).
+ * @return	The coordinate in fixed-point units.
+ */
+int degrees_to_fixed_point(double degrees);
+
+/**
+ * Convert a coordinate in fixed point to degrees.
+ * @param	fixed	The coordinate in fixed-point units.
+ * @return	The coordinate (in degrees).
+ */
+double fixed_point_to_degrees(int fixed);
+
+/**
+ * Compute the position of a point along a Hilbert curve over a 2^16 by 2^16 grid, e.g., to
+ * order nodes or queries so that nearby ones are processed together.
+ * @param	x	The x coordinate in [0, 2^16).
+ * @param	y	The y coordinate in [0, 2^16).
+ * @return	The position of the point along the curve.
+ */
+uint32_t hilbert_index(uint32_t x, uint32_t y);
+
 
 #endif // LOSM_UTILITIES_H
@@ -0,0 +1,182 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef LOSM_WALK_SAMPLER_H
+#define LOSM_WALK_SAMPLER_H
+
+
+#include <memory>
+#include <string>
+#include <cstdint>
+
+#include "losm_graph.h"
+#include "losm_thread_pool.h"
+
+/**
+ * How a random walk chooses the edge to take out of its current node.
+ */
+enum class LOSMWalkBias {
+	UNIFORM,		// Every edge is equally likely.
+	SPEED_LIMIT		// Each edge is chosen in proportion to its speed limit, e.g., to favor arterial roads.
+};
+
+/**
+ * A request for a batch of random walks.
+ */
+struct LOSMWalkRequest {
+	/**
+	 * The number of walks.
+	 */
+	unsigned int numWalks;
+
+	/**
+	 * The number of steps of each walk, so that each visits length + 1 nodes.
+	 */
+	unsigned int length;
+
+	/**
+	 * How each step chooses its edge.
+	 */
+	LOSMWalkBias bias;
+
+	/**
+	 * If a walk never steps back to the node it just came from, unless it is at a dead end.
+	 */
+	bool nonBacktracking;
+
+	/**
+	 * The seed of the random numbers. Each walk's random numbers depend only on the seed and the
+	 * index of the walk, so a batch is reproducible regardless of the number of threads.
+	 */
+	uint64_t seed;
+
+	/**
+	 * The index of the node each walk starts at, numWalks of them, or nullptr to start each
+	 * walk at a node chosen uniformly at random.
+	 */
+	const unsigned int *sources;
+};
+
+/**
+ * A sampler of random walks over a LOSMGraph, e.g., to generate synthetic trajectories. Walks are
+ * split over a thread pool and written into flat arrays, or streamed to a binary file, so that
+ * millions of them need neither per-step allocation nor per-walk containers.
+ *
+ * The random numbers are counter-based: each step's number is a hash of the seed, the index of
+ * the walk, and the index of the step, so there is no generator state to share or advance. A walk
+ * which reaches a node without edges stops early, and the rest of its nodes and edges are
+ * LOSMGraph::INVALID_INDEX.
+ */
+class LOSMWalkSampler {
+public:
+	/**
+	 * The constructor for the LOSMWalkSampler class.
+	 * @param	graph			The graph to walk.
+	 * @param	numThreads		The number of workers. Zero uses the hardware concurrency.
+	 * @throw	LOSMException	The graph was null.
+	 */
+	LOSMWalkSampler(std::shared_ptr<const LOSMGraph> graph, unsigned int numThreads = 0);
+
+	/**
+	 * The deconstructor for the LOSMWalkSampler class, which waits for the workers.
+	 */
+	virtual ~LOSMWalkSampler();
+
+	/**
+	 * Get the graph being walked.
+	 * @return	The graph.
+	 */
+	std::shared_ptr<const LOSMGraph> get_graph() const;
+
+	/**
+	 * Sample a batch of walks into flat arrays, such that walk i visits nodes[i * (length + 1)]
+	 * through nodes[i * (length + 1) + length], along edges[i * length] through
+	 * edges[i * length + length - 1].
+	 * @param	request			The walks to sample.
+	 * @param	nodes			The nodes of each walk, numWalks * (length + 1) of them. This will be modified.
+	 * @param	edges			The edges of each walk, numWalks * length of them, or nullptr to
+	 * 							only sample the nodes. This will be modified.
+	 * @throw	LOSMException	A source node does not exist, or the graph has no nodes to start at.
+	 */
+	void sample(const LOSMWalkRequest &request, unsigned int *nodes, unsigned int *edges);
+
+	/**
+	 * Sample a batch of walks into a binary file, in chunks so that the batch need not fit in
+	 * memory. The file is a header of the magic number, the number of walks, the length, the
+	 * number of nodes and edges of the graph, and the seed, followed by one record per walk of
+	 * its length + 1 nodes then its length edges, all little-endian 32-bit indices.
+	 * @param	request			The walks to sample.
+	 * @param	filename		The file to write.
+	 * @throw	LOSMException	A source node does not exist, the graph has no nodes to start at, or
+	 * 							the file could not be written.
+	 */
+	void save(const LOSMWalkRequest &request, std::string filename);
+
+private:
+	/**
+	 * Check that every source of a request exists, or that there are nodes to start at.
+	 * @param	request			The walks to sample.
+	 * @throw	LOSMException	A source node does not exist, or the graph has no nodes to start at.
+	 */
+	void check_request(const LOSMWalkRequest &request) const;
+
+	/**
+	 * Sample one walk.
+	 * @param	request	The walks to sample.
+	 * @param	walk	The index of the walk.
+	 * @param	nodes	The length + 1 nodes of the walk. This will be modified.
+	 * @param	edges	The length edges of the walk, or nullptr. This will be modified.
+	 */
+	void sample_walk(const LOSMWalkRequest &request, unsigned int walk, unsigned int *nodes,
+			unsigned int *edges) const;
+
+	/**
+	 * The number of walks each task samples.
+	 */
+	static const unsigned int WALKS_PER_TASK = 256;
+
+	/**
+	 * The approximate number of bytes of walks save() buffers before writing them.
+	 */
+	static const size_t SAVE_CHUNK_SIZE = 16 * 1024 * 1024;
+
+	/**
+	 * The magic number at the start of a saved file.
+	 */
+	static const char SAVED_MAGIC[8];
+
+	/**
+	 * The graph being walked.
+	 */
+	std::shared_ptr<const LOSMGraph> graph;
+
+	/**
+	 * The pool of workers.
+	 */
+	std::unique_ptr<LOSMThreadPool> pool;
+
+};
+
+
+#endif // LOSM_WALK_SAMPLER_H
@@ -24,6 +24,7 @@
 
 #include "../include/losm.h"
 #include "../include/losm_exception.h"
+#include "../include/losm_instrumentation.h"
 
 #include <unordered_map>
 #include <algorithm>
@@ -36,31 +37,54 @@ LOSM::LOSM(std::string nodesFilename, std::string edgesFilename, std::string lan
 	load(nodesFilename, edgesFilename, landmarksFilename);
 }
 
-LOSM::~LOSM()
+LOSM::LOSM(const std::vector<const LOSMNode *> &nodes, const std::vector<const LOSMEdge *> &edges,
+		const std::vector<const LOSMLandmark *> &landmarks)
 {
-	for (const LOSMNode *node : nodes) {
-		delete node;
-	}
-	nodes.clear();
+	this->nodes = nodes;
+	this->edges = edges;
+	this->landmarks = landmarks;
 
+	neighbors.reserve(nodes.size());
 	for (const LOSMEdge *edge : edges) {
-		delete edge;
+		neighbors[edge->get_node_1()].push_back(edge->get_node_2());
+		neighbors[edge->get_node_2()].push_back(edge->get_node_1());
 	}
-	edges.clear();
+}
 
-	for (const LOSMLandmark *landmark : landmarks) {
-		delete landmark;
-	}
-	landmarks.clear();
+LOSM::~LOSM()
+{
+	clear();
 }
 
 void LOSM::load(std::string nodesFilename, std::string edgesFilename, std::string landmarksFilename)
 {
-	LOSMNode::load(nodesFilename, nodes);
+	// Load into temporaries, so that on an error the objects already loaded remain.
+	std::vector<const LOSMNode *> newNodes;
+	std::vector<const LOSMEdge *> newEdges;
+	std::vector<const LOSMLandmark *> newLandmarks;
+	std::unordered_map<const LOSMNode *, std::vector<const LOSMNode *> > newNeighbors;
+
+	LOSMNode::load(nodesFilename, newNodes);
+
+	try {
+		LOSMEdge::load(edgesFilename, newNodes, newEdges, newNeighbors);
+		LOSMLandmark::load(landmarksFilename, newLandmarks);
+	} catch (const LOSMException &err) {
+		for (const LOSMEdge *edge : newEdges) {
+			delete edge;
+		}
+		for (const LOSMNode *node : newNodes) {
+			delete node;
+		}
+		throw;
+	}
 
-	LOSMEdge::load(edgesFilename, nodes, edges, neighbors);
+	clear();
 
-	LOSMLandmark::load(landmarksFilename, landmarks);
+	nodes.swap(newNodes);
+	edges.swap(newEdges);
+	landmarks.swap(newLandmarks);
+	neighbors.swap(newNeighbors);
 }
 
 const std::vector<const LOSMNode *> &LOSM::get_nodes() const {
@@ -76,6 +100,8 @@ const std::vector<const LOSMLandmark *> &LOSM::get_landmarks() const {
 }
 
 void LOSM::get_neighbors(const LOSMNode *node, std::vector<const LOSMNode *> &result) const {
+	LOSM_INSTRUMENT(LOSMOperation::GET_NEIGHBORS);
+
 	std::unordered_map<const LOSMNode *, std::vector<const LOSMNode *> >::const_iterator alpha = neighbors.find(node);
 	if (alpha == neighbors.end()) {
 		throw LOSMException();
@@ -83,3 +109,23 @@ void LOSM::get_neighbors(const LOSMNode *node, std::vector<const LOSMNode *> &re
 
 	result = alpha->second;
 }
+
+void LOSM::clear()
+{
+	for (const LOSMNode *node : nodes) {
+		delete node;
+	}
+	nodes.clear();
+
+	for (const LOSMEdge *edge : edges) {
+		delete edge;
+	}
+	edges.clear();
+
+	for (const LOSMLandmark *landmark : landmarks) {
+		delete landmark;
+	}
+	landmarks.clear();
+
+	neighbors.clear();
+}
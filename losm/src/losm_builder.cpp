@@ -0,0 +1,285 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "../include/losm_builder.h"
+#include "../include/losm_exception.h"
+#include "../include/losm_utilities.h"
+
+#include <iostream>
+#include <cmath>
+
+LOSMBuilder::LOSMBuilder()
+{ }
+
+LOSMBuilder::~LOSMBuilder()
+{ }
+
+void LOSMBuilder::reserve(size_t numNodes, size_t numEdges, size_t numLandmarks)
+{
+	nodes.reserve(numNodes);
+	nodeIndices.reserve(numNodes);
+	edges.reserve(numEdges);
+	landmarks.reserve(numLandmarks);
+}
+
+size_t LOSMBuilder::get_num_nodes() const
+{
+	return nodes.size();
+}
+
+size_t LOSMBuilder::get_num_edges() const
+{
+	return edges.size();
+}
+
+size_t LOSMBuilder::get_num_landmarks() const
+{
+	return landmarks.size();
+}
+
+void LOSMBuilder::add_node(unsigned long uid, double x, double y)
+{
+	add_node(uid, x, y, COUNTED_DEGREE);
+}
+
+void LOSMBuilder::add_node(unsigned long uid, double x, double y, unsigned int degree)
+{
+	check_coordinate(x, y, "add_node");
+
+	if (!nodeIndices.insert(std::make_pair(uid, (unsigned int)nodes.size())).second) {
+		std::cerr << "Error[LOSMBuilder::add_node]: A node with UID '" << uid << "' was already added." << std::endl;
+		throw LOSMException();
+	}
+
+	nodes.push_back(NodeRecord{uid, x, y, degree});
+}
+
+void LOSMBuilder::add_edge(unsigned long uid1, unsigned long uid2, std::string name, float distance,
+		unsigned int speedLimit, unsigned int lanes)
+{
+	unsigned int node1 = find_node(uid1, "add_edge");
+	unsigned int node2 = find_node(uid2, "add_edge");
+	check_distance(distance, "add_edge");
+
+	edges.push_back(EdgeRecord{node1, node2, std::move(name), distance, speedLimit, lanes});
+}
+
+void LOSMBuilder::add_landmark(unsigned long uid, double x, double y, std::string name)
+{
+	check_coordinate(x, y, "add_landmark");
+
+	landmarks.push_back(LandmarkRecord{uid, x, y, std::move(name)});
+}
+
+void LOSMBuilder::add_nodes(size_t count, const unsigned long *uids, const double *x, const double *y)
+{
+	size_t first = nodes.size();
+	nodes.reserve(first + count);
+	nodeIndices.reserve(first + count);
+
+	// On an error, the nodes of this call are removed again.
+	try {
+		for (size_t i = 0; i < count; i++) {
+			add_node(uids[i], x[i], y[i]);
+		}
+	} catch (const LOSMException &err) {
+		for (size_t i = first; i < nodes.size(); i++) {
+			nodeIndices.erase(nodes[i].uid);
+		}
+		nodes.resize(first);
+		throw;
+	}
+}
+
+void LOSMBuilder::add_edges(size_t count, const unsigned long *uids1, const unsigned long *uids2,
+		const std::string *names, const float *distances, const unsigned int *speedLimits, const unsigned int *lanes)
+{
+	// Validate every edge first, so that on an error none are added.
+	std::vector<unsigned int> endpoints(2 * count);
+	for (size_t i = 0; i < count; i++) {
+		endpoints[2 * i] = find_node(uids1[i], "add_edges");
+		endpoints[2 * i + 1] = find_node(uids2[i], "add_edges");
+		check_distance(distances[i], "add_edges");
+	}
+
+	edges.reserve(edges.size() + count);
+	for (size_t i = 0; i < count; i++) {
+		edges.push_back(EdgeRecord{endpoints[2 * i], endpoints[2 * i + 1], (names != nullptr) ? names[i] : "",
+				distances[i], speedLimits[i], lanes[i]});
+	}
+}
+
+void LOSMBuilder::read_nodes(std::istream &stream)
+{
+	read_lines(stream, 4, "read_nodes", [this](const std::vector<std::string> &items) {
+		unsigned long uid = 0, degree = 0;
+		double x = 0.0, y = 0.0;
+
+		if (!parse_unsigned(items[0], uid) || !parse_double(items[1], x) || !parse_double(items[2], y) ||
+				!parse_unsigned(items[3], degree)) {
+			std::cerr << "Error[LOSMBuilder::read_nodes]: Failed to convert the items to numbers." << std::endl;
+			throw LOSMException();
+		}
+
+		add_node(uid, x, y, (unsigned int)degree);
+	});
+}
+
+void LOSMBuilder::read_edges(std::istream &stream)
+{
+	read_lines(stream, 6, "read_edges", [this](const std::vector<std::string> &items) {
+		unsigned long uid1 = 0, uid2 = 0, speedLimit = 0, lanes = 0;
+		double distance = 0.0;
+
+		if (!parse_unsigned(items[0], uid1) || !parse_unsigned(items[1], uid2) ||
+				!parse_double(items[3], distance) || !parse_unsigned(items[4], speedLimit) ||
+				!parse_unsigned(items[5], lanes)) {
+			std::cerr << "Error[LOSMBuilder::read_edges]: Failed to convert the items to numbers." << std::endl;
+			throw LOSMException();
+		}
+
+		add_edge(uid1, uid2, items[2], (float)distance, (unsigned int)speedLimit, (unsigned int)lanes);
+	});
+}
+
+void LOSMBuilder::read_landmarks(std::istream &stream)
+{
+	read_lines(stream, 4, "read_landmarks", [this](const std::vector<std::string> &items) {
+		unsigned long uid = 0;
+		double x = 0.0, y = 0.0;
+
+		if (!parse_unsigned(items[0], uid) || !parse_double(items[1], x) || !parse_double(items[2], y)) {
+			std::cerr << "Error[LOSMBuilder::read_landmarks]: Failed to convert the items to numbers." << std::endl;
+			throw LOSMException();
+		}
+
+		add_landmark(uid, x, y, items[3]);
+	});
+}
+
+std::shared_ptr<LOSM> LOSMBuilder::finalize()
+{
+	std::vector<unsigned int> degrees(nodes.size(), 0);
+	for (const EdgeRecord &edge : edges) {
+		degrees[edge.node1]++;
+		degrees[edge.node2]++;
+	}
+
+	std::vector<const LOSMNode *> newNodes;
+	std::vector<const LOSMEdge *> newEdges;
+	std::vector<const LOSMLandmark *> newLandmarks;
+
+	newNodes.reserve(nodes.size());
+	newEdges.reserve(edges.size());
+	newLandmarks.reserve(landmarks.size());
+
+	for (unsigned int i = 0; i < nodes.size(); i++) {
+		const NodeRecord &node = nodes[i];
+		newNodes.push_back(new LOSMNode(node.uid, node.x, node.y,
+				(node.degree == COUNTED_DEGREE) ? degrees[i] : node.degree));
+	}
+
+	for (EdgeRecord &edge : edges) {
+		newEdges.push_back(new LOSMEdge(newNodes[edge.node1], newNodes[edge.node2], std::move(edge.name),
+				edge.distance, edge.speedLimit, edge.lanes));
+	}
+
+	for (LandmarkRecord &landmark : landmarks) {
+		newLandmarks.push_back(new LOSMLandmark(landmark.uid, landmark.x, landmark.y, std::move(landmark.name)));
+	}
+
+	clear();
+
+	return std::make_shared<LOSM>(newNodes, newEdges, newLandmarks);
+}
+
+void LOSMBuilder::clear()
+{
+	std::vector<NodeRecord>().swap(nodes);
+	std::vector<EdgeRecord>().swap(edges);
+	std::vector<LandmarkRecord>().swap(landmarks);
+	std::unordered_map<unsigned long, unsigned int>().swap(nodeIndices);
+}
+
+void LOSMBuilder::check_coordinate(double x, double y, const char *method)
+{
+	if (!is_valid_coordinate(x, y)) {
+		std::cerr << "Error[LOSMBuilder::" << method << "]: The coordinate (" << x << ", " << y <<
+				") is not a valid latitude and longitude." << std::endl;
+		throw LOSMException();
+	}
+}
+
+unsigned int LOSMBuilder::find_node(unsigned long uid, const char *method) const
+{
+	std::unordered_map<unsigned long, unsigned int>::const_iterator alpha = nodeIndices.find(uid);
+	if (alpha == nodeIndices.end()) {
+		std::cerr << "Error[LOSMBuilder::" << method << "]: Failed to find a node with UID '" << uid << "'." << std::endl;
+		throw LOSMException();
+	}
+
+	return alpha->second;
+}
+
+void LOSMBuilder::check_distance(float distance, const char *method)
+{
+	if (!(distance >= 0.0f && distance < INFINITY)) {
+		std::cerr << "Error[LOSMBuilder::" << method << "]: The distance " << distance << " is not valid." << std::endl;
+		throw LOSMException();
+	}
+}
+
+void LOSMBuilder::read_lines(std::istream &stream, unsigned int numItems, const char *method,
+		std::function<void (const std::vector<std::string> &)> add)
+{
+	std::string line;
+	unsigned long long lineNumber = 0;
+
+	while (std::getline(stream, line)) {
+		lineNumber++;
+
+		std::vector<std::string> items = split_string_by_comma(line);
+		if (items.empty()) {
+			continue;
+		}
+
+		try {
+			if (items.size() != numItems) {
+				std::cerr << "Error[LOSMBuilder::" << method << "]: Expected " << numItems <<
+						" comma-delimited items, but found " << items.size() << "." << std::endl;
+				throw LOSMException();
+			}
+
+			add(items);
+		} catch (const LOSMException &err) {
+			std::cerr << "Error[LOSMBuilder::" << method << "]: Failed to add line " << lineNumber << "." << std::endl;
+			throw;
+		}
+	}
+
+	if (stream.bad()) {
+		std::cerr << "Error[LOSMBuilder::" << method << "]: Failed to read the stream." << std::endl;
+		throw LOSMException();
+	}
+}
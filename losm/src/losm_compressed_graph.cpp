@@ -0,0 +1,636 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "../include/losm_compressed_graph.h"
+#include "../include/losm_exception.h"
+#include "../include/losm_utilities.h"
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+
+const unsigned int LOSMCompressedGraph::UID_BLOCK_SIZE;
+
+/**
+ * Append an unsigned integer to a byte string as a varint: seven bits per byte, least
+ * significant first, with the high bit set on every byte but the last.
+ * @param	value	The value to append.
+ * @param	bytes	The byte string. This will be modified.
+ */
+static void write_varint(unsigned long value, std::vector<unsigned char> &bytes)
+{
+	while (value >= 0x80) {
+		bytes.push_back((unsigned char)(value | 0x80));
+		value >>= 7;
+	}
+	bytes.push_back((unsigned char)value);
+}
+
+/**
+ * Read a varint from a byte string.
+ * @param	current		The position in the byte string. This will be advanced past the varint.
+ * @return	The value read.
+ */
+static inline unsigned long read_varint(const unsigned char *&current)
+{
+	unsigned long value = *current & 0x7F;
+	unsigned int shift = 7;
+
+	while (*current & 0x80) {
+		current++;
+		value |= (unsigned long)(*current & 0x7F) << shift;
+		shift += 7;
+	}
+	current++;
+
+	return value;
+}
+
+/**
+ * Bit-pack a list of values.
+ * @param	values	The values to pack.
+ * @param	bits	The number of bits of each value.
+ * @param	packed	The bit-packed words. This will be modified.
+ */
+static void set_packed(const std::vector<unsigned int> &values, unsigned int bits, std::vector<uint64_t> &packed)
+{
+	packed.assign(((uint64_t)values.size() * bits + 63) / 64 + 1, 0);
+
+	for (unsigned int i = 0; i < values.size(); i++) {
+		uint64_t position = (uint64_t)i * bits;
+		packed[position / 64] |= (uint64_t)values[i] << (position % 64);
+		if (position % 64 + bits > 64) {
+			packed[position / 64 + 1] |= (uint64_t)values[i] >> (64 - position % 64);
+		}
+	}
+}
+
+bool LOSMCompressedGraph::NeighborIterator::next(unsigned int &neighbor, unsigned int &edge)
+{
+	if (current >= end) {
+		return false;
+	}
+
+	// The first neighbor is a zigzag-encoded offset from the node, the rest are non-negative
+	// offsets from the previous neighbor.
+	unsigned long delta = read_varint(current);
+	if (first) {
+		long offset = (long)(delta >> 1) ^ -(long)(delta & 1);
+		neighbor = (unsigned int)((long)node + offset);
+		first = false;
+	} else {
+		neighbor = previous + (unsigned int)delta;
+	}
+	previous = neighbor;
+
+	if (neighbor < node) {
+		edge = graph->ownedEdges[neighbor] + (unsigned int)read_varint(current);
+	} else if (neighbor == node) {
+		edge = graph->ownedEdges[node] + (unsigned int)read_varint(current);
+		selfLoops++;
+	} else {
+		edge = graph->ownedEdges[node] + selfLoops / 2 + owned;
+		owned++;
+	}
+
+	return true;
+}
+
+LOSMCompressedGraph::LOSMCompressedGraph(const LOSMGraph &graph)
+{
+	unsigned int n = graph.get_num_nodes();
+	unsigned int m = graph.get_num_edges();
+
+	Source source;
+	source.uids.assign(graph.get_uid_array(), graph.get_uid_array() + n);
+	source.fixedX.assign(graph.get_fixed_x_array(), graph.get_fixed_x_array() + n);
+	source.fixedY.assign(graph.get_fixed_y_array(), graph.get_fixed_y_array() + n);
+	source.edgeNodes.assign(graph.get_edge_nodes_array(), graph.get_edge_nodes_array() + 2 * m);
+	source.distances.assign(graph.get_edge_distances_array(), graph.get_edge_distances_array() + m);
+	source.speedLimits.assign(graph.get_speed_limit_array(), graph.get_speed_limit_array() + m);
+	source.lanes.assign(graph.get_lanes_array(), graph.get_lanes_array() + m);
+
+	compress(source);
+}
+
+LOSMCompressedGraph::LOSMCompressedGraph(std::string nodesFilename, std::string edgesFilename)
+{
+	Source source;
+	load_source(nodesFilename, edgesFilename, source);
+	compress(source);
+}
+
+void LOSMCompressedGraph::load_source(std::string nodesFilename, std::string edgesFilename, Source &source)
+{
+	std::ifstream nodesFile(nodesFilename);
+	if (!nodesFile.is_open()) {
+		std::cerr << "Error[LOSMCompressedGraph::load_source]: Failed to open the file '" << nodesFilename << "'." << std::endl;
+		throw LOSMException();
+	}
+
+	std::string line;
+	unsigned long row = 0;
+
+	while (std::getline(nodesFile, line)) {
+		row++;
+
+		std::vector<std::string> items = split_string_by_comma(line);
+		unsigned long uid = 0;
+		double x = 0.0;
+		double y = 0.0;
+
+		if (items.size() != 4 || !parse_unsigned(items[0], uid) || !parse_double(items[1], x) ||
+				!parse_double(items[2], y) || !is_valid_coordinate(x, y)) {
+			std::cerr << "Error[LOSMCompressedGraph::load_source]: Invalid node on line " << row <<
+					" in file '" << nodesFilename << "'." << std::endl;
+			throw LOSMException();
+		}
+
+		source.uids.push_back(uid);
+		source.fixedX.push_back(degrees_to_fixed_point(x));
+		source.fixedY.push_back(degrees_to_fixed_point(y));
+	}
+
+	if (source.uids.size() >= LOSMGraph::INVALID_INDEX) {
+		std::cerr << "Error[LOSMCompressedGraph::load_source]: Too many nodes in file '" << nodesFilename << "'." << std::endl;
+		throw LOSMException();
+	}
+
+	// Nodes are found by unique identifier through a sorted copy, which is half the size of a hash map.
+	std::vector<std::pair<unsigned long, unsigned int> > uids(source.uids.size());
+	for (unsigned int i = 0; i < uids.size(); i++) {
+		uids[i] = std::make_pair(source.uids[i], i);
+	}
+	std::sort(uids.begin(), uids.end());
+
+	for (unsigned int i = 1; i < uids.size(); i++) {
+		if (uids[i].first == uids[i - 1].first) {
+			std::cerr << "Error[LOSMCompressedGraph::load_source]: A node with UID '" << uids[i].first <<
+					"' appears more than once in file '" << nodesFilename << "'." << std::endl;
+			throw LOSMException();
+		}
+	}
+
+	std::ifstream edgesFile(edgesFilename);
+	if (!edgesFile.is_open()) {
+		std::cerr << "Error[LOSMCompressedGraph::load_source]: Failed to open the file '" << edgesFilename << "'." << std::endl;
+		throw LOSMException();
+	}
+
+	row = 0;
+
+	while (std::getline(edgesFile, line)) {
+		row++;
+
+		std::vector<std::string> items = split_string_by_comma(line);
+		unsigned long uid1 = 0;
+		unsigned long uid2 = 0;
+		double distance = 0.0;
+		unsigned long speedLimit = 0;
+		unsigned long lanes = 0;
+
+		if (items.size() != 6 || !parse_unsigned(items[0], uid1) || !parse_unsigned(items[1], uid2) ||
+				!parse_double(items[3], distance) || !parse_unsigned(items[4], speedLimit) ||
+				!parse_unsigned(items[5], lanes)) {
+			std::cerr << "Error[LOSMCompressedGraph::load_source]: Invalid edge on line " << row <<
+					" in file '" << edgesFilename << "'." << std::endl;
+			throw LOSMException();
+		}
+
+		for (unsigned long uid : {uid1, uid2}) {
+			std::vector<std::pair<unsigned long, unsigned int> >::const_iterator alpha =
+					std::lower_bound(uids.begin(), uids.end(), std::make_pair(uid, 0u));
+			if (alpha == uids.end() || alpha->first != uid) {
+				std::cerr << "Error[LOSMCompressedGraph::load_source]: Failed to find node with UID '" << uid <<
+						"' on line " << row << " in file '" << edgesFilename << "'." << std::endl;
+				throw LOSMException();
+			}
+			source.edgeNodes.push_back(alpha->second);
+		}
+
+		source.distances.push_back((float)distance);
+		source.speedLimits.push_back((unsigned int)std::min(speedLimit, 0xFFFFFFFFul));
+		source.lanes.push_back((unsigned int)std::min(lanes, 0xFFFFFFFFul));
+	}
+
+	if (source.distances.size() >= LOSMGraph::INVALID_INDEX) {
+		std::cerr << "Error[LOSMCompressedGraph::load_source]: Too many edges in file '" << edgesFilename << "'." << std::endl;
+		throw LOSMException();
+	}
+}
+
+void LOSMCompressedGraph::compress(Source &source)
+{
+	numNodes = source.uids.size();
+	numEdges = source.distances.size();
+
+	const std::vector<int> &x = source.fixedX;
+	const std::vector<int> &y = source.fixedY;
+
+	// Renumber the nodes along a Hilbert curve over the bounding box of their coordinates.
+	long minX = 0, maxX = 0, minY = 0, maxY = 0;
+	if (numNodes > 0) {
+		minX = *std::min_element(x.begin(), x.end());
+		maxX = *std::max_element(x.begin(), x.end());
+		minY = *std::min_element(y.begin(), y.end());
+		maxY = *std::max_element(y.begin(), y.end());
+	}
+
+	std::vector<std::pair<uint32_t, unsigned int> > curve(numNodes);
+	for (unsigned int i = 0; i < numNodes; i++) {
+		uint32_t qx = (uint32_t)((x[i] - minX) * 65535 / std::max(1L, maxX - minX));
+		uint32_t qy = (uint32_t)((y[i] - minY) * 65535 / std::max(1L, maxY - minY));
+		curve[i] = std::make_pair(hilbert_index(qx, qy), i);
+	}
+	std::sort(curve.begin(), curve.end());
+
+	std::vector<unsigned int> newNodes(numNodes);
+	for (unsigned int i = 0; i < numNodes; i++) {
+		newNodes[curve[i].second] = i;
+	}
+
+	fixedX.resize(numNodes);
+	fixedY.resize(numNodes);
+	for (unsigned int i = 0; i < numNodes; i++) {
+		fixedX[i] = x[curve[i].second];
+		fixedY[i] = y[curve[i].second];
+	}
+	std::vector<int>().swap(source.fixedX);
+	std::vector<int>().swap(source.fixedY);
+
+	// Renumber the edges by their lower and then upper endpoint, so that the edges owned by each
+	// node are contiguous and ordered like the node's neighbors.
+	std::vector<std::pair<std::pair<unsigned int, unsigned int>, unsigned int> > edgeKeys(numEdges);
+	for (unsigned int i = 0; i < numEdges; i++) {
+		unsigned int n1 = newNodes[source.edgeNodes[2 * i]];
+		unsigned int n2 = newNodes[source.edgeNodes[2 * i + 1]];
+		edgeKeys[i] = std::make_pair(std::make_pair(std::min(n1, n2), std::max(n1, n2)), i);
+	}
+	std::vector<unsigned int>().swap(source.edgeNodes);
+	std::sort(edgeKeys.begin(), edgeKeys.end());
+
+	std::vector<unsigned int> newEdges(numEdges);
+	ownedEdges.assign(numNodes + 1, 0);
+
+	for (unsigned int i = 0; i < numEdges; i++) {
+		newEdges[edgeKeys[i].second] = i;
+		ownedEdges[edgeKeys[i].first.first + 1]++;
+	}
+	for (unsigned int i = 0; i < numNodes; i++) {
+		ownedEdges[i + 1] += ownedEdges[i];
+	}
+
+	// Quantize the speed limits to one byte per edge with a table of the distinct values.
+	std::vector<unsigned int> edgeSpeedLimits(numEdges);
+	for (unsigned int i = 0; i < numEdges; i++) {
+		edgeSpeedLimits[newEdges[i]] = std::min(255u, source.speedLimits[i]);
+	}
+	std::vector<unsigned int>().swap(source.speedLimits);
+
+	speedLimits = edgeSpeedLimits;
+	std::sort(speedLimits.begin(), speedLimits.end());
+	speedLimits.erase(std::unique(speedLimits.begin(), speedLimits.end()), speedLimits.end());
+	speedLimits.shrink_to_fit();
+
+	for (unsigned int speedLimit : speedLimits) {
+		if (speedLimit == 0) {
+			hoursPerMile.push_back(1.0f / (float)LOSMGraph::DEFAULT_SPEED_LIMIT);
+		} else {
+			hoursPerMile.push_back(1.0f / (float)speedLimit);
+		}
+	}
+
+	distances.resize(numEdges);
+	speedClasses.resize(numEdges);
+	lanes.resize(numEdges);
+
+	for (unsigned int i = 0; i < numEdges; i++) {
+		unsigned int j = newEdges[i];
+		distances[j] = source.distances[i];
+		speedClasses[j] = (unsigned char)(std::lower_bound(speedLimits.begin(), speedLimits.end(),
+				edgeSpeedLimits[j]) - speedLimits.begin());
+		lanes[j] = (unsigned char)std::min(255u, source.lanes[i]);
+	}
+	std::vector<float>().swap(source.distances);
+	std::vector<unsigned int>().swap(source.lanes);
+	std::vector<unsigned int>().swap(edgeSpeedLimits);
+	std::vector<unsigned int>().swap(newEdges);
+
+	// List the neighbors of each node in the new numbering; every edge appears at both of its
+	// endpoints, so a self-loop appears twice at its node.
+	std::vector<unsigned int> slotOffsets(numNodes + 1, 0);
+	for (unsigned int i = 0; i < numEdges; i++) {
+		slotOffsets[edgeKeys[i].first.first + 1]++;
+		slotOffsets[edgeKeys[i].first.second + 1]++;
+	}
+	for (unsigned int i = 0; i < numNodes; i++) {
+		slotOffsets[i + 1] += slotOffsets[i];
+	}
+
+	std::vector<std::pair<unsigned int, unsigned int> > slots(2 * (size_t)numEdges);
+	std::vector<unsigned int> next(slotOffsets.begin(), slotOffsets.end() - 1);
+
+	for (unsigned int i = 0; i < numEdges; i++) {
+		unsigned int u = edgeKeys[i].first.first;
+		unsigned int v = edgeKeys[i].first.second;
+		slots[next[u]++] = std::make_pair(v, i);
+		slots[next[v]++] = std::make_pair(u, i);
+	}
+	std::vector<unsigned int>().swap(next);
+
+	// Encode the adjacency of each node.
+	adjacencyOffsets.resize(numNodes + 1);
+
+	for (unsigned int u = 0; u < numNodes; u++) {
+		std::sort(slots.begin() + slotOffsets[u], slots.begin() + slotOffsets[u + 1]);
+
+		if (adjacency.size() > 0xFFFFFFFFul) {
+			std::cerr << "Error[LOSMCompressedGraph::compress]: The adjacency exceeded 4 GB." << std::endl;
+			throw LOSMException();
+		}
+		adjacencyOffsets[u] = adjacency.size();
+
+		unsigned int previous = u;
+
+		for (unsigned int i = slotOffsets[u]; i < slotOffsets[u + 1]; i++) {
+			unsigned int v = slots[i].first;
+
+			if (i == slotOffsets[u]) {
+				int64_t offset = (int64_t)v - (int64_t)u;
+				write_varint((unsigned long)(((uint64_t)offset << 1) ^ (uint64_t)(offset >> 63)), adjacency);
+			} else {
+				write_varint(v - previous, adjacency);
+			}
+			previous = v;
+
+			// Edges owned by the neighbor (or self-loops) need their rank within the owner's range;
+			// edges owned by this node follow implicitly from the order of the neighbors.
+			if (v <= u) {
+				write_varint(slots[i].second - ownedEdges[v], adjacency);
+			}
+		}
+	}
+
+	adjacencyOffsets[numNodes] = adjacency.size();
+	adjacency.shrink_to_fit();
+	std::vector<std::pair<unsigned int, unsigned int> >().swap(slots);
+	std::vector<unsigned int>().swap(slotOffsets);
+
+	// Keep the original index of each node and edge, so that results map back to them.
+	indexBits = get_index_bits(numNodes);
+	edgeBits = get_index_bits(numEdges);
+
+	std::vector<unsigned int> values(numEdges);
+	for (unsigned int i = 0; i < numEdges; i++) {
+		values[i] = edgeKeys[i].second;
+	}
+	set_packed(values, edgeBits, originalEdges);
+	std::vector<std::pair<std::pair<unsigned int, unsigned int>, unsigned int> >().swap(edgeKeys);
+
+	values.resize(numNodes);
+	for (unsigned int i = 0; i < numNodes; i++) {
+		values[i] = curve[i].second;
+	}
+	set_packed(values, indexBits, originalNodes);
+
+	// Store the sorted unique identifiers in blocks of varint deltas, and bit-pack the mapping
+	// between their ranks and the node indices in both directions.
+	std::vector<std::pair<unsigned long, unsigned int> > uids(numNodes);
+	for (unsigned int i = 0; i < numNodes; i++) {
+		uids[i] = std::make_pair(source.uids[curve[i].second], i);
+	}
+	std::vector<unsigned long>().swap(source.uids);
+	std::sort(uids.begin(), uids.end());
+
+	for (unsigned int i = 0; i < numNodes; i++) {
+		if (i % UID_BLOCK_SIZE == 0) {
+			uidBlockFirsts.push_back(uids[i].first);
+			uidBlockOffsets.push_back(uidDeltas.size());
+		} else {
+			write_varint(uids[i].first - uids[i - 1].first, uidDeltas);
+		}
+	}
+	uidDeltas.shrink_to_fit();
+
+	for (unsigned int i = 0; i < numNodes; i++) {
+		values[i] = uids[i].second;
+	}
+	set_packed(values, indexBits, uidNodes);
+
+	for (unsigned int i = 0; i < numNodes; i++) {
+		values[uids[i].second] = i;
+	}
+	set_packed(values, indexBits, nodeUIDRanks);
+}
+
+LOSMCompressedGraph::~LOSMCompressedGraph()
+{ }
+
+unsigned int LOSMCompressedGraph::get_num_nodes() const
+{
+	return numNodes;
+}
+
+unsigned int LOSMCompressedGraph::get_num_edges() const
+{
+	return numEdges;
+}
+
+unsigned long LOSMCompressedGraph::get_uid(unsigned int node) const
+{
+	unsigned int rank = get_packed(nodeUIDRanks, indexBits, node);
+	unsigned int block = rank / UID_BLOCK_SIZE;
+
+	unsigned long uid = uidBlockFirsts[block];
+	const unsigned char *current = &uidDeltas[0] + uidBlockOffsets[block];
+
+	for (unsigned int i = block * UID_BLOCK_SIZE; i < rank; i++) {
+		uid += read_varint(current);
+	}
+
+	return uid;
+}
+
+unsigned int LOSMCompressedGraph::find_node_index(unsigned long uid) const
+{
+	// Find the last block starting at or before the unique identifier, then scan it.
+	std::vector<unsigned long>::const_iterator alpha = std::upper_bound(uidBlockFirsts.begin(), uidBlockFirsts.end(), uid);
+	if (alpha == uidBlockFirsts.begin()) {
+		return LOSMGraph::INVALID_INDEX;
+	}
+
+	unsigned int block = (alpha - uidBlockFirsts.begin()) - 1;
+	unsigned int last = std::min(numNodes, (block + 1) * UID_BLOCK_SIZE);
+
+	unsigned long current = uidBlockFirsts[block];
+	const unsigned char *delta = &uidDeltas[0] + uidBlockOffsets[block];
+
+	for (unsigned int rank = block * UID_BLOCK_SIZE; rank < last; rank++) {
+		if (rank > block * UID_BLOCK_SIZE) {
+			current += read_varint(delta);
+		}
+
+		if (current == uid) {
+			return get_packed(uidNodes, indexBits, rank);
+		} else if (current > uid) {
+			break;
+		}
+	}
+
+	return LOSMGraph::INVALID_INDEX;
+}
+
+unsigned int LOSMCompressedGraph::get_original_node(unsigned int node) const
+{
+	return get_packed(originalNodes, indexBits, node);
+}
+
+unsigned int LOSMCompressedGraph::get_original_edge(unsigned int edge) const
+{
+	return get_packed(originalEdges, edgeBits, edge);
+}
+
+int LOSMCompressedGraph::get_fixed_x(unsigned int node) const
+{
+	return fixedX[node];
+}
+
+int LOSMCompressedGraph::get_fixed_y(unsigned int node) const
+{
+	return fixedY[node];
+}
+
+LOSMCompressedGraph::NeighborIterator LOSMCompressedGraph::get_neighbors(unsigned int node) const
+{
+	NeighborIterator iterator;
+	iterator.graph = this;
+	iterator.node = node;
+	iterator.current = adjacency.data() + adjacencyOffsets[node];
+	iterator.end = adjacency.data() + adjacencyOffsets[node + 1];
+	iterator.previous = node;
+	iterator.first = true;
+	iterator.selfLoops = 0;
+	iterator.owned = 0;
+	return iterator;
+}
+
+float LOSMCompressedGraph::get_distance(unsigned int edge) const
+{
+	return distances[edge];
+}
+
+unsigned int LOSMCompressedGraph::get_speed_limit(unsigned int edge) const
+{
+	return speedLimits[speedClasses[edge]];
+}
+
+unsigned int LOSMCompressedGraph::get_lanes(unsigned int edge) const
+{
+	return lanes[edge];
+}
+
+float LOSMCompressedGraph::get_edge_cost(unsigned int edge, LOSMCost cost) const
+{
+	if (cost == LOSMCost::TRAVEL_TIME) {
+		return distances[edge] * hoursPerMile[speedClasses[edge]];
+	}
+	return distances[edge];
+}
+
+LOSMMemoryUsage LOSMCompressedGraph::get_memory_usage() const
+{
+	LOSMMemoryUsage usage;
+
+	usage.adjacency = adjacency.capacity() + adjacencyOffsets.capacity() * sizeof(unsigned int) +
+			ownedEdges.capacity() * sizeof(unsigned int);
+
+	usage.edgeAttributes = distances.capacity() * sizeof(float) + speedClasses.capacity() + lanes.capacity() +
+			speedLimits.capacity() * sizeof(unsigned int) + hoursPerMile.capacity() * sizeof(float);
+
+	usage.coordinates = fixedX.capacity() * sizeof(int) + fixedY.capacity() * sizeof(int);
+
+	usage.indices = uidBlockFirsts.capacity() * sizeof(unsigned long) +
+			uidBlockOffsets.capacity() * sizeof(unsigned int) + uidDeltas.capacity() +
+			uidNodes.capacity() * sizeof(uint64_t) + nodeUIDRanks.capacity() * sizeof(uint64_t) +
+			originalNodes.capacity() * sizeof(uint64_t) + originalEdges.capacity() * sizeof(uint64_t);
+
+	usage.spatialIndex = 0;
+	usage.objects = 0;
+
+	return usage;
+}
+
+void LOSMCompressedGraph::report_memory_usage(const LOSMGraph &uncompressed, std::ostream &stream) const
+{
+	LOSMMemoryUsage before = uncompressed.get_memory_usage();
+	LOSMMemoryUsage after = get_memory_usage();
+
+	const char *names[] = {"adjacency", "edge attributes", "coordinates", "indices", "spatial index", "objects"};
+	size_t beforeParts[] = {before.adjacency, before.edgeAttributes, before.coordinates, before.indices,
+			before.spatialIndex, before.objects};
+	size_t afterParts[] = {after.adjacency, after.edgeAttributes, after.coordinates, after.indices,
+			after.spatialIndex, after.objects};
+
+	size_t beforeTotal = 0;
+	size_t afterTotal = 0;
+
+	stream << std::left << std::setw(18) << "part" << std::right << std::setw(16) << "uncompressed" <<
+			std::setw(16) << "compressed" << std::endl;
+
+	for (unsigned int i = 0; i < 6; i++) {
+		stream << std::left << std::setw(18) << names[i] << std::right << std::setw(16) << beforeParts[i] <<
+				std::setw(16) << afterParts[i] << std::endl;
+		beforeTotal += beforeParts[i];
+		afterTotal += afterParts[i];
+	}
+
+	stream << std::left << std::setw(18) << "total" << std::right << std::setw(16) << beforeTotal <<
+			std::setw(16) << afterTotal << std::endl;
+
+	if (numEdges > 0) {
+		stream << "Adjacency bytes per edge: " << std::fixed << std::setprecision(2) <<
+				(double)before.adjacency / numEdges << " uncompressed, " <<
+				(double)after.adjacency / numEdges << " compressed." << std::endl;
+	}
+}
+
+unsigned int LOSMCompressedGraph::get_index_bits(unsigned int count)
+{
+	unsigned int bits = 1;
+	while (bits < 32 && (1ul << bits) < count) {
+		bits++;
+	}
+	return bits;
+}
+
+unsigned int LOSMCompressedGraph::get_packed(const std::vector<uint64_t> &packed, unsigned int bits, unsigned int index)
+{
+	uint64_t position = (uint64_t)index * bits;
+	uint64_t value = packed[position / 64] >> (position % 64);
+	if (position % 64 + bits > 64) {
+		value |= packed[position / 64 + 1] << (64 - position % 64);
+	}
+	return (unsigned int)(value & ((1ull << bits) - 1));
+}
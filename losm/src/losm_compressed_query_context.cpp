@@ -0,0 +1,161 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "../include/losm_compressed_query_context.h"
+#include "../include/losm_exception.h"
+#include "../include/losm_instrumentation.h"
+
+#include <iostream>
+#include <algorithm>
+#include <functional>
+#include <cmath>
+
+LOSMCompressedQueryContext::LOSMCompressedQueryContext(std::shared_ptr<const LOSMCompressedGraph> graph)
+{
+	if (graph == nullptr) {
+		std::cerr << "Error[LOSMCompressedQueryContext::LOSMCompressedQueryContext]: The graph provided was null." << std::endl;
+		throw LOSMException();
+	}
+
+	this->graph = graph;
+
+	costs.resize(graph->get_num_nodes(), INFINITY);
+	parentNodes.resize(graph->get_num_nodes(), LOSMGraph::INVALID_INDEX);
+	parentEdges.resize(graph->get_num_nodes(), LOSMGraph::INVALID_INDEX);
+	stamps.resize(graph->get_num_nodes(), 0);
+	currentStamp = 0;
+}
+
+LOSMCompressedQueryContext::~LOSMCompressedQueryContext()
+{ }
+
+const LOSMCompressedGraph *LOSMCompressedQueryContext::get_graph() const
+{
+	return graph.get();
+}
+
+float LOSMCompressedQueryContext::find_distance(unsigned long sourceUID, unsigned long targetUID, LOSMCost cost)
+{
+	return search(get_node_index(sourceUID), get_node_index(targetUID), cost);
+}
+
+void LOSMCompressedQueryContext::find_route(unsigned long sourceUID, unsigned long targetUID, LOSMCost cost,
+		LOSMCompressedRoute &route)
+{
+	unsigned int source = get_node_index(sourceUID);
+	unsigned int target = get_node_index(targetUID);
+
+	route.uids.clear();
+	route.edges.clear();
+	route.cost = search(source, target, cost);
+	route.found = (route.cost != INFINITY);
+
+	if (!route.found) {
+		return;
+	}
+
+	// Follow the parents back from the target, then reverse them.
+	for (unsigned int node = target; node != source; node = parentNodes[node]) {
+		route.uids.push_back(graph->get_uid(node));
+		route.edges.push_back(graph->get_original_edge(parentEdges[node]));
+	}
+	route.uids.push_back(sourceUID);
+
+	std::reverse(route.uids.begin(), route.uids.end());
+	std::reverse(route.edges.begin(), route.edges.end());
+}
+
+float LOSMCompressedQueryContext::search(unsigned int source, unsigned int target, LOSMCost cost)
+{
+	LOSM_INSTRUMENT(LOSMOperation::SEARCH);
+
+	currentStamp++;
+	if (currentStamp == 0) {
+		std::fill(stamps.begin(), stamps.end(), 0);
+		currentStamp = 1;
+	}
+
+	std::greater<std::pair<float, unsigned int> > compare;
+	heap.clear();
+
+	costs[source] = 0.0f;
+	parentNodes[source] = LOSMGraph::INVALID_INDEX;
+	parentEdges[source] = LOSMGraph::INVALID_INDEX;
+	stamps[source] = currentStamp;
+	heap.push_back(std::make_pair(0.0f, source));
+
+	while (!heap.empty()) {
+		std::pop_heap(heap.begin(), heap.end(), compare);
+		float nodeCost = heap.back().first;
+		unsigned int node = heap.back().second;
+		heap.pop_back();
+
+		// Skip stale entries which were superseded by a cheaper path.
+		if (nodeCost > costs[node]) {
+			continue;
+		}
+
+		if (node == target) {
+			return nodeCost;
+		}
+
+		LOSMCompressedGraph::NeighborIterator neighbors = graph->get_neighbors(node);
+		unsigned int neighbor = 0;
+		unsigned int edge = 0;
+
+		while (neighbors.next(neighbor, edge)) {
+			float neighborCost = nodeCost + graph->get_edge_cost(edge, cost);
+
+			if (stamps[neighbor] != currentStamp || neighborCost < costs[neighbor]) {
+				costs[neighbor] = neighborCost;
+				parentNodes[neighbor] = node;
+				parentEdges[neighbor] = edge;
+				stamps[neighbor] = currentStamp;
+
+				heap.push_back(std::make_pair(neighborCost, neighbor));
+				std::push_heap(heap.begin(), heap.end(), compare);
+			}
+		}
+	}
+
+	return INFINITY;
+}
+
+float LOSMCompressedQueryContext::get_cost(unsigned int node) const
+{
+	if (stamps[node] != currentStamp) {
+		return INFINITY;
+	}
+	return costs[node];
+}
+
+unsigned int LOSMCompressedQueryContext::get_node_index(unsigned long uid) const
+{
+	unsigned int node = graph->find_node_index(uid);
+	if (node == LOSMGraph::INVALID_INDEX) {
+		std::cerr << "Error[LOSMCompressedQueryContext::get_node_index]: No node has the UID '" << uid << "'." << std::endl;
+		throw LOSMException();
+	}
+	return node;
+}
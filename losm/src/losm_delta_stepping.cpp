@@ -0,0 +1,269 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "../include/losm_delta_stepping.h"
+#include "../include/losm_exception.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+const float LOSMDeltaStepping::DELTA_FACTOR = 4.0f;
+
+/**
+ * The packed state of a node which has not been reached.
+ */
+static const uint64_t UNREACHED = 0xFFFFFFFFFFFFFFFFull;
+
+/**
+ * Pack a non-negative cost and an edge, such that packed states order by cost, then edge.
+ * @param	cost	The cost.
+ * @param	edge	The index of the edge.
+ * @return	The packed state.
+ */
+static inline uint64_t pack_state(float cost, unsigned int edge)
+{
+	uint32_t bits = 0;
+	std::memcpy(&bits, &cost, sizeof(bits));
+	return ((uint64_t)bits << 32) | edge;
+}
+
+/**
+ * Get the cost of a packed state.
+ * @param	state	The packed state.
+ * @return	The cost.
+ */
+static inline float unpack_cost(uint64_t state)
+{
+	uint32_t bits = (uint32_t)(state >> 32);
+	float cost = 0.0f;
+	std::memcpy(&cost, &bits, sizeof(cost));
+	return cost;
+}
+
+LOSMDeltaStepping::LOSMDeltaStepping(std::shared_ptr<const LOSMGraph> graph, unsigned int numThreads) :
+		currentCost(LOSMCost::DISTANCE), currentDelta(1.0f), currentBucket(0)
+{
+	if (graph == nullptr) {
+		std::cerr << "Error[LOSMDeltaStepping::LOSMDeltaStepping]: The graph provided was null." << std::endl;
+		throw LOSMException();
+	}
+
+	this->graph = graph;
+
+	const float *edgeCosts[2] = {graph->get_edge_distances_array(), graph->get_edge_travel_times_array()};
+	for (unsigned int i = 0; i < 2; i++) {
+		double sum = 0.0;
+		maxCosts[i] = 0.0f;
+		for (unsigned int edge = 0; edge < graph->get_num_edges(); edge++) {
+			sum += edgeCosts[i][edge];
+			maxCosts[i] = std::max(maxCosts[i], edgeCosts[i][edge]);
+		}
+		meanCosts[i] = (graph->get_num_edges() > 0 ? (float)(sum / graph->get_num_edges()) : 0.0f);
+	}
+
+	states.reset(new std::atomic<uint64_t>[graph->get_num_nodes()]);
+
+	pool.reset(new LOSMThreadPool(numThreads));
+	buckets.resize(pool->get_num_threads() + 1);
+}
+
+LOSMDeltaStepping::~LOSMDeltaStepping()
+{
+	pool.reset();
+}
+
+float LOSMDeltaStepping::get_default_delta(LOSMCost cost) const
+{
+	float delta = meanCosts[cost == LOSMCost::DISTANCE ? 0 : 1] * DELTA_FACTOR;
+	if (!(delta > 0.0f)) {
+		return 1.0f;
+	}
+	return delta;
+}
+
+void LOSMDeltaStepping::search(unsigned int source, LOSMCost cost, std::vector<float> &costs,
+		std::vector<unsigned int> &parentEdges, float delta)
+{
+	unsigned int numNodes = graph->get_num_nodes();
+	if (source >= numNodes) {
+		std::cerr << "Error[LOSMDeltaStepping::search]: The source is not a node of the graph." << std::endl;
+		throw LOSMException();
+	}
+
+	if (!(delta > 0.0f)) {
+		delta = get_default_delta(cost);
+	}
+
+	// Every tentative cost is within the largest edge cost of the current bucket's, so this
+	// many buckets suffice; the width is widened if there would be too many.
+	float maxCost = maxCosts[cost == LOSMCost::DISTANCE ? 0 : 1];
+	delta = std::max(delta, maxCost / (float)MAX_BUCKETS);
+	unsigned int numBuckets = (unsigned int)(maxCost / delta) + 2;
+
+	currentCost = cost;
+	currentDelta = delta;
+	currentBucket = 0;
+	for (Buckets &workerBuckets : buckets) {
+		workerBuckets.nodes.resize(numBuckets);
+		for (std::vector<unsigned int> &bucket : workerBuckets.nodes) {
+			bucket.clear();
+		}
+		workerBuckets.settled.clear();
+	}
+
+	unsigned int numBatches = (numNodes + BATCH_SIZE - 1) / BATCH_SIZE;
+	pool->parallel_for(numBatches, [this, numNodes](unsigned int batch, unsigned int /* worker */) {
+		unsigned int last = std::min(numNodes, (batch + 1) * BATCH_SIZE);
+		for (unsigned int node = batch * BATCH_SIZE; node < last; node++) {
+			states[node].store(UNREACHED, std::memory_order_relaxed);
+		}
+	});
+
+	unsigned int caller = pool->get_num_threads();
+	states[source].store(pack_state(0.0f, LOSMGraph::INVALID_INDEX));
+	buckets[caller].nodes[0].push_back(source);
+
+	// Small frontiers are relaxed by the calling thread, since a round trip through the pool
+	// costs more than they do.
+	std::vector<unsigned int> frontier;
+	auto relax_frontier = [&](bool heavy) {
+		if (frontier.size() <= BATCH_SIZE) {
+			relax(frontier, 0, frontier.size(), heavy, caller);
+			return;
+		}
+
+		unsigned int count = (unsigned int)frontier.size();
+		pool->parallel_for((count + BATCH_SIZE - 1) / BATCH_SIZE,
+			[this, &frontier, count, heavy](unsigned int batch, unsigned int worker) {
+				relax(frontier, batch * BATCH_SIZE, std::min(count, (batch + 1) * BATCH_SIZE), heavy, worker);
+			});
+	};
+
+	while (true) {
+		// Find the lowest bucket which any worker has filled.
+		bool found = false;
+		for (unsigned int i = 0; i < numBuckets && !found; i++) {
+			unsigned int slot = (currentBucket + i) % numBuckets;
+			for (const Buckets &workerBuckets : buckets) {
+				if (!workerBuckets.nodes[slot].empty()) {
+					currentBucket += i;
+					found = true;
+					break;
+				}
+			}
+		}
+
+		if (!found) {
+			break;
+		}
+
+		// Relax the light edges until the bucket stays empty.
+		unsigned int slot = currentBucket % numBuckets;
+		while (true) {
+			frontier.clear();
+			for (Buckets &workerBuckets : buckets) {
+				frontier.insert(frontier.end(), workerBuckets.nodes[slot].begin(), workerBuckets.nodes[slot].end());
+				workerBuckets.nodes[slot].clear();
+			}
+
+			if (frontier.empty()) {
+				break;
+			}
+
+			relax_frontier(false);
+		}
+
+		// The costs of the bucket's nodes are now final, so their heavy edges are relaxed once.
+		frontier.clear();
+		for (Buckets &workerBuckets : buckets) {
+			frontier.insert(frontier.end(), workerBuckets.settled.begin(), workerBuckets.settled.end());
+			workerBuckets.settled.clear();
+		}
+
+		relax_frontier(true);
+	}
+
+	costs.resize(numNodes);
+	parentEdges.resize(numNodes);
+
+	for (unsigned int node = 0; node < numNodes; node++) {
+		uint64_t state = states[node].load(std::memory_order_relaxed);
+		if (state == UNREACHED) {
+			costs[node] = INFINITY;
+			parentEdges[node] = LOSMGraph::INVALID_INDEX;
+		} else {
+			costs[node] = unpack_cost(state);
+			parentEdges[node] = (unsigned int)(state & 0xFFFFFFFFull);
+		}
+	}
+}
+
+void LOSMDeltaStepping::relax(const std::vector<unsigned int> &frontier, unsigned int first, unsigned int last,
+		bool heavy, unsigned int worker)
+{
+	const float *edgeCosts = (currentCost == LOSMCost::DISTANCE ? graph->get_edge_distances_array() :
+			graph->get_edge_travel_times_array());
+	const unsigned int *offsets = graph->get_adjacency_offsets_array();
+	const unsigned int *adjacentNodes = graph->get_adjacent_nodes_array();
+	const unsigned int *adjacentEdges = graph->get_adjacent_edges_array();
+
+	Buckets &workerBuckets = buckets[worker];
+	unsigned int numBuckets = (unsigned int)workerBuckets.nodes.size();
+
+	for (unsigned int i = first; i < last; i++) {
+		unsigned int node = frontier[i];
+		float nodeCost = unpack_cost(states[node].load(std::memory_order_relaxed));
+
+		// Skip nodes which have since moved to a lower bucket; they were relaxed there.
+		if (!heavy) {
+			if ((unsigned long)(nodeCost / currentDelta) != currentBucket) {
+				continue;
+			}
+			workerBuckets.settled.push_back(node);
+		}
+
+		for (unsigned int slot = offsets[node]; slot < offsets[node + 1]; slot++) {
+			unsigned int edge = adjacentEdges[slot];
+			float edgeCost = edgeCosts[edge];
+			if ((edgeCost > currentDelta) != heavy) {
+				continue;
+			}
+
+			unsigned int neighbor = adjacentNodes[slot];
+			float neighborCost = nodeCost + edgeCost;
+			uint64_t state = pack_state(neighborCost, edge);
+
+			uint64_t previous = states[neighbor].load(std::memory_order_relaxed);
+			while (state < previous) {
+				if (states[neighbor].compare_exchange_weak(previous, state, std::memory_order_relaxed)) {
+					unsigned long bucket = (unsigned long)(neighborCost / currentDelta);
+					workerBuckets.nodes[bucket % numBuckets].push_back(neighbor);
+					break;
+				}
+			}
+		}
+	}
+}
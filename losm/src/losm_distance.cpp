@@ -0,0 +1,325 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "../include/losm_distance.h"
+#include "../include/losm_utilities.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LOSM_DISTANCE_AVX2
+#include <immintrin.h>
+#endif
+
+// The number of radians in one fixed-point unit.
+static const double FIXED_POINT_TO_RADIANS = M_PI / (180.0 * LOSM_FIXED_POINT_SCALE);
+
+// Half of a full turn of longitude in fixed-point units.
+static const double FIXED_POINT_HALF_TURN = 180.0 * LOSM_FIXED_POINT_SCALE;
+
+/**
+ * Compute the difference between two longitudes in fixed point, wrapped into [-180, 180] degrees.
+ * @param	y1	The first longitude in fixed point.
+ * @param	y2	The second longitude in fixed point.
+ * @return	The difference y2 - y1 in fixed point, wrapped around the antimeridian.
+ */
+static inline double longitude_difference(int y1, int y2)
+{
+	double difference = (double)y2 - (double)y1;
+	if (difference > FIXED_POINT_HALF_TURN) {
+		difference -= 2.0 * FIXED_POINT_HALF_TURN;
+	} else if (difference < -FIXED_POINT_HALF_TURN) {
+		difference += 2.0 * FIXED_POINT_HALF_TURN;
+	}
+	return difference;
+}
+
+float haversine_distance(int x1, int y1, int x2, int y2)
+{
+	double lat1 = x1 * FIXED_POINT_TO_RADIANS;
+	double lat2 = x2 * FIXED_POINT_TO_RADIANS;
+	double dlat = ((double)x2 - (double)x1) * FIXED_POINT_TO_RADIANS;
+	double dlon = longitude_difference(y1, y2) * FIXED_POINT_TO_RADIANS;
+
+	double sinLat = std::sin(dlat / 2.0);
+	double sinLon = std::sin(dlon / 2.0);
+
+	double alpha = sinLat * sinLat + std::cos(lat1) * std::cos(lat2) * sinLon * sinLon;
+	double beta = 2.0 * std::asin(std::sqrt(std::min(1.0, alpha)));
+
+	return (float)(LOSM_EARTH_RADIUS_IN_MILES * beta);
+}
+
+float equirectangular_distance(int x1, int y1, int x2, int y2)
+{
+	double meanLat = 0.5 * ((double)x1 + (double)x2) * FIXED_POINT_TO_RADIANS;
+	double dlat = ((double)x2 - (double)x1) * FIXED_POINT_TO_RADIANS;
+	double dlon = longitude_difference(y1, y2) * FIXED_POINT_TO_RADIANS * std::cos(meanLat);
+
+	return (float)(LOSM_EARTH_RADIUS_IN_MILES * std::sqrt(dlat * dlat + dlon * dlon));
+}
+
+#ifdef LOSM_DISTANCE_AVX2
+
+/**
+ * Check once if the processor supports the AVX2 kernels.
+ * @return	True if AVX2 and FMA are both supported, false otherwise.
+ */
+static bool has_avx2()
+{
+	static const bool supported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+	return supported;
+}
+
+/**
+ * Compute the sine of eight angles in [-pi/2, pi/2] with its Taylor series to degree 11,
+ * which is accurate to about 6e-8 on that interval.
+ */
+__attribute__((target("avx2,fma")))
+static inline __m256 sin_avx2(__m256 x)
+{
+	__m256 z = _mm256_mul_ps(x, x);
+	__m256 p = _mm256_set1_ps(-1.0f / 39916800.0f);
+	p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(1.0f / 362880.0f));
+	p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(-1.0f / 5040.0f));
+	p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(1.0f / 120.0f));
+	p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(-1.0f / 6.0f));
+	p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(1.0f));
+	return _mm256_mul_ps(p, x);
+}
+
+/**
+ * Compute the cosine of eight angles in [-pi/2, pi/2] with its Taylor series to degree 12,
+ * which is accurate to about 7e-9 on that interval.
+ */
+__attribute__((target("avx2,fma")))
+static inline __m256 cos_avx2(__m256 x)
+{
+	__m256 z = _mm256_mul_ps(x, x);
+	__m256 p = _mm256_set1_ps(1.0f / 479001600.0f);
+	p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(-1.0f / 3628800.0f));
+	p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(1.0f / 40320.0f));
+	p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(-1.0f / 720.0f));
+	p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(1.0f / 24.0f));
+	p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(-0.5f));
+	return _mm256_fmadd_ps(p, z, _mm256_set1_ps(1.0f));
+}
+
+/**
+ * Compute the arcsine of eight values in [0, 1] with the single-precision Cephes polynomial,
+ * reflecting values above 0.5 through asin(x) = pi/2 - 2 asin(sqrt((1 - x) / 2)).
+ */
+__attribute__((target("avx2,fma")))
+static inline __m256 asin_avx2(__m256 x)
+{
+	__m256 half = _mm256_set1_ps(0.5f);
+	__m256 large = _mm256_cmp_ps(x, half, _CMP_GT_OQ);
+
+	__m256 reflected = _mm256_mul_ps(half, _mm256_sub_ps(_mm256_set1_ps(1.0f), x));
+	__m256 z = _mm256_blendv_ps(_mm256_mul_ps(x, x), reflected, large);
+	__m256 s = _mm256_blendv_ps(x, _mm256_sqrt_ps(reflected), large);
+
+	__m256 p = _mm256_set1_ps(4.2163199048e-2f);
+	p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(2.4181311049e-2f));
+	p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(4.5470025998e-2f));
+	p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(7.4953002686e-2f));
+	p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(1.6666752422e-1f));
+	p = _mm256_fmadd_ps(_mm256_mul_ps(p, z), s, s);
+
+	__m256 flipped = _mm256_fnmadd_ps(_mm256_set1_ps(2.0f), p, _mm256_set1_ps((float)(M_PI / 2.0)));
+	return _mm256_blendv_ps(p, flipped, large);
+}
+
+/**
+ * Compute eight longitude differences y2 - y1 in radians, wrapped around the antimeridian. The
+ * halves of both longitudes are subtracted and wrapped first, since y2 - y1 may overflow 32 bits.
+ */
+__attribute__((target("avx2,fma")))
+static inline __m256 longitude_difference_avx2(__m256i y1, __m256i y2)
+{
+	__m256i one = _mm256_set1_epi32(1);
+	__m256i high = _mm256_sub_epi32(_mm256_srai_epi32(y2, 1), _mm256_srai_epi32(y1, 1));
+	__m256i low = _mm256_sub_epi32(_mm256_and_si256(y2, one), _mm256_and_si256(y1, one));
+
+	// Wrap the difference of the halves into [-90, 90] degrees, i.e., half of [-180, 180].
+	__m256i quarterTurn = _mm256_set1_epi32((int)(FIXED_POINT_HALF_TURN / 2.0));
+	__m256i halfTurn = _mm256_set1_epi32((int)FIXED_POINT_HALF_TURN);
+	high = _mm256_sub_epi32(high, _mm256_and_si256(_mm256_cmpgt_epi32(high, quarterTurn), halfTurn));
+	high = _mm256_add_epi32(high, _mm256_and_si256(_mm256_cmpgt_epi32(_mm256_sub_epi32(_mm256_setzero_si256(),
+			quarterTurn), high), halfTurn));
+
+	__m256i difference = _mm256_add_epi32(_mm256_slli_epi32(high, 1), low);
+
+	return _mm256_mul_ps(_mm256_cvtepi32_ps(difference), _mm256_set1_ps((float)FIXED_POINT_TO_RADIANS));
+}
+
+/**
+ * Compute eight Haversine distances (in miles).
+ */
+__attribute__((target("avx2,fma")))
+static inline __m256 haversine_avx2(__m256i x1, __m256i y1, __m256i x2, __m256i y2)
+{
+	__m256 toRadians = _mm256_set1_ps((float)FIXED_POINT_TO_RADIANS);
+	__m256 half = _mm256_set1_ps(0.5f);
+
+	__m256 lat1 = _mm256_mul_ps(_mm256_cvtepi32_ps(x1), toRadians);
+	__m256 lat2 = _mm256_mul_ps(_mm256_cvtepi32_ps(x2), toRadians);
+	__m256 dlat = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_sub_epi32(x2, x1)), toRadians);
+	__m256 dlon = longitude_difference_avx2(y1, y2);
+
+	__m256 sinLat = sin_avx2(_mm256_mul_ps(dlat, half));
+	__m256 sinLon = sin_avx2(_mm256_mul_ps(dlon, half));
+
+	__m256 alpha = _mm256_mul_ps(_mm256_mul_ps(cos_avx2(lat1), cos_avx2(lat2)), _mm256_mul_ps(sinLon, sinLon));
+	alpha = _mm256_fmadd_ps(sinLat, sinLat, alpha);
+	alpha = _mm256_min_ps(_mm256_max_ps(alpha, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+
+	__m256 beta = _mm256_mul_ps(_mm256_set1_ps(2.0f), asin_avx2(_mm256_sqrt_ps(alpha)));
+
+	return _mm256_mul_ps(beta, _mm256_set1_ps((float)LOSM_EARTH_RADIUS_IN_MILES));
+}
+
+/**
+ * Compute eight equirectangular distances (in miles).
+ */
+__attribute__((target("avx2,fma")))
+static inline __m256 equirectangular_avx2(__m256i x1, __m256i y1, __m256i x2, __m256i y2)
+{
+	__m256 toRadians = _mm256_set1_ps((float)FIXED_POINT_TO_RADIANS);
+
+	__m256 meanLat = _mm256_mul_ps(_mm256_add_ps(_mm256_cvtepi32_ps(x1), _mm256_cvtepi32_ps(x2)),
+			_mm256_set1_ps((float)(0.5 * FIXED_POINT_TO_RADIANS)));
+	__m256 dlat = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_sub_epi32(x2, x1)), toRadians);
+	__m256 dlon = _mm256_mul_ps(longitude_difference_avx2(y1, y2), cos_avx2(meanLat));
+
+	__m256 length = _mm256_sqrt_ps(_mm256_fmadd_ps(dlat, dlat, _mm256_mul_ps(dlon, dlon)));
+
+	return _mm256_mul_ps(length, _mm256_set1_ps((float)LOSM_EARTH_RADIUS_IN_MILES));
+}
+
+/**
+ * Run an eight-wide kernel over count pairs. The first coordinates advance by stride, so a
+ * stride of zero compares one coordinate against all others. The tail is padded so that every
+ * element is computed by the same kernel.
+ */
+template <__m256 (*Kernel)(__m256i, __m256i, __m256i, __m256i)>
+__attribute__((target("avx2,fma")))
+static void run_avx2(unsigned int count, const int *x1, const int *y1, unsigned int stride,
+		const int *x2, const int *y2, float *result)
+{
+	unsigned int i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m256i a = (stride == 0) ? _mm256_set1_epi32(x1[0]) : _mm256_loadu_si256((const __m256i *)(x1 + i));
+		__m256i b = (stride == 0) ? _mm256_set1_epi32(y1[0]) : _mm256_loadu_si256((const __m256i *)(y1 + i));
+		__m256i c = _mm256_loadu_si256((const __m256i *)(x2 + i));
+		__m256i d = _mm256_loadu_si256((const __m256i *)(y2 + i));
+
+		_mm256_storeu_ps(result + i, Kernel(a, b, c, d));
+	}
+
+	if (i < count) {
+		int bx1[8] = {0}, by1[8] = {0}, bx2[8] = {0}, by2[8] = {0};
+		float bresult[8];
+
+		for (unsigned int j = 0; i + j < count; j++) {
+			bx1[j] = x1[(i + j) * stride];
+			by1[j] = y1[(i + j) * stride];
+			bx2[j] = x2[i + j];
+			by2[j] = y2[i + j];
+		}
+
+		__m256i a = _mm256_loadu_si256((const __m256i *)bx1);
+		__m256i b = _mm256_loadu_si256((const __m256i *)by1);
+		__m256i c = _mm256_loadu_si256((const __m256i *)bx2);
+		__m256i d = _mm256_loadu_si256((const __m256i *)by2);
+
+		_mm256_storeu_ps(bresult, Kernel(a, b, c, d));
+
+		for (unsigned int j = 0; i + j < count; j++) {
+			result[i + j] = bresult[j];
+		}
+	}
+}
+
+#endif // LOSM_DISTANCE_AVX2
+
+void haversine_distances(unsigned int count, const int *x1, const int *y1, const int *x2, const int *y2,
+		float *result)
+{
+#ifdef LOSM_DISTANCE_AVX2
+	if (has_avx2()) {
+		run_avx2<haversine_avx2>(count, x1, y1, 1, x2, y2, result);
+		return;
+	}
+#endif
+
+	for (unsigned int i = 0; i < count; i++) {
+		result[i] = haversine_distance(x1[i], y1[i], x2[i], y2[i]);
+	}
+}
+
+void haversine_distances(int x, int y, unsigned int count, const int *xs, const int *ys, float *result)
+{
+#ifdef LOSM_DISTANCE_AVX2
+	if (has_avx2()) {
+		run_avx2<haversine_avx2>(count, &x, &y, 0, xs, ys, result);
+		return;
+	}
+#endif
+
+	for (unsigned int i = 0; i < count; i++) {
+		result[i] = haversine_distance(x, y, xs[i], ys[i]);
+	}
+}
+
+void equirectangular_distances(unsigned int count, const int *x1, const int *y1, const int *x2, const int *y2,
+		float *result)
+{
+#ifdef LOSM_DISTANCE_AVX2
+	if (has_avx2()) {
+		run_avx2<equirectangular_avx2>(count, x1, y1, 1, x2, y2, result);
+		return;
+	}
+#endif
+
+	for (unsigned int i = 0; i < count; i++) {
+		result[i] = equirectangular_distance(x1[i], y1[i], x2[i], y2[i]);
+	}
+}
+
+void equirectangular_distances(int x, int y, unsigned int count, const int *xs, const int *ys, float *result)
+{
+#ifdef LOSM_DISTANCE_AVX2
+	if (has_avx2()) {
+		run_avx2<equirectangular_avx2>(count, &x, &y, 0, xs, ys, result);
+		return;
+	}
+#endif
+
+	for (unsigned int i = 0; i < count; i++) {
+		result[i] = equirectangular_distance(x, y, xs[i], ys[i]);
+	}
+}
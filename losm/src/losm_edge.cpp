@@ -78,6 +78,13 @@ void LOSMEdge::load(std::string filename, const std::vector<const LOSMNode *> no
 		std::unordered_map<const LOSMNode *, std::vector<const LOSMNode *> > &neighborsResult)
 {
 	edgesResult.clear();
+	neighborsResult.clear();
+
+	// Index the nodes by unique identifier, keeping the first of any duplicates.
+	std::unordered_map<unsigned long, const LOSMNode *> uids;
+	for (const LOSMNode *node : nodes) {
+		uids.emplace(node->get_uid(), node);
+	}
 
 	// Attempt to open the file.
 	std::ifstream file(filename);
@@ -115,11 +122,9 @@ void LOSMEdge::load(std::string filename, const std::vector<const LOSMNode *> no
 
 		// Find the node belonging to the first node's unique identifier.
         const LOSMNode *edgeN1 = nullptr;
-        for (const LOSMNode *node : nodes) {
-        	if (node->get_uid() == edgeUID1) {
-        		edgeN1 = node;
-        		break;
-        	}
+        std::unordered_map<unsigned long, const LOSMNode *>::const_iterator node1 = uids.find(edgeUID1);
+        if (node1 != uids.end()) {
+        	edgeN1 = node1->second;
         }
 
         if (edgeN1 == nullptr) {
@@ -141,11 +146,9 @@ void LOSMEdge::load(std::string filename, const std::vector<const LOSMNode *> no
 
 		// Find the node belonging to the second node's unique identifier.
         const LOSMNode *edgeN2 = nullptr;
-        for (const LOSMNode *node : nodes) {
-        	if (node->get_uid() == edgeUID2) {
-        		edgeN2 = node;
-        		break;
-        	}
+        std::unordered_map<unsigned long, const LOSMNode *>::const_iterator node2 = uids.find(edgeUID2);
+        if (node2 != uids.end()) {
+        	edgeN2 = node2->second;
         }
 
         if (edgeN2 == nullptr) {
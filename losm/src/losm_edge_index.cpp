@@ -0,0 +1,438 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "../include/losm_edge_index.h"
+#include "../include/losm_exception.h"
+#include "../include/losm_utilities.h"
+#include "../include/losm_distance.h"
+#include "../include/losm_instrumentation.h"
+
+#include <iostream>
+#include <algorithm>
+#include <utility>
+#include <cmath>
+
+/**
+ * The factor by which distances to boxes are shrunk, to remain lower bounds despite rounding.
+ */
+static const float BOX_DISTANCE_FACTOR = 1.0f - 1e-5f;
+
+LOSMEdgeIndex::LOSMEdgeIndex(std::shared_ptr<const LOSMGraph> graph)
+{
+	if (graph == nullptr) {
+		std::cerr << "Error[LOSMEdgeIndex::LOSMEdgeIndex]: The graph provided was null." << std::endl;
+		throw LOSMException();
+	}
+
+	this->graph = graph;
+
+	scaleX = (float)(LOSM_EARTH_RADIUS_IN_MILES * M_PI / 180.0 / LOSM_FIXED_POINT_SCALE);
+
+	const int *x = graph->get_fixed_x_array();
+	const int *y = graph->get_fixed_y_array();
+	const unsigned int *edgeNodes = graph->get_edge_nodes_array();
+	unsigned int numEdges = graph->get_num_edges();
+
+	std::vector<Box> boxes(numEdges);
+	for (unsigned int i = 0; i < numEdges; i++) {
+		unsigned int n1 = edgeNodes[2 * i + 0];
+		unsigned int n2 = edgeNodes[2 * i + 1];
+
+		boxes[i].minX = std::min(x[n1], x[n2]);
+		boxes[i].minY = std::min(y[n1], y[n2]);
+		boxes[i].maxX = std::max(x[n1], x[n2]);
+		boxes[i].maxY = std::max(y[n1], y[n2]);
+		boxes[i].first = i;
+		boxes[i].last = i + 1;
+	}
+
+	sort_tiles(boxes);
+
+	segmentEdges.resize(numEdges);
+	segmentCoordinates.resize(4 * numEdges);
+
+	for (unsigned int i = 0; i < numEdges; i++) {
+		unsigned int edge = boxes[i].first;
+		segmentEdges[i] = edge;
+		segmentCoordinates[4 * i + 0] = x[edgeNodes[2 * edge + 0]];
+		segmentCoordinates[4 * i + 1] = y[edgeNodes[2 * edge + 0]];
+		segmentCoordinates[4 * i + 2] = x[edgeNodes[2 * edge + 1]];
+		segmentCoordinates[4 * i + 3] = y[edgeNodes[2 * edge + 1]];
+	}
+
+	// Group each level into the nodes of the next, tiling every new level, until one remains.
+	numLeaves = 0;
+	unsigned int base = 0;
+
+	while (boxes.size() > 1 || (numLeaves == 0 && !boxes.empty())) {
+		std::vector<Box> parents;
+
+		for (unsigned int i = 0; i < boxes.size(); i += NODE_SIZE) {
+			unsigned int last = std::min((unsigned int)boxes.size(), i + NODE_SIZE);
+
+			Box parent = boxes[i];
+			for (unsigned int j = i + 1; j < last; j++) {
+				parent.minX = std::min(parent.minX, boxes[j].minX);
+				parent.minY = std::min(parent.minY, boxes[j].minY);
+				parent.maxX = std::max(parent.maxX, boxes[j].maxX);
+				parent.maxY = std::max(parent.maxY, boxes[j].maxY);
+			}
+			parent.first = base + i;
+			parent.last = base + last;
+
+			parents.push_back(parent);
+		}
+
+		if (numLeaves == 0) {
+			numLeaves = parents.size();
+		}
+
+		sort_tiles(parents);
+
+		base = nodes.size();
+		nodes.insert(nodes.end(), parents.begin(), parents.end());
+		boxes.swap(parents);
+	}
+}
+
+LOSMEdgeIndex::~LOSMEdgeIndex()
+{ }
+
+std::shared_ptr<const LOSMGraph> LOSMEdgeIndex::get_graph() const
+{
+	return graph;
+}
+
+void LOSMEdgeIndex::find_nearest_edge(float x, float y, LOSMEdgeProjection &result) const
+{
+	LOSM_INSTRUMENT(LOSMOperation::FIND_NEAREST_EDGE);
+
+	search_nearest(degrees_to_fixed_point(x), degrees_to_fixed_point(y), LOSMGraph::INVALID_INDEX, result);
+}
+
+void LOSMEdgeIndex::find_nearest_edges(float x, float y, unsigned int k, std::vector<LOSMEdgeProjection> &result) const
+{
+	LOSM_INSTRUMENT(LOSMOperation::FIND_NEAREST_EDGE);
+
+	result.clear();
+
+	std::vector<QueueEntry> queue;
+	search_k_nearest(degrees_to_fixed_point(x), degrees_to_fixed_point(y), k, queue, result);
+}
+
+void LOSMEdgeIndex::find_nearest_edges(unsigned int count, const float *x, const float *y,
+		LOSMEdgeProjection *result) const
+{
+	if (count == 0) {
+		return;
+	}
+
+	std::vector<int> px(count);
+	std::vector<int> py(count);
+	for (unsigned int i = 0; i < count; i++) {
+		px[i] = degrees_to_fixed_point(x[i]);
+		py[i] = degrees_to_fixed_point(y[i]);
+	}
+
+	// Visit the coordinates along a Hilbert curve over their bounding box.
+	long minX = *std::min_element(px.begin(), px.end());
+	long maxX = *std::max_element(px.begin(), px.end());
+	long minY = *std::min_element(py.begin(), py.end());
+	long maxY = *std::max_element(py.begin(), py.end());
+
+	std::vector<std::pair<uint32_t, unsigned int> > curve(count);
+	for (unsigned int i = 0; i < count; i++) {
+		uint32_t qx = (uint32_t)((px[i] - minX) * 65535 / std::max(1L, maxX - minX));
+		uint32_t qy = (uint32_t)((py[i] - minY) * 65535 / std::max(1L, maxY - minY));
+		curve[i] = std::make_pair(hilbert_index(qx, qy), i);
+	}
+	std::sort(curve.begin(), curve.end());
+
+	unsigned int hint = LOSMGraph::INVALID_INDEX;
+	for (const std::pair<uint32_t, unsigned int> &entry : curve) {
+		unsigned int i = entry.second;
+		hint = search_nearest(px[i], py[i], hint, result[i]);
+	}
+}
+
+void LOSMEdgeIndex::find_nearest_edges(unsigned int count, const float *x, const float *y, unsigned int k,
+		std::vector<LOSMEdgeProjection> &result) const
+{
+	LOSMEdgeProjection missing;
+	missing.edge = LOSMGraph::INVALID_INDEX;
+	missing.fraction = 0.0f;
+	missing.distance = INFINITY;
+	missing.x = 0.0f;
+	missing.y = 0.0f;
+
+	result.clear();
+	result.reserve((size_t)count * k);
+
+	std::vector<QueueEntry> queue;
+
+	for (unsigned int i = 0; i < count; i++) {
+		search_k_nearest(degrees_to_fixed_point(x[i]), degrees_to_fixed_point(y[i]), k, queue, result);
+		result.resize((size_t)(i + 1) * k, missing);
+	}
+}
+
+size_t LOSMEdgeIndex::get_memory_usage() const
+{
+	return nodes.capacity() * sizeof(Box) + segmentEdges.capacity() * sizeof(unsigned int) +
+			segmentCoordinates.capacity() * sizeof(int);
+}
+
+void LOSMEdgeIndex::sort_tiles(std::vector<Box> &boxes)
+{
+	if (boxes.size() <= NODE_SIZE) {
+		return;
+	}
+
+	// With P nodes to fill, cut ceil(sqrt(P)) vertical slices of whole nodes.
+	size_t numNodes = (boxes.size() + NODE_SIZE - 1) / NODE_SIZE;
+	size_t numSlices = (size_t)std::ceil(std::sqrt((double)numNodes));
+	size_t sliceSize = ((numNodes + numSlices - 1) / numSlices) * NODE_SIZE;
+
+	std::sort(boxes.begin(), boxes.end(),
+		[](const Box &a, const Box &b) {
+			return (long long)a.minX + a.maxX < (long long)b.minX + b.maxX;
+		});
+
+	for (size_t first = 0; first < boxes.size(); first += sliceSize) {
+		size_t last = std::min(boxes.size(), first + sliceSize);
+		std::sort(boxes.begin() + first, boxes.begin() + last,
+			[](const Box &a, const Box &b) {
+				return (long long)a.minY + a.maxY < (long long)b.minY + b.maxY;
+			});
+	}
+}
+
+float LOSMEdgeIndex::compute_box_distance(const Box &box, int px, int py, float scaleY) const
+{
+	long long dx = std::max(0LL, std::max((long long)box.minX - px, (long long)px - box.maxX));
+	long long dy = std::max(0LL, std::max((long long)box.minY - py, (long long)py - box.maxY));
+
+	float mx = (float)dx * scaleX;
+	float my = (float)dy * scaleY;
+
+	// Shrink the bound slightly, since a segment along the side of the box may round to a
+	// smaller distance than the box itself.
+	return (mx * mx + my * my) * BOX_DISTANCE_FACTOR;
+}
+
+float LOSMEdgeIndex::project(unsigned int segment, int px, int py, float scaleY, float &fraction) const
+{
+	const int *coordinates = &segmentCoordinates[4 * segment];
+
+	// Project the coordinate onto the segment in a local frame (in miles) centered on it.
+	float ax = (float)((long long)coordinates[0] - px) * scaleX;
+	float ay = (float)((long long)coordinates[1] - py) * scaleY;
+	float bx = (float)((long long)coordinates[2] - px) * scaleX;
+	float by = (float)((long long)coordinates[3] - py) * scaleY;
+
+	float dx = bx - ax;
+	float dy = by - ay;
+	float lengthSq = dx * dx + dy * dy;
+
+	fraction = 0.0f;
+	if (lengthSq > 0.0f) {
+		fraction = std::min(1.0f, std::max(0.0f, -(ax * dx + ay * dy) / lengthSq));
+	}
+
+	float cx = ax + fraction * dx;
+	float cy = ay + fraction * dy;
+
+	return cx * cx + cy * cy;
+}
+
+unsigned int LOSMEdgeIndex::search_nearest(int px, int py, unsigned int hint, LOSMEdgeProjection &result) const
+{
+	unsigned int best = LOSMGraph::INVALID_INDEX;
+	float bestDistanceSq = INFINITY;
+	float bestFraction = 0.0f;
+
+	if (nodes.empty()) {
+		fill_projection(best, bestFraction, bestDistanceSq, result);
+		return best;
+	}
+
+	float scaleY = get_scale_y(px);
+
+	if (hint != LOSMGraph::INVALID_INDEX) {
+		best = hint;
+		bestDistanceSq = project(hint, px, py, scaleY, bestFraction);
+	}
+
+	// Boxes are pruned only when strictly farther than the best, so that ties are broken by edge.
+	std::pair<float, unsigned int> stack[MAX_STACK_SIZE];
+	unsigned int stackSize = 0;
+
+	stack[stackSize++] = std::make_pair(compute_box_distance(nodes.back(), px, py, scaleY), (unsigned int)nodes.size() - 1);
+
+	while (stackSize > 0) {
+		std::pair<float, unsigned int> current = stack[--stackSize];
+		if (current.first > bestDistanceSq) {
+			continue;
+		}
+
+		const Box &node = nodes[current.second];
+
+		if (current.second < numLeaves) {
+			for (unsigned int segment = node.first; segment < node.last; segment++) {
+				float fraction = 0.0f;
+				float distanceSq = project(segment, px, py, scaleY, fraction);
+
+				if (distanceSq < bestDistanceSq || (distanceSq == bestDistanceSq &&
+						segmentEdges[segment] < segmentEdges[best])) {
+					best = segment;
+					bestDistanceSq = distanceSq;
+					bestFraction = fraction;
+				}
+			}
+			continue;
+		}
+
+		// Push the children farthest first, so the nearest is searched first.
+		std::pair<float, unsigned int> children[NODE_SIZE];
+		unsigned int numChildren = 0;
+
+		for (unsigned int child = node.first; child < node.last; child++) {
+			float distanceSq = compute_box_distance(nodes[child], px, py, scaleY);
+			if (distanceSq > bestDistanceSq) {
+				continue;
+			}
+
+			// Insertion sort, which is fastest for so few children.
+			unsigned int position = numChildren++;
+			while (position > 0 && children[position - 1].first < distanceSq) {
+				children[position] = children[position - 1];
+				position--;
+			}
+			children[position] = std::make_pair(distanceSq, child);
+		}
+
+		for (unsigned int i = 0; i < numChildren; i++) {
+			stack[stackSize++] = children[i];
+		}
+	}
+
+	fill_projection(best, bestFraction, bestDistanceSq, result);
+
+	return best;
+}
+
+void LOSMEdgeIndex::search_k_nearest(int px, int py, unsigned int k, std::vector<QueueEntry> &queue,
+		std::vector<LOSMEdgeProjection> &result) const
+{
+	if (nodes.empty() || k == 0) {
+		return;
+	}
+
+	float scaleY = get_scale_y(px);
+
+	// A min-heap by distance in which, at equal distances, nodes come before segments and
+	// segments by edge, so that segments are reported in order with ties broken by edge.
+	auto compare = [this](const QueueEntry &a, const QueueEntry &b) {
+		if (a.distanceSq != b.distanceSq) {
+			return a.distanceSq > b.distanceSq;
+		}
+		if (a.segment != b.segment) {
+			return a.segment;
+		}
+		if (a.segment) {
+			return segmentEdges[a.index] > segmentEdges[b.index];
+		}
+		return a.index > b.index;
+	};
+
+	queue.clear();
+	queue.push_back({compute_box_distance(nodes.back(), px, py, scaleY), (unsigned int)nodes.size() - 1, false});
+
+	unsigned int found = 0;
+
+	while (!queue.empty() && found < k) {
+		std::pop_heap(queue.begin(), queue.end(), compare);
+		QueueEntry current = queue.back();
+		queue.pop_back();
+
+		if (current.segment) {
+			float fraction = 0.0f;
+			float distanceSq = project(current.index, px, py, scaleY, fraction);
+
+			LOSMEdgeProjection projection;
+			fill_projection(current.index, fraction, distanceSq, projection);
+			result.push_back(projection);
+
+			found++;
+			continue;
+		}
+
+		const Box &node = nodes[current.index];
+		bool leaf = (current.index < numLeaves);
+
+		for (unsigned int child = node.first; child < node.last; child++) {
+			QueueEntry entry;
+			entry.index = child;
+			entry.segment = leaf;
+
+			if (leaf) {
+				float fraction = 0.0f;
+				entry.distanceSq = project(child, px, py, scaleY, fraction);
+			} else {
+				entry.distanceSq = compute_box_distance(nodes[child], px, py, scaleY);
+			}
+
+			queue.push_back(entry);
+			std::push_heap(queue.begin(), queue.end(), compare);
+		}
+	}
+}
+
+void LOSMEdgeIndex::fill_projection(unsigned int segment, float fraction, float distanceSq,
+		LOSMEdgeProjection &result) const
+{
+	if (segment == LOSMGraph::INVALID_INDEX) {
+		result.edge = LOSMGraph::INVALID_INDEX;
+		result.fraction = 0.0f;
+		result.distance = INFINITY;
+		result.x = 0.0f;
+		result.y = 0.0f;
+		return;
+	}
+
+	const int *coordinates = &segmentCoordinates[4 * segment];
+
+	result.edge = segmentEdges[segment];
+	result.fraction = fraction;
+	result.distance = std::sqrt(distanceSq);
+	result.x = (float)fixed_point_to_degrees(coordinates[0]) +
+			fraction * (float)(((double)coordinates[2] - coordinates[0]) / LOSM_FIXED_POINT_SCALE);
+	result.y = (float)fixed_point_to_degrees(coordinates[1]) +
+			fraction * (float)(((double)coordinates[3] - coordinates[1]) / LOSM_FIXED_POINT_SCALE);
+}
+
+float LOSMEdgeIndex::get_scale_y(int px) const
+{
+	return scaleX * (float)std::cos(fixed_point_to_degrees(px) * M_PI / 180.0);
+}
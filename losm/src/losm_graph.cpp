@@ -0,0 +1,825 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "../include/losm_graph.h"
+#include "../include/losm_exception.h"
+#include "../include/losm_utilities.h"
+#include "../include/losm_distance.h"
+#include "../include/losm_instrumentation.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+
+const unsigned int LOSMGraph::INVALID_INDEX;
+const unsigned int LOSMGraph::DEFAULT_SPEED_LIMIT;
+const unsigned int LOSMGraph::NUM_NEAREST_CANDIDATES;
+const char LOSMGraph::SAVED_MAGIC[8] = {'L', 'O', 'S', 'M', 'G', 'R', '0', '3'};
+
+/**
+ * The alignment (in bytes) of each array of the saved indexes.
+ */
+static const size_t SAVED_ALIGNMENT = 8;
+
+/**
+ * Get the number of bytes an array occupies in saved indexes, including its padding.
+ * @param	count	The number of elements in the array.
+ * @return	The number of bytes.
+ */
+template <typename T>
+static size_t get_saved_size(size_t count)
+{
+	return (count * sizeof(T) + SAVED_ALIGNMENT - 1) / SAVED_ALIGNMENT * SAVED_ALIGNMENT;
+}
+
+/**
+ * View an array of saved indexes in place.
+ * @param	current	The position of the array in the saved indexes.
+ * @param	count	The number of elements in the array.
+ * @param	result	The view of the array. This will be modified.
+ * @return	The position following the array and its padding.
+ */
+template <typename T>
+static const char *view_array(const char *current, size_t count, LOSMSpan<T> &result)
+{
+	result = LOSMSpan<T>((const T *)current, count);
+	return current + get_saved_size<T>(count);
+}
+
+/**
+ * Write an array of saved indexes, followed by its padding.
+ * @param	values	The array.
+ * @param	stream	The stream to write the array to.
+ */
+template <typename T>
+static void write_array(const LOSMSpan<T> &values, std::ostream &stream)
+{
+	const char padding[SAVED_ALIGNMENT] = {0};
+
+	stream.write((const char *)values.data(), values.size() * sizeof(T));
+	stream.write(padding, get_saved_size<T>(values.size()) - values.size() * sizeof(T));
+}
+
+LOSMGraph::LOSMGraph(std::shared_ptr<const LOSM> losm, const LOSMStorageOptions &options)
+{
+	if (losm == nullptr) {
+		std::cerr << "Error[LOSMGraph::LOSMGraph]: The LOSM object provided was null." << std::endl;
+		throw LOSMException();
+	}
+
+	this->losm = losm;
+	set_storage(options);
+
+	const std::vector<const LOSMNode *> &nodes = losm->get_nodes();
+	const std::vector<const LOSMEdge *> &edges = losm->get_edges();
+
+	std::unordered_map<const LOSMNode *, unsigned int> nodeIndices;
+	nodeIndices.reserve(nodes.size());
+	for (unsigned int i = 0; i < nodes.size(); i++) {
+		nodeIndices[nodes[i]] = i;
+	}
+
+	// The arrays are built in the storage, and only viewed once they are complete.
+	LOSMArray<unsigned int> &adjacencyOffsets = storage.adjacencyOffsets;
+	LOSMArray<unsigned int> &adjacencyNodes = storage.adjacencyNodes;
+	LOSMArray<unsigned int> &adjacencyEdges = storage.adjacencyEdges;
+	LOSMArray<float> &edgeDistances = storage.edgeDistances;
+	LOSMArray<float> &edgeTravelTimes = storage.edgeTravelTimes;
+
+	// Count the degree of each node, then convert the counts into offsets.
+	adjacencyOffsets.assign(nodes.size() + 1, 0);
+	edgeDistances.resize(edges.size());
+	edgeTravelTimes.resize(edges.size());
+
+	for (unsigned int i = 0; i < edges.size(); i++) {
+		std::unordered_map<const LOSMNode *, unsigned int>::const_iterator n1 = nodeIndices.find(edges[i]->get_node_1());
+		std::unordered_map<const LOSMNode *, unsigned int>::const_iterator n2 = nodeIndices.find(edges[i]->get_node_2());
+		if (n1 == nodeIndices.end() || n2 == nodeIndices.end()) {
+			std::cerr << "Error[LOSMGraph::LOSMGraph]: Edge " << i << " refers to a node which was not loaded." << std::endl;
+			throw LOSMException();
+		}
+
+		adjacencyOffsets[n1->second + 1]++;
+		adjacencyOffsets[n2->second + 1]++;
+
+		unsigned int speedLimit = edges[i]->get_speed_limit();
+		if (speedLimit == 0) {
+			speedLimit = DEFAULT_SPEED_LIMIT;
+		}
+
+		edgeDistances[i] = edges[i]->get_distance();
+		edgeTravelTimes[i] = edges[i]->get_distance() / (float)speedLimit;
+	}
+
+	for (unsigned int i = 0; i < nodes.size(); i++) {
+		adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+	}
+
+	// Fill in the slots in the same order as LOSM::get_neighbors() lists them.
+	adjacencyNodes.resize(adjacencyOffsets[nodes.size()]);
+	adjacencyEdges.resize(adjacencyOffsets[nodes.size()]);
+
+	std::vector<unsigned int> next(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+
+	for (unsigned int i = 0; i < edges.size(); i++) {
+		unsigned int n1 = nodeIndices[edges[i]->get_node_1()];
+		unsigned int n2 = nodeIndices[edges[i]->get_node_2()];
+
+		adjacencyNodes[next[n1]] = n2;
+		adjacencyEdges[next[n1]] = i;
+		next[n1]++;
+
+		adjacencyNodes[next[n2]] = n1;
+		adjacencyEdges[next[n2]] = i;
+		next[n2]++;
+	}
+
+	copy_attributes(nodeIndices);
+
+	// Copy the fixed-point coordinates into contiguous arrays, and find the scale with which
+	// to project longitudes for the k-d tree.
+	LOSMArray<int> &fixedX = storage.fixedX;
+	LOSMArray<int> &fixedY = storage.fixedY;
+
+	fixedX.resize(nodes.size());
+	fixedY.resize(nodes.size());
+
+	double meanX = 0.0;
+
+	for (unsigned int i = 0; i < nodes.size(); i++) {
+		fixedX[i] = nodes[i]->get_fixed_x();
+		fixedY[i] = nodes[i]->get_fixed_y();
+		meanX += fixed_point_to_degrees(fixedX[i]);
+	}
+
+	if (nodes.size() > 0) {
+		meanX /= (double)nodes.size();
+	}
+
+	projectionScale = (float)std::cos(meanX * M_PI / 180.0);
+
+	storage.kdTree.resize(nodes.size());
+	for (unsigned int i = 0; i < nodes.size(); i++) {
+		storage.kdTree[i] = i;
+	}
+
+	build_kd_tree(storage.kdTree, storage.fixedX, storage.fixedY, 0, nodes.size(), 0);
+
+	// The landmarks have a k-d tree of their own, so that a region's landmarks are found
+	// without scanning all of them.
+	const std::vector<const LOSMLandmark *> &landmarks = losm->get_landmarks();
+
+	storage.landmarkFixedX.resize(landmarks.size());
+	storage.landmarkFixedY.resize(landmarks.size());
+	storage.landmarkKdTree.resize(landmarks.size());
+
+	for (unsigned int i = 0; i < landmarks.size(); i++) {
+		storage.landmarkFixedX[i] = landmarks[i]->get_fixed_x();
+		storage.landmarkFixedY[i] = landmarks[i]->get_fixed_y();
+		storage.landmarkKdTree[i] = i;
+	}
+
+	build_kd_tree(storage.landmarkKdTree, storage.landmarkFixedX, storage.landmarkFixedY, 0, landmarks.size(), 0);
+
+	view_storage();
+}
+
+LOSMGraph::LOSMGraph(std::shared_ptr<const LOSM> losm, std::shared_ptr<const void> memory, const char *data,
+		size_t size)
+{
+	if (losm == nullptr) {
+		std::cerr << "Error[LOSMGraph::LOSMGraph]: The LOSM object provided was null." << std::endl;
+		throw LOSMException();
+	}
+
+	this->losm = losm;
+	this->memory = memory;
+
+	uint32_t counts[5];
+	size_t headerSize = get_saved_size<char>(sizeof(SAVED_MAGIC) + sizeof(counts) + sizeof(float));
+
+	if (data == nullptr || (uintptr_t)data % SAVED_ALIGNMENT != 0 || size < headerSize ||
+			std::memcmp(data, SAVED_MAGIC, sizeof(SAVED_MAGIC)) != 0) {
+		std::cerr << "Error[LOSMGraph::LOSMGraph]: The saved indexes are not in a known format." << std::endl;
+		throw LOSMException();
+	}
+
+	std::memcpy(counts, data + sizeof(SAVED_MAGIC), sizeof(counts));
+	std::memcpy(&projectionScale, data + sizeof(SAVED_MAGIC) + sizeof(counts), sizeof(float));
+
+	size_t numNodes = counts[0];
+	size_t numEdges = counts[1];
+	size_t numSlots = counts[2];
+	size_t numTableSlots = counts[3];
+	size_t numLandmarks = counts[4];
+
+	if (numNodes != losm->get_nodes().size() || numEdges != losm->get_edges().size() || numSlots != 2 * numEdges ||
+			numLandmarks != losm->get_landmarks().size() || numTableSlots < 2 * numNodes || numTableSlots == 0 || (numTableSlots & (numTableSlots - 1)) != 0) {
+		std::cerr << "Error[LOSMGraph::LOSMGraph]: The saved indexes do not match the LOSM object." << std::endl;
+		throw LOSMException();
+	}
+
+	size_t expected = headerSize + get_saved_size<unsigned int>(numNodes + 1) +
+			2 * get_saved_size<unsigned int>(numSlots) + 2 * get_saved_size<float>(numEdges) +
+			2 * get_saved_size<int>(numNodes) + get_saved_size<unsigned long>(numNodes) +
+			get_saved_size<unsigned int>(2 * numEdges) + 2 * get_saved_size<unsigned int>(numEdges) +
+			get_saved_size<unsigned int>(numNodes) + get_saved_size<unsigned long>(numTableSlots) +
+			get_saved_size<unsigned int>(numTableSlots) + 2 * get_saved_size<int>(numLandmarks) +
+			get_saved_size<unsigned int>(numLandmarks);
+	if (size != expected) {
+		std::cerr << "Error[LOSMGraph::LOSMGraph]: The saved indexes have " << size <<
+				" bytes instead of " << expected << "." << std::endl;
+		throw LOSMException();
+	}
+
+	const char *current = data + headerSize;
+
+	current = view_array(current, numNodes + 1, adjacencyOffsets);
+	current = view_array(current, numSlots, adjacencyNodes);
+	current = view_array(current, numSlots, adjacencyEdges);
+	current = view_array(current, numEdges, edgeDistances);
+	current = view_array(current, numEdges, edgeTravelTimes);
+	current = view_array(current, numNodes, fixedX);
+	current = view_array(current, numNodes, fixedY);
+	current = view_array(current, numNodes, uids);
+	current = view_array(current, 2 * numEdges, edgeNodes);
+	current = view_array(current, numEdges, edgeSpeedLimits);
+	current = view_array(current, numEdges, edgeLanes);
+	current = view_array(current, numNodes, kdTree);
+	current = view_array(current, numTableSlots, uidTableKeys);
+	current = view_array(current, numTableSlots, uidTableNodes);
+	current = view_array(current, numLandmarks, landmarkFixedX);
+	current = view_array(current, numLandmarks, landmarkFixedY);
+	current = view_array(current, numLandmarks, landmarkKdTree);
+
+	// Guard against a corrupt file, since every query trusts these indices.
+	bool valid = (adjacencyOffsets[0] == 0 && adjacencyOffsets[numNodes] == numSlots);
+	for (unsigned int i = 0; i < numSlots && valid; i++) {
+		valid = (adjacencyNodes[i] < numNodes && adjacencyEdges[i] < numEdges);
+	}
+	for (unsigned int i = 0; i < numNodes && valid; i++) {
+		valid = (adjacencyOffsets[i] <= adjacencyOffsets[i + 1] && kdTree[i] < numNodes);
+	}
+	for (unsigned int i = 0; i < 2 * numEdges && valid; i++) {
+		valid = (edgeNodes[i] < numNodes);
+	}
+	for (unsigned int i = 0; i < numTableSlots && valid; i++) {
+		valid = (uidTableNodes[i] == INVALID_INDEX || uidTableNodes[i] < numNodes);
+	}
+	for (unsigned int i = 0; i < numLandmarks && valid; i++) {
+		valid = (landmarkKdTree[i] < numLandmarks);
+	}
+
+	if (!valid) {
+		std::cerr << "Error[LOSMGraph::LOSMGraph]: The saved indexes are corrupt." << std::endl;
+		throw LOSMException();
+	}
+}
+
+LOSMGraph::LOSMGraph(const LOSMGraph &graph, const LOSMStorageOptions &options)
+{
+	losm = graph.losm;
+	set_storage(options);
+
+	storage.adjacencyOffsets.assign(graph.adjacencyOffsets.begin(), graph.adjacencyOffsets.end());
+	storage.adjacencyNodes.assign(graph.adjacencyNodes.begin(), graph.adjacencyNodes.end());
+	storage.adjacencyEdges.assign(graph.adjacencyEdges.begin(), graph.adjacencyEdges.end());
+	storage.edgeDistances.assign(graph.edgeDistances.begin(), graph.edgeDistances.end());
+	storage.edgeTravelTimes.assign(graph.edgeTravelTimes.begin(), graph.edgeTravelTimes.end());
+	storage.fixedX.assign(graph.fixedX.begin(), graph.fixedX.end());
+	storage.fixedY.assign(graph.fixedY.begin(), graph.fixedY.end());
+	storage.uids.assign(graph.uids.begin(), graph.uids.end());
+	storage.edgeNodes.assign(graph.edgeNodes.begin(), graph.edgeNodes.end());
+	storage.edgeSpeedLimits.assign(graph.edgeSpeedLimits.begin(), graph.edgeSpeedLimits.end());
+	storage.edgeLanes.assign(graph.edgeLanes.begin(), graph.edgeLanes.end());
+	storage.kdTree.assign(graph.kdTree.begin(), graph.kdTree.end());
+	storage.uidTableKeys.assign(graph.uidTableKeys.begin(), graph.uidTableKeys.end());
+	storage.uidTableNodes.assign(graph.uidTableNodes.begin(), graph.uidTableNodes.end());
+	storage.landmarkFixedX.assign(graph.landmarkFixedX.begin(), graph.landmarkFixedX.end());
+	storage.landmarkFixedY.assign(graph.landmarkFixedY.begin(), graph.landmarkFixedY.end());
+	storage.landmarkKdTree.assign(graph.landmarkKdTree.begin(), graph.landmarkKdTree.end());
+
+	projectionScale = graph.projectionScale;
+
+	view_storage();
+}
+
+LOSMGraph::~LOSMGraph()
+{ }
+
+const LOSMStorageOptions &LOSMGraph::get_storage_options() const
+{
+	return options;
+}
+
+std::shared_ptr<const LOSM> LOSMGraph::get_losm() const
+{
+	return losm;
+}
+
+unsigned int LOSMGraph::get_num_nodes() const
+{
+	return adjacencyOffsets.size() - 1;
+}
+
+unsigned int LOSMGraph::get_num_edges() const
+{
+	return edgeDistances.size();
+}
+
+const LOSMNode *LOSMGraph::get_node(unsigned int index) const
+{
+	return losm->get_nodes()[index];
+}
+
+const LOSMEdge *LOSMGraph::get_edge(unsigned int index) const
+{
+	return losm->get_edges()[index];
+}
+
+unsigned int LOSMGraph::get_node_index(const LOSMNode *node) const
+{
+	LOSM_INSTRUMENT(LOSMOperation::FIND_NODE_INDEX);
+
+	if (node == nullptr) {
+		std::cerr << "Error[LOSMGraph::get_node_index]: The node provided was null." << std::endl;
+		throw LOSMException();
+	}
+
+	unsigned int index = find_node_index(node->get_uid());
+	if (index == INVALID_INDEX || losm->get_nodes()[index] != node) {
+		std::cerr << "Error[LOSMGraph::get_node_index]: The node with UID '" << node->get_uid() <<
+				"' does not belong to this graph." << std::endl;
+		throw LOSMException();
+	}
+
+	return index;
+}
+
+unsigned int LOSMGraph::find_node_index(unsigned long uid) const
+{
+	LOSM_INSTRUMENT(LOSMOperation::FIND_NODE_INDEX);
+
+	size_t mask = uidTableKeys.size() - 1;
+
+	for (size_t slot = hash_uid(uid, mask); uidTableNodes[slot] != INVALID_INDEX; slot = (slot + 1) & mask) {
+		if (uidTableKeys[slot] == uid) {
+			return uidTableNodes[slot];
+		}
+	}
+
+	return INVALID_INDEX;
+}
+
+unsigned int LOSMGraph::get_adjacency_begin(unsigned int node) const
+{
+	return adjacencyOffsets[node];
+}
+
+unsigned int LOSMGraph::get_adjacency_end(unsigned int node) const
+{
+	return adjacencyOffsets[node + 1];
+}
+
+unsigned int LOSMGraph::get_adjacent_node(unsigned int slot) const
+{
+	return adjacencyNodes[slot];
+}
+
+unsigned int LOSMGraph::get_adjacent_edge(unsigned int slot) const
+{
+	return adjacencyEdges[slot];
+}
+
+float LOSMGraph::get_edge_cost(unsigned int edge, LOSMCost cost) const
+{
+	if (cost == LOSMCost::TRAVEL_TIME) {
+		return edgeTravelTimes[edge];
+	}
+	return edgeDistances[edge];
+}
+
+const int *LOSMGraph::get_fixed_x_array() const
+{
+	return fixedX.data();
+}
+
+const int *LOSMGraph::get_fixed_y_array() const
+{
+	return fixedY.data();
+}
+
+const unsigned long *LOSMGraph::get_uid_array() const
+{
+	return uids.data();
+}
+
+const unsigned int *LOSMGraph::get_edge_nodes_array() const
+{
+	return edgeNodes.data();
+}
+
+const float *LOSMGraph::get_edge_distances_array() const
+{
+	return edgeDistances.data();
+}
+
+const float *LOSMGraph::get_edge_travel_times_array() const
+{
+	return edgeTravelTimes.data();
+}
+
+const unsigned int *LOSMGraph::get_speed_limit_array() const
+{
+	return edgeSpeedLimits.data();
+}
+
+const unsigned int *LOSMGraph::get_lanes_array() const
+{
+	return edgeLanes.data();
+}
+
+const unsigned int *LOSMGraph::get_adjacency_offsets_array() const
+{
+	return adjacencyOffsets.data();
+}
+
+const unsigned int *LOSMGraph::get_adjacent_nodes_array() const
+{
+	return adjacencyNodes.data();
+}
+
+const unsigned int *LOSMGraph::get_adjacent_edges_array() const
+{
+	return adjacencyEdges.data();
+}
+
+void LOSMGraph::compute_edge_distances(std::vector<float> &result) const
+{
+	const std::vector<const LOSMEdge *> &edges = losm->get_edges();
+	result.resize(edges.size());
+
+	// Gather the endpoints' coordinates in blocks so the kernel runs over contiguous arrays.
+	const unsigned int blockSize = 256;
+	int x1[blockSize], y1[blockSize], x2[blockSize], y2[blockSize];
+
+	for (unsigned int first = 0; first < edges.size(); first += blockSize) {
+		unsigned int count = std::min(blockSize, (unsigned int)edges.size() - first);
+
+		for (unsigned int i = 0; i < count; i++) {
+			const LOSMEdge *edge = edges[first + i];
+			x1[i] = edge->get_node_1()->get_fixed_x();
+			y1[i] = edge->get_node_1()->get_fixed_y();
+			x2[i] = edge->get_node_2()->get_fixed_x();
+			y2[i] = edge->get_node_2()->get_fixed_y();
+		}
+
+		haversine_distances(count, x1, y1, x2, y2, &result[first]);
+	}
+}
+
+void LOSMGraph::compute_node_distances(unsigned int node, std::vector<float> &result) const
+{
+	result.resize(fixedX.size());
+	haversine_distances(fixedX[node], fixedY[node], fixedX.size(), fixedX.data(), fixedY.data(), result.data());
+}
+
+unsigned int LOSMGraph::find_nearest_node(float x, float y) const
+{
+	LOSM_INSTRUMENT(LOSMOperation::FIND_NEAREST_NODE);
+
+	if (kdTree.empty()) {
+		return INVALID_INDEX;
+	}
+
+	int px = degrees_to_fixed_point(x);
+	int py = degrees_to_fixed_point(y);
+
+	std::vector<std::pair<float, unsigned int> > candidates;
+	candidates.reserve(NUM_NEAREST_CANDIDATES + 1);
+
+	search_kd_tree(0, kdTree.size(), 0, px, py, candidates);
+
+	// Refine the candidates by their exact distance, breaking ties by index.
+	int cx[NUM_NEAREST_CANDIDATES], cy[NUM_NEAREST_CANDIDATES];
+	float distances[NUM_NEAREST_CANDIDATES];
+
+	for (unsigned int i = 0; i < candidates.size(); i++) {
+		cx[i] = fixedX[candidates[i].second];
+		cy[i] = fixedY[candidates[i].second];
+	}
+
+	haversine_distances(px, py, candidates.size(), cx, cy, distances);
+
+	unsigned int best = 0;
+	for (unsigned int i = 1; i < candidates.size(); i++) {
+		if (distances[i] < distances[best] ||
+				(distances[i] == distances[best] && candidates[i].second < candidates[best].second)) {
+			best = i;
+		}
+	}
+
+	return candidates[best].second;
+}
+
+void LOSMGraph::find_nodes_in_box(float minX, float minY, float maxX, float maxY,
+		std::vector<unsigned int> &result) const
+{
+	LOSM_INSTRUMENT(LOSMOperation::FIND_NEAREST_NODE);
+
+	result.clear();
+
+	if (minX > maxX || minY > maxY) {
+		return;
+	}
+
+	search_kd_tree_box(kdTree, fixedX, fixedY, 0, kdTree.size(), 0, degrees_to_fixed_point(minX),
+			degrees_to_fixed_point(minY), degrees_to_fixed_point(maxX), degrees_to_fixed_point(maxY), result);
+}
+
+void LOSMGraph::find_landmarks_in_box(float minX, float minY, float maxX, float maxY,
+		std::vector<unsigned int> &result) const
+{
+	result.clear();
+
+	if (minX > maxX || minY > maxY) {
+		return;
+	}
+
+	search_kd_tree_box(landmarkKdTree, landmarkFixedX, landmarkFixedY, 0, landmarkKdTree.size(), 0,
+			degrees_to_fixed_point(minX), degrees_to_fixed_point(minY), degrees_to_fixed_point(maxX),
+			degrees_to_fixed_point(maxY), result);
+}
+
+LOSMMemoryUsage LOSMGraph::get_memory_usage() const
+{
+	LOSMMemoryUsage usage;
+
+	usage.adjacency = adjacencyOffsets.size() * sizeof(unsigned int) +
+			adjacencyNodes.size() * sizeof(unsigned int) +
+			adjacencyEdges.size() * sizeof(unsigned int) +
+			edgeNodes.size() * sizeof(unsigned int);
+
+	usage.edgeAttributes = edgeDistances.size() * sizeof(float) + edgeTravelTimes.size() * sizeof(float) +
+			edgeSpeedLimits.size() * sizeof(unsigned int) + edgeLanes.size() * sizeof(unsigned int);
+
+	usage.coordinates = fixedX.size() * sizeof(int) + fixedY.size() * sizeof(int) +
+			landmarkFixedX.size() * sizeof(int) + landmarkFixedY.size() * sizeof(int);
+
+	usage.indices = uids.size() * sizeof(unsigned long) + uidTableKeys.size() * sizeof(unsigned long) +
+			uidTableNodes.size() * sizeof(unsigned int);
+
+	usage.spatialIndex = kdTree.size() * sizeof(unsigned int) + landmarkKdTree.size() * sizeof(unsigned int);
+
+	// The objects themselves, their pointers in the LOSM object's lists, and each edge's name.
+	usage.objects = losm->get_nodes().size() * (sizeof(LOSMNode) + sizeof(const LOSMNode *)) +
+			losm->get_landmarks().size() * (sizeof(LOSMLandmark) + sizeof(const LOSMLandmark *)) +
+			losm->get_edges().size() * (sizeof(LOSMEdge) + sizeof(const LOSMEdge *));
+
+	for (const LOSMEdge *edge : losm->get_edges()) {
+		usage.objects += edge->get_name().capacity();
+	}
+
+	// The LOSM object's neighbor lists hold two pointers per edge, plus a hash map entry per node.
+	usage.objects += losm->get_edges().size() * 2 * sizeof(const LOSMNode *) +
+			losm->get_nodes().size() * (2 * sizeof(void *) + sizeof(std::pair<const LOSMNode *, std::vector<const LOSMNode *> >));
+
+	return usage;
+}
+
+void LOSMGraph::save(std::ostream &stream) const
+{
+	uint32_t counts[5] = {(uint32_t)get_num_nodes(), (uint32_t)get_num_edges(), (uint32_t)adjacencyNodes.size(),
+			(uint32_t)uidTableKeys.size(), (uint32_t)landmarkKdTree.size()};
+
+	// The header is padded like the arrays which follow it.
+	char header[sizeof(SAVED_MAGIC) + sizeof(counts) + sizeof(float)];
+	std::memcpy(header, SAVED_MAGIC, sizeof(SAVED_MAGIC));
+	std::memcpy(header + sizeof(SAVED_MAGIC), counts, sizeof(counts));
+	std::memcpy(header + sizeof(SAVED_MAGIC) + sizeof(counts), &projectionScale, sizeof(float));
+
+	write_array(LOSMSpan<char>(header, sizeof(header)), stream);
+	write_array(adjacencyOffsets, stream);
+	write_array(adjacencyNodes, stream);
+	write_array(adjacencyEdges, stream);
+	write_array(edgeDistances, stream);
+	write_array(edgeTravelTimes, stream);
+	write_array(fixedX, stream);
+	write_array(fixedY, stream);
+	write_array(uids, stream);
+	write_array(edgeNodes, stream);
+	write_array(edgeSpeedLimits, stream);
+	write_array(edgeLanes, stream);
+	write_array(kdTree, stream);
+	write_array(uidTableKeys, stream);
+	write_array(uidTableNodes, stream);
+	write_array(landmarkFixedX, stream);
+	write_array(landmarkFixedY, stream);
+	write_array(landmarkKdTree, stream);
+}
+
+void LOSMGraph::set_storage(const LOSMStorageOptions &options)
+{
+	this->options = options;
+
+	storage.adjacencyOffsets = LOSMArray<unsigned int>(LOSMAllocator<unsigned int>(options));
+	storage.adjacencyNodes = LOSMArray<unsigned int>(LOSMAllocator<unsigned int>(options));
+	storage.adjacencyEdges = LOSMArray<unsigned int>(LOSMAllocator<unsigned int>(options));
+	storage.edgeDistances = LOSMArray<float>(LOSMAllocator<float>(options));
+	storage.edgeTravelTimes = LOSMArray<float>(LOSMAllocator<float>(options));
+	storage.fixedX = LOSMArray<int>(LOSMAllocator<int>(options));
+	storage.fixedY = LOSMArray<int>(LOSMAllocator<int>(options));
+	storage.uids = LOSMArray<unsigned long>(LOSMAllocator<unsigned long>(options));
+	storage.edgeNodes = LOSMArray<unsigned int>(LOSMAllocator<unsigned int>(options));
+	storage.edgeSpeedLimits = LOSMArray<unsigned int>(LOSMAllocator<unsigned int>(options));
+	storage.edgeLanes = LOSMArray<unsigned int>(LOSMAllocator<unsigned int>(options));
+	storage.kdTree = LOSMArray<unsigned int>(LOSMAllocator<unsigned int>(options));
+	storage.uidTableKeys = LOSMArray<unsigned long>(LOSMAllocator<unsigned long>(options));
+	storage.uidTableNodes = LOSMArray<unsigned int>(LOSMAllocator<unsigned int>(options));
+	storage.landmarkFixedX = LOSMArray<int>(LOSMAllocator<int>(options));
+	storage.landmarkFixedY = LOSMArray<int>(LOSMAllocator<int>(options));
+	storage.landmarkKdTree = LOSMArray<unsigned int>(LOSMAllocator<unsigned int>(options));
+}
+
+void LOSMGraph::view_storage()
+{
+	adjacencyOffsets = storage.adjacencyOffsets;
+	adjacencyNodes = storage.adjacencyNodes;
+	adjacencyEdges = storage.adjacencyEdges;
+	edgeDistances = storage.edgeDistances;
+	edgeTravelTimes = storage.edgeTravelTimes;
+	fixedX = storage.fixedX;
+	fixedY = storage.fixedY;
+	uids = storage.uids;
+	edgeNodes = storage.edgeNodes;
+	edgeSpeedLimits = storage.edgeSpeedLimits;
+	edgeLanes = storage.edgeLanes;
+	kdTree = storage.kdTree;
+	uidTableKeys = storage.uidTableKeys;
+	uidTableNodes = storage.uidTableNodes;
+	landmarkFixedX = storage.landmarkFixedX;
+	landmarkFixedY = storage.landmarkFixedY;
+	landmarkKdTree = storage.landmarkKdTree;
+}
+
+void LOSMGraph::copy_attributes(const std::unordered_map<const LOSMNode *, unsigned int> &nodeIndices)
+{
+	const std::vector<const LOSMNode *> &nodes = losm->get_nodes();
+	const std::vector<const LOSMEdge *> &edges = losm->get_edges();
+
+	storage.uids.resize(nodes.size());
+	for (unsigned int i = 0; i < nodes.size(); i++) {
+		storage.uids[i] = nodes[i]->get_uid();
+	}
+
+	storage.edgeNodes.resize(2 * edges.size());
+	storage.edgeSpeedLimits.resize(edges.size());
+	storage.edgeLanes.resize(edges.size());
+
+	for (unsigned int i = 0; i < edges.size(); i++) {
+		storage.edgeNodes[2 * i] = nodeIndices.find(edges[i]->get_node_1())->second;
+		storage.edgeNodes[2 * i + 1] = nodeIndices.find(edges[i]->get_node_2())->second;
+		storage.edgeSpeedLimits[i] = edges[i]->get_speed_limit();
+		storage.edgeLanes[i] = edges[i]->get_lanes();
+	}
+
+	// Size the table to at least twice the number of nodes, so that probes stay short. Of nodes
+	// with the same unique identifier, the first is kept, as it is the one edges are loaded onto.
+	size_t numTableSlots = 1;
+	while (numTableSlots < 2 * nodes.size()) {
+		numTableSlots *= 2;
+	}
+
+	size_t mask = numTableSlots - 1;
+
+	storage.uidTableKeys.assign(numTableSlots, 0);
+	storage.uidTableNodes.assign(numTableSlots, INVALID_INDEX);
+
+	for (unsigned int i = 0; i < nodes.size(); i++) {
+		size_t slot = hash_uid(storage.uids[i], mask);
+		while (storage.uidTableNodes[slot] != INVALID_INDEX && storage.uidTableKeys[slot] != storage.uids[i]) {
+			slot = (slot + 1) & mask;
+		}
+
+		if (storage.uidTableNodes[slot] == INVALID_INDEX) {
+			storage.uidTableKeys[slot] = storage.uids[i];
+			storage.uidTableNodes[slot] = i;
+		}
+	}
+}
+
+size_t LOSMGraph::hash_uid(unsigned long uid, size_t mask)
+{
+	uint64_t hash = (uint64_t)uid * 0x9E3779B97F4A7C15ull;
+	return (size_t)(hash ^ (hash >> 32)) & mask;
+}
+
+void LOSMGraph::build_kd_tree(LOSMArray<unsigned int> &tree, const LOSMArray<int> &x, const LOSMArray<int> &y,
+		unsigned int first, unsigned int last, unsigned int depth)
+{
+	if (last - first <= 1) {
+		return;
+	}
+
+	unsigned int middle = first + (last - first) / 2;
+	const LOSMArray<int> &axis = (depth % 2 == 0) ? x : y;
+
+	std::nth_element(tree.begin() + first, tree.begin() + middle, tree.begin() + last,
+			[&axis](unsigned int a, unsigned int b) { return axis[a] < axis[b]; });
+
+	build_kd_tree(tree, x, y, first, middle, depth + 1);
+	build_kd_tree(tree, x, y, middle + 1, last, depth + 1);
+}
+
+void LOSMGraph::search_kd_tree(unsigned int first, unsigned int last, unsigned int depth,
+		int px, int py, std::vector<std::pair<float, unsigned int> > &candidates) const
+{
+	if (first >= last) {
+		return;
+	}
+
+	unsigned int middle = first + (last - first) / 2;
+	unsigned int node = kdTree[middle];
+
+	float dx = (float)((long long)fixedX[node] - px);
+	float dy = (float)((long long)fixedY[node] - py) * projectionScale;
+	float distanceSq = dx * dx + dy * dy;
+
+	// Keep the nearest candidates in a max-heap, so the farthest one is replaced first.
+	if (candidates.size() < NUM_NEAREST_CANDIDATES || distanceSq < candidates.front().first) {
+		candidates.push_back(std::make_pair(distanceSq, node));
+		std::push_heap(candidates.begin(), candidates.end());
+
+		if (candidates.size() > NUM_NEAREST_CANDIDATES) {
+			std::pop_heap(candidates.begin(), candidates.end());
+			candidates.pop_back();
+		}
+	}
+
+	// Descend into the side containing the point first, then the other side only if the
+	// splitting plane is closer than the farthest candidate.
+	float split = (depth % 2 == 0) ? dx : dy;
+
+	unsigned int nearFirst = middle + 1, nearLast = last, farFirst = first, farLast = middle;
+	if (split > 0.0f) {
+		std::swap(nearFirst, farFirst);
+		std::swap(nearLast, farLast);
+	}
+
+	search_kd_tree(nearFirst, nearLast, depth + 1, px, py, candidates);
+
+	if (candidates.size() < NUM_NEAREST_CANDIDATES || split * split < candidates.front().first) {
+		search_kd_tree(farFirst, farLast, depth + 1, px, py, candidates);
+	}
+}
+
+void LOSMGraph::search_kd_tree_box(const LOSMSpan<unsigned int> &tree, const LOSMSpan<int> &x,
+		const LOSMSpan<int> &y, unsigned int first, unsigned int last, unsigned int depth,
+		int minX, int minY, int maxX, int maxY, std::vector<unsigned int> &result)
+{
+	if (first >= last) {
+		return;
+	}
+
+	unsigned int middle = first + (last - first) / 2;
+	unsigned int point = tree[middle];
+
+	if (x[point] >= minX && x[point] <= maxX && y[point] >= minY && y[point] <= maxY) {
+		result.push_back(point);
+	}
+
+	// Only descend into the sides of the splitting plane which overlap the box.
+	int split = (depth % 2 == 0) ? x[point] : y[point];
+	int low = (depth % 2 == 0) ? minX : minY;
+	int high = (depth % 2 == 0) ? maxX : maxY;
+
+	if (low <= split) {
+		search_kd_tree_box(tree, x, y, first, middle, depth + 1, minX, minY, maxX, maxY, result);
+	}
+	if (high >= split) {
+		search_kd_tree_box(tree, x, y, middle + 1, last, depth + 1, minX, minY, maxX, maxY, result);
+	}
+}
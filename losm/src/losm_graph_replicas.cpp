@@ -0,0 +1,89 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "../include/losm_graph_replicas.h"
+#include "../include/losm_exception.h"
+
+#include <iostream>
+
+LOSMGraphReplicas::LOSMGraphReplicas(std::shared_ptr<const LOSMGraph> graph, LOSMPageMode pages)
+{
+	if (graph == nullptr) {
+		std::cerr << "Error[LOSMGraphReplicas::LOSMGraphReplicas]: The graph provided was null." << std::endl;
+		throw LOSMException();
+	}
+
+	numaNodes = ::get_numa_nodes();
+
+	// With one NUMA node, all memory is local, so only copy the graph to change its pages.
+	if (numaNodes.size() == 1) {
+		if (graph->get_storage_options().pages == pages) {
+			replicas.push_back(graph);
+		} else {
+			replicas.push_back(std::make_shared<LOSMGraph>(*graph, LOSMStorageOptions(pages)));
+		}
+		return;
+	}
+
+	for (unsigned int numaNode : numaNodes) {
+		replicas.push_back(std::make_shared<LOSMGraph>(*graph, LOSMStorageOptions(pages, (int)numaNode)));
+	}
+}
+
+LOSMGraphReplicas::~LOSMGraphReplicas()
+{ }
+
+unsigned int LOSMGraphReplicas::get_num_replicas() const
+{
+	return replicas.size();
+}
+
+const std::vector<unsigned int> &LOSMGraphReplicas::get_numa_nodes() const
+{
+	return numaNodes;
+}
+
+std::shared_ptr<const LOSMGraph> LOSMGraphReplicas::get_replica(unsigned int numaNode) const
+{
+	for (unsigned int i = 0; i < numaNodes.size(); i++) {
+		if (numaNodes[i] == numaNode) {
+			return replicas[i];
+		}
+	}
+
+	std::cerr << "Error[LOSMGraphReplicas::get_replica]: NUMA node " << numaNode << " does not have a replica." << std::endl;
+	throw LOSMException();
+}
+
+std::shared_ptr<const LOSMGraph> LOSMGraphReplicas::get_local_replica() const
+{
+	// A thread on a node without memory, or one which is unknown, takes the first replica.
+	unsigned int numaNode = get_current_numa_node();
+
+	for (unsigned int i = 0; i < numaNodes.size(); i++) {
+		if (numaNodes[i] == numaNode) {
+			return replicas[i];
+		}
+	}
+
+	return replicas[0];
+}
@@ -0,0 +1,605 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "../include/losm_hub_labels.h"
+#include "../include/losm_exception.h"
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <random>
+#include <cstring>
+#include <cmath>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LOSM_HUB_LABELS_AVX2
+#include <immintrin.h>
+#endif
+
+const unsigned int LOSMHubLabels::NUM_RANKING_SAMPLES;
+const char LOSMHubLabels::SAVED_MAGIC[8] = {'L', 'O', 'S', 'M', 'H', 'L', '0', '1'};
+
+/**
+ * The number of pairs ahead whose labels are prefetched by the batched queries.
+ */
+static const unsigned int PREFETCH_DISTANCE = 8;
+
+/**
+ * The header at the start of the saved layout, padded to the alignment.
+ */
+struct LOSMHubLabelsHeader {
+	char magic[8];
+	uint32_t numNodes;
+	uint32_t cost;
+	uint64_t numPairs;
+	uint64_t numSlots;
+	char padding[32];
+};
+
+/**
+ * Round a size up to a multiple of an alignment.
+ * @param	size		The size.
+ * @param	alignment	The alignment, a power of two.
+ * @return	The rounded size.
+ */
+static inline uint64_t align_up(uint64_t size, uint64_t alignment)
+{
+	return (size + alignment - 1) & ~(alignment - 1);
+}
+
+/**
+ * Merge two labels, each terminated by LOSMGraph::INVALID_INDEX, which is greater than every hub.
+ * @param	hubs1	The hubs of the first label.
+ * @param	costs1	The costs of the first label.
+ * @param	hubs2	The hubs of the second label.
+ * @param	costs2	The costs of the second label.
+ * @return	The minimum sum of costs over the common hubs, or infinity if there are none.
+ */
+static inline float merge_labels_scalar(const uint32_t *hubs1, const float *costs1, const uint32_t *hubs2,
+		const float *costs2)
+{
+	float best = INFINITY;
+	unsigned int i = 0;
+	unsigned int j = 0;
+
+	// Both cursors advance on equal hubs, so the loop is free of hard-to-predict branches.
+	while (true) {
+		uint32_t hub1 = hubs1[i];
+		uint32_t hub2 = hubs2[j];
+
+		if (hub1 == hub2) {
+			if (hub1 == LOSMGraph::INVALID_INDEX) {
+				break;
+			}
+			best = std::min(best, costs1[i] + costs2[j]);
+		}
+
+		i += (hub1 <= hub2);
+		j += (hub2 <= hub1);
+	}
+
+	return best;
+}
+
+#ifdef LOSM_HUB_LABELS_AVX2
+
+/**
+ * Check once if the processor supports the AVX2 merge.
+ * @return	True if AVX2 is supported, false otherwise.
+ */
+static bool has_avx2()
+{
+	static const bool supported = __builtin_cpu_supports("avx2");
+	return supported;
+}
+
+/**
+ * Merge two labels as in merge_labels_scalar(), eight slots at a time. Each block of one label
+ * is compared with all eight rotations of the other's block, and the block with the smaller
+ * last hub is then advanced. Labels are padded to whole blocks with the terminator and infinite
+ * costs, so the padding never lowers the minimum.
+ */
+__attribute__((target("avx2")))
+static float merge_labels_avx2(const uint32_t *hubs1, const float *costs1, const uint32_t *hubs2,
+		const float *costs2)
+{
+	const __m256i rotation = _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 0);
+	const __m256 infinity = _mm256_set1_ps(INFINITY);
+	__m256 best = infinity;
+	__m256 bestOther = infinity;
+
+	while (true) {
+		__m256i block1 = _mm256_load_si256((const __m256i *)hubs1);
+		__m256 blockCosts1 = _mm256_load_ps(costs1);
+		__m256i block2 = _mm256_load_si256((const __m256i *)hubs2);
+		__m256 blockCosts2 = _mm256_load_ps(costs2);
+
+		// Two minimums are kept, so that consecutive rotations do not wait on each other.
+		for (unsigned int r = 0; r < 8; r += 2) {
+			__m256 equal = _mm256_castsi256_ps(_mm256_cmpeq_epi32(block1, block2));
+			__m256 sum = _mm256_add_ps(blockCosts1, blockCosts2);
+			best = _mm256_min_ps(best, _mm256_blendv_ps(infinity, sum, equal));
+
+			block2 = _mm256_permutevar8x32_epi32(block2, rotation);
+			blockCosts2 = _mm256_permutevar8x32_ps(blockCosts2, rotation);
+
+			equal = _mm256_castsi256_ps(_mm256_cmpeq_epi32(block1, block2));
+			sum = _mm256_add_ps(blockCosts1, blockCosts2);
+			bestOther = _mm256_min_ps(bestOther, _mm256_blendv_ps(infinity, sum, equal));
+
+			block2 = _mm256_permutevar8x32_epi32(block2, rotation);
+			blockCosts2 = _mm256_permutevar8x32_ps(blockCosts2, rotation);
+		}
+
+		uint32_t last1 = hubs1[7];
+		uint32_t last2 = hubs2[7];
+		if (last1 == LOSMGraph::INVALID_INDEX && last2 == LOSMGraph::INVALID_INDEX) {
+			break;
+		}
+
+		if (last1 <= last2) {
+			hubs1 += 8;
+			costs1 += 8;
+		}
+		if (last2 <= last1) {
+			hubs2 += 8;
+			costs2 += 8;
+		}
+	}
+
+	// Reduce the sixteen minimums to one.
+	best = _mm256_min_ps(best, bestOther);
+	__m128 low = _mm_min_ps(_mm256_castps256_ps128(best), _mm256_extractf128_ps(best, 1));
+	low = _mm_min_ps(low, _mm_movehl_ps(low, low));
+	low = _mm_min_ss(low, _mm_shuffle_ps(low, low, 1));
+	return _mm_cvtss_f32(low);
+}
+
+#endif // LOSM_HUB_LABELS_AVX2
+
+/**
+ * Merge two labels with the fastest kernel the processor supports.
+ * @param	hubs1	The hubs of the first label.
+ * @param	costs1	The costs of the first label.
+ * @param	hubs2	The hubs of the second label.
+ * @param	costs2	The costs of the second label.
+ * @return	The minimum sum of costs over the common hubs, or infinity if there are none.
+ */
+static inline float merge_labels(const uint32_t *hubs1, const float *costs1, const uint32_t *hubs2,
+		const float *costs2)
+{
+#ifdef LOSM_HUB_LABELS_AVX2
+	if (has_avx2()) {
+		return merge_labels_avx2(hubs1, costs1, hubs2, costs2);
+	}
+#endif
+	return merge_labels_scalar(hubs1, costs1, hubs2, costs2);
+}
+
+/**
+ * Prefetch the start of an array.
+ * @param	address	The address to prefetch.
+ */
+static inline void prefetch(const void *address)
+{
+#if defined(__GNUC__)
+	__builtin_prefetch(address);
+#endif
+}
+
+LOSMHubLabels::LOSMHubLabels(const LOSMGraph &graph, LOSMCost cost) : numNodes(graph.get_num_nodes()),
+		cost(cost), numPairs(0), offsets(nullptr), hubs(nullptr), costs(nullptr), image(nullptr), imageSize(0),
+		mapping(nullptr)
+{
+	std::vector<unsigned int> order;
+	rank_nodes(graph, order);
+
+	// The labels are built in rank order, so each is sorted by hub as it grows.
+	std::vector<std::vector<std::pair<uint32_t, float> > > labels(numNodes);
+	std::vector<float> rootCosts(numNodes, INFINITY);
+	std::vector<float> nodeCosts(numNodes, INFINITY);
+	std::vector<unsigned int> reached;
+
+	std::greater<std::pair<float, unsigned int> > compare;
+	std::vector<std::pair<float, unsigned int> > heap;
+
+	for (unsigned int rank = 0; rank < numNodes; rank++) {
+		unsigned int root = order[rank];
+		for (const std::pair<uint32_t, float> &entry : labels[root]) {
+			rootCosts[entry.first] = entry.second;
+		}
+
+		heap.clear();
+		reached.clear();
+		nodeCosts[root] = 0.0f;
+		reached.push_back(root);
+		heap.push_back(std::make_pair(0.0f, root));
+
+		while (!heap.empty()) {
+			std::pop_heap(heap.begin(), heap.end(), compare);
+			float nodeCost = heap.back().first;
+			unsigned int node = heap.back().second;
+			heap.pop_back();
+
+			if (nodeCost > nodeCosts[node]) {
+				continue;
+			}
+
+			// Prune the node if a higher-ranked hub already covers its route from the root.
+			float covered = INFINITY;
+			for (const std::pair<uint32_t, float> &entry : labels[node]) {
+				covered = std::min(covered, rootCosts[entry.first] + entry.second);
+			}
+			if (covered <= nodeCost) {
+				continue;
+			}
+
+			labels[node].push_back(std::make_pair(rank, nodeCost));
+
+			for (unsigned int slot = graph.get_adjacency_begin(node); slot < graph.get_adjacency_end(node); slot++) {
+				unsigned int neighbor = graph.get_adjacent_node(slot);
+				float neighborCost = nodeCost + graph.get_edge_cost(graph.get_adjacent_edge(slot), cost);
+
+				if (neighborCost < nodeCosts[neighbor]) {
+					if (nodeCosts[neighbor] == INFINITY) {
+						reached.push_back(neighbor);
+					}
+					nodeCosts[neighbor] = neighborCost;
+
+					heap.push_back(std::make_pair(neighborCost, neighbor));
+					std::push_heap(heap.begin(), heap.end(), compare);
+				}
+			}
+		}
+
+		for (unsigned int node : reached) {
+			nodeCosts[node] = INFINITY;
+		}
+		for (const std::pair<uint32_t, float> &entry : labels[root]) {
+			rootCosts[entry.first] = INFINITY;
+		}
+	}
+
+	// Lay out the labels as they are saved, each padded with the terminator to the alignment.
+	unsigned int slotsPerAlignment = ALIGNMENT / sizeof(uint32_t);
+	std::vector<uint64_t> labelOffsets(numNodes + 1, 0);
+	for (unsigned int node = 0; node < numNodes; node++) {
+		labelOffsets[node + 1] = labelOffsets[node] + align_up(labels[node].size() + 1, slotsPerAlignment);
+		numPairs += labels[node].size();
+	}
+
+	uint64_t numSlots = labelOffsets[numNodes];
+	uint64_t offsetsStart = sizeof(LOSMHubLabelsHeader);
+	uint64_t hubsStart = offsetsStart + align_up((numNodes + 1) * sizeof(uint64_t), ALIGNMENT);
+	uint64_t costsStart = hubsStart + align_up(numSlots * sizeof(uint32_t), ALIGNMENT);
+	imageSize = costsStart + numSlots * sizeof(float);
+
+	buffer.assign(imageSize + ALIGNMENT, 0);
+	char *data = buffer.data() + (ALIGNMENT - (uintptr_t)buffer.data() % ALIGNMENT) % ALIGNMENT;
+
+	LOSMHubLabelsHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, SAVED_MAGIC, sizeof(SAVED_MAGIC));
+	header.numNodes = numNodes;
+	header.cost = (cost == LOSMCost::DISTANCE ? 0 : 1);
+	header.numPairs = numPairs;
+	header.numSlots = numSlots;
+	std::memcpy(data, &header, sizeof(header));
+	std::memcpy(data + offsetsStart, labelOffsets.data(), labelOffsets.size() * sizeof(uint64_t));
+
+	uint32_t *dataHubs = (uint32_t *)(data + hubsStart);
+	float *dataCosts = (float *)(data + costsStart);
+
+	for (unsigned int node = 0; node < numNodes; node++) {
+		uint64_t slot = labelOffsets[node];
+		for (const std::pair<uint32_t, float> &entry : labels[node]) {
+			dataHubs[slot] = entry.first;
+			dataCosts[slot] = entry.second;
+			slot++;
+		}
+		for (; slot < labelOffsets[node + 1]; slot++) {
+			dataHubs[slot] = LOSMGraph::INVALID_INDEX;
+			dataCosts[slot] = INFINITY;
+		}
+	}
+
+	attach(data, imageSize);
+}
+
+LOSMHubLabels::LOSMHubLabels(std::string filename) : numNodes(0), cost(LOSMCost::DISTANCE), numPairs(0),
+		offsets(nullptr), hubs(nullptr), costs(nullptr), image(nullptr), imageSize(0), mapping(nullptr)
+{
+	int file = open(filename.c_str(), O_RDONLY);
+	if (file < 0) {
+		std::cerr << "Error[LOSMHubLabels::LOSMHubLabels]: Failed to open the file '" << filename << "'." << std::endl;
+		throw LOSMException();
+	}
+
+	struct stat status;
+	if (fstat(file, &status) != 0 || status.st_size == 0) {
+		close(file);
+		std::cerr << "Error[LOSMHubLabels::LOSMHubLabels]: Failed to read the file '" << filename << "'." << std::endl;
+		throw LOSMException();
+	}
+
+	size_t size = status.st_size;
+	void *data = mmap(nullptr, size, PROT_READ, MAP_SHARED, file, 0);
+	close(file);
+
+	if (data == MAP_FAILED) {
+		std::cerr << "Error[LOSMHubLabels::LOSMHubLabels]: Failed to map the file '" << filename << "'." << std::endl;
+		throw LOSMException();
+	}
+
+	if (!attach((const char *)data, size)) {
+		munmap(data, size);
+		std::cerr << "Error[LOSMHubLabels::LOSMHubLabels]: The file '" << filename << "' is not valid." << std::endl;
+		throw LOSMException();
+	}
+
+	mapping = data;
+}
+
+LOSMHubLabels::~LOSMHubLabels()
+{
+	if (mapping != nullptr) {
+		munmap(mapping, imageSize);
+	}
+}
+
+unsigned int LOSMHubLabels::get_num_nodes() const
+{
+	return numNodes;
+}
+
+LOSMCost LOSMHubLabels::get_cost() const
+{
+	return cost;
+}
+
+unsigned long long LOSMHubLabels::get_num_pairs() const
+{
+	return numPairs;
+}
+
+size_t LOSMHubLabels::get_memory_usage() const
+{
+	return imageSize;
+}
+
+float LOSMHubLabels::find_distance(unsigned int source, unsigned int target) const
+{
+	return merge_labels(hubs + offsets[source], costs + offsets[source], hubs + offsets[target],
+			costs + offsets[target]);
+}
+
+void LOSMHubLabels::find_distances(unsigned int count, const unsigned int *sources, const unsigned int *targets,
+		float *result) const
+{
+	for (unsigned int i = 0; i < count; i++) {
+		if (i + PREFETCH_DISTANCE < count) {
+			uint64_t source = offsets[sources[i + PREFETCH_DISTANCE]];
+			uint64_t target = offsets[targets[i + PREFETCH_DISTANCE]];
+			prefetch(hubs + source);
+			prefetch(costs + source);
+			prefetch(hubs + target);
+			prefetch(costs + target);
+		}
+
+		result[i] = find_distance(sources[i], targets[i]);
+	}
+}
+
+void LOSMHubLabels::find_distances(unsigned int source, unsigned int count, const unsigned int *targets,
+		float *result) const
+{
+	const uint32_t *sourceHubs = hubs + offsets[source];
+	const float *sourceCosts = costs + offsets[source];
+
+	for (unsigned int i = 0; i < count; i++) {
+		if (i + PREFETCH_DISTANCE < count) {
+			uint64_t target = offsets[targets[i + PREFETCH_DISTANCE]];
+			prefetch(hubs + target);
+			prefetch(costs + target);
+		}
+
+		result[i] = merge_labels(sourceHubs, sourceCosts, hubs + offsets[targets[i]], costs + offsets[targets[i]]);
+	}
+}
+
+void LOSMHubLabels::save(std::string filename) const
+{
+	std::ofstream file(filename, std::ios::binary);
+	if (!file.is_open()) {
+		std::cerr << "Error[LOSMHubLabels::save]: Failed to open the file '" << filename << "'." << std::endl;
+		throw LOSMException();
+	}
+
+	file.write(image, imageSize);
+
+	if (!file) {
+		std::cerr << "Error[LOSMHubLabels::save]: Failed to write the file '" << filename << "'." << std::endl;
+		throw LOSMException();
+	}
+}
+
+void LOSMHubLabels::rank_nodes(const LOSMGraph &graph, std::vector<unsigned int> &order) const
+{
+	// Each sample's shortest path tree credits every node with the size of its subtree, i.e.,
+	// the number of cheapest routes from the sample which pass through it.
+	std::vector<double> scores(numNodes, 0.0);
+	std::vector<float> nodeCosts(numNodes, INFINITY);
+	std::vector<unsigned int> parents(numNodes, LOSMGraph::INVALID_INDEX);
+	std::vector<unsigned int> subtreeSizes(numNodes, 0);
+	std::vector<unsigned int> settled;
+
+	std::greater<std::pair<float, unsigned int> > compare;
+	std::vector<std::pair<float, unsigned int> > heap;
+
+	std::mt19937 generator(numNodes);
+	unsigned int numSamples = std::min(numNodes, NUM_RANKING_SAMPLES);
+
+	for (unsigned int sample = 0; sample < numSamples; sample++) {
+		unsigned int source = generator() % numNodes;
+
+		settled.clear();
+		nodeCosts[source] = 0.0f;
+		parents[source] = LOSMGraph::INVALID_INDEX;
+		heap.push_back(std::make_pair(0.0f, source));
+
+		while (!heap.empty()) {
+			std::pop_heap(heap.begin(), heap.end(), compare);
+			float nodeCost = heap.back().first;
+			unsigned int node = heap.back().second;
+			heap.pop_back();
+
+			if (nodeCost > nodeCosts[node]) {
+				continue;
+			}
+
+			settled.push_back(node);
+
+			for (unsigned int slot = graph.get_adjacency_begin(node); slot < graph.get_adjacency_end(node); slot++) {
+				unsigned int neighbor = graph.get_adjacent_node(slot);
+				float neighborCost = nodeCost + graph.get_edge_cost(graph.get_adjacent_edge(slot), cost);
+
+				if (neighborCost < nodeCosts[neighbor]) {
+					nodeCosts[neighbor] = neighborCost;
+					parents[neighbor] = node;
+
+					heap.push_back(std::make_pair(neighborCost, neighbor));
+					std::push_heap(heap.begin(), heap.end(), compare);
+				}
+			}
+		}
+
+		// Every child is settled after its parent, so the subtrees are summed in reverse.
+		for (unsigned int i = (unsigned int)settled.size(); i > 0; i--) {
+			unsigned int node = settled[i - 1];
+			subtreeSizes[node]++;
+			scores[node] += subtreeSizes[node];
+			if (parents[node] != LOSMGraph::INVALID_INDEX) {
+				subtreeSizes[parents[node]] += subtreeSizes[node];
+			}
+		}
+
+		for (unsigned int node : settled) {
+			nodeCosts[node] = INFINITY;
+			subtreeSizes[node] = 0;
+		}
+	}
+
+	// Ties, e.g., between nodes no sample reached, are broken by degree.
+	order.resize(numNodes);
+	for (unsigned int i = 0; i < numNodes; i++) {
+		order[i] = i;
+	}
+
+	std::sort(order.begin(), order.end(), [&](unsigned int node1, unsigned int node2) {
+		if (scores[node1] != scores[node2]) {
+			return scores[node1] > scores[node2];
+		}
+		unsigned int degree1 = graph.get_adjacency_end(node1) - graph.get_adjacency_begin(node1);
+		unsigned int degree2 = graph.get_adjacency_end(node2) - graph.get_adjacency_begin(node2);
+		if (degree1 != degree2) {
+			return degree1 > degree2;
+		}
+		return node1 < node2;
+	});
+}
+
+bool LOSMHubLabels::attach(const char *data, size_t size)
+{
+	// The SIMD merge loads whole blocks with aligned loads, so the image must be aligned.
+	LOSMHubLabelsHeader header;
+	if (size < sizeof(header) || (uintptr_t)data % ALIGNMENT != 0) {
+		return false;
+	}
+
+	std::memcpy(&header, data, sizeof(header));
+	if (std::memcmp(header.magic, SAVED_MAGIC, sizeof(SAVED_MAGIC)) != 0 || header.cost > 1) {
+		return false;
+	}
+
+	uint64_t offsetsStart = sizeof(LOSMHubLabelsHeader);
+	uint64_t hubsStart = offsetsStart + align_up((header.numNodes + 1ull) * sizeof(uint64_t), ALIGNMENT);
+	uint64_t costsStart = hubsStart + align_up(header.numSlots * sizeof(uint32_t), ALIGNMENT);
+	if (header.numSlots > size || costsStart + header.numSlots * sizeof(float) != size) {
+		return false;
+	}
+
+	const uint64_t *labelOffsets = (const uint64_t *)(data + offsetsStart);
+	const uint32_t *labelHubs = (const uint32_t *)(data + hubsStart);
+
+	// Every label must start on a block and end with the terminator, so that the aligned loads of
+	// merges stay within it.
+	uint64_t slotsPerAlignment = ALIGNMENT / sizeof(uint32_t);
+
+	if (labelOffsets[0] != 0 || labelOffsets[header.numNodes] != header.numSlots) {
+		return false;
+	}
+	for (unsigned int node = 0; node < header.numNodes; node++) {
+		if (labelOffsets[node + 1] <= labelOffsets[node] || labelOffsets[node + 1] > header.numSlots ||
+				labelOffsets[node] % slotsPerAlignment != 0 ||
+				labelHubs[labelOffsets[node + 1] - 1] != LOSMGraph::INVALID_INDEX) {
+			return false;
+		}
+	}
+
+	// The hubs of each label must be strictly increasing nodes, followed only by the terminator,
+	// since merges advance past the smaller hub.
+	for (unsigned int node = 0; node < header.numNodes; node++) {
+		uint64_t slot = labelOffsets[node];
+		for (; labelHubs[slot] != LOSMGraph::INVALID_INDEX; slot++) {
+			if (labelHubs[slot] >= header.numNodes ||
+					(slot > labelOffsets[node] && labelHubs[slot] <= labelHubs[slot - 1])) {
+				return false;
+			}
+		}
+		for (; slot < labelOffsets[node + 1]; slot++) {
+			if (labelHubs[slot] != LOSMGraph::INVALID_INDEX) {
+				return false;
+			}
+		}
+	}
+
+	numNodes = header.numNodes;
+	cost = (header.cost == 0 ? LOSMCost::DISTANCE : LOSMCost::TRAVEL_TIME);
+	numPairs = header.numPairs;
+	offsets = labelOffsets;
+	hubs = labelHubs;
+	costs = (const float *)(data + costsStart);
+	image = data;
+	imageSize = size;
+
+	return true;
+}
@@ -0,0 +1,510 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "../include/losm_index_cache.h"
+#include "../include/losm_exception.h"
+#include "../include/losm_utilities.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstring>
+#include <cstdio>
+#include <cstdint>
+#include <cerrno>
+#include <vector>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+const char LOSMIndexCache::CACHE_MAGIC[8] = {'L', 'O', 'S', 'M', 'I', 'C', '0', '3'};
+
+/**
+ * Mix a 64-bit word into a hash.
+ * @param	hash	The hash.
+ * @param	word	The word.
+ * @return	The new hash.
+ */
+static inline uint64_t mix_hash(uint64_t hash, uint64_t word)
+{
+	word *= 0x87C37B91114253D5ull;
+	word = (word << 31) | (word >> 33);
+	word *= 0x4CF5AD432745937Full;
+	hash ^= word;
+	hash = (hash << 27) | (hash >> 37);
+	return hash * 5 + 0x52DCE729;
+}
+
+/**
+ * Hash the whole contents of a file, eight bytes at a time.
+ * @param	file	The open file, read from its current position to its end.
+ * @param	hash	The hash of the contents. This will be modified.
+ * @return	True if the file was read to its end, false otherwise.
+ */
+static bool hash_contents(int file, uint64_t &hash)
+{
+	std::vector<char> buffer(1 << 20);
+	uint64_t length = 0;
+	hash = 0;
+
+	while (true) {
+		// Fill the whole buffer, so that only the last one is short of a multiple of eight bytes.
+		size_t filled = 0;
+		while (filled < buffer.size()) {
+			ssize_t count = read(file, buffer.data() + filled, buffer.size() - filled);
+			if (count < 0 && errno == EINTR) {
+				continue;
+			} else if (count < 0) {
+				return false;
+			} else if (count == 0) {
+				break;
+			}
+			filled += count;
+		}
+
+		size_t i = 0;
+		for (; i + 8 <= filled; i += 8) {
+			uint64_t word = 0;
+			std::memcpy(&word, buffer.data() + i, 8);
+			hash = mix_hash(hash, word);
+		}
+		if (i < filled) {
+			uint64_t word = 0;
+			std::memcpy(&word, buffer.data() + i, filled - i);
+			hash = mix_hash(hash, word);
+		}
+
+		length += filled;
+		if (filled < buffer.size()) {
+			break;
+		}
+	}
+
+	hash = mix_hash(hash, length);
+	return true;
+}
+
+LOSMIndexCache::LOSMIndexCache(std::string directory) : directory(directory)
+{
+	if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST) {
+		std::cerr << "Error[LOSMIndexCache::LOSMIndexCache]: Failed to create the directory '" <<
+				directory << "'." << std::endl;
+		throw LOSMException();
+	}
+
+	struct stat status;
+	if (stat(directory.c_str(), &status) != 0 || !S_ISDIR(status.st_mode)) {
+		std::cerr << "Error[LOSMIndexCache::LOSMIndexCache]: The path '" << directory <<
+				"' is not a directory." << std::endl;
+		throw LOSMException();
+	}
+}
+
+LOSMIndexCache::~LOSMIndexCache()
+{ }
+
+std::string LOSMIndexCache::get_directory() const
+{
+	return directory;
+}
+
+std::shared_ptr<const LOSMGraph> LOSMIndexCache::load(std::string nodesFilename, std::string edgesFilename,
+		std::string landmarksFilename) const
+{
+	// Fingerprint the files before loading them, so a file replaced in between is caught the next
+	// time instead of being cached under the new fingerprint.
+	LOSMFileFingerprint fingerprints[3];
+	fingerprints[0] = compute_fingerprint(nodesFilename);
+	fingerprints[1] = compute_fingerprint(edgesFilename);
+	fingerprints[2] = compute_fingerprint(landmarksFilename);
+
+	std::string filename = get_cache_filename(fingerprints);
+
+	std::shared_ptr<const LOSMGraph> graph = restore_graph(nullptr, fingerprints, filename);
+	if (graph != nullptr) {
+		return graph;
+	}
+
+	std::shared_ptr<LOSM> losm(new LOSM(nodesFilename, edgesFilename, landmarksFilename));
+
+	return build_graph(losm, fingerprints, filename);
+}
+
+std::shared_ptr<const LOSMGraph> LOSMIndexCache::load_graph(std::shared_ptr<const LOSM> losm,
+		std::string nodesFilename, std::string edgesFilename, std::string landmarksFilename) const
+{
+	if (losm == nullptr) {
+		std::cerr << "Error[LOSMIndexCache::load_graph]: The LOSM object provided was null." << std::endl;
+		throw LOSMException();
+	}
+
+	LOSMFileFingerprint fingerprints[3];
+	fingerprints[0] = compute_fingerprint(nodesFilename);
+	fingerprints[1] = compute_fingerprint(edgesFilename);
+	fingerprints[2] = compute_fingerprint(landmarksFilename);
+
+	std::string filename = get_cache_filename(fingerprints);
+
+	std::shared_ptr<const LOSMGraph> graph = restore_graph(losm, fingerprints, filename);
+	if (graph != nullptr) {
+		return graph;
+	}
+
+	return build_graph(losm, fingerprints, filename);
+}
+
+LOSMFileFingerprint LOSMIndexCache::compute_fingerprint(std::string filename)
+{
+	int file = open(filename.c_str(), O_RDONLY);
+	struct stat status;
+	uint64_t contents = 0;
+
+	bool valid = (file >= 0 && fstat(file, &status) == 0 && S_ISREG(status.st_mode) && hash_contents(file, contents));
+	if (file >= 0) {
+		close(file);
+	}
+
+	if (!valid) {
+		std::cerr << "Error[LOSMIndexCache::compute_fingerprint]: Failed to read the file '" <<
+				filename << "'." << std::endl;
+		throw LOSMException();
+	}
+
+	LOSMFileFingerprint fingerprint;
+	fingerprint.size = status.st_size;
+	fingerprint.modified = (long long)status.st_mtim.tv_sec * 1000000000ll + status.st_mtim.tv_nsec;
+	fingerprint.device = status.st_dev;
+	fingerprint.inode = status.st_ino;
+	fingerprint.contents = contents;
+
+	return fingerprint;
+}
+
+std::shared_ptr<const LOSMGraph> LOSMIndexCache::build_graph(std::shared_ptr<const LOSM> losm,
+		const LOSMFileFingerprint fingerprints[3], std::string filename) const
+{
+	std::shared_ptr<const LOSMGraph> graph(new LOSMGraph(losm));
+
+	// Failing to write the cache only costs the next process the time to load the files again.
+	save_graph(*graph, fingerprints, filename);
+
+	return graph;
+}
+
+std::shared_ptr<const LOSMGraph> LOSMIndexCache::restore_graph(std::shared_ptr<const LOSM> losm,
+		const LOSMFileFingerprint fingerprints[3], std::string filename) const
+{
+	int file = open(filename.c_str(), O_RDONLY);
+	if (file < 0) {
+		return nullptr;
+	}
+
+	struct stat status;
+	size_t headerSize = sizeof(CACHE_MAGIC) + 3 * sizeof(LOSMFileFingerprint) + sizeof(uint64_t);
+
+	if (fstat(file, &status) != 0 || (size_t)status.st_size < headerSize) {
+		close(file);
+		return nullptr;
+	}
+
+	size_t size = status.st_size;
+	void *data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+
+	if (data == MAP_FAILED) {
+		return nullptr;
+	}
+
+	// The graph keeps the mapping alive, since its arrays view it.
+	std::shared_ptr<const void> memory(data, [size](const void *mapping) { munmap((void *)mapping, size); });
+
+	// The saved fingerprints must match in full, not just in the hash naming the file. The metadata
+	// is compared first, as it rules out most stale cache files.
+	const char *bytes = (const char *)data;
+	LOSMFileFingerprint saved[3];
+	uint64_t graphOffset = 0;
+
+	std::memcpy(saved, bytes + sizeof(CACHE_MAGIC), sizeof(saved));
+	std::memcpy(&graphOffset, bytes + sizeof(CACHE_MAGIC) + sizeof(saved), sizeof(graphOffset));
+
+	bool valid = (std::memcmp(bytes, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0 && graphOffset >= headerSize &&
+			graphOffset <= size);
+	for (unsigned int i = 0; i < 3 && valid; i++) {
+		valid = (saved[i].size == fingerprints[i].size && saved[i].modified == fingerprints[i].modified &&
+				saved[i].device == fingerprints[i].device && saved[i].inode == fingerprints[i].inode &&
+				saved[i].contents == fingerprints[i].contents);
+	}
+
+	if (!valid) {
+		return nullptr;
+	}
+
+	if (losm == nullptr) {
+		losm = restore_losm(bytes + headerSize, graphOffset - headerSize);
+		if (losm == nullptr) {
+			return nullptr;
+		}
+	}
+
+	try {
+		return std::shared_ptr<const LOSMGraph>(new LOSMGraph(losm, memory, bytes + graphOffset, size - graphOffset));
+	} catch (const LOSMException &err) {
+		return nullptr;
+	}
+}
+
+bool LOSMIndexCache::save_graph(const LOSMGraph &graph, const LOSMFileFingerprint fingerprints[3],
+		std::string filename) const
+{
+	std::stringstream temporaryFilename;
+	temporaryFilename << filename << ".tmp." << getpid();
+
+	std::ofstream file(temporaryFilename.str(), std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) {
+		return false;
+	}
+
+	// The offset of the graph's indexes is only known once the LOSM object is written, and is
+	// padded so that the mapped indexes are aligned.
+	uint64_t graphOffset = 0;
+
+	file.write(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+	file.write((const char *)fingerprints, 3 * sizeof(LOSMFileFingerprint));
+	file.write((const char *)&graphOffset, sizeof(graphOffset));
+
+	save_losm(graph, file);
+
+	const char padding[8] = {0};
+	graphOffset = (uint64_t)file.tellp();
+	file.write(padding, (8 - graphOffset % 8) % 8);
+	graphOffset = (uint64_t)file.tellp();
+
+	graph.save(file);
+
+	file.seekp(sizeof(CACHE_MAGIC) + 3 * sizeof(LOSMFileFingerprint));
+	file.write((const char *)&graphOffset, sizeof(graphOffset));
+	file.close();
+
+	if (file.fail() || std::rename(temporaryFilename.str().c_str(), filename.c_str()) != 0) {
+		std::remove(temporaryFilename.str().c_str());
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Read a value from a saved LOSM object, if it does not run past the end.
+ * @param	current	The position of the value. This will be modified to follow it.
+ * @param	end		The end of the saved LOSM object.
+ * @param	value	The value. This will be modified.
+ * @return	True if the value was read, false otherwise.
+ */
+template <typename T>
+static bool read_value(const char *&current, const char *end, T &value)
+{
+	if ((size_t)(end - current) < sizeof(T)) {
+		return false;
+	}
+
+	std::memcpy(&value, current, sizeof(T));
+	current += sizeof(T);
+
+	return true;
+}
+
+/**
+ * Read a string, preceded by its length, from a saved LOSM object, if it does not run past the end.
+ * @param	current	The position of the string. This will be modified to follow it.
+ * @param	end		The end of the saved LOSM object.
+ * @param	value	The string. This will be modified.
+ * @return	True if the string was read, false otherwise.
+ */
+static bool read_string(const char *&current, const char *end, std::string &value)
+{
+	uint32_t length = 0;
+	if (!read_value(current, end, length) || (size_t)(end - current) < length) {
+		return false;
+	}
+
+	value.assign(current, length);
+	current += length;
+
+	return true;
+}
+
+/**
+ * Write a value of a saved LOSM object.
+ * @param	value	The value.
+ * @param	stream	The stream to write the value to.
+ */
+template <typename T>
+static void write_value(const T &value, std::ostream &stream)
+{
+	stream.write((const char *)&value, sizeof(T));
+}
+
+/**
+ * Write a string of a saved LOSM object, preceded by its length.
+ * @param	value	The string.
+ * @param	stream	The stream to write the string to.
+ */
+static void write_string(const std::string &value, std::ostream &stream)
+{
+	write_value((uint32_t)value.size(), stream);
+	stream.write(value.data(), value.size());
+}
+
+std::shared_ptr<const LOSM> LOSMIndexCache::restore_losm(const char *data, size_t size)
+{
+	const char *current = data;
+	const char *end = data + size;
+
+	uint32_t counts[3];
+	if (!read_value(current, end, counts)) {
+		return nullptr;
+	}
+
+	std::vector<const LOSMNode *> nodes;
+	std::vector<const LOSMEdge *> edges;
+	std::vector<const LOSMLandmark *> landmarks;
+
+	// Each node takes at least 20 bytes, so a corrupt count cannot reserve more than the data.
+	bool valid = (counts[0] <= size / 20);
+	if (valid) {
+		nodes.reserve(counts[0]);
+	}
+
+	for (uint32_t i = 0; i < counts[0] && valid; i++) {
+		uint64_t uid = 0;
+		int32_t x = 0, y = 0;
+		uint32_t degree = 0;
+
+		valid = (read_value(current, end, uid) && read_value(current, end, x) && read_value(current, end, y) &&
+				read_value(current, end, degree));
+		if (valid) {
+			nodes.push_back(new LOSMNode(uid, fixed_point_to_degrees(x), fixed_point_to_degrees(y), degree));
+		}
+	}
+
+	for (uint32_t i = 0; i < counts[1] && valid; i++) {
+		uint32_t n1 = 0, n2 = 0, speedLimit = 0, lanes = 0;
+		float distance = 0.0f;
+		std::string name;
+
+		valid = (read_value(current, end, n1) && read_value(current, end, n2) && read_value(current, end, distance) &&
+				read_value(current, end, speedLimit) && read_value(current, end, lanes) &&
+				read_string(current, end, name) && n1 < nodes.size() && n2 < nodes.size());
+		if (valid) {
+			edges.push_back(new LOSMEdge(nodes[n1], nodes[n2], name, distance, speedLimit, lanes));
+		}
+	}
+
+	for (uint32_t i = 0; i < counts[2] && valid; i++) {
+		uint64_t uid = 0;
+		int32_t x = 0, y = 0;
+		std::string name;
+
+		valid = (read_value(current, end, uid) && read_value(current, end, x) && read_value(current, end, y) &&
+				read_string(current, end, name));
+		if (valid) {
+			landmarks.push_back(new LOSMLandmark(uid, fixed_point_to_degrees(x), fixed_point_to_degrees(y), name));
+		}
+	}
+
+	// Only the padding which aligns the graph's indexes may follow, and the LOSM object only owns
+	// the objects once it is created.
+	if (!valid || end - current >= 8) {
+		for (const LOSMNode *node : nodes) {
+			delete node;
+		}
+		for (const LOSMEdge *edge : edges) {
+			delete edge;
+		}
+		for (const LOSMLandmark *landmark : landmarks) {
+			delete landmark;
+		}
+		return nullptr;
+	}
+
+	return std::shared_ptr<const LOSM>(new LOSM(nodes, edges, landmarks));
+}
+
+void LOSMIndexCache::save_losm(const LOSMGraph &graph, std::ostream &stream)
+{
+	std::shared_ptr<const LOSM> losm = graph.get_losm();
+
+	const std::vector<const LOSMNode *> &nodes = losm->get_nodes();
+	const std::vector<const LOSMEdge *> &edges = losm->get_edges();
+	const std::vector<const LOSMLandmark *> &landmarks = losm->get_landmarks();
+
+	uint32_t counts[3] = {(uint32_t)nodes.size(), (uint32_t)edges.size(), (uint32_t)landmarks.size()};
+	write_value(counts, stream);
+
+	for (const LOSMNode *node : nodes) {
+		write_value((uint64_t)node->get_uid(), stream);
+		write_value((int32_t)node->get_fixed_x(), stream);
+		write_value((int32_t)node->get_fixed_y(), stream);
+		write_value((uint32_t)node->get_degree(), stream);
+	}
+
+	const unsigned int *edgeNodes = graph.get_edge_nodes_array();
+
+	for (unsigned int i = 0; i < edges.size(); i++) {
+		write_value((uint32_t)edgeNodes[2 * i], stream);
+		write_value((uint32_t)edgeNodes[2 * i + 1], stream);
+		write_value(edges[i]->get_distance(), stream);
+		write_value((uint32_t)edges[i]->get_speed_limit(), stream);
+		write_value((uint32_t)edges[i]->get_lanes(), stream);
+		write_string(edges[i]->get_name(), stream);
+	}
+
+	for (const LOSMLandmark *landmark : landmarks) {
+		write_value((uint64_t)landmark->get_uid(), stream);
+		write_value((int32_t)landmark->get_fixed_x(), stream);
+		write_value((int32_t)landmark->get_fixed_y(), stream);
+		write_string(landmark->get_name(), stream);
+	}
+}
+
+std::string LOSMIndexCache::get_cache_filename(const LOSMFileFingerprint fingerprints[3]) const
+{
+	uint64_t hash = 0;
+	for (unsigned int i = 0; i < 3; i++) {
+		hash = mix_hash(hash, fingerprints[i].size);
+		hash = mix_hash(hash, fingerprints[i].modified);
+		hash = mix_hash(hash, fingerprints[i].device);
+		hash = mix_hash(hash, fingerprints[i].inode);
+		hash = mix_hash(hash, fingerprints[i].contents);
+	}
+
+	std::stringstream filename;
+	filename << directory << "/" << std::hex << std::setw(16) << std::setfill('0') << hash << ".graph";
+
+	return filename.str();
+}
@@ -0,0 +1,595 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "../include/losm_instrumentation.h"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+/**
+ * A span sampled for the trace.
+ */
+struct LOSMSpan {
+	/**
+	 * The operation.
+	 */
+	LOSMOperation operation;
+
+	/**
+	 * The time at which it started, and its duration (in nanoseconds).
+	 */
+	uint64_t start;
+	uint64_t duration;
+
+	/**
+	 * The identifier of the thread which ran it.
+	 */
+	unsigned int thread;
+};
+
+/**
+ * The latencies and spans recorded by one thread.
+ */
+struct LOSMThreadData {
+	/**
+	 * The identifier of the thread, in order of registration from one.
+	 */
+	unsigned int id;
+
+	/**
+	 * The bucket counts, number, sum, smallest, and largest of the latencies of each operation.
+	 * Only the owning thread records them, so relaxed loads and stores suffice.
+	 */
+	std::atomic<uint64_t> counts[LOSM_NUM_OPERATIONS][LOSMHistogram::NUM_BUCKETS];
+	std::atomic<uint64_t> numbers[LOSM_NUM_OPERATIONS];
+	std::atomic<uint64_t> totals[LOSM_NUM_OPERATIONS];
+	std::atomic<uint64_t> mins[LOSM_NUM_OPERATIONS];
+	std::atomic<uint64_t> maxs[LOSM_NUM_OPERATIONS];
+
+	/**
+	 * The reset generation to which the latencies belong. Since only the owning thread may write
+	 * them, reset() advances the global generation instead, and the owner discards the stale
+	 * latencies before it next records; until then, reads skip them.
+	 */
+	std::atomic<uint64_t> generation;
+
+	/**
+	 * The number of operations since the last sampled span.
+	 */
+	unsigned int sinceSample;
+
+	/**
+	 * The sampled spans and the number dropped, guarded by the span mutex.
+	 */
+	std::mutex spanMutex;
+	std::vector<LOSMSpan> spans;
+	uint64_t droppedSpans;
+
+	/**
+	 * Discard every latency and span.
+	 */
+	void clear();
+
+	/**
+	 * Discard every latency, but not the spans.
+	 */
+	void clear_latencies();
+
+	/**
+	 * Check if the latencies belong to the current reset generation.
+	 * @return	True if the latencies are current, false if they are awaiting the owner's discard.
+	 */
+	bool is_current() const;
+};
+
+/**
+ * The data of every live thread, and the totals of the threads which have exited.
+ */
+struct LOSMInstrumentationRegistry {
+	std::mutex mutex;
+	std::vector<LOSMThreadData *> threads;
+	LOSMThreadData *retired;
+	unsigned int numThreads;
+};
+
+/**
+ * Get the registry. It is never destroyed, since threads may exit after static destructors run.
+ * @return	The registry.
+ */
+static LOSMInstrumentationRegistry &get_registry()
+{
+	static LOSMInstrumentationRegistry *registry = nullptr;
+	static std::once_flag created;
+
+	std::call_once(created, []() {
+		registry = new LOSMInstrumentationRegistry();
+		registry->retired = new LOSMThreadData();
+		registry->retired->id = 0;
+		registry->retired->generation = 0;
+		registry->retired->sinceSample = 0;
+		registry->retired->clear();
+		registry->numThreads = 0;
+	});
+
+	return *registry;
+}
+
+/**
+ * Add to a counter which only the calling thread writes.
+ * @param	counter		The counter.
+ * @param	value		The value to add.
+ */
+static inline void add_relaxed(std::atomic<uint64_t> &counter, uint64_t value)
+{
+	counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+static std::atomic<bool> instrumentationEnabled(false);
+static std::atomic<unsigned int> samplingInterval(0);
+static std::atomic<uint64_t> resetGeneration(0);
+
+static const char *OPERATION_NAMES[LOSM_NUM_OPERATIONS] = {
+	"get_neighbors", "find_node_index", "find_nearest_node", "find_nearest_edge", "search",
+	"search_time_dependent", "search_bounded", "find_lexicographic_route", "find_k_shortest_routes",
+	"find_alternative_routes"
+};
+
+void LOSMThreadData::clear()
+{
+	clear_latencies();
+
+	std::lock_guard<std::mutex> lock(spanMutex);
+	spans.clear();
+	droppedSpans = 0;
+}
+
+void LOSMThreadData::clear_latencies()
+{
+	for (unsigned int i = 0; i < LOSM_NUM_OPERATIONS; i++) {
+		for (unsigned int j = 0; j < LOSMHistogram::NUM_BUCKETS; j++) {
+			counts[i][j].store(0, std::memory_order_relaxed);
+		}
+		numbers[i].store(0, std::memory_order_relaxed);
+		totals[i].store(0, std::memory_order_relaxed);
+		mins[i].store(std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed);
+		maxs[i].store(0, std::memory_order_relaxed);
+	}
+}
+
+bool LOSMThreadData::is_current() const
+{
+	return (generation.load(std::memory_order_acquire) == resetGeneration.load(std::memory_order_relaxed));
+}
+
+/**
+ * The owner of a thread's data, which folds it into the registry's totals when the thread exits.
+ */
+struct LOSMThreadDataOwner {
+	LOSMThreadData *data;
+
+	LOSMThreadDataOwner() : data(nullptr) { }
+
+	~LOSMThreadDataOwner()
+	{
+		if (data == nullptr) {
+			return;
+		}
+
+		LOSMInstrumentationRegistry &registry = get_registry();
+		std::lock_guard<std::mutex> lock(registry.mutex);
+
+		LOSMThreadData *retired = registry.retired;
+		// Latencies from before a reset which the thread never discarded are stale.
+		if (data->is_current()) {
+			for (unsigned int i = 0; i < LOSM_NUM_OPERATIONS; i++) {
+				for (unsigned int j = 0; j < LOSMHistogram::NUM_BUCKETS; j++) {
+					add_relaxed(retired->counts[i][j], data->counts[i][j].load(std::memory_order_relaxed));
+				}
+				add_relaxed(retired->numbers[i], data->numbers[i].load(std::memory_order_relaxed));
+				add_relaxed(retired->totals[i], data->totals[i].load(std::memory_order_relaxed));
+				retired->mins[i].store(std::min(retired->mins[i].load(std::memory_order_relaxed),
+						data->mins[i].load(std::memory_order_relaxed)), std::memory_order_relaxed);
+				retired->maxs[i].store(std::max(retired->maxs[i].load(std::memory_order_relaxed),
+						data->maxs[i].load(std::memory_order_relaxed)), std::memory_order_relaxed);
+			}
+		}
+
+		{
+			std::lock_guard<std::mutex> spanLock(data->spanMutex);
+			std::lock_guard<std::mutex> retiredLock(retired->spanMutex);
+			retired->spans.insert(retired->spans.end(), data->spans.begin(), data->spans.end());
+			retired->droppedSpans += data->droppedSpans;
+		}
+
+		registry.threads.erase(std::find(registry.threads.begin(), registry.threads.end(), data));
+		delete data;
+	}
+};
+
+/**
+ * Get the data of the calling thread, registering it on first use.
+ * @return	The data of the calling thread.
+ */
+static LOSMThreadData &get_thread_data()
+{
+	static thread_local LOSMThreadDataOwner owner;
+
+	if (owner.data == nullptr) {
+		LOSMInstrumentationRegistry &registry = get_registry();
+		std::lock_guard<std::mutex> lock(registry.mutex);
+
+		owner.data = new LOSMThreadData();
+		owner.data->id = ++registry.numThreads;
+		owner.data->generation = resetGeneration.load(std::memory_order_relaxed);
+		owner.data->sinceSample = 0;
+		owner.data->clear();
+		registry.threads.push_back(owner.data);
+	}
+
+	return *owner.data;
+}
+
+LOSMHistogram::LOSMHistogram()
+{
+	clear();
+}
+
+LOSMHistogram::~LOSMHistogram()
+{ }
+
+void LOSMHistogram::record(uint64_t value)
+{
+	counts[get_bucket(value)]++;
+	count++;
+	total += value;
+	min = std::min(min, value);
+	max = std::max(max, value);
+}
+
+void LOSMHistogram::merge(const LOSMHistogram &other)
+{
+	for (unsigned int i = 0; i < NUM_BUCKETS; i++) {
+		counts[i] += other.counts[i];
+	}
+	count += other.count;
+	total += other.total;
+	min = std::min(min, other.min);
+	max = std::max(max, other.max);
+}
+
+void LOSMHistogram::clear()
+{
+	std::fill(counts, counts + NUM_BUCKETS, 0);
+	count = 0;
+	total = 0;
+	min = std::numeric_limits<uint64_t>::max();
+	max = 0;
+}
+
+uint64_t LOSMHistogram::get_count() const
+{
+	return count;
+}
+
+uint64_t LOSMHistogram::get_min() const
+{
+	return (count > 0) ? min : 0;
+}
+
+uint64_t LOSMHistogram::get_max() const
+{
+	return max;
+}
+
+double LOSMHistogram::get_mean() const
+{
+	return (count > 0) ? (double)total / count : 0.0;
+}
+
+uint64_t LOSMHistogram::get_percentile(double percentile) const
+{
+	if (count == 0) {
+		return 0;
+	}
+
+	double rank = std::ceil(std::min(100.0, std::max(0.0, percentile)) / 100.0 * count);
+	uint64_t target = std::max((uint64_t)1, (uint64_t)rank);
+	uint64_t cumulative = 0;
+
+	for (unsigned int i = 0; i < NUM_BUCKETS; i++) {
+		cumulative += counts[i];
+		if (cumulative >= target) {
+			return std::min(get_bucket_max(i), max);
+		}
+	}
+
+	return max;
+}
+
+unsigned int LOSMHistogram::get_bucket(uint64_t value)
+{
+	if (value < (1u << SUB_BUCKET_BITS)) {
+		return (unsigned int)value;
+	}
+
+	unsigned int exponent = 0;
+	for (uint64_t remaining = value >> 1; remaining > 0; remaining >>= 1) {
+		exponent++;
+	}
+
+	if (exponent >= 48) {
+		return NUM_BUCKETS - 1;
+	}
+
+	// Each power of two from 2^SUB_BUCKET_BITS is a group of buckets, indexed by the bits
+	// following the leading one.
+	unsigned int group = exponent - SUB_BUCKET_BITS + 1;
+	unsigned int sub = (unsigned int)(value >> (exponent - SUB_BUCKET_BITS)) & ((1u << SUB_BUCKET_BITS) - 1);
+	return (group << SUB_BUCKET_BITS) + sub;
+}
+
+uint64_t LOSMHistogram::get_bucket_max(unsigned int bucket)
+{
+	if (bucket < (1u << SUB_BUCKET_BITS)) {
+		return bucket;
+	}
+
+	unsigned int group = bucket >> SUB_BUCKET_BITS;
+	uint64_t sub = bucket & ((1u << SUB_BUCKET_BITS) - 1);
+	uint64_t lower = (((uint64_t)1 << SUB_BUCKET_BITS) + sub) << (group - 1);
+	return lower + ((uint64_t)1 << (group - 1)) - 1;
+}
+
+bool LOSMInstrumentation::is_compiled()
+{
+#ifdef LOSM_INSTRUMENTATION
+	return true;
+#else
+	return false;
+#endif
+}
+
+void LOSMInstrumentation::set_enabled(bool enabled)
+{
+	instrumentationEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool LOSMInstrumentation::is_enabled()
+{
+	return instrumentationEnabled.load(std::memory_order_relaxed);
+}
+
+void LOSMInstrumentation::set_sampling_interval(unsigned int interval)
+{
+	samplingInterval.store(interval, std::memory_order_relaxed);
+}
+
+const char *LOSMInstrumentation::get_operation_name(LOSMOperation operation)
+{
+	return OPERATION_NAMES[(unsigned int)operation];
+}
+
+void LOSMInstrumentation::get_histogram(LOSMOperation operation, LOSMHistogram &result)
+{
+	unsigned int i = (unsigned int)operation;
+	result.clear();
+
+	LOSMInstrumentationRegistry &registry = get_registry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+
+	std::vector<LOSMThreadData *> sources(registry.threads);
+	sources.push_back(registry.retired);
+
+	for (LOSMThreadData *data : sources) {
+		if (!data->is_current()) {
+			continue;
+		}
+
+		for (unsigned int j = 0; j < LOSMHistogram::NUM_BUCKETS; j++) {
+			result.counts[j] += data->counts[i][j].load(std::memory_order_relaxed);
+		}
+		result.count += data->numbers[i].load(std::memory_order_relaxed);
+		result.total += data->totals[i].load(std::memory_order_relaxed);
+		result.min = std::min(result.min, data->mins[i].load(std::memory_order_relaxed));
+		result.max = std::max(result.max, data->maxs[i].load(std::memory_order_relaxed));
+	}
+}
+
+uint64_t LOSMInstrumentation::get_num_dropped_spans()
+{
+	LOSMInstrumentationRegistry &registry = get_registry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+
+	std::vector<LOSMThreadData *> sources(registry.threads);
+	sources.push_back(registry.retired);
+
+	uint64_t dropped = 0;
+	for (LOSMThreadData *data : sources) {
+		std::lock_guard<std::mutex> spanLock(data->spanMutex);
+		dropped += data->droppedSpans;
+	}
+
+	return dropped;
+}
+
+void LOSMInstrumentation::reset()
+{
+	LOSMInstrumentationRegistry &registry = get_registry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+
+	// The latencies of live threads are theirs alone to write, so they discard them on their next
+	// record; the spans are guarded by a mutex and may be discarded here.
+	uint64_t generation = resetGeneration.load(std::memory_order_relaxed) + 1;
+	resetGeneration.store(generation, std::memory_order_relaxed);
+
+	for (LOSMThreadData *data : registry.threads) {
+		std::lock_guard<std::mutex> spanLock(data->spanMutex);
+		data->spans.clear();
+		data->droppedSpans = 0;
+	}
+
+	registry.retired->clear();
+	registry.retired->generation.store(generation, std::memory_order_relaxed);
+}
+
+void LOSMInstrumentation::report(std::ostream &stream)
+{
+	stream << std::left << std::setw(26) << "operation" << std::right << std::setw(12) << "count" <<
+			std::setw(12) << "mean (us)" << std::setw(12) << "p50 (us)" << std::setw(12) << "p90 (us)" <<
+			std::setw(12) << "p99 (us)" << std::setw(12) << "max (us)" << std::endl;
+
+	LOSMHistogram histogram;
+	for (unsigned int i = 0; i < LOSM_NUM_OPERATIONS; i++) {
+		get_histogram((LOSMOperation)i, histogram);
+		if (histogram.get_count() == 0) {
+			continue;
+		}
+
+		stream << std::left << std::setw(26) << OPERATION_NAMES[i] << std::right << std::setw(12) <<
+				histogram.get_count() << std::fixed << std::setprecision(2) <<
+				std::setw(12) << histogram.get_mean() / 1000.0 <<
+				std::setw(12) << histogram.get_percentile(50.0) / 1000.0 <<
+				std::setw(12) << histogram.get_percentile(90.0) / 1000.0 <<
+				std::setw(12) << histogram.get_percentile(99.0) / 1000.0 <<
+				std::setw(12) << histogram.get_max() / 1000.0 << std::endl;
+	}
+
+	uint64_t dropped = get_num_dropped_spans();
+	if (dropped > 0) {
+		stream << "Spans dropped because a thread's buffer was full: " << dropped << "." << std::endl;
+	}
+}
+
+void LOSMInstrumentation::write_trace(std::ostream &stream)
+{
+	std::vector<LOSMSpan> spans;
+	std::vector<unsigned int> threadIds;
+
+	{
+		LOSMInstrumentationRegistry &registry = get_registry();
+		std::lock_guard<std::mutex> lock(registry.mutex);
+
+		std::vector<LOSMThreadData *> sources(registry.threads);
+		sources.push_back(registry.retired);
+
+		for (LOSMThreadData *data : sources) {
+			std::lock_guard<std::mutex> spanLock(data->spanMutex);
+			spans.insert(spans.end(), data->spans.begin(), data->spans.end());
+		}
+	}
+
+	std::sort(spans.begin(), spans.end(), [](const LOSMSpan &a, const LOSMSpan &b) {
+		return a.start < b.start || (a.start == b.start && a.duration > b.duration);
+	});
+
+	for (const LOSMSpan &span : spans) {
+		threadIds.push_back(span.thread);
+	}
+	std::sort(threadIds.begin(), threadIds.end());
+	threadIds.erase(std::unique(threadIds.begin(), threadIds.end()), threadIds.end());
+
+	// Timestamps are in microseconds, with nanosecond precision.
+	stream << "{\"traceEvents\":[";
+
+	bool first = true;
+	for (unsigned int thread : threadIds) {
+		stream << (first ? "" : ",") << std::endl << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" <<
+				thread << ",\"args\":{\"name\":\"losm thread " << thread << "\"}}";
+		first = false;
+	}
+
+	for (const LOSMSpan &span : spans) {
+		stream << (first ? "" : ",") << std::endl << "{\"name\":\"" << OPERATION_NAMES[(unsigned int)span.operation] <<
+				"\",\"cat\":\"losm\",\"ph\":\"X\",\"pid\":1,\"tid\":" << span.thread <<
+				",\"ts\":" << span.start / 1000 << "." << std::setfill('0') << std::setw(3) << span.start % 1000 <<
+				",\"dur\":" << span.duration / 1000 << "." << std::setw(3) << span.duration % 1000 <<
+				std::setfill(' ') << "}";
+		first = false;
+	}
+
+	stream << std::endl << "],\"displayTimeUnit\":\"ns\"}" << std::endl;
+}
+
+uint64_t LOSMInstrumentation::get_time()
+{
+	static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void LOSMInstrumentation::record(LOSMOperation operation, uint64_t start, uint64_t duration)
+{
+	LOSMThreadData &data = get_thread_data();
+	unsigned int i = (unsigned int)operation;
+
+	uint64_t generation = resetGeneration.load(std::memory_order_relaxed);
+	if (data.generation.load(std::memory_order_relaxed) != generation) {
+		data.clear_latencies();
+		data.generation.store(generation, std::memory_order_release);
+	}
+
+	add_relaxed(data.counts[i][LOSMHistogram::get_bucket(duration)], 1);
+	add_relaxed(data.numbers[i], 1);
+	add_relaxed(data.totals[i], duration);
+	if (duration < data.mins[i].load(std::memory_order_relaxed)) {
+		data.mins[i].store(duration, std::memory_order_relaxed);
+	}
+	if (duration > data.maxs[i].load(std::memory_order_relaxed)) {
+		data.maxs[i].store(duration, std::memory_order_relaxed);
+	}
+
+	unsigned int interval = samplingInterval.load(std::memory_order_relaxed);
+	if (interval == 0 || ++data.sinceSample < interval) {
+		return;
+	}
+	data.sinceSample = 0;
+
+	std::lock_guard<std::mutex> lock(data.spanMutex);
+	if (data.spans.size() < MAX_SPANS) {
+		data.spans.push_back(LOSMSpan{operation, start, duration, data.id});
+	} else {
+		data.droppedSpans++;
+	}
+}
+
+LOSMInstrumentationScope::LOSMInstrumentationScope(LOSMOperation operation) : operation(operation),
+		active(LOSMInstrumentation::is_enabled()), start(0)
+{
+	if (active) {
+		start = LOSMInstrumentation::get_time();
+	}
+}
+
+LOSMInstrumentationScope::~LOSMInstrumentationScope()
+{
+	if (active) {
+		LOSMInstrumentation::record(operation, start, LOSMInstrumentation::get_time() - start);
+	}
+}
@@ -29,11 +29,11 @@
 #include <iostream>
 #include <fstream>
 
-LOSMLandmark::LOSMLandmark(unsigned long uid, float x, float y, std::string name)
+LOSMLandmark::LOSMLandmark(unsigned long uid, double x, double y, std::string name)
 {
 	this->uid = uid;
-	this->x = x;
-	this->y = y;
+	this->x = degrees_to_fixed_point(x);
+	this->y = degrees_to_fixed_point(y);
 	this->name = name;
 }
 
@@ -47,10 +47,20 @@ unsigned long LOSMLandmark::get_uid() const
 
 float LOSMLandmark::get_x() const
 {
-	return x;
+	return (float)fixed_point_to_degrees(x);
 }
 
 float LOSMLandmark::get_y() const
+{
+	return (float)fixed_point_to_degrees(y);
+}
+
+int LOSMLandmark::get_fixed_x() const
+{
+	return x;
+}
+
+int LOSMLandmark::get_fixed_y() const
 {
 	return y;
 }
@@ -99,7 +109,7 @@ void LOSMLandmark::load(std::string filename, std::vector<const LOSMLandmark *>
         }
 
 		// Attempt to parse the x coordinate.
-        float landmarkX = 0.0f;
+        double landmarkX = 0.0;
 		try {
 			landmarkX = std::stod(items[1]);
         } catch (const std::exception &err) {
@@ -110,7 +120,7 @@ void LOSMLandmark::load(std::string filename, std::vector<const LOSMLandmark *>
         }
 
 		// Attempt to parse the y coordinate.
-        float landmarkY = 0.0f;
+        double landmarkY = 0.0;
 		try {
 			landmarkY = std::stod(items[2]);
         } catch (const std::exception &err) {
@@ -123,6 +133,14 @@ void LOSMLandmark::load(std::string filename, std::vector<const LOSMLandmark *>
 		// Attempt to parse the landmark's name.
         std::string landmarkName = items[3];
 
+		// Reject coordinates which are not a latitude and longitude.
+		if (!is_valid_coordinate(landmarkX, landmarkY)) {
+			std::cerr << "Error[LOSMLandmark::load]: The coordinate (" << items[1] << ", " << items[2] <<
+					") is not a valid latitude and longitude on line " << row << " in file '" << filename << "'." << std::endl;
+			error = true;
+			break;
+		}
+
         // Now, with the variables loaded, we may create the landmark and add it.
         result.push_back(new LOSMLandmark(landmarkUID, landmarkX, landmarkY, landmarkName));
 
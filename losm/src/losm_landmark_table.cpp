@@ -0,0 +1,343 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "../include/losm_landmark_table.h"
+#include "../include/losm_exception.h"
+#include "../include/losm_thread_pool.h"
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <cstring>
+#include <cmath>
+
+const char LOSMLandmarkTable::SAVED_MAGIC[8] = {'L', 'O', 'S', 'M', 'L', 'T', '0', '1'};
+
+/**
+ * The header at the start of a saved file. It is followed by the unique identifier of each
+ * landmark, the attachment of each landmark, and the upper triangle of each cost matrix.
+ */
+struct LOSMLandmarkTableHeader {
+	char magic[8];
+	uint32_t numLandmarks;
+	uint32_t numNodes;
+	uint32_t numEdges;
+	uint32_t padding;
+};
+
+LOSMLandmarkTable::LOSMLandmarkTable(std::shared_ptr<const LOSMGraph> graph, unsigned int numThreads) :
+		graph(graph)
+{
+	index_landmarks();
+
+	unsigned int numLandmarks = landmarks.size();
+
+	std::vector<float> x(numLandmarks);
+	std::vector<float> y(numLandmarks);
+	for (unsigned int i = 0; i < numLandmarks; i++) {
+		x[i] = landmarks[i]->get_x();
+		y[i] = landmarks[i]->get_y();
+	}
+
+	attachments.resize(numLandmarks);
+	LOSMEdgeIndex index(graph);
+	index.find_nearest_edges(numLandmarks, x.data(), y.data(), attachments.data());
+
+	size_t numPairs = (size_t)numLandmarks * (numLandmarks - (numLandmarks > 0)) / 2;
+	costs[0].assign(numPairs, INFINITY);
+	costs[1].assign(numPairs, INFINITY);
+
+	// Each task is one source and type of cost; the scratch space of a worker is allocated on
+	// its first task and reused for the rest.
+	LOSMThreadPool pool(numThreads);
+	std::vector<Search> searches(pool.get_num_threads() + 1);
+
+	pool.parallel_for(2 * numLandmarks, [this, &searches](unsigned int task, unsigned int worker) {
+		compute_costs(task / 2, (task % 2 == 0) ? LOSMCost::DISTANCE : LOSMCost::TRAVEL_TIME, searches[worker]);
+	});
+}
+
+LOSMLandmarkTable::LOSMLandmarkTable(std::shared_ptr<const LOSMGraph> graph, std::string filename) :
+		graph(graph)
+{
+	index_landmarks();
+
+	std::ifstream file(filename, std::ios::binary);
+	if (!file.is_open()) {
+		std::cerr << "Error[LOSMLandmarkTable::LOSMLandmarkTable]: Failed to open the file '" << filename << "'." << std::endl;
+		throw LOSMException();
+	}
+
+	LOSMLandmarkTableHeader header;
+	file.read((char *)&header, sizeof(header));
+
+	if (!file || std::memcmp(header.magic, SAVED_MAGIC, sizeof(SAVED_MAGIC)) != 0) {
+		std::cerr << "Error[LOSMLandmarkTable::LOSMLandmarkTable]: The file '" << filename << "' is not valid." << std::endl;
+		throw LOSMException();
+	}
+
+	if (header.numLandmarks != landmarks.size() || header.numNodes != graph->get_num_nodes() ||
+			header.numEdges != graph->get_num_edges()) {
+		std::cerr << "Error[LOSMLandmarkTable::LOSMLandmarkTable]: The file '" << filename << "' is of a different map." << std::endl;
+		throw LOSMException();
+	}
+
+	unsigned int numLandmarks = header.numLandmarks;
+
+	std::vector<uint64_t> uids(numLandmarks);
+	file.read((char *)uids.data(), numLandmarks * sizeof(uint64_t));
+	for (unsigned int i = 0; i < numLandmarks && file; i++) {
+		if (uids[i] != landmarks[i]->get_uid()) {
+			std::cerr << "Error[LOSMLandmarkTable::LOSMLandmarkTable]: The file '" << filename << "' is of a different map." << std::endl;
+			throw LOSMException();
+		}
+	}
+
+	attachments.resize(numLandmarks);
+	file.read((char *)attachments.data(), numLandmarks * sizeof(LOSMEdgeProjection));
+
+	size_t numPairs = (size_t)numLandmarks * (numLandmarks - (numLandmarks > 0)) / 2;
+	for (unsigned int i = 0; i < 2; i++) {
+		costs[i].resize(numPairs);
+		file.read((char *)costs[i].data(), numPairs * sizeof(float));
+	}
+
+	// The file must end exactly after the costs, and every attachment must be on an edge.
+	bool valid = (bool)file && file.peek() == std::ifstream::traits_type::eof();
+	for (unsigned int i = 0; i < numLandmarks && valid; i++) {
+		valid = (attachments[i].edge < header.numEdges || attachments[i].edge == LOSMGraph::INVALID_INDEX);
+	}
+
+	if (!valid) {
+		std::cerr << "Error[LOSMLandmarkTable::LOSMLandmarkTable]: The file '" << filename << "' is not valid." << std::endl;
+		throw LOSMException();
+	}
+}
+
+LOSMLandmarkTable::~LOSMLandmarkTable()
+{ }
+
+std::shared_ptr<const LOSMGraph> LOSMLandmarkTable::get_graph() const
+{
+	return graph;
+}
+
+unsigned int LOSMLandmarkTable::get_num_landmarks() const
+{
+	return landmarks.size();
+}
+
+const LOSMLandmark *LOSMLandmarkTable::get_landmark(unsigned int index) const
+{
+	return landmarks[index];
+}
+
+unsigned int LOSMLandmarkTable::get_landmark_index(const LOSMLandmark *landmark) const
+{
+	std::unordered_map<const LOSMLandmark *, unsigned int>::const_iterator alpha = landmarkIndices.find(landmark);
+	if (alpha == landmarkIndices.end()) {
+		std::cerr << "Error[LOSMLandmarkTable::get_landmark_index]: The landmark is not in the graph." << std::endl;
+		throw LOSMException();
+	}
+
+	return alpha->second;
+}
+
+const LOSMEdgeProjection &LOSMLandmarkTable::get_attachment(unsigned int index) const
+{
+	return attachments[index];
+}
+
+float LOSMLandmarkTable::get_cost(unsigned int source, unsigned int target, LOSMCost cost) const
+{
+	if (source == target) {
+		return 0.0f;
+	}
+
+	const std::vector<float> &table = costs[cost == LOSMCost::DISTANCE ? 0 : 1];
+	return (source < target) ? table[get_pair(source, target)] : table[get_pair(target, source)];
+}
+
+float LOSMLandmarkTable::get_cost(const LOSMLandmark *source, const LOSMLandmark *target, LOSMCost cost) const
+{
+	return get_cost(get_landmark_index(source), get_landmark_index(target), cost);
+}
+
+size_t LOSMLandmarkTable::get_memory_usage() const
+{
+	return attachments.size() * sizeof(LOSMEdgeProjection) + (costs[0].size() + costs[1].size()) * sizeof(float);
+}
+
+void LOSMLandmarkTable::save(std::string filename) const
+{
+	std::ofstream file(filename, std::ios::binary);
+	if (!file.is_open()) {
+		std::cerr << "Error[LOSMLandmarkTable::save]: Failed to open the file '" << filename << "'." << std::endl;
+		throw LOSMException();
+	}
+
+	LOSMLandmarkTableHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, SAVED_MAGIC, sizeof(SAVED_MAGIC));
+	header.numLandmarks = landmarks.size();
+	header.numNodes = graph->get_num_nodes();
+	header.numEdges = graph->get_num_edges();
+
+	std::vector<uint64_t> uids(landmarks.size());
+	for (unsigned int i = 0; i < landmarks.size(); i++) {
+		uids[i] = landmarks[i]->get_uid();
+	}
+
+	file.write((const char *)&header, sizeof(header));
+	file.write((const char *)uids.data(), uids.size() * sizeof(uint64_t));
+	file.write((const char *)attachments.data(), attachments.size() * sizeof(LOSMEdgeProjection));
+	file.write((const char *)costs[0].data(), costs[0].size() * sizeof(float));
+	file.write((const char *)costs[1].data(), costs[1].size() * sizeof(float));
+
+	if (!file) {
+		std::cerr << "Error[LOSMLandmarkTable::save]: Failed to write the file '" << filename << "'." << std::endl;
+		throw LOSMException();
+	}
+}
+
+void LOSMLandmarkTable::index_landmarks()
+{
+	if (graph == nullptr) {
+		std::cerr << "Error[LOSMLandmarkTable::index_landmarks]: The graph is null." << std::endl;
+		throw LOSMException();
+	}
+
+	landmarks = graph->get_losm()->get_landmarks();
+	for (unsigned int i = 0; i < landmarks.size(); i++) {
+		landmarkIndices[landmarks[i]] = i;
+	}
+}
+
+void LOSMLandmarkTable::compute_costs(unsigned int source, LOSMCost cost, Search &search)
+{
+	const LOSMEdgeProjection &start = attachments[source];
+	if (start.edge == LOSMGraph::INVALID_INDEX) {
+		return;
+	}
+
+	unsigned int numLandmarks = landmarks.size();
+	const unsigned int *edgeNodes = graph->get_edge_nodes_array();
+
+	if (search.costs.empty()) {
+		search.costs.assign(graph->get_num_nodes(), INFINITY);
+		search.targets.assign(graph->get_num_nodes(), 0);
+	}
+
+	// Mark the ends of the later landmarks' edges, so the search stops once they are settled. The
+	// stamp is unique to this search, so marks left by earlier searches need not be cleared.
+	unsigned int stamp = 2 * source + (cost == LOSMCost::DISTANCE ? 1 : 2);
+	unsigned int remaining = 0;
+
+	for (unsigned int target = source + 1; target < numLandmarks; target++) {
+		unsigned int edge = attachments[target].edge;
+		if (edge == LOSMGraph::INVALID_INDEX) {
+			continue;
+		}
+
+		for (unsigned int i = 0; i < 2; i++) {
+			unsigned int node = edgeNodes[2 * edge + i];
+			if (search.targets[node] != stamp) {
+				search.targets[node] = stamp;
+				remaining++;
+			}
+		}
+	}
+
+	std::greater<std::pair<float, unsigned int> > compare;
+	std::vector<std::pair<float, unsigned int> > &heap = search.heap;
+
+	auto relax = [&search, &heap, &compare](unsigned int node, float nodeCost) {
+		if (nodeCost < search.costs[node]) {
+			if (search.costs[node] == INFINITY) {
+				search.touched.push_back(node);
+			}
+			search.costs[node] = nodeCost;
+
+			heap.push_back(std::make_pair(nodeCost, node));
+			std::push_heap(heap.begin(), heap.end(), compare);
+		}
+	};
+
+	float startCost = graph->get_edge_cost(start.edge, cost);
+	relax(edgeNodes[2 * start.edge], start.fraction * startCost);
+	relax(edgeNodes[2 * start.edge + 1], (1.0f - start.fraction) * startCost);
+
+	while (!heap.empty() && remaining > 0) {
+		std::pop_heap(heap.begin(), heap.end(), compare);
+		float nodeCost = heap.back().first;
+		unsigned int node = heap.back().second;
+		heap.pop_back();
+
+		if (nodeCost > search.costs[node]) {
+			continue;
+		}
+
+		if (search.targets[node] == stamp) {
+			search.targets[node] = 0;
+			remaining--;
+		}
+
+		for (unsigned int slot = graph->get_adjacency_begin(node); slot < graph->get_adjacency_end(node); slot++) {
+			relax(graph->get_adjacent_node(slot), nodeCost + graph->get_edge_cost(graph->get_adjacent_edge(slot), cost));
+		}
+	}
+
+	// A route enters a target's edge from either end, or runs along it if both are on one edge.
+	std::vector<float> &table = costs[cost == LOSMCost::DISTANCE ? 0 : 1];
+
+	for (unsigned int target = source + 1; target < numLandmarks; target++) {
+		const LOSMEdgeProjection &end = attachments[target];
+		if (end.edge == LOSMGraph::INVALID_INDEX) {
+			continue;
+		}
+
+		float endCost = graph->get_edge_cost(end.edge, cost);
+		float best = std::min(search.costs[edgeNodes[2 * end.edge]] + end.fraction * endCost,
+				search.costs[edgeNodes[2 * end.edge + 1]] + (1.0f - end.fraction) * endCost);
+		if (end.edge == start.edge) {
+			best = std::min(best, std::fabs(start.fraction - end.fraction) * startCost);
+		}
+
+		table[get_pair(source, target)] = best;
+	}
+
+	for (unsigned int node : search.touched) {
+		search.costs[node] = INFINITY;
+	}
+	search.touched.clear();
+	heap.clear();
+}
+
+size_t LOSMLandmarkTable::get_pair(unsigned int i, unsigned int j) const
+{
+	size_t n = landmarks.size();
+	return (size_t)i * (2 * n - i - 1) / 2 + (j - i - 1);
+}
@@ -0,0 +1,288 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "../include/losm_loader.h"
+#include "../include/losm_utilities.h"
+
+#include <fstream>
+#include <thread>
+#include <unordered_map>
+
+LOSMLoader::LOSMLoader()
+{
+	cancelled = std::make_shared<std::atomic<bool> >(false);
+}
+
+LOSMLoader::~LOSMLoader()
+{ }
+
+std::future<LOSMLoadResult> LOSMLoader::load(std::string nodesFilename, std::string edgesFilename,
+		std::string landmarksFilename, ProgressCallback callback)
+{
+	std::shared_ptr<std::atomic<bool> > flag;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		flag = cancelled;
+	}
+
+	std::shared_ptr<std::promise<LOSMLoadResult> > promise(new std::promise<LOSMLoadResult>());
+
+	std::thread([promise, flag, nodesFilename, edgesFilename, landmarksFilename, callback]() {
+		try {
+			promise->set_value(load_files(nodesFilename, edgesFilename, landmarksFilename, callback, flag.get()));
+		} catch (...) {
+			promise->set_exception(std::current_exception());
+		}
+	}).detach();
+
+	return promise->get_future();
+}
+
+void LOSMLoader::cancel()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	cancelled->store(true);
+	cancelled = std::make_shared<std::atomic<bool> >(false);
+}
+
+LOSMLoadResult LOSMLoader::load_files(std::string nodesFilename, std::string edgesFilename,
+		std::string landmarksFilename, ProgressCallback callback, const std::atomic<bool> *cancelled)
+{
+	LOSMLoadResult result;
+	result.status = LOSMLoadStatus::LOADED;
+
+	std::vector<const LOSMNode *> nodes;
+	std::vector<const LOSMEdge *> edges;
+	std::vector<const LOSMLandmark *> landmarks;
+	std::unordered_map<unsigned long, const LOSMNode *> uids;
+
+	LineParser parseNode = [&](const std::vector<std::string> &items, LOSMLoadError &error) {
+		unsigned long uid = 0, degree = 0;
+		double x = 0.0, y = 0.0;
+
+		if (!parse_integer(items, 0, "uid", uid, error) || !parse_float(items, 1, "x", x, error) ||
+				!parse_float(items, 2, "y", y, error) || !parse_integer(items, 3, "degree", degree, error) ||
+				!check_coordinate(items, x, y, error)) {
+			return false;
+		}
+
+		// Edges refer to nodes by unique identifier, so a duplicate would make them ambiguous.
+		if (uids.find(uid) != uids.end()) {
+			error.field = "uid";
+			error.message = "A node with UID '" + items[0] + "' was already loaded.";
+			return false;
+		}
+
+		const LOSMNode *node = new LOSMNode(uid, x, y, degree);
+		nodes.push_back(node);
+		uids[uid] = node;
+
+		return true;
+	};
+
+	LineParser parseEdge = [&](const std::vector<std::string> &items, LOSMLoadError &error) {
+		const LOSMNode *endpoints[2] = {nullptr, nullptr};
+
+		for (unsigned int i = 0; i < 2; i++) {
+			const char *field = (i == 0) ? "uid1" : "uid2";
+
+			unsigned long uid = 0;
+			if (!parse_integer(items, i, field, uid, error)) {
+				return false;
+			}
+
+			std::unordered_map<unsigned long, const LOSMNode *>::const_iterator node = uids.find(uid);
+			if (node == uids.end()) {
+				error.field = field;
+				error.message = "Failed to find a node with UID '" + items[i] + "'.";
+				return false;
+			}
+			endpoints[i] = node->second;
+		}
+
+		double distance = 0.0;
+		unsigned long speedLimit = 0, lanes = 0;
+
+		if (!parse_float(items, 3, "distance", distance, error) ||
+				!parse_integer(items, 4, "speed_limit", speedLimit, error) ||
+				!parse_integer(items, 5, "lanes", lanes, error)) {
+			return false;
+		}
+
+		edges.push_back(new LOSMEdge(endpoints[0], endpoints[1], items[2], distance, speedLimit, lanes));
+
+		return true;
+	};
+
+	LineParser parseLandmark = [&](const std::vector<std::string> &items, LOSMLoadError &error) {
+		unsigned long uid = 0;
+		double x = 0.0, y = 0.0;
+
+		if (!parse_integer(items, 0, "uid", uid, error) || !parse_float(items, 1, "x", x, error) ||
+				!parse_float(items, 2, "y", y, error) || !check_coordinate(items, x, y, error)) {
+			return false;
+		}
+
+		landmarks.push_back(new LOSMLandmark(uid, x, y, items[3]));
+
+		return true;
+	};
+
+	result.status = read_file(LOSMLoadFile::NODES, nodesFilename, 4, parseNode, callback, cancelled, result.error);
+	if (result.status == LOSMLoadStatus::LOADED) {
+		result.status = read_file(LOSMLoadFile::EDGES, edgesFilename, 6, parseEdge, callback, cancelled, result.error);
+	}
+	if (result.status == LOSMLoadStatus::LOADED) {
+		result.status = read_file(LOSMLoadFile::LANDMARKS, landmarksFilename, 4, parseLandmark, callback,
+				cancelled, result.error);
+	}
+
+	if (result.status != LOSMLoadStatus::LOADED) {
+		for (const LOSMNode *node : nodes) {
+			delete node;
+		}
+		for (const LOSMEdge *edge : edges) {
+			delete edge;
+		}
+		for (const LOSMLandmark *landmark : landmarks) {
+			delete landmark;
+		}
+		return result;
+	}
+
+	result.losm = std::make_shared<LOSM>(nodes, edges, landmarks);
+
+	return result;
+}
+
+bool LOSMLoader::parse_integer(const std::vector<std::string> &items, unsigned int index, const char *field,
+		unsigned long &value, LOSMLoadError &error)
+{
+	if (!parse_unsigned(items[index], value)) {
+		error.field = field;
+		error.message = "Failed to convert '" + items[index] + "' to an unsigned integer.";
+		return false;
+	}
+
+	return true;
+}
+
+bool LOSMLoader::parse_float(const std::vector<std::string> &items, unsigned int index, const char *field,
+		double &value, LOSMLoadError &error)
+{
+	if (!parse_double(items[index], value)) {
+		error.field = field;
+		error.message = "Failed to convert '" + items[index] + "' to a float.";
+		return false;
+	}
+
+	return true;
+}
+
+bool LOSMLoader::check_coordinate(const std::vector<std::string> &items, double x, double y, LOSMLoadError &error)
+{
+	if (is_valid_coordinate(x, y)) {
+		return true;
+	}
+
+	error.field = (x >= -90.0 && x <= 90.0) ? "y" : "x";
+	error.message = "The coordinate (" + items[1] + ", " + items[2] + ") is not a valid latitude and longitude.";
+
+	return false;
+}
+
+LOSMLoadStatus LOSMLoader::read_file(LOSMLoadFile file, std::string filename, unsigned int numItems,
+		LineParser parser, ProgressCallback callback, const std::atomic<bool> *cancelled, LOSMLoadError &error)
+{
+	error.file = file;
+	error.filename = filename;
+	error.line = 0;
+	error.field.clear();
+	error.message.clear();
+
+	std::ifstream stream(filename, std::ios::binary);
+	if (!stream.is_open()) {
+		error.message = "Failed to open the file.";
+		return LOSMLoadStatus::FAILED;
+	}
+
+	LOSMLoadProgress progress;
+	progress.file = file;
+	progress.filename = filename;
+	progress.bytesProcessed = 0;
+	progress.linesProcessed = 0;
+	progress.finished = false;
+
+	stream.seekg(0, std::ios::end);
+	progress.totalBytes = (unsigned long long)stream.tellg();
+	stream.seekg(0, std::ios::beg);
+
+	std::string line;
+
+	while (std::getline(stream, line)) {
+		progress.linesProcessed++;
+		progress.bytesProcessed += line.size() + 1;
+
+		std::vector<std::string> items = split_string_by_comma(line);
+
+		if (items.size() != numItems) {
+			error.line = progress.linesProcessed;
+			error.message = "Expected " + std::to_string(numItems) + " comma-delimited items, but found " +
+					std::to_string(items.size()) + ".";
+			return LOSMLoadStatus::FAILED;
+		}
+
+		if (!parser(items, error)) {
+			error.line = progress.linesProcessed;
+			return LOSMLoadStatus::FAILED;
+		}
+
+		if (progress.linesProcessed % PROGRESS_INTERVAL == 0) {
+			if (cancelled != nullptr && cancelled->load()) {
+				return LOSMLoadStatus::CANCELLED;
+			}
+			if (callback) {
+				callback(progress);
+			}
+		}
+	}
+
+	if (stream.bad()) {
+		error.line = progress.linesProcessed + 1;
+		error.message = "Failed to read the file.";
+		return LOSMLoadStatus::FAILED;
+	}
+
+	if (cancelled != nullptr && cancelled->load()) {
+		return LOSMLoadStatus::CANCELLED;
+	}
+
+	progress.bytesProcessed = progress.totalBytes;
+	progress.finished = true;
+	if (callback) {
+		callback(progress);
+	}
+
+	return LOSMLoadStatus::LOADED;
+}
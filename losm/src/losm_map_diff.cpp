@@ -0,0 +1,540 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "../include/losm_map_diff.h"
+#include "../include/losm_exception.h"
+#include "../include/losm_utilities.h"
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <future>
+#include <cstdlib>
+#include <cstring>
+
+const size_t LOSMMapDiffer::DEFAULT_MEMORY_BUDGET;
+const unsigned int LOSMMapDiffer::PARTITIONS_PER_THREAD;
+
+/**
+ * Scramble a 64-bit value, with the output function of SplitMix64, so that partitions are even
+ * however the unique identifiers were assigned.
+ * @param	value	The value.
+ * @return	The scrambled value.
+ */
+static uint64_t mix(uint64_t value)
+{
+	value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+	return value ^ (value >> 31);
+}
+
+/**
+ * Merge the records of one partition of two versions into added, removed, and modified sets.
+ * Records with the same key are matched identical ones first, then in order.
+ * @param	before		The records of the old version. This will be sorted.
+ * @param	after		The records of the new version. This will be sorted.
+ * @param	added		The changes of records only in the new version. This will be modified.
+ * @param	removed		The changes of records only in the old version. This will be modified.
+ * @param	modified	The changes of records in both versions which differ. This will be modified.
+ */
+template <typename T, typename Change>
+static void diff_records(std::vector<T> &before, std::vector<T> &after, std::vector<Change> &added,
+		std::vector<Change> &removed, std::vector<Change> &modified)
+{
+	std::sort(before.begin(), before.end());
+	std::sort(after.begin(), after.end());
+
+	std::vector<const T *> unmatchedBefore;
+	std::vector<const T *> unmatchedAfter;
+
+	size_t i = 0;
+	size_t j = 0;
+
+	while (i < before.size() || j < after.size()) {
+		if (j == after.size() || (i < before.size() && before[i].get_key() < after[j].get_key())) {
+			removed.push_back(before[i].get_change(0));
+			i++;
+			continue;
+		}
+
+		if (i == before.size() || after[j].get_key() < before[i].get_key()) {
+			added.push_back(after[j].get_change(0));
+			j++;
+			continue;
+		}
+
+		std::pair<unsigned long, unsigned long> key = before[i].get_key();
+		size_t lastBefore = i;
+		size_t lastAfter = j;
+		while (lastBefore < before.size() && before[lastBefore].get_key() == key) {
+			lastBefore++;
+		}
+		while (lastAfter < after.size() && after[lastAfter].get_key() == key) {
+			lastAfter++;
+		}
+
+		// Both ranges are sorted by their attributes, so identical records meet in one merge.
+		unmatchedBefore.clear();
+		unmatchedAfter.clear();
+
+		while (i < lastBefore && j < lastAfter) {
+			if (before[i] < after[j]) {
+				unmatchedBefore.push_back(&before[i++]);
+			} else if (after[j] < before[i]) {
+				unmatchedAfter.push_back(&after[j++]);
+			} else {
+				i++;
+				j++;
+			}
+		}
+		while (i < lastBefore) {
+			unmatchedBefore.push_back(&before[i++]);
+		}
+		while (j < lastAfter) {
+			unmatchedAfter.push_back(&after[j++]);
+		}
+
+		size_t numPairs = std::min(unmatchedBefore.size(), unmatchedAfter.size());
+		for (size_t k = 0; k < numPairs; k++) {
+			modified.push_back(unmatchedAfter[k]->get_change(unmatchedBefore[k]->compare(*unmatchedAfter[k])));
+		}
+		for (size_t k = numPairs; k < unmatchedBefore.size(); k++) {
+			removed.push_back(unmatchedBefore[k]->get_change(0));
+		}
+		for (size_t k = numPairs; k < unmatchedAfter.size(); k++) {
+			added.push_back(unmatchedAfter[k]->get_change(0));
+		}
+	}
+}
+
+/**
+ * Open a file of a map for reading.
+ * @param	filename		The file.
+ * @param	file			The stream of the file. This will be modified.
+ * @throw	LOSMException	The file could not be opened.
+ */
+static void open_file(const std::string &filename, std::ifstream &file)
+{
+	file.open(filename);
+	if (!file.is_open()) {
+		std::cerr << "Error[LOSMMapDiffer::read_files]: Failed to open the file '" << filename << "'." << std::endl;
+		throw LOSMException();
+	}
+}
+
+/**
+ * Check that a file of a map was read to its end.
+ * @param	filename		The file.
+ * @param	file			The stream of the file.
+ * @throw	LOSMException	The file could not be read.
+ */
+static void check_file(const std::string &filename, const std::ifstream &file)
+{
+	if (file.bad()) {
+		std::cerr << "Error[LOSMMapDiffer::read_files]: Failed to read the file '" << filename << "'." << std::endl;
+		throw LOSMException();
+	}
+}
+
+/**
+ * Report an invalid line of a file of a map.
+ * @param	filename		The file.
+ * @param	lineNumber		The number of the line.
+ * @throw	LOSMException	Always.
+ */
+static void fail_line(const std::string &filename, unsigned long long lineNumber)
+{
+	std::cerr << "Error[LOSMMapDiffer::read_files]: Failed to parse line " << lineNumber <<
+			" of the file '" << filename << "'." << std::endl;
+	throw LOSMException();
+}
+
+std::pair<unsigned long, unsigned long> LOSMMapDiffer::NodeRecord::get_key() const
+{
+	return std::make_pair(uid, 0UL);
+}
+
+unsigned int LOSMMapDiffer::NodeRecord::compare(const NodeRecord &other) const
+{
+	unsigned int attributes = 0;
+	if (x != other.x || y != other.y) {
+		attributes |= LOSM_NODE_CHANGED_COORDINATES;
+	}
+	if (degree != other.degree) {
+		attributes |= LOSM_NODE_CHANGED_DEGREE;
+	}
+	return attributes;
+}
+
+LOSMNodeChange LOSMMapDiffer::NodeRecord::get_change(unsigned int attributes) const
+{
+	LOSMNodeChange change;
+	change.uid = uid;
+	change.attributes = attributes;
+	return change;
+}
+
+bool LOSMMapDiffer::NodeRecord::operator<(const NodeRecord &other) const
+{
+	if (uid != other.uid) {
+		return (uid < other.uid);
+	}
+	if (x != other.x) {
+		return (x < other.x);
+	}
+	if (y != other.y) {
+		return (y < other.y);
+	}
+	return (degree < other.degree);
+}
+
+std::pair<unsigned long, unsigned long> LOSMMapDiffer::EdgeRecord::get_key() const
+{
+	return std::make_pair(uid1, uid2);
+}
+
+unsigned int LOSMMapDiffer::EdgeRecord::compare(const EdgeRecord &other) const
+{
+	unsigned int attributes = 0;
+	if (nameHash != other.nameHash) {
+		attributes |= LOSM_EDGE_CHANGED_NAME;
+	}
+	if (distance != other.distance) {
+		attributes |= LOSM_EDGE_CHANGED_DISTANCE;
+	}
+	if (speedLimit != other.speedLimit) {
+		attributes |= LOSM_EDGE_CHANGED_SPEED_LIMIT;
+	}
+	if (lanes != other.lanes) {
+		attributes |= LOSM_EDGE_CHANGED_LANES;
+	}
+	return attributes;
+}
+
+LOSMEdgeChange LOSMMapDiffer::EdgeRecord::get_change(unsigned int attributes) const
+{
+	LOSMEdgeChange change;
+	change.uid1 = uid1;
+	change.uid2 = uid2;
+	change.attributes = attributes;
+	return change;
+}
+
+bool LOSMMapDiffer::EdgeRecord::operator<(const EdgeRecord &other) const
+{
+	if (uid1 != other.uid1) {
+		return (uid1 < other.uid1);
+	}
+	if (uid2 != other.uid2) {
+		return (uid2 < other.uid2);
+	}
+	if (nameHash != other.nameHash) {
+		return (nameHash < other.nameHash);
+	}
+	if (distance != other.distance) {
+		return (distance < other.distance);
+	}
+	if (speedLimit != other.speedLimit) {
+		return (speedLimit < other.speedLimit);
+	}
+	return (lanes < other.lanes);
+}
+
+LOSMMapDiffer::Pass::Pass(unsigned int first, unsigned int numPartitions, unsigned int total) :
+		first(first), numPartitions(numPartitions), total(total)
+{
+	for (unsigned int version = 0; version < 2; version++) {
+		nodes[version].resize(numPartitions);
+		edges[version].resize(numPartitions);
+	}
+}
+
+unsigned int LOSMMapDiffer::Pass::find_node_partition(unsigned long uid) const
+{
+	unsigned int partition = (unsigned int)(mix(uid) % total);
+	if (partition < first || partition >= first + numPartitions) {
+		return LOSMGraph::INVALID_INDEX;
+	}
+	return partition - first;
+}
+
+unsigned int LOSMMapDiffer::Pass::find_edge_partition(unsigned long uid1, unsigned long uid2) const
+{
+	unsigned int partition = (unsigned int)(mix(mix(std::min(uid1, uid2)) + std::max(uid1, uid2)) % total);
+	if (partition < first || partition >= first + numPartitions) {
+		return LOSMGraph::INVALID_INDEX;
+	}
+	return partition - first;
+}
+
+LOSMMapDiffer::LOSMMapDiffer(size_t memoryBudget, unsigned int numThreads) :
+		memoryBudget(std::max((size_t)1, memoryBudget))
+{
+	pool.reset(new LOSMThreadPool(numThreads));
+}
+
+LOSMMapDiffer::~LOSMMapDiffer()
+{
+	pool.reset();
+}
+
+void LOSMMapDiffer::compare(const LOSM &before, const LOSM &after, LOSMMapDiff &result)
+{
+	size_t size = (before.get_nodes().size() + after.get_nodes().size()) * sizeof(NodeRecord) +
+			(before.get_edges().size() + after.get_edges().size()) * sizeof(EdgeRecord);
+
+	compare(size, [&before, &after](unsigned int version, Pass &pass) {
+		const LOSM &losm = (version == 0) ? before : after;
+
+		for (const LOSMNode *node : losm.get_nodes()) {
+			unsigned int partition = pass.find_node_partition(node->get_uid());
+			if (partition == LOSMGraph::INVALID_INDEX) {
+				continue;
+			}
+
+			NodeRecord record;
+			record.uid = node->get_uid();
+			record.x = node->get_fixed_x();
+			record.y = node->get_fixed_y();
+			record.degree = node->get_degree();
+			pass.nodes[version][partition].push_back(record);
+		}
+
+		for (const LOSMEdge *edge : losm.get_edges()) {
+			unsigned long uid1 = edge->get_node_1()->get_uid();
+			unsigned long uid2 = edge->get_node_2()->get_uid();
+
+			unsigned int partition = pass.find_edge_partition(uid1, uid2);
+			if (partition == LOSMGraph::INVALID_INDEX) {
+				continue;
+			}
+
+			EdgeRecord record;
+			record.uid1 = std::min(uid1, uid2);
+			record.uid2 = std::max(uid1, uid2);
+			record.nameHash = hash_name(edge->get_name());
+			record.distance = edge->get_distance();
+			record.speedLimit = edge->get_speed_limit();
+			record.lanes = edge->get_lanes();
+			pass.edges[version][partition].push_back(record);
+		}
+	}, result);
+}
+
+void LOSMMapDiffer::compare(std::string nodesBefore, std::string edgesBefore, std::string nodesAfter,
+		std::string edgesAfter, LOSMMapDiff &result)
+{
+	// Each line becomes a record of about its own length, so the files' sizes bound the records'.
+	size_t size = 0;
+	for (const std::string &filename : {nodesBefore, edgesBefore, nodesAfter, edgesAfter}) {
+		std::ifstream file(filename, std::ios::binary | std::ios::ate);
+		if (!file.is_open()) {
+			std::cerr << "Error[LOSMMapDiffer::compare]: Failed to open the file '" << filename << "'." << std::endl;
+			throw LOSMException();
+		}
+		size += (size_t)file.tellg();
+	}
+
+	compare(size, [&](unsigned int version, Pass &pass) {
+		if (version == 0) {
+			read_files(nodesBefore, edgesBefore, version, pass);
+		} else {
+			read_files(nodesAfter, edgesAfter, version, pass);
+		}
+	}, result);
+}
+
+void LOSMMapDiffer::compare(size_t size, Reader read, LOSMMapDiff &result)
+{
+	result = LOSMMapDiff();
+
+	unsigned int partitionsPerPass = PARTITIONS_PER_THREAD * pool->get_num_threads();
+	unsigned int numPasses = (unsigned int)std::max((size_t)1, (size + memoryBudget - 1) / memoryBudget);
+	unsigned int numPartitions = partitionsPerPass * numPasses;
+
+	std::vector<LOSMMapDiff> diffs(partitionsPerPass);
+
+	for (unsigned int i = 0; i < numPasses; i++) {
+		Pass pass(i * partitionsPerPass, partitionsPerPass, numPartitions);
+
+		// Read the two versions at the same time; they fill separate partitions.
+		std::future<void> readBefore = pool->submit([&read, &pass]() {
+			read(0, pass);
+		});
+
+		try {
+			read(1, pass);
+		} catch (...) {
+			readBefore.wait();
+			throw;
+		}
+		readBefore.get();
+
+		pool->parallel_for(partitionsPerPass, [&pass, &diffs](unsigned int partition, unsigned int /* worker */) {
+			LOSMMapDiff &diff = diffs[partition];
+			diff = LOSMMapDiff();
+
+			diff_records(pass.nodes[0][partition], pass.nodes[1][partition], diff.addedNodes,
+					diff.removedNodes, diff.modifiedNodes);
+			diff_records(pass.edges[0][partition], pass.edges[1][partition], diff.addedEdges,
+					diff.removedEdges, diff.modifiedEdges);
+
+			// Release the partition as soon as it is merged.
+			for (unsigned int version = 0; version < 2; version++) {
+				std::vector<NodeRecord>().swap(pass.nodes[version][partition]);
+				std::vector<EdgeRecord>().swap(pass.edges[version][partition]);
+			}
+		});
+
+		for (const LOSMMapDiff &diff : diffs) {
+			result.addedNodes.insert(result.addedNodes.end(), diff.addedNodes.begin(), diff.addedNodes.end());
+			result.removedNodes.insert(result.removedNodes.end(), diff.removedNodes.begin(), diff.removedNodes.end());
+			result.modifiedNodes.insert(result.modifiedNodes.end(), diff.modifiedNodes.begin(), diff.modifiedNodes.end());
+			result.addedEdges.insert(result.addedEdges.end(), diff.addedEdges.begin(), diff.addedEdges.end());
+			result.removedEdges.insert(result.removedEdges.end(), diff.removedEdges.begin(), diff.removedEdges.end());
+			result.modifiedEdges.insert(result.modifiedEdges.end(), diff.modifiedEdges.begin(), diff.modifiedEdges.end());
+		}
+	}
+
+	// The partitions are in hash order, so sort each set by unique identifiers.
+	auto nodeLess = [](const LOSMNodeChange &a, const LOSMNodeChange &b) {
+		return (a.uid < b.uid);
+	};
+	auto edgeLess = [](const LOSMEdgeChange &a, const LOSMEdgeChange &b) {
+		return (a.uid1 < b.uid1 || (a.uid1 == b.uid1 && a.uid2 < b.uid2));
+	};
+
+	std::sort(result.addedNodes.begin(), result.addedNodes.end(), nodeLess);
+	std::sort(result.removedNodes.begin(), result.removedNodes.end(), nodeLess);
+	std::sort(result.modifiedNodes.begin(), result.modifiedNodes.end(), nodeLess);
+	std::sort(result.addedEdges.begin(), result.addedEdges.end(), edgeLess);
+	std::sort(result.removedEdges.begin(), result.removedEdges.end(), edgeLess);
+	std::sort(result.modifiedEdges.begin(), result.modifiedEdges.end(), edgeLess);
+}
+
+void LOSMMapDiffer::read_files(const std::string &nodesFilename, const std::string &edgesFilename,
+		unsigned int version, Pass &pass)
+{
+	std::string line;
+	unsigned long long lineNumber = 0;
+
+	std::ifstream nodesFile;
+	open_file(nodesFilename, nodesFile);
+
+	while (std::getline(nodesFile, line)) {
+		lineNumber++;
+
+		// Skip the lines of other passes after parsing only the unique identifier. A line which
+		// does not even start with one is parsed in full, so that it is reported.
+		char *end = nullptr;
+		unsigned long uid = std::strtoul(line.c_str(), &end, 10);
+		if (end != line.c_str() && pass.find_node_partition(uid) == LOSMGraph::INVALID_INDEX) {
+			continue;
+		}
+
+		std::vector<std::string> items = split_string_by_comma(line);
+		if (items.empty()) {
+			continue;
+		}
+
+		unsigned long degree = 0;
+		double x = 0.0, y = 0.0;
+
+		if (items.size() != 4 || !parse_unsigned(items[0], uid) || !parse_double(items[1], x) ||
+				!parse_double(items[2], y) || !parse_unsigned(items[3], degree)) {
+			fail_line(nodesFilename, lineNumber);
+		}
+
+		unsigned int partition = pass.find_node_partition(uid);
+		if (partition == LOSMGraph::INVALID_INDEX) {
+			continue;
+		}
+
+		NodeRecord record;
+		record.uid = uid;
+		record.x = degrees_to_fixed_point(x);
+		record.y = degrees_to_fixed_point(y);
+		record.degree = (unsigned int)degree;
+		pass.nodes[version][partition].push_back(record);
+	}
+
+	check_file(nodesFilename, nodesFile);
+
+	lineNumber = 0;
+
+	std::ifstream edgesFile;
+	open_file(edgesFilename, edgesFile);
+
+	while (std::getline(edgesFile, line)) {
+		lineNumber++;
+
+		char *end = nullptr;
+		unsigned long uid1 = std::strtoul(line.c_str(), &end, 10);
+		const char *comma = std::strchr(line.c_str(), ',');
+
+		if (end != line.c_str() && comma != nullptr) {
+			unsigned long uid2 = std::strtoul(comma + 1, &end, 10);
+			if (end != comma + 1 && pass.find_edge_partition(uid1, uid2) == LOSMGraph::INVALID_INDEX) {
+				continue;
+			}
+		}
+
+		std::vector<std::string> items = split_string_by_comma(line);
+		if (items.empty()) {
+			continue;
+		}
+
+		unsigned long uid2 = 0, speedLimit = 0, lanes = 0;
+		double distance = 0.0;
+
+		if (items.size() != 6 || !parse_unsigned(items[0], uid1) || !parse_unsigned(items[1], uid2) ||
+				!parse_double(items[3], distance) || !parse_unsigned(items[4], speedLimit) ||
+				!parse_unsigned(items[5], lanes)) {
+			fail_line(edgesFilename, lineNumber);
+		}
+
+		unsigned int partition = pass.find_edge_partition(uid1, uid2);
+		if (partition == LOSMGraph::INVALID_INDEX) {
+			continue;
+		}
+
+		EdgeRecord record;
+		record.uid1 = std::min(uid1, uid2);
+		record.uid2 = std::max(uid1, uid2);
+		record.nameHash = hash_name(items[2]);
+		record.distance = (float)distance;
+		record.speedLimit = (unsigned int)speedLimit;
+		record.lanes = (unsigned int)lanes;
+		pass.edges[version][partition].push_back(record);
+	}
+
+	check_file(edgesFilename, edgesFile);
+}
+
+uint64_t LOSMMapDiffer::hash_name(const std::string &name)
+{
+	uint64_t hash = 0xCBF29CE484222325ULL;
+	for (unsigned char c : name) {
+		hash = (hash ^ c) * 0x100000001B3ULL;
+	}
+	return hash;
+}
@@ -0,0 +1,228 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "../include/losm_map_handle.h"
+#include "../include/losm_exception.h"
+
+#include <iostream>
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <chrono>
+
+const unsigned int LOSMMapHandle::RECLAIM_INTERVAL;
+
+LOSMMapHandle::Reader::Reader(const LOSMMapHandle &handle) : handle(handle)
+{
+	// Start from a slot given by the thread, so that threads rarely probe the same slots.
+	unsigned int start = std::hash<std::thread::id>()(std::this_thread::get_id()) % handle.numSlots;
+
+	for (unsigned int i = 0; i < handle.numSlots; i++) {
+		slot = (start + i) % handle.numSlots;
+
+		// Announce the epoch before reading the current version, so that any version replaced
+		// after this point is retired with a later epoch and outlives this reader.
+		unsigned long long expected = 0;
+		if (handle.slots[slot].epoch.compare_exchange_strong(expected, handle.epoch.load())) {
+			version = handle.current.load();
+			return;
+		}
+	}
+
+	std::cerr << "Error[LOSMMapHandle::Reader::Reader]: All " << handle.numSlots <<
+			" reader slots are occupied." << std::endl;
+	throw LOSMException();
+}
+
+LOSMMapHandle::Reader::~Reader()
+{
+	handle.slots[slot].epoch.store(0);
+}
+
+const LOSMMapVersion &LOSMMapHandle::Reader::get_version() const
+{
+	return *version;
+}
+
+const LOSM &LOSMMapHandle::Reader::get_losm() const
+{
+	return *version->losm;
+}
+
+const LOSMGraph &LOSMMapHandle::Reader::get_graph() const
+{
+	return *version->graph;
+}
+
+LOSMMapHandle::LOSMMapHandle(std::shared_ptr<const LOSM> losm, unsigned int maxReaders)
+{
+	if (losm == nullptr) {
+		std::cerr << "Error[LOSMMapHandle::LOSMMapHandle]: The LOSM object provided was null." << std::endl;
+		throw LOSMException();
+	}
+
+	numSlots = maxReaders;
+	if (numSlots == 0) {
+		numSlots = 16 * std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	slots.reset(new Slot[numSlots]);
+	for (unsigned int i = 0; i < numSlots; i++) {
+		slots[i].epoch.store(0);
+	}
+
+	epoch.store(1);
+	numReloads.store(0);
+	stopping.store(false);
+
+	LOSMMapVersion *version = new LOSMMapVersion();
+	version->number = 1;
+	version->losm = losm;
+	version->graph = std::make_shared<const LOSMGraph>(losm);
+
+	current.store(version);
+}
+
+LOSMMapHandle::~LOSMMapHandle()
+{
+	stopping.store(true);
+
+	{
+		std::lock_guard<std::mutex> lock(reloadMutex);
+		if (worker.joinable()) {
+			worker.join();
+		}
+	}
+
+	for (const std::pair<unsigned long long, const LOSMMapVersion *> &entry : retired) {
+		delete entry.second;
+	}
+	retired.clear();
+
+	delete current.load();
+}
+
+unsigned long long LOSMMapHandle::get_version_number() const
+{
+	return epoch.load();
+}
+
+unsigned int LOSMMapHandle::get_num_retired() const
+{
+	std::lock_guard<std::mutex> lock(writerMutex);
+	return retired.size();
+}
+
+unsigned long long LOSMMapHandle::publish(std::shared_ptr<const LOSM> losm)
+{
+	if (losm == nullptr) {
+		std::cerr << "Error[LOSMMapHandle::publish]: The LOSM object provided was null." << std::endl;
+		throw LOSMException();
+	}
+
+	LOSMMapVersion *version = new LOSMMapVersion();
+	version->losm = losm;
+	version->graph = std::make_shared<const LOSMGraph>(losm);
+
+	unsigned long long number = publish_version(version);
+	reclaim();
+
+	return number;
+}
+
+std::future<unsigned long long> LOSMMapHandle::reload(std::string nodesFilename, std::string edgesFilename,
+		std::string landmarksFilename)
+{
+	std::lock_guard<std::mutex> lock(reloadMutex);
+
+	std::shared_ptr<std::promise<unsigned long long> > promise(new std::promise<unsigned long long>());
+	unsigned long long ticket = ++numReloads;
+
+	// Each reload waits for the one before it, so joining the last joins them all.
+	std::thread previous(std::move(worker));
+
+	worker = std::thread([this, promise, ticket, nodesFilename, edgesFilename, landmarksFilename](std::thread previous) {
+		if (previous.joinable()) {
+			previous.join();
+		}
+
+		try {
+			std::shared_ptr<LOSM> losm = std::make_shared<LOSM>(nodesFilename, edgesFilename, landmarksFilename);
+
+			LOSMMapVersion *version = new LOSMMapVersion();
+			version->losm = losm;
+			version->graph = std::make_shared<const LOSMGraph>(losm);
+
+			promise->set_value(publish_version(version));
+		} catch (...) {
+			promise->set_exception(std::current_exception());
+		}
+
+		// Reclaim until the replaced versions are gone, or a later reload takes over.
+		while (!reclaim() && !stopping.load() && numReloads.load() == ticket) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(RECLAIM_INTERVAL));
+		}
+	}, std::move(previous));
+
+	return promise->get_future();
+}
+
+bool LOSMMapHandle::reclaim()
+{
+	std::lock_guard<std::mutex> lock(writerMutex);
+
+	unsigned long long oldest = std::numeric_limits<unsigned long long>::max();
+	for (unsigned int i = 0; i < numSlots; i++) {
+		unsigned long long announced = slots[i].epoch.load();
+		if (announced != 0) {
+			oldest = std::min(oldest, announced);
+		}
+	}
+
+	// A version retired at an epoch may still be held by readers which announced an earlier one.
+	std::vector<std::pair<unsigned long long, const LOSMMapVersion *> > remaining;
+	for (const std::pair<unsigned long long, const LOSMMapVersion *> &entry : retired) {
+		if (entry.first <= oldest) {
+			delete entry.second;
+		} else {
+			remaining.push_back(entry);
+		}
+	}
+	retired.swap(remaining);
+
+	return retired.empty();
+}
+
+unsigned long long LOSMMapHandle::publish_version(LOSMMapVersion *version)
+{
+	std::lock_guard<std::mutex> lock(writerMutex);
+
+	const LOSMMapVersion *previous = current.load();
+	version->number = previous->number + 1;
+
+	current.store(version);
+	retired.push_back(std::make_pair(epoch.fetch_add(1) + 1, previous));
+
+	return version->number;
+}
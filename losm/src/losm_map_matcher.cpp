@@ -0,0 +1,556 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "../include/losm_map_matcher.h"
+#include "../include/losm_exception.h"
+#include "../include/losm_utilities.h"
+#include "../include/losm_distance.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+/**
+ * The budget of the searches between consecutive fixes, as a multiple of their great-circle
+ * distance, to which twice the search radius is added.
+ */
+static const float ROUTE_BUDGET_FACTOR = 2.0f;
+
+/**
+ * Divide two integers, rounding toward negative infinity.
+ * @param	numerator	The numerator.
+ * @param	denominator	The denominator, which must be positive.
+ * @return	The quotient, rounded down.
+ */
+static int floor_divide(int numerator, int denominator)
+{
+	int quotient = numerator / denominator;
+	if (numerator % denominator != 0 && numerator < 0) {
+		quotient--;
+	}
+	return quotient;
+}
+
+LOSMMapMatcher::LOSMMapMatcher(std::shared_ptr<const LOSMGraph> graph, float gpsSigma, float transitionBeta,
+		float searchRadius, unsigned int maxCandidates, unsigned int windowSize, unsigned int numThreads)
+{
+	if (graph == nullptr) {
+		std::cerr << "Error[LOSMMapMatcher::LOSMMapMatcher]: The graph provided was null." << std::endl;
+		throw LOSMException();
+	}
+
+	if (!(gpsSigma > 0.0f) || !(transitionBeta > 0.0f) || !(searchRadius > 0.0f) ||
+			maxCandidates == 0 || windowSize == 0) {
+		std::cerr << "Error[LOSMMapMatcher::LOSMMapMatcher]: The parameters must be positive." << std::endl;
+		throw LOSMException();
+	}
+
+	this->graph = graph;
+	this->gpsSigma = gpsSigma;
+	this->transitionBeta = transitionBeta;
+	this->searchRadius = searchRadius;
+	this->maxCandidates = maxCandidates;
+	this->windowSize = windowSize;
+
+	const int *x = graph->get_fixed_x_array();
+	const int *y = graph->get_fixed_y_array();
+
+	// Project with the scale of longitudes at the mean latitude, which is accurate enough
+	// within the search radius.
+	double meanX = 0.0;
+	for (unsigned int i = 0; i < graph->get_num_nodes(); i++) {
+		meanX += fixed_point_to_degrees(x[i]);
+	}
+	if (graph->get_num_nodes() > 0) {
+		meanX /= (double)graph->get_num_nodes();
+	}
+
+	double milesPerDegree = LOSM_EARTH_RADIUS_IN_MILES * M_PI / 180.0;
+	milesPerFixedX = (float)(milesPerDegree / LOSM_FIXED_POINT_SCALE);
+	milesPerFixedY = (float)(milesPerDegree * std::cos(meanX * M_PI / 180.0) / LOSM_FIXED_POINT_SCALE);
+
+	cellSizeX = std::max(1, (int)std::ceil(searchRadius / milesPerFixedX));
+	cellSizeY = std::max(1, (int)std::ceil(searchRadius / milesPerFixedY));
+
+	// Insert each edge into the cells its segment crosses, then group them by cell. Queries search
+	// the cells neighboring a fix's cell as well, which covers the search radius around the segment.
+	const unsigned int *edgeNodes = graph->get_edge_nodes_array();
+	std::vector<std::pair<long long, unsigned int> > cells;
+
+	for (unsigned int i = 0; i < graph->get_num_edges(); i++) {
+		unsigned int n1 = edgeNodes[2 * i];
+		unsigned int n2 = edgeNodes[2 * i + 1];
+
+		rasterize_segment(x[n1], y[n1], x[n2], y[n2], i, cells);
+	}
+
+	std::sort(cells.begin(), cells.end());
+
+	for (unsigned int i = 0; i < cells.size(); i++) {
+		if (i == 0 || cells[i].first != cells[i - 1].first) {
+			cellKeys.push_back(cells[i].first);
+			cellOffsets.push_back(i);
+		}
+		cellEdges.push_back(cells[i].second);
+	}
+	cellOffsets.push_back(cells.size());
+
+	pool.reset(new LOSMThreadPool(numThreads));
+
+	for (unsigned int i = 0; i < pool->get_num_threads(); i++) {
+		contexts.push_back(std::unique_ptr<LOSMQueryContext>(new LOSMQueryContext(graph)));
+	}
+}
+
+LOSMMapMatcher::~LOSMMapMatcher()
+{
+	pool.reset();
+}
+
+std::shared_ptr<const LOSMGraph> LOSMMapMatcher::get_graph() const
+{
+	return graph;
+}
+
+float LOSMMapMatcher::get_gps_sigma() const
+{
+	return gpsSigma;
+}
+
+float LOSMMapMatcher::get_transition_beta() const
+{
+	return transitionBeta;
+}
+
+float LOSMMapMatcher::get_search_radius() const
+{
+	return searchRadius;
+}
+
+unsigned int LOSMMapMatcher::get_window_size() const
+{
+	return windowSize;
+}
+
+void LOSMMapMatcher::find_candidates(const LOSMGPSFix &fix, std::vector<LOSMMatchedFix> &result) const
+{
+	result.clear();
+
+	int px = degrees_to_fixed_point(fix.x);
+	int py = degrees_to_fixed_point(fix.y);
+
+	int row = floor_divide(px, cellSizeX);
+	int column = floor_divide(py, cellSizeY);
+
+	// Cells are at least as large as the search radius, so the neighboring cells suffice.
+	std::vector<unsigned int> edges;
+
+	for (int i = row - 1; i <= row + 1; i++) {
+		for (int j = column - 1; j <= column + 1; j++) {
+			std::vector<long long>::const_iterator alpha = std::lower_bound(cellKeys.begin(), cellKeys.end(),
+					get_cell_key(i, j));
+			if (alpha == cellKeys.end() || *alpha != get_cell_key(i, j)) {
+				continue;
+			}
+
+			unsigned int cell = alpha - cellKeys.begin();
+			edges.insert(edges.end(), cellEdges.begin() + cellOffsets[cell], cellEdges.begin() + cellOffsets[cell + 1]);
+		}
+	}
+
+	std::sort(edges.begin(), edges.end());
+	edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+	const int *x = graph->get_fixed_x_array();
+	const int *y = graph->get_fixed_y_array();
+	const unsigned int *edgeNodes = graph->get_edge_nodes_array();
+
+	for (unsigned int edge : edges) {
+		unsigned int n1 = edgeNodes[2 * edge];
+		unsigned int n2 = edgeNodes[2 * edge + 1];
+
+		// Project the fix onto the segment in a local frame (in miles) centered on the fix.
+		float ax = (float)((long long)x[n1] - px) * milesPerFixedX;
+		float ay = (float)((long long)y[n1] - py) * milesPerFixedY;
+		float bx = (float)((long long)x[n2] - px) * milesPerFixedX;
+		float by = (float)((long long)y[n2] - py) * milesPerFixedY;
+
+		float dx = bx - ax;
+		float dy = by - ay;
+		float lengthSq = dx * dx + dy * dy;
+
+		float fraction = 0.0f;
+		if (lengthSq > 0.0f) {
+			fraction = std::min(1.0f, std::max(0.0f, -(ax * dx + ay * dy) / lengthSq));
+		}
+
+		float cx = ax + fraction * dx;
+		float cy = ay + fraction * dy;
+
+		LOSMMatchedFix candidate;
+		candidate.edge = edge;
+		candidate.fraction = fraction;
+		candidate.offset = std::sqrt(cx * cx + cy * cy);
+
+		if (candidate.offset <= searchRadius) {
+			result.push_back(candidate);
+		}
+	}
+
+	std::sort(result.begin(), result.end(),
+		[](const LOSMMatchedFix &a, const LOSMMatchedFix &b) {
+			return a.offset < b.offset || (a.offset == b.offset && a.edge < b.edge);
+		});
+
+	if (result.size() > maxCandidates) {
+		result.resize(maxCandidates);
+	}
+}
+
+float LOSMMapMatcher::compute_fix_distance(const LOSMGPSFix &a, const LOSMGPSFix &b) const
+{
+	return haversine_distance(degrees_to_fixed_point(a.x), degrees_to_fixed_point(a.y),
+			degrees_to_fixed_point(b.x), degrees_to_fixed_point(b.y));
+}
+
+std::future<std::vector<std::vector<LOSMMatchedFix> > > LOSMMapMatcher::match_traces(
+		const std::vector<std::vector<LOSMGPSFix> > &traces)
+{
+	std::shared_ptr<std::vector<std::vector<LOSMGPSFix> > > input(new std::vector<std::vector<LOSMGPSFix> >(traces));
+
+	return pool->run_batch<std::vector<LOSMMatchedFix> >(input->size(),
+		[this, input](unsigned int i, unsigned int worker, std::vector<LOSMMatchedFix> &matched) {
+			LOSMMapMatchSession session(*this, *contexts[worker]);
+			matched.reserve((*input)[i].size());
+
+			for (const LOSMGPSFix &fix : (*input)[i]) {
+				session.push(fix, matched);
+			}
+			session.finish(matched);
+		});
+}
+
+long long LOSMMapMatcher::get_cell_key(int row, int column)
+{
+	return (long long)(((unsigned long long)(unsigned int)row << 32) | (unsigned int)column);
+}
+
+void LOSMMapMatcher::rasterize_segment(int x1, int y1, int x2, int y2, unsigned int edge,
+		std::vector<std::pair<long long, unsigned int> > &cells) const
+{
+	if (x1 > x2) {
+		std::swap(x1, x2);
+		std::swap(y1, y2);
+	}
+
+	int firstRow = floor_divide(x1, cellSizeX);
+	int lastRow = floor_divide(x2, cellSizeX);
+
+	for (int row = firstRow; row <= lastRow; row++) {
+		// Clip the segment to the row, and find the columns of the part within it. One extra unit
+		// on each side absorbs rounding, at worst adding a cell the segment only touches.
+		double low = std::max((double)x1, (double)row * cellSizeX);
+		double high = std::min((double)x2, ((double)row + 1.0) * cellSizeX);
+
+		double yLow = y1;
+		double yHigh = y2;
+		if (x2 > x1) {
+			yLow = y1 + (double)(y2 - y1) * (low - x1) / (double)(x2 - x1);
+			yHigh = y1 + (double)(y2 - y1) * (high - x1) / (double)(x2 - x1);
+		}
+
+		double yMin = std::max((double)std::min(y1, y2), std::min(yLow, yHigh));
+		double yMax = std::min((double)std::max(y1, y2), std::max(yLow, yHigh));
+
+		int firstColumn = floor_divide((int)std::floor(yMin) - 1, cellSizeY);
+		int lastColumn = floor_divide((int)std::ceil(yMax) + 1, cellSizeY);
+
+		for (int column = firstColumn; column <= lastColumn; column++) {
+			cells.push_back(std::make_pair(get_cell_key(row, column), edge));
+		}
+	}
+}
+
+LOSMMapMatchSession::LOSMMapMatchSession(const LOSMMapMatcher &matcher)
+{
+	this->matcher = &matcher;
+	ownedContext.reset(new LOSMQueryContext(matcher.get_graph()));
+	context = ownedContext.get();
+}
+
+LOSMMapMatchSession::LOSMMapMatchSession(const LOSMMapMatcher &matcher, LOSMQueryContext &context)
+{
+	this->matcher = &matcher;
+	this->context = &context;
+}
+
+LOSMMapMatchSession::~LOSMMapMatchSession()
+{ }
+
+void LOSMMapMatchSession::push(const LOSMGPSFix &fix, std::vector<LOSMMatchedFix> &matched)
+{
+	Step step;
+	step.fix = fix;
+	matcher->find_candidates(fix, step.candidates);
+
+	// A fix far from every road is left unmatched, and splits the trace.
+	if (step.candidates.empty()) {
+		finish(matched);
+
+		LOSMMatchedFix unmatched;
+		unmatched.edge = LOSMGraph::INVALID_INDEX;
+		unmatched.fraction = 0.0f;
+		unmatched.offset = INFINITY;
+		matched.push_back(unmatched);
+		return;
+	}
+
+	if (window.empty() || !transition(step)) {
+		finish(matched);
+
+		float sigma = matcher->gpsSigma;
+		step.scores.resize(step.candidates.size());
+		step.parents.assign(step.candidates.size(), LOSMGraph::INVALID_INDEX);
+
+		for (unsigned int i = 0; i < step.candidates.size(); i++) {
+			float z = step.candidates[i].offset / sigma;
+			step.scores[i] = -0.5f * z * z;
+		}
+	}
+
+	window.push_back(std::move(step));
+
+	decide_converged(matched);
+
+	// Once the window is full, commit to the oldest fix on the currently best path.
+	if (window.size() > matcher->windowSize) {
+		unsigned int candidate = get_best_candidate();
+		for (unsigned int i = window.size() - 1; i > 0; i--) {
+			candidate = window[i].parents[candidate];
+		}
+		decide(0, candidate, matched);
+	}
+}
+
+void LOSMMapMatchSession::finish(std::vector<LOSMMatchedFix> &matched)
+{
+	if (!window.empty()) {
+		decide(window.size() - 1, get_best_candidate(), matched);
+	}
+}
+
+bool LOSMMapMatchSession::transition(Step &step)
+{
+	const Step &previous = window.back();
+	const LOSMGraph *graph = context->get_graph();
+	const unsigned int *edgeNodes = graph->get_edge_nodes_array();
+
+	unsigned int numPrevious = previous.candidates.size();
+	unsigned int numCurrent = step.candidates.size();
+
+	float greatCircle = matcher->compute_fix_distance(previous.fix, step.fix);
+	float budget = ROUTE_BUDGET_FACTOR * greatCircle + 2.0f * matcher->searchRadius;
+
+	routeDistances.assign(numPrevious * numCurrent, INFINITY);
+
+	// A route between candidates on the same edge may stay on it.
+	for (unsigned int a = 0; a < numPrevious; a++) {
+		for (unsigned int b = 0; b < numCurrent; b++) {
+			if (previous.candidates[a].edge == step.candidates[b].edge) {
+				routeDistances[a * numCurrent + b] = std::fabs(step.candidates[b].fraction -
+						previous.candidates[a].fraction) * graph->get_edge_cost(step.candidates[b].edge, LOSMCost::DISTANCE);
+			}
+		}
+	}
+
+	// Otherwise it leaves through an endpoint of the previous edge, and enters through an endpoint
+	// of the current one. Each endpoint of a live previous candidate is searched from once.
+	std::vector<unsigned int> sources;
+	for (unsigned int a = 0; a < numPrevious; a++) {
+		if (previous.scores[a] != -INFINITY) {
+			sources.push_back(edgeNodes[2 * previous.candidates[a].edge]);
+			sources.push_back(edgeNodes[2 * previous.candidates[a].edge + 1]);
+		}
+	}
+	std::sort(sources.begin(), sources.end());
+	sources.erase(std::unique(sources.begin(), sources.end()), sources.end());
+
+	for (unsigned int source : sources) {
+		context->search_bounded(source, budget, LOSMCost::DISTANCE);
+
+		for (unsigned int a = 0; a < numPrevious; a++) {
+			const LOSMMatchedFix &from = previous.candidates[a];
+			if (previous.scores[a] == -INFINITY) {
+				continue;
+			}
+
+			float fromLength = graph->get_edge_cost(from.edge, LOSMCost::DISTANCE);
+			float exit = INFINITY;
+			if (edgeNodes[2 * from.edge] == source) {
+				exit = from.fraction * fromLength;
+			}
+			if (edgeNodes[2 * from.edge + 1] == source) {
+				exit = std::min(exit, (1.0f - from.fraction) * fromLength);
+			}
+			if (exit == INFINITY) {
+				continue;
+			}
+
+			for (unsigned int b = 0; b < numCurrent; b++) {
+				const LOSMMatchedFix &to = step.candidates[b];
+				float toLength = graph->get_edge_cost(to.edge, LOSMCost::DISTANCE);
+
+				float entry1 = context->get_cost(edgeNodes[2 * to.edge]) + to.fraction * toLength;
+				float entry2 = context->get_cost(edgeNodes[2 * to.edge + 1]) + (1.0f - to.fraction) * toLength;
+
+				float &route = routeDistances[a * numCurrent + b];
+				route = std::min(route, exit + std::min(entry1, entry2));
+			}
+		}
+	}
+
+	// Combine the best transition into each candidate with its emission.
+	float sigma = matcher->gpsSigma;
+	float beta = matcher->transitionBeta;
+	float best = -INFINITY;
+
+	step.scores.assign(numCurrent, -INFINITY);
+	step.parents.assign(numCurrent, LOSMGraph::INVALID_INDEX);
+
+	for (unsigned int b = 0; b < numCurrent; b++) {
+		for (unsigned int a = 0; a < numPrevious; a++) {
+			float route = routeDistances[a * numCurrent + b];
+			if (previous.scores[a] == -INFINITY || route == INFINITY) {
+				continue;
+			}
+
+			float score = previous.scores[a] - std::fabs(route - greatCircle) / beta;
+			if (score > step.scores[b]) {
+				step.scores[b] = score;
+				step.parents[b] = a;
+			}
+		}
+
+		if (step.scores[b] != -INFINITY) {
+			float z = step.candidates[b].offset / sigma;
+			step.scores[b] -= 0.5f * z * z;
+			best = std::max(best, step.scores[b]);
+		}
+	}
+
+	if (best == -INFINITY) {
+		return false;
+	}
+
+	// Keep the scores near zero, since traces may be arbitrarily long.
+	for (unsigned int b = 0; b < numCurrent; b++) {
+		step.scores[b] -= best;
+	}
+
+	return true;
+}
+
+void LOSMMapMatchSession::decide(unsigned int last, unsigned int candidate, std::vector<LOSMMatchedFix> &matched)
+{
+	std::vector<unsigned int> path(last + 1);
+	path[last] = candidate;
+	for (unsigned int i = last; i > 0; i--) {
+		path[i - 1] = window[i].parents[path[i]];
+	}
+
+	for (unsigned int i = 0; i <= last; i++) {
+		matched.push_back(window.front().candidates[path[i]]);
+		window.pop_front();
+	}
+
+	if (window.empty()) {
+		return;
+	}
+
+	// Paths which do not pass through the decided candidate are no longer possible.
+	Step &front = window.front();
+	for (unsigned int i = 0; i < front.candidates.size(); i++) {
+		if (front.parents[i] != candidate) {
+			front.scores[i] = -INFINITY;
+		}
+		front.parents[i] = LOSMGraph::INVALID_INDEX;
+	}
+
+	for (unsigned int j = 1; j < window.size(); j++) {
+		for (unsigned int i = 0; i < window[j].candidates.size(); i++) {
+			unsigned int parent = window[j].parents[i];
+			if (parent == LOSMGraph::INVALID_INDEX || window[j - 1].scores[parent] == -INFINITY) {
+				window[j].scores[i] = -INFINITY;
+			}
+		}
+	}
+}
+
+void LOSMMapMatchSession::decide_converged(std::vector<LOSMMatchedFix> &matched)
+{
+	if (window.size() < 2) {
+		return;
+	}
+
+	// Follow the parents of every live candidate of the last step back through the window. The
+	// latest step (before the last) where they all meet is decided, along with all before it.
+	std::vector<unsigned int> current;
+	for (unsigned int i = 0; i < window.back().candidates.size(); i++) {
+		if (window.back().scores[i] != -INFINITY) {
+			current.push_back(i);
+		}
+	}
+
+	std::vector<unsigned int> parents;
+
+	for (unsigned int j = window.size() - 1; j > 0; j--) {
+		parents.clear();
+		for (unsigned int i : current) {
+			parents.push_back(window[j].parents[i]);
+		}
+		std::sort(parents.begin(), parents.end());
+		parents.erase(std::unique(parents.begin(), parents.end()), parents.end());
+
+		if (parents.size() == 1) {
+			decide(j - 1, parents[0], matched);
+			return;
+		}
+
+		current.swap(parents);
+	}
+}
+
+unsigned int LOSMMapMatchSession::get_best_candidate() const
+{
+	const Step &last = window.back();
+
+	unsigned int best = 0;
+	for (unsigned int i = 1; i < last.scores.size(); i++) {
+		if (last.scores[i] > last.scores[best]) {
+			best = i;
+		}
+	}
+
+	return best;
+}
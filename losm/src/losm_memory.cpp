@@ -0,0 +1,265 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "../include/losm_memory.h"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+// The NUMA memory policy which prefers, but does not require, the nodes given; see mbind(2).
+static const int MPOL_PREFERRED_NODES = 1;
+
+/**
+ * Read a list of NUMA nodes from sysfs, given as ranges, e.g., "0-1" or "0,2-3".
+ * @param	filename	The file, e.g., "/sys/devices/system/node/online".
+ * @param	nodes		The nodes, in increasing order. This will be modified.
+ * @return	True if the file held at least one node, false otherwise.
+ */
+static bool read_numa_node_list(const char *filename, std::vector<unsigned int> &nodes)
+{
+	std::ifstream file(filename);
+	std::string list;
+
+	nodes.clear();
+
+	if (!std::getline(file, list)) {
+		return false;
+	}
+
+	std::istringstream ranges(list);
+	std::string range;
+
+	while (std::getline(ranges, range, ',')) {
+		char *end = nullptr;
+		unsigned long first = std::strtoul(range.c_str(), &end, 10);
+		if (end == range.c_str()) {
+			continue;
+		}
+
+		unsigned long last = first;
+		if (*end == '-') {
+			last = std::strtoul(end + 1, nullptr, 10);
+		}
+
+		for (unsigned long node = first; node <= last; node++) {
+			nodes.push_back((unsigned int)node);
+		}
+	}
+
+	return !nodes.empty();
+}
+
+/**
+ * Check if allocate_storage() maps an array directly, rather than allocating it from the heap.
+ * @param	size	The number of bytes.
+ * @param	options	Where and how to allocate the memory.
+ * @return	True if the array is mapped, false otherwise.
+ */
+static bool is_mapped(size_t size, const LOSMStorageOptions &options)
+{
+	return ((options.pages != LOSMPageMode::DEFAULT || options.numaNode >= 0) && size >= LOSM_MIN_MAPPED_SIZE);
+}
+
+/**
+ * Get the length of the mapping of a directly mapped array: a multiple of the huge page size if it
+ * uses huge pages, and of the ordinary page size otherwise.
+ * @param	size	The number of bytes.
+ * @param	options	Where and how to allocate the memory.
+ * @return	The length of the mapping (in bytes).
+ */
+static size_t get_mapped_size(size_t size, const LOSMStorageOptions &options)
+{
+	size_t pageSize = (options.pages == LOSMPageMode::DEFAULT) ? (size_t)sysconf(_SC_PAGESIZE) : get_huge_page_size();
+	return (size + pageSize - 1) / pageSize * pageSize;
+}
+
+/**
+ * Map memory aligned to the huge page size, so that transparent huge pages can back all of it.
+ * @param	size	The length of the mapping, a multiple of the huge page size.
+ * @return	The memory, or nullptr if it could not be mapped.
+ */
+static void *map_aligned(size_t size)
+{
+	size_t alignment = get_huge_page_size();
+
+	// Over-map by one huge page, then unmap the unaligned head and the tail beyond the array.
+	void *data = mmap(nullptr, size + alignment, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (data == MAP_FAILED) {
+		return nullptr;
+	}
+
+	uintptr_t first = (uintptr_t)data;
+	uintptr_t aligned = (first + alignment - 1) / alignment * alignment;
+
+	if (aligned > first) {
+		munmap(data, aligned - first);
+	}
+	if (first + alignment > aligned) {
+		munmap((void *)(aligned + size), first + alignment - aligned);
+	}
+
+	return (void *)aligned;
+}
+
+LOSMStorageOptions::LOSMStorageOptions() : pages(LOSMPageMode::DEFAULT), numaNode(-1)
+{ }
+
+LOSMStorageOptions::LOSMStorageOptions(LOSMPageMode pages, int numaNode) : pages(pages), numaNode(numaNode)
+{ }
+
+void *allocate_storage(size_t size, const LOSMStorageOptions &options)
+{
+	if (!is_mapped(size, options)) {
+		return ::operator new(size);
+	}
+
+	size_t mappedSize = get_mapped_size(size, options);
+	void *data = nullptr;
+
+	if (options.pages == LOSMPageMode::DEFAULT) {
+		data = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (data == MAP_FAILED) {
+			data = nullptr;
+		}
+	}
+
+#ifdef MAP_HUGETLB
+	if (options.pages == LOSMPageMode::EXPLICIT) {
+		data = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (data == MAP_FAILED) {
+			data = nullptr;
+		}
+	}
+#endif
+
+	// Transparent huge pages, and the fallback when no explicit huge pages are reserved.
+	if (data == nullptr && options.pages != LOSMPageMode::DEFAULT) {
+		data = map_aligned(mappedSize);
+
+#ifdef MADV_HUGEPAGE
+		if (data != nullptr) {
+			madvise(data, mappedSize, MADV_HUGEPAGE);
+		}
+#endif
+	}
+
+	if (data == nullptr) {
+		throw std::bad_alloc();
+	}
+
+	// Set the policy before anything touches the pages, since they are placed on the first touch.
+	// Failure is not an error, e.g., the kernel has no NUMA support; the pages are then placed as usual.
+#if defined(__linux__) && defined(SYS_mbind)
+	if (options.numaNode >= 0) {
+		const unsigned int bitsPerWord = 8 * sizeof(unsigned long);
+		std::vector<unsigned long> mask(options.numaNode / bitsPerWord + 1, 0);
+		mask[options.numaNode / bitsPerWord] = 1UL << (options.numaNode % bitsPerWord);
+
+		syscall(SYS_mbind, data, mappedSize, MPOL_PREFERRED_NODES, mask.data(), mask.size() * bitsPerWord + 1, 0);
+	}
+#endif
+
+	return data;
+}
+
+void free_storage(void *data, size_t size, const LOSMStorageOptions &options)
+{
+	if (data == nullptr) {
+		return;
+	}
+
+	if (!is_mapped(size, options)) {
+		::operator delete(data);
+	} else {
+		munmap(data, get_mapped_size(size, options));
+	}
+}
+
+size_t get_huge_page_size()
+{
+	static const size_t hugePageSize = []() {
+		std::ifstream file("/proc/meminfo");
+		std::string line;
+
+		while (std::getline(file, line)) {
+			std::istringstream fields(line);
+			std::string key;
+			size_t kilobytes = 0;
+
+			if (fields >> key >> kilobytes && key == "Hugepagesize:" && kilobytes > 0) {
+				return kilobytes * 1024;
+			}
+		}
+
+		return (size_t)2 * 1024 * 1024;
+	}();
+
+	return hugePageSize;
+}
+
+const std::vector<unsigned int> &get_numa_nodes()
+{
+	static const std::vector<unsigned int> numaNodes = []() {
+		// The possible nodes include ones which may never exist, and online nodes may have no
+		// memory, e.g., CPU-only nodes, so only nodes with memory are used.
+		std::vector<unsigned int> nodes;
+
+		if (!read_numa_node_list("/sys/devices/system/node/has_memory", nodes) &&
+				!read_numa_node_list("/sys/devices/system/node/online", nodes)) {
+			nodes.assign(1, 0);
+		}
+
+		return nodes;
+	}();
+
+	return numaNodes;
+}
+
+unsigned int get_num_numa_nodes()
+{
+	return get_numa_nodes().size();
+}
+
+unsigned int get_current_numa_node()
+{
+#if defined(__linux__) && defined(SYS_getcpu)
+	unsigned int cpu = 0;
+	unsigned int node = 0;
+
+	if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) {
+		return node;
+	}
+#endif
+
+	return 0;
+}
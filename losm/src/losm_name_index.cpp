@@ -0,0 +1,406 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "../include/losm_name_index.h"
+#include "../include/losm_exception.h"
+
+#include <iostream>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <cstring>
+
+LOSMNameIndex::LOSMNameIndex(std::shared_ptr<const LOSMGraph> graph)
+{
+	if (graph == nullptr) {
+		std::cerr << "Error[LOSMNameIndex::LOSMNameIndex]: The graph provided was null." << std::endl;
+		throw LOSMException();
+	}
+
+	this->graph = graph;
+
+	unsigned int numEdges = graph->get_num_edges();
+	const std::vector<const LOSMLandmark *> &allLandmarks = graph->get_losm()->get_landmarks();
+
+	// Give each distinct key an index in order of first appearance, edges before landmarks.
+	std::unordered_map<std::string, unsigned int> names;
+	std::vector<unsigned int> edgeNames(numEdges, LOSMGraph::INVALID_INDEX);
+	std::vector<unsigned int> landmarkNames(allLandmarks.size(), LOSMGraph::INVALID_INDEX);
+
+	keyOffsets.push_back(0);
+
+	for (unsigned int i = 0; i < numEdges + allLandmarks.size(); i++) {
+		std::string key = fold(i < numEdges ? graph->get_edge(i)->get_name() : allLandmarks[i - numEdges]->get_name());
+		if (key.empty()) {
+			continue;
+		}
+
+		std::pair<std::unordered_map<std::string, unsigned int>::iterator, bool> name =
+				names.emplace(key, (unsigned int)spellings.size());
+		if (name.second) {
+			keys += key;
+			keyOffsets.push_back(keys.size());
+			spellings.push_back(i);
+		}
+
+		if (i < numEdges) {
+			edgeNames[i] = name.first->second;
+		} else {
+			landmarkNames[i - numEdges] = name.first->second;
+		}
+	}
+
+	unsigned int numNames = spellings.size();
+
+	// Group the edges and landmarks by name with a counting sort, keeping them in order.
+	edgeOffsets.assign(numNames + 1, 0);
+	for (unsigned int name : edgeNames) {
+		if (name != LOSMGraph::INVALID_INDEX) {
+			edgeOffsets[name + 1]++;
+		}
+	}
+	for (unsigned int name = 0; name < numNames; name++) {
+		edgeOffsets[name + 1] += edgeOffsets[name];
+	}
+
+	edges.resize(edgeOffsets[numNames]);
+	std::vector<unsigned int> positions(edgeOffsets.begin(), edgeOffsets.end() - 1);
+	for (unsigned int edge = 0; edge < numEdges; edge++) {
+		if (edgeNames[edge] != LOSMGraph::INVALID_INDEX) {
+			edges[positions[edgeNames[edge]]++] = edge;
+		}
+	}
+
+	landmarkOffsets.assign(numNames + 1, 0);
+	for (unsigned int name : landmarkNames) {
+		if (name != LOSMGraph::INVALID_INDEX) {
+			landmarkOffsets[name + 1]++;
+		}
+	}
+	for (unsigned int name = 0; name < numNames; name++) {
+		landmarkOffsets[name + 1] += landmarkOffsets[name];
+	}
+
+	landmarks.resize(landmarkOffsets[numNames]);
+	positions.assign(landmarkOffsets.begin(), landmarkOffsets.end() - 1);
+	for (unsigned int landmark = 0; landmark < landmarkNames.size(); landmark++) {
+		if (landmarkNames[landmark] != LOSMGraph::INVALID_INDEX) {
+			landmarks[positions[landmarkNames[landmark]]++] = landmark;
+		}
+	}
+
+	// Add an entry for every word of every key, then sort them by key.
+	for (unsigned int name = 0; name < numNames; name++) {
+		for (unsigned int start = keyOffsets[name]; start < keyOffsets[name + 1]; start++) {
+			if (start == keyOffsets[name] || keys[start - 1] == ' ') {
+				Entry entry;
+				entry.name = name;
+				entry.start = start - keyOffsets[name];
+				entries.push_back(entry);
+			}
+		}
+	}
+
+	std::sort(entries.begin(), entries.end(),
+		[this](const Entry &a, const Entry &b) {
+			unsigned int lengthA = 0, lengthB = 0;
+			const char *keyA = get_key(a, lengthA);
+			const char *keyB = get_key(b, lengthB);
+
+			int comparison = std::memcmp(keyA, keyB, std::min(lengthA, lengthB));
+			if (comparison != 0) {
+				return comparison < 0;
+			}
+			if (lengthA != lengthB) {
+				return lengthA < lengthB;
+			}
+			return a.name < b.name;
+		});
+}
+
+LOSMNameIndex::~LOSMNameIndex()
+{ }
+
+unsigned int LOSMNameIndex::get_num_names() const
+{
+	return spellings.size();
+}
+
+std::string LOSMNameIndex::get_name(unsigned int name) const
+{
+	unsigned int numEdges = graph->get_num_edges();
+
+	if (spellings[name] < numEdges) {
+		return graph->get_edge(spellings[name])->get_name();
+	}
+	return graph->get_losm()->get_landmarks()[spellings[name] - numEdges]->get_name();
+}
+
+void LOSMNameIndex::get_edges(unsigned int name, std::vector<unsigned int> &result) const
+{
+	result.assign(edges.begin() + edgeOffsets[name], edges.begin() + edgeOffsets[name + 1]);
+}
+
+void LOSMNameIndex::get_landmarks(unsigned int name, std::vector<unsigned int> &result) const
+{
+	result.assign(landmarks.begin() + landmarkOffsets[name], landmarks.begin() + landmarkOffsets[name + 1]);
+}
+
+std::string LOSMNameIndex::fold(const std::string &text)
+{
+	std::string key;
+	key.reserve(text.size());
+
+	bool space = false;
+
+	for (unsigned char character : text) {
+		if (character >= 'A' && character <= 'Z') {
+			character = character - 'A' + 'a';
+		}
+
+		// Keep the bytes of other encodings, e.g., UTF-8, as they are.
+		if (character < 0x80 && !(character >= '0' && character <= '9') && !(character >= 'a' && character <= 'z')) {
+			space = true;
+			continue;
+		}
+
+		if (space && !key.empty()) {
+			key.push_back(' ');
+		}
+		space = false;
+
+		key.push_back(character);
+	}
+
+	return key;
+}
+
+unsigned int LOSMNameIndex::find_exact(const std::string &query) const
+{
+	std::string key = fold(query);
+
+	for (unsigned int i = search(0, key.data(), key.size(), false); i < entries.size(); i++) {
+		unsigned int length = 0;
+		const char *entryKey = get_key(entries[i], length);
+		if (length != key.size() || std::memcmp(entryKey, key.data(), length) != 0) {
+			break;
+		}
+
+		if (entries[i].start == 0) {
+			return entries[i].name;
+		}
+	}
+
+	return LOSMGraph::INVALID_INDEX;
+}
+
+void LOSMNameIndex::find_prefix(const std::string &query, unsigned int maxResults,
+		std::vector<LOSMNameMatch> &result) const
+{
+	std::string key = fold(query);
+
+	unsigned int first = search(0, key.data(), key.size(), false);
+	unsigned int last = search(first, key.data(), key.size(), true);
+
+	std::vector<std::pair<LOSMNameMatch, unsigned int> > matches;
+	for (unsigned int i = first; i < last; i++) {
+		LOSMNameMatch match;
+		match.name = entries[i].name;
+		match.edits = 0;
+		matches.push_back(std::make_pair(match, entries[i].start));
+	}
+
+	rank(matches, maxResults, result);
+}
+
+void LOSMNameIndex::find_fuzzy(const std::string &query, unsigned int maxEdits, unsigned int maxResults,
+		std::vector<LOSMNameMatch> &result) const
+{
+	std::string key = fold(query);
+	unsigned int width = key.size() + 1;
+
+	// Row d holds the edits between each prefix of the query and the first d characters of the
+	// current entry's key. Rows up to the depth shared with the previous key remain valid.
+	std::vector<unsigned int> rows(width);
+	for (unsigned int j = 0; j < width; j++) {
+		rows[j] = j;
+	}
+
+	const char *previous = nullptr;
+	unsigned int validDepth = 0;
+
+	std::vector<std::pair<LOSMNameMatch, unsigned int> > matches;
+
+	unsigned int i = 0;
+	while (i < entries.size()) {
+		unsigned int length = 0;
+		const char *entryKey = get_key(entries[i], length);
+
+		unsigned int depth = 0;
+		while (depth < validDepth && depth < length && entryKey[depth] == previous[depth]) {
+			depth++;
+		}
+
+		bool pruned = false;
+
+		for (; depth < length; depth++) {
+			if (rows.size() < (depth + 2) * width) {
+				rows.resize((depth + 2) * width);
+			}
+
+			const unsigned int *above = &rows[depth * width];
+			unsigned int *current = &rows[(depth + 1) * width];
+
+			current[0] = depth + 1;
+			unsigned int minimum = current[0];
+
+			for (unsigned int j = 1; j < width; j++) {
+				unsigned int substitution = above[j - 1] + (key[j - 1] != entryKey[depth] ? 1 : 0);
+				current[j] = std::min(substitution, std::min(above[j], current[j - 1]) + 1);
+				minimum = std::min(minimum, current[j]);
+			}
+
+			// No key which begins with these characters can be within the maximum edits.
+			if (minimum > maxEdits) {
+				previous = entryKey;
+				validDepth = depth;
+				i = search(i, entryKey, depth + 1, true);
+				pruned = true;
+				break;
+			}
+		}
+
+		if (pruned) {
+			continue;
+		}
+
+		previous = entryKey;
+		validDepth = length;
+
+		unsigned int edits = rows[length * width + width - 1];
+		if (edits <= maxEdits) {
+			LOSMNameMatch match;
+			match.name = entries[i].name;
+			match.edits = edits;
+			matches.push_back(std::make_pair(match, entries[i].start));
+		}
+
+		i++;
+	}
+
+	rank(matches, maxResults, result);
+}
+
+size_t LOSMNameIndex::get_memory_usage() const
+{
+	return keys.capacity() + (keyOffsets.capacity() + spellings.capacity() + edgeOffsets.capacity() +
+			edges.capacity() + landmarkOffsets.capacity() + landmarks.capacity()) * sizeof(unsigned int) +
+			entries.capacity() * sizeof(Entry);
+}
+
+const char *LOSMNameIndex::get_key(const Entry &entry, unsigned int &length) const
+{
+	unsigned int first = keyOffsets[entry.name] + entry.start;
+	length = keyOffsets[entry.name + 1] - first;
+	return keys.data() + first;
+}
+
+unsigned int LOSMNameIndex::search(unsigned int first, const char *text, unsigned int length, bool upper) const
+{
+	auto compare = [this, text, length](unsigned int position) {
+		unsigned int keyLength = 0;
+		const char *key = get_key(entries[position], keyLength);
+		keyLength = std::min(keyLength, length);
+
+		int comparison = std::memcmp(key, text, keyLength);
+		if (comparison == 0 && keyLength < length) {
+			comparison = -1;
+		}
+		return comparison;
+	};
+
+	// Gallop from the first entry, since the entry sought is usually near it, then bisect.
+	unsigned int last = first;
+	unsigned int step = 1;
+
+	while (last < entries.size()) {
+		int comparison = compare(last);
+		if (comparison > 0 || (!upper && comparison == 0)) {
+			break;
+		}
+
+		first = last + 1;
+		last = first + step;
+		step *= 2;
+	}
+	last = std::min(last, (unsigned int)entries.size());
+
+	while (first < last) {
+		unsigned int middle = first + (last - first) / 2;
+
+		int comparison = compare(middle);
+		if (comparison < 0 || (upper && comparison == 0)) {
+			first = middle + 1;
+		} else {
+			last = middle;
+		}
+	}
+
+	return first;
+}
+
+void LOSMNameIndex::rank(std::vector<std::pair<LOSMNameMatch, unsigned int> > &matches, unsigned int maxResults,
+		std::vector<LOSMNameMatch> &result) const
+{
+	std::sort(matches.begin(), matches.end(),
+		[this](const std::pair<LOSMNameMatch, unsigned int> &a, const std::pair<LOSMNameMatch, unsigned int> &b) {
+			if (a.first.edits != b.first.edits) {
+				return a.first.edits < b.first.edits;
+			}
+			if ((a.second == 0) != (b.second == 0)) {
+				return a.second == 0;
+			}
+
+			unsigned int lengthA = keyOffsets[a.first.name + 1] - keyOffsets[a.first.name];
+			unsigned int lengthB = keyOffsets[b.first.name + 1] - keyOffsets[b.first.name];
+			if (lengthA != lengthB) {
+				return lengthA < lengthB;
+			}
+			return a.first.name < b.first.name;
+		});
+
+	// The first match of each name is its best.
+	result.clear();
+
+	std::unordered_set<unsigned int> found;
+	for (const std::pair<LOSMNameMatch, unsigned int> &match : matches) {
+		if (result.size() >= maxResults) {
+			break;
+		}
+		if (found.insert(match.first.name).second) {
+			result.push_back(match.first);
+		}
+	}
+}
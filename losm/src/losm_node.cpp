@@ -29,11 +29,11 @@
 #include <iostream>
 #include <fstream>
 
-LOSMNode::LOSMNode(unsigned long uid, float x, float y, unsigned int degree)
+LOSMNode::LOSMNode(unsigned long uid, double x, double y, unsigned int degree)
 {
 	this->uid = uid;
-	this->x = x;
-	this->y = y;
+	this->x = degrees_to_fixed_point(x);
+	this->y = degrees_to_fixed_point(y);
 	this->degree = degree;
 }
 
@@ -47,10 +47,20 @@ unsigned long LOSMNode::get_uid() const
 
 float LOSMNode::get_x() const
 {
-	return x;
+	return (float)fixed_point_to_degrees(x);
 }
 
 float LOSMNode::get_y() const
+{
+	return (float)fixed_point_to_degrees(y);
+}
+
+int LOSMNode::get_fixed_x() const
+{
+	return x;
+}
+
+int LOSMNode::get_fixed_y() const
 {
 	return y;
 }
@@ -99,7 +109,7 @@ void LOSMNode::load(std::string filename, std::vector<const LOSMNode *> &result)
         }
 
 		// Attempt to parse the x coordinate.
-        float nodeX = 0.0f;
+        double nodeX = 0.0;
 		try {
 			nodeX = std::stod(items[1]);
         } catch (const std::exception &err) {
@@ -110,7 +120,7 @@ void LOSMNode::load(std::string filename, std::vector<const LOSMNode *> &result)
         }
 
 		// Attempt to parse the y coordinate.
-        float nodeY = 0.0f;
+        double nodeY = 0.0;
 		try {
 			nodeY = std::stod(items[2]);
         } catch (const std::exception &err) {
@@ -131,6 +141,14 @@ void LOSMNode::load(std::string filename, std::vector<const LOSMNode *> &result)
 			break;
         }
 
+		// Reject coordinates which are not a latitude and longitude.
+		if (!is_valid_coordinate(nodeX, nodeY)) {
+			std::cerr << "Error[LOSMNode::load]: The coordinate (" << items[1] << ", " << items[2] <<
+					") is not a valid latitude and longitude on line " << row << " in file '" << filename << "'." << std::endl;
+			error = true;
+			break;
+		}
+
         // Now, with the variables loaded, we may create the node and add it.
         result.push_back(new LOSMNode(nodeUID, nodeX, nodeY, nodeDegree));
 
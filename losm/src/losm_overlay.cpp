@@ -0,0 +1,250 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "../include/losm_overlay.h"
+#include "../include/losm_exception.h"
+#include "../include/losm_utilities.h"
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <cmath>
+
+LOSMOverlay::LOSMOverlay(std::string directory)
+{
+	std::string nodesFilename = directory + "/overlay_nodes.dat";
+	std::string edgesFilename = directory + "/overlay_edges.dat";
+
+	std::ifstream nodesFile(nodesFilename);
+	if (!nodesFile.is_open()) {
+		std::cerr << "Error[LOSMOverlay::LOSMOverlay]: Failed to open the file '" << nodesFilename << "'." << std::endl;
+		throw LOSMException();
+	}
+
+	std::string line;
+	int row = 1;
+
+	while (std::getline(nodesFile, line)) {
+		std::vector<std::string> items = split_string_by_comma(line);
+		if (items.size() != 2) {
+			std::cerr << "Error[LOSMOverlay::LOSMOverlay]: Incorrect number of comma-delimited items on line " <<
+					row << " in file '" << nodesFilename << "'." << std::endl;
+			throw LOSMException();
+		}
+
+		try {
+			nodeIndices[std::stoul(items[0])] = (unsigned int)cells.size();
+			cells.push_back((unsigned int)std::stoul(items[1]));
+		} catch (const std::exception &err) {
+			std::cerr << "Error[LOSMOverlay::LOSMOverlay]: Failed to convert an item to an integer on line " <<
+					row << " in file '" << nodesFilename << "'." << std::endl;
+			throw LOSMException();
+		}
+
+		row++;
+	}
+
+	std::ifstream edgesFile(edgesFilename);
+	if (!edgesFile.is_open()) {
+		std::cerr << "Error[LOSMOverlay::LOSMOverlay]: Failed to open the file '" << edgesFilename << "'." << std::endl;
+		throw LOSMException();
+	}
+
+	std::vector<unsigned int> edgeNodes;
+	std::vector<float> edgeDistances;
+	std::vector<float> edgeTravelTimes;
+	row = 1;
+
+	while (std::getline(edgesFile, line)) {
+		std::vector<std::string> items = split_string_by_comma(line);
+		if (items.size() != 5) {
+			std::cerr << "Error[LOSMOverlay::LOSMOverlay]: Incorrect number of comma-delimited items on line " <<
+					row << " in file '" << edgesFilename << "'." << std::endl;
+			throw LOSMException();
+		}
+
+		unsigned int node1 = LOSMGraph::INVALID_INDEX;
+		unsigned int node2 = LOSMGraph::INVALID_INDEX;
+
+		try {
+			node1 = get_node_index(std::stoul(items[0]));
+			node2 = get_node_index(std::stoul(items[1]));
+			edgeDistances.push_back(std::stof(items[2]));
+			edgeTravelTimes.push_back(std::stof(items[3]));
+		} catch (const std::exception &err) {
+			std::cerr << "Error[LOSMOverlay::LOSMOverlay]: Failed to convert an item to a number on line " <<
+					row << " in file '" << edgesFilename << "'." << std::endl;
+			throw LOSMException();
+		}
+
+		if (node1 == LOSMGraph::INVALID_INDEX || node2 == LOSMGraph::INVALID_INDEX) {
+			std::cerr << "Error[LOSMOverlay::LOSMOverlay]: Failed to find the nodes on line " <<
+					row << " in file '" << edgesFilename << "'." << std::endl;
+			throw LOSMException();
+		}
+
+		edgeNodes.push_back(node1);
+		edgeNodes.push_back(node2);
+
+		row++;
+	}
+
+	// Build the adjacency by counting the degree of each node, then filling the slots.
+	unsigned int numNodes = (unsigned int)cells.size();
+	offsets.assign(numNodes + 1, 0);
+	for (unsigned int node : edgeNodes) {
+		offsets[node + 1]++;
+	}
+	for (unsigned int i = 0; i < numNodes; i++) {
+		offsets[i + 1] += offsets[i];
+	}
+
+	adjacentNodes.resize(edgeNodes.size());
+	adjacentDistances.resize(edgeNodes.size());
+	adjacentTravelTimes.resize(edgeNodes.size());
+
+	std::vector<unsigned int> next(offsets.begin(), offsets.end() - 1);
+	for (unsigned int edge = 0; edge < edgeDistances.size(); edge++) {
+		for (unsigned int end = 0; end < 2; end++) {
+			unsigned int slot = next[edgeNodes[2 * edge + end]]++;
+			adjacentNodes[slot] = edgeNodes[2 * edge + 1 - end];
+			adjacentDistances[slot] = edgeDistances[edge];
+			adjacentTravelTimes[slot] = edgeTravelTimes[edge];
+		}
+	}
+}
+
+LOSMOverlay::~LOSMOverlay()
+{ }
+
+unsigned int LOSMOverlay::get_num_nodes() const
+{
+	return (unsigned int)cells.size();
+}
+
+unsigned int LOSMOverlay::get_num_edges() const
+{
+	return (unsigned int)(adjacentNodes.size() / 2);
+}
+
+unsigned int LOSMOverlay::get_cell(unsigned long uid) const
+{
+	unsigned int node = get_node_index(uid);
+	if (node == LOSMGraph::INVALID_INDEX) {
+		return LOSMGraph::INVALID_INDEX;
+	}
+	return cells[node];
+}
+
+unsigned int LOSMOverlay::get_node_index(unsigned long uid) const
+{
+	auto result = nodeIndices.find(uid);
+	if (result == nodeIndices.end()) {
+		return LOSMGraph::INVALID_INDEX;
+	}
+	return result->second;
+}
+
+void LOSMOverlay::find_boundary_costs(LOSMQueryContext &shard, const LOSMNode *node, LOSMCost cost,
+		std::vector<LOSMBoundaryCost> &result) const
+{
+	const LOSMGraph *graph = shard.get_graph();
+	shard.search(graph->get_node_index(node), LOSMGraph::INVALID_INDEX, cost);
+
+	result.clear();
+
+	const unsigned long *uids = graph->get_uid_array();
+	for (unsigned int i = 0; i < graph->get_num_nodes(); i++) {
+		float nodeCost = shard.get_cost(i);
+		if (nodeCost != INFINITY && get_node_index(uids[i]) != LOSMGraph::INVALID_INDEX) {
+			LOSMBoundaryCost boundaryCost = {uids[i], nodeCost};
+			result.push_back(boundaryCost);
+		}
+	}
+}
+
+float LOSMOverlay::find_distance(const std::vector<LOSMBoundaryCost> &sourceCosts,
+		const std::vector<LOSMBoundaryCost> &targetCosts, LOSMCost cost) const
+{
+	unsigned int numNodes = get_num_nodes();
+	const std::vector<float> &adjacentCosts = (cost == LOSMCost::DISTANCE ? adjacentDistances : adjacentTravelTimes);
+
+	std::vector<float> costs(numNodes, INFINITY);
+	std::vector<float> remaining(numNodes, INFINITY);
+
+	for (const LOSMBoundaryCost &targetCost : targetCosts) {
+		unsigned int node = get_node_index(targetCost.uid);
+		if (node != LOSMGraph::INVALID_INDEX) {
+			remaining[node] = std::min(remaining[node], targetCost.cost);
+		}
+	}
+
+	std::greater<std::pair<float, unsigned int> > compare;
+	std::vector<std::pair<float, unsigned int> > heap;
+
+	// Every boundary node of the source's cell is a source of the search, at its own cost.
+	for (const LOSMBoundaryCost &sourceCost : sourceCosts) {
+		unsigned int node = get_node_index(sourceCost.uid);
+		if (node != LOSMGraph::INVALID_INDEX && sourceCost.cost < costs[node]) {
+			costs[node] = sourceCost.cost;
+			heap.push_back(std::make_pair(sourceCost.cost, node));
+		}
+	}
+	std::make_heap(heap.begin(), heap.end(), compare);
+
+	float best = INFINITY;
+
+	while (!heap.empty()) {
+		std::pop_heap(heap.begin(), heap.end(), compare);
+		float nodeCost = heap.back().first;
+		unsigned int node = heap.back().second;
+		heap.pop_back();
+
+		if (nodeCost > costs[node]) {
+			continue;
+		}
+
+		// No later node can lead to a cheaper route, since the remaining costs are non-negative.
+		if (nodeCost >= best) {
+			break;
+		}
+
+		best = std::min(best, nodeCost + remaining[node]);
+
+		for (unsigned int slot = offsets[node]; slot < offsets[node + 1]; slot++) {
+			unsigned int neighbor = adjacentNodes[slot];
+			float neighborCost = nodeCost + adjacentCosts[slot];
+
+			if (neighborCost < costs[neighbor]) {
+				costs[neighbor] = neighborCost;
+				heap.push_back(std::make_pair(neighborCost, neighbor));
+				std::push_heap(heap.begin(), heap.end(), compare);
+			}
+		}
+	}
+
+	return best;
+}
@@ -0,0 +1,357 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "../include/losm_partition.h"
+#include "../include/losm_exception.h"
+#include "../include/losm_utilities.h"
+#include "../include/losm.h"
+
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <utility>
+#include <cerrno>
+#include <cmath>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+/**
+ * The number of directions along which each set of nodes is tried for a split.
+ */
+static const unsigned int NUM_SPLIT_DIRECTIONS = 4;
+
+LOSMPartition::LOSMPartition(std::shared_ptr<const LOSMGraph> graph, unsigned int numCells)
+{
+	if (graph == nullptr || numCells == 0) {
+		std::cerr << "Error[LOSMPartition::LOSMPartition]: Invalid graph or number of cells." << std::endl;
+		throw LOSMException();
+	}
+
+	this->graph = graph;
+
+	unsigned int numNodes = graph->get_num_nodes();
+	cells.resize(numNodes, 0);
+
+	std::vector<unsigned int> nodes(numNodes);
+	for (unsigned int i = 0; i < numNodes; i++) {
+		nodes[i] = i;
+	}
+
+	std::vector<int> sides(numNodes, -1);
+	bisect(nodes, 0, numNodes, numCells, 0, sides);
+
+	cellNodes.resize(numCells);
+	boundaryNodes.resize(numCells);
+
+	for (unsigned int node = 0; node < numNodes; node++) {
+		unsigned int cell = cells[node];
+		cellNodes[cell].push_back(node);
+
+		for (unsigned int slot = graph->get_adjacency_begin(node); slot < graph->get_adjacency_end(node); slot++) {
+			if (cells[graph->get_adjacent_node(slot)] != cell) {
+				boundaryNodes[cell].push_back(node);
+				break;
+			}
+		}
+	}
+
+	const unsigned int *edgeNodes = graph->get_edge_nodes_array();
+	for (unsigned int edge = 0; edge < graph->get_num_edges(); edge++) {
+		if (cells[edgeNodes[2 * edge + 0]] != cells[edgeNodes[2 * edge + 1]]) {
+			cutEdges.push_back(edge);
+		}
+	}
+}
+
+LOSMPartition::~LOSMPartition()
+{ }
+
+unsigned int LOSMPartition::get_num_cells() const
+{
+	return (unsigned int)cellNodes.size();
+}
+
+unsigned int LOSMPartition::get_cell(unsigned int node) const
+{
+	return cells[node];
+}
+
+const std::vector<unsigned int> &LOSMPartition::get_nodes(unsigned int cell) const
+{
+	return cellNodes[cell];
+}
+
+const std::vector<unsigned int> &LOSMPartition::get_boundary_nodes(unsigned int cell) const
+{
+	return boundaryNodes[cell];
+}
+
+const std::vector<unsigned int> &LOSMPartition::get_cut_edges() const
+{
+	return cutEdges;
+}
+
+void LOSMPartition::save(std::string directory) const
+{
+	if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST) {
+		std::cerr << "Error[LOSMPartition::save]: Failed to create the directory '" << directory << "'." << std::endl;
+		throw LOSMException();
+	}
+
+	unsigned int numCells = get_num_cells();
+	const unsigned long *uids = graph->get_uid_array();
+	const int *fixedX = graph->get_fixed_x_array();
+	const int *fixedY = graph->get_fixed_y_array();
+	const unsigned int *edgeNodes = graph->get_edge_nodes_array();
+	const float *distances = graph->get_edge_distances_array();
+	const float *travelTimes = graph->get_edge_travel_times_array();
+	const unsigned int *speedLimits = graph->get_speed_limit_array();
+	const unsigned int *lanes = graph->get_lanes_array();
+
+	// Each shard keeps only the edges within its cell, so the degree of each node is counted
+	// from those, like LOSMSubgraph does, rather than taken from the full graph. The edges and
+	// landmarks are bucketed by cell first, so that each shard is written in turn and only one
+	// is ever held in memory.
+	std::vector<unsigned int> degrees(graph->get_num_nodes(), 0);
+	std::vector<std::vector<unsigned int> > cellEdges(numCells);
+	std::vector<std::vector<const LOSMLandmark *> > cellLandmarks(numCells);
+
+	for (unsigned int edge = 0; edge < graph->get_num_edges(); edge++) {
+		unsigned int node1 = edgeNodes[2 * edge + 0];
+		unsigned int node2 = edgeNodes[2 * edge + 1];
+		if (cells[node1] != cells[node2]) {
+			continue;
+		}
+
+		degrees[node1]++;
+		degrees[node2]++;
+		cellEdges[cells[node1]].push_back(edge);
+	}
+
+	for (const LOSMLandmark *landmark : graph->get_losm()->get_landmarks()) {
+		unsigned int node = graph->find_nearest_node(landmark->get_x(), landmark->get_y());
+		if (node != LOSMGraph::INVALID_INDEX) {
+			cellLandmarks[cells[node]].push_back(landmark);
+		}
+	}
+
+	for (unsigned int cell = 0; cell < numCells; cell++) {
+		std::string prefix = directory + "/cell" + std::to_string(cell) + "_";
+
+		std::ostringstream nodesFile;
+		nodesFile << std::fixed << std::setprecision(7);
+		for (unsigned int node : cellNodes[cell]) {
+			nodesFile << uids[node] << "," << fixed_point_to_degrees(fixedX[node]) << "," <<
+					fixed_point_to_degrees(fixedY[node]) << "," << degrees[node] << std::endl;
+		}
+		write_file(prefix + "nodes.dat", nodesFile.str());
+
+		std::ostringstream edgesFile;
+		edgesFile << std::setprecision(std::numeric_limits<float>::max_digits10);
+		for (unsigned int edge : cellEdges[cell]) {
+			edgesFile << uids[edgeNodes[2 * edge + 0]] << "," << uids[edgeNodes[2 * edge + 1]] << "," <<
+					graph->get_edge(edge)->get_name() << "," << distances[edge] << "," << speedLimits[edge] <<
+					"," << lanes[edge] << std::endl;
+		}
+		write_file(prefix + "edges.dat", edgesFile.str());
+
+		std::ostringstream landmarksFile;
+		landmarksFile << std::fixed << std::setprecision(7);
+		for (const LOSMLandmark *landmark : cellLandmarks[cell]) {
+			landmarksFile << landmark->get_uid() << "," << fixed_point_to_degrees(landmark->get_fixed_x()) <<
+					"," << fixed_point_to_degrees(landmark->get_fixed_y()) << "," << landmark->get_name() << std::endl;
+		}
+		write_file(prefix + "landmarks.dat", landmarksFile.str());
+	}
+
+	// The overlay holds the boundary nodes, the edges between cells, and the cheapest routes
+	// within each cell between its boundary nodes.
+	std::ostringstream overlayNodes;
+	std::ostringstream overlayEdges;
+	overlayEdges << std::setprecision(std::numeric_limits<float>::max_digits10);
+
+	for (unsigned int cell = 0; cell < numCells; cell++) {
+		for (unsigned int node : boundaryNodes[cell]) {
+			overlayNodes << uids[node] << "," << cell << std::endl;
+		}
+	}
+
+	for (unsigned int edge : cutEdges) {
+		overlayEdges << uids[edgeNodes[2 * edge + 0]] << "," << uids[edgeNodes[2 * edge + 1]] << "," <<
+				distances[edge] << "," << travelTimes[edge] << ",-1" << std::endl;
+	}
+
+	std::vector<float> distanceCosts(graph->get_num_nodes(), INFINITY);
+	std::vector<float> travelTimeCosts(graph->get_num_nodes(), INFINITY);
+	std::vector<unsigned int> distanceReached;
+	std::vector<unsigned int> travelTimeReached;
+
+	for (unsigned int cell = 0; cell < numCells; cell++) {
+		const std::vector<unsigned int> &boundary = boundaryNodes[cell];
+
+		for (unsigned int i = 0; i < boundary.size(); i++) {
+			search_cell(boundary[i], LOSMCost::DISTANCE, distanceCosts, distanceReached);
+			search_cell(boundary[i], LOSMCost::TRAVEL_TIME, travelTimeCosts, travelTimeReached);
+
+			// The edges are undirected, so each pair is written once.
+			for (unsigned int j = i + 1; j < boundary.size(); j++) {
+				if (distanceCosts[boundary[j]] != INFINITY) {
+					overlayEdges << uids[boundary[i]] << "," << uids[boundary[j]] << "," <<
+							distanceCosts[boundary[j]] << "," << travelTimeCosts[boundary[j]] << "," <<
+							cell << std::endl;
+				}
+			}
+
+			for (unsigned int node : distanceReached) {
+				distanceCosts[node] = INFINITY;
+			}
+			for (unsigned int node : travelTimeReached) {
+				travelTimeCosts[node] = INFINITY;
+			}
+		}
+	}
+
+	write_file(directory + "/overlay_nodes.dat", overlayNodes.str());
+	write_file(directory + "/overlay_edges.dat", overlayEdges.str());
+}
+
+void LOSMPartition::bisect(std::vector<unsigned int> &nodes, unsigned int first, unsigned int last,
+		unsigned int numCells, unsigned int firstCell, std::vector<int> &sides)
+{
+	if (numCells == 1 || last - first < 2) {
+		for (unsigned int i = first; i < last; i++) {
+			cells[nodes[i]] = firstCell;
+		}
+		return;
+	}
+
+	unsigned int leftCells = numCells / 2;
+	unsigned int split = first + (unsigned int)((unsigned long long)(last - first) * leftCells / numCells);
+
+	const int *fixedX = graph->get_fixed_x_array();
+	const int *fixedY = graph->get_fixed_y_array();
+
+	// Longitude is scaled by the cosine of the mean latitude, so that the directions are
+	// directions on the ground.
+	double meanX = 0.0;
+	for (unsigned int i = first; i < last; i++) {
+		meanX += fixedX[nodes[i]];
+	}
+	meanX /= (double)(last - first);
+	double scaleY = std::cos(fixed_point_to_degrees((int)meanX) * M_PI / 180.0);
+
+	std::vector<std::pair<double, unsigned int> > keys(last - first);
+	auto sort_along = [&](unsigned int direction) {
+		double angle = M_PI * (double)direction / (double)NUM_SPLIT_DIRECTIONS;
+		double dx = std::cos(angle);
+		double dy = std::sin(angle) * scaleY;
+
+		for (unsigned int i = first; i < last; i++) {
+			keys[i - first] = std::make_pair(fixedX[nodes[i]] * dx + fixedY[nodes[i]] * dy, nodes[i]);
+		}
+		std::nth_element(keys.begin(), keys.begin() + (split - first), keys.end());
+	};
+
+	unsigned int bestDirection = 0;
+	unsigned int bestCut = std::numeric_limits<unsigned int>::max();
+
+	for (unsigned int direction = 0; direction < NUM_SPLIT_DIRECTIONS; direction++) {
+		sort_along(direction);
+		for (unsigned int i = 0; i < keys.size(); i++) {
+			sides[keys[i].second] = (i < split - first ? 0 : 1);
+		}
+
+		// Count the edges from the first side to the second, within the set.
+		unsigned int cut = 0;
+		for (unsigned int i = 0; i < split - first; i++) {
+			unsigned int node = keys[i].second;
+			for (unsigned int slot = graph->get_adjacency_begin(node); slot < graph->get_adjacency_end(node); slot++) {
+				if (sides[graph->get_adjacent_node(slot)] == 1) {
+					cut++;
+				}
+			}
+		}
+
+		if (cut < bestCut) {
+			bestCut = cut;
+			bestDirection = direction;
+		}
+	}
+
+	sort_along(bestDirection);
+	for (unsigned int i = first; i < last; i++) {
+		nodes[i] = keys[i - first].second;
+		sides[nodes[i]] = -1;
+	}
+
+	bisect(nodes, first, split, leftCells, firstCell, sides);
+	bisect(nodes, split, last, numCells - leftCells, firstCell + leftCells, sides);
+}
+
+void LOSMPartition::search_cell(unsigned int source, LOSMCost cost, std::vector<float> &costs,
+		std::vector<unsigned int> &reached) const
+{
+	unsigned int cell = cells[source];
+
+	std::greater<std::pair<float, unsigned int> > compare;
+	std::vector<std::pair<float, unsigned int> > heap;
+
+	reached.clear();
+	reached.push_back(source);
+	costs[source] = 0.0f;
+	heap.push_back(std::make_pair(0.0f, source));
+
+	while (!heap.empty()) {
+		std::pop_heap(heap.begin(), heap.end(), compare);
+		float nodeCost = heap.back().first;
+		unsigned int node = heap.back().second;
+		heap.pop_back();
+
+		if (nodeCost > costs[node]) {
+			continue;
+		}
+
+		for (unsigned int slot = graph->get_adjacency_begin(node); slot < graph->get_adjacency_end(node); slot++) {
+			unsigned int neighbor = graph->get_adjacent_node(slot);
+			if (cells[neighbor] != cell) {
+				continue;
+			}
+
+			float neighborCost = nodeCost + graph->get_edge_cost(graph->get_adjacent_edge(slot), cost);
+			if (neighborCost < costs[neighbor]) {
+				if (costs[neighbor] == INFINITY) {
+					reached.push_back(neighbor);
+				}
+				costs[neighbor] = neighborCost;
+
+				heap.push_back(std::make_pair(neighborCost, neighbor));
+				std::push_heap(heap.begin(), heap.end(), compare);
+			}
+		}
+	}
+}
@@ -0,0 +1,1120 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "../include/losm_query_context.h"
+#include "../include/losm_exception.h"
+#include "../include/losm_distance.h"
+#include "../include/losm_instrumentation.h"
+
+#include <iostream>
+#include <algorithm>
+#include <functional>
+#include <set>
+#include <cmath>
+
+/**
+ * The tolerance, relative to an objective's optimal cost, added to its limit so that rounding
+ * in the sums of costs never excludes the optimal route itself.
+ */
+static const float LEXICOGRAPHIC_TOLERANCE = 1e-4f;
+
+/**
+ * The factor applied to the great-circle lower bounds of A*, so that the rounding of edge
+ * distances in the map files never makes them overestimate.
+ */
+static const float A_STAR_BOUND_FACTOR = 0.99f;
+
+/**
+ * The factor applied to the reverse costs which guide the spur and penalty searches, so that
+ * summing the same edge costs in the opposite order never makes them overestimate.
+ */
+static const float GUIDED_BOUND_FACTOR = 0.9999f;
+
+/**
+ * The maximum number of penalized searches for alternative routes, per route wanted.
+ */
+static const unsigned int PENALTY_SEARCHES_PER_ROUTE = 4;
+
+LOSMQueryContext::LOSMQueryContext(std::shared_ptr<const LOSMGraph> graph)
+{
+	if (graph == nullptr) {
+		std::cerr << "Error[LOSMQueryContext::LOSMQueryContext]: The graph provided was null." << std::endl;
+		throw LOSMException();
+	}
+
+	this->graph = graph;
+
+	costs.resize(graph->get_num_nodes(), INFINITY);
+	parentEdges.resize(graph->get_num_nodes(), LOSMGraph::INVALID_INDEX);
+	stamps.resize(graph->get_num_nodes(), 0);
+	currentStamp = 0;
+	currentBoundStamp = 0;
+	currentReverseStamp = 0;
+	currentBlock = 0;
+}
+
+LOSMQueryContext::~LOSMQueryContext()
+{ }
+
+const LOSMGraph *LOSMQueryContext::get_graph() const
+{
+	return graph.get();
+}
+
+const LOSMNode *LOSMQueryContext::find_nearest_node(float x, float y)
+{
+	unsigned int node = graph->find_nearest_node(x, y);
+	if (node == LOSMGraph::INVALID_INDEX) {
+		return nullptr;
+	}
+	return graph->get_node(node);
+}
+
+float LOSMQueryContext::find_distance(const LOSMNode *source, const LOSMNode *target, LOSMCost cost)
+{
+	return search(graph->get_node_index(source), graph->get_node_index(target), cost);
+}
+
+void LOSMQueryContext::find_route(const LOSMNode *source, const LOSMNode *target, LOSMCost cost,
+		LOSMRoute &route)
+{
+	unsigned int sourceIndex = graph->get_node_index(source);
+	unsigned int targetIndex = graph->get_node_index(target);
+
+	route.nodes.clear();
+	route.edges.clear();
+	route.cost = search(sourceIndex, targetIndex, cost);
+	route.found = (route.cost != INFINITY);
+
+	if (!route.found) {
+		return;
+	}
+
+	build_route(sourceIndex, targetIndex, route);
+}
+
+void LOSMQueryContext::find_time_dependent_route(const LOSMNode *source, const LOSMNode *target,
+		const LOSMSpeedProfiles &profiles, float departure, LOSMRoute &route)
+{
+	unsigned int sourceIndex = graph->get_node_index(source);
+	unsigned int targetIndex = graph->get_node_index(target);
+
+	route.nodes.clear();
+	route.edges.clear();
+	route.cost = search_time_dependent(sourceIndex, targetIndex, profiles, departure);
+	route.found = (route.cost != INFINITY);
+
+	if (route.found) {
+		build_route(sourceIndex, targetIndex, route);
+	}
+}
+
+void LOSMQueryContext::find_reachable(const LOSMReachabilityRequest &request, LOSMReachability &result)
+{
+	search_bounded(graph->get_node_index(request.source), request.budget, request.cost);
+
+	result.nodes = settled;
+	result.costs.clear();
+	result.boundaryEdges.clear();
+
+	if (request.includeCosts) {
+		result.costs.reserve(settled.size());
+		for (unsigned int node : settled) {
+			result.costs.push_back(costs[node]);
+		}
+	}
+
+	// An edge is on the boundary if exactly one of its endpoints is reachable, so it is found
+	// once, from that endpoint.
+	if (request.includeBoundaryEdges) {
+		for (unsigned int node : settled) {
+			for (unsigned int slot = graph->get_adjacency_begin(node); slot < graph->get_adjacency_end(node); slot++) {
+				if (stamps[graph->get_adjacent_node(slot)] != currentStamp) {
+					result.boundaryEdges.push_back(graph->get_adjacent_edge(slot));
+				}
+			}
+		}
+	}
+}
+
+void LOSMQueryContext::find_lexicographic_route(const LOSMLexicographicRequest &request,
+		LOSMLexicographicRoute &route)
+{
+	LOSM_INSTRUMENT(LOSMOperation::FIND_LEXICOGRAPHIC_ROUTE);
+
+	unsigned int sourceIndex = graph->get_node_index(request.source);
+	unsigned int targetIndex = graph->get_node_index(request.target);
+
+	if (request.objectives.empty()) {
+		std::cerr << "Error[LOSMQueryContext::find_lexicographic_route]: No objectives were given." << std::endl;
+		throw LOSMException();
+	}
+
+	for (const LOSMObjective &objective : request.objectives) {
+		if (objective.edgeCosts != nullptr && objective.edgeCosts->size() != graph->get_num_edges()) {
+			std::cerr << "Error[LOSMQueryContext::find_lexicographic_route]: Expected " << graph->get_num_edges() <<
+					" edge costs, but " << objective.edgeCosts->size() << " were given." << std::endl;
+			throw LOSMException();
+		}
+	}
+
+	route.found = false;
+	route.costs.clear();
+	route.nodes.clear();
+	route.edges.clear();
+
+	std::vector<float> limits(request.objectives.size(), INFINITY);
+	if (!compute_bounds(sourceIndex, targetIndex, request.objectives, limits)) {
+		return;
+	}
+
+	// The first objective's optimal cost is its bound at the source, so its stage is only
+	// searched if it is the only one.
+	unsigned int numObjectives = (unsigned int)request.objectives.size();
+	unsigned int label = LOSMGraph::INVALID_INDEX;
+
+	for (unsigned int stage = (numObjectives > 1 ? 1 : 0); stage < numObjectives; stage++) {
+		label = search_labels(sourceIndex, targetIndex, request.objectives, stage, limits, request.maxLabels);
+		if (label == LOSMGraph::INVALID_INDEX) {
+			return;
+		}
+
+		float optimal = labelCosts[label * numObjectives + stage];
+		limits[stage] = optimal + request.objectives[stage].slack +
+				LEXICOGRAPHIC_TOLERANCE * std::max(1.0f, optimal);
+	}
+
+	// Follow the parents back from the target's label, then reverse them.
+	route.found = true;
+	route.costs.assign(numObjectives, 0.0f);
+	route.nodes.push_back(graph->get_node(labels[label].node));
+
+	for (unsigned int current = label; labels[current].parent != LOSMGraph::INVALID_INDEX;
+			current = labels[current].parent) {
+		unsigned int edge = labels[current].edge;
+		for (unsigned int i = 0; i < numObjectives; i++) {
+			route.costs[i] += get_objective_cost(request.objectives[i], edge);
+		}
+
+		route.edges.push_back(graph->get_edge(edge));
+		route.nodes.push_back(graph->get_node(labels[labels[current].parent].node));
+	}
+
+	std::reverse(route.nodes.begin(), route.nodes.end());
+	std::reverse(route.edges.begin(), route.edges.end());
+}
+
+void LOSMQueryContext::find_k_shortest_routes(const LOSMKShortestRequest &request, std::vector<LOSMRoute> &routes)
+{
+	LOSM_INSTRUMENT(LOSMOperation::FIND_K_SHORTEST_ROUTES);
+
+	unsigned int sourceIndex = graph->get_node_index(request.source);
+	unsigned int targetIndex = graph->get_node_index(request.target);
+
+	routes.clear();
+	if (request.k == 0) {
+		return;
+	}
+
+	// The reverse search gives the exact cost to the target of every node, which guides every
+	// spur search, and its tree gives the cheapest route itself.
+	search_reverse(targetIndex, INFINITY, request.cost);
+	if (reverseStamps[sourceIndex] != currentReverseStamp) {
+		return;
+	}
+
+	const unsigned int *edgeNodes = graph->get_edge_nodes_array();
+
+	std::vector<Path> found(1);
+	found[0].nodes.push_back(sourceIndex);
+	found[0].cost = 0.0f;
+	found[0].deviation = 0;
+
+	for (unsigned int node = sourceIndex; node != targetIndex; node = found[0].nodes.back()) {
+		unsigned int edge = reverseParentEdges[node];
+		found[0].edges.push_back(edge);
+		found[0].nodes.push_back(edgeNodes[2 * edge] == node ? edgeNodes[2 * edge + 1] : edgeNodes[2 * edge]);
+		found[0].cost += graph->get_edge_cost(edge, request.cost);
+	}
+
+	std::vector<Path> candidates;
+	std::set<std::vector<unsigned int> > seen;
+	seen.insert(found[0].edges);
+
+	while (found.size() < request.k) {
+		const Path &previous = found.back();
+
+		// Spurs before the previous route's deviation were already taken from its parent.
+		for (unsigned int i = previous.deviation; i + 1 < previous.nodes.size(); i++) {
+			clear_blocks();
+
+			// The root may not be revisited, and the spur may not leave the root the way any
+			// route found so far with the same root did.
+			for (unsigned int j = 0; j < i; j++) {
+				nodeBlocks[previous.nodes[j]] = currentBlock;
+			}
+			for (const Path &path : found) {
+				if (path.edges.size() > i && std::equal(path.edges.begin(), path.edges.begin() + i,
+						previous.edges.begin())) {
+					edgeBlocks[path.edges[i]] = currentBlock;
+				}
+			}
+
+			if (search_guided(previous.nodes[i], targetIndex, request.cost) == INFINITY) {
+				continue;
+			}
+
+			Path candidate;
+			candidate.nodes.assign(previous.nodes.begin(), previous.nodes.begin() + i + 1);
+			candidate.edges.assign(previous.edges.begin(), previous.edges.begin() + i);
+			candidate.deviation = i;
+			append_path(previous.nodes[i], targetIndex, candidate);
+
+			candidate.cost = 0.0f;
+			for (unsigned int edge : candidate.edges) {
+				candidate.cost += graph->get_edge_cost(edge, request.cost);
+			}
+
+			if (seen.insert(candidate.edges).second) {
+				candidates.push_back(std::move(candidate));
+			}
+		}
+
+		if (candidates.empty()) {
+			break;
+		}
+
+		// Take the cheapest candidate, breaking ties by fewer edges.
+		unsigned int best = 0;
+		for (unsigned int i = 1; i < candidates.size(); i++) {
+			if (candidates[i].cost < candidates[best].cost || (candidates[i].cost == candidates[best].cost &&
+					candidates[i].edges.size() < candidates[best].edges.size())) {
+				best = i;
+			}
+		}
+
+		found.push_back(std::move(candidates[best]));
+		candidates[best] = std::move(candidates.back());
+		candidates.pop_back();
+	}
+
+	clear_blocks();
+
+	routes.resize(found.size());
+	for (unsigned int i = 0; i < found.size(); i++) {
+		convert_path(found[i], routes[i]);
+	}
+}
+
+void LOSMQueryContext::find_alternative_routes(const LOSMAlternativeRequest &request, std::vector<LOSMRoute> &routes)
+{
+	LOSM_INSTRUMENT(LOSMOperation::FIND_ALTERNATIVE_ROUTES);
+
+	unsigned int sourceIndex = graph->get_node_index(request.source);
+	unsigned int targetIndex = graph->get_node_index(request.target);
+
+	routes.clear();
+	if (request.maxRoutes == 0) {
+		return;
+	}
+
+	float optimal = search(sourceIndex, targetIndex, request.cost);
+	if (optimal == INFINITY) {
+		return;
+	}
+
+	// Only nodes within the stretch bound of both ends can be on an acceptable route.
+	float budget = optimal * std::max(1.0f, request.maxStretch);
+	search_bounded(sourceIndex, budget, request.cost);
+	search_reverse(targetIndex, budget, request.cost);
+
+	const unsigned int *edgeNodes = graph->get_edge_nodes_array();
+
+	std::vector<Path> found(1);
+	found[0].nodes.push_back(sourceIndex);
+	found[0].deviation = 0;
+	append_path(sourceIndex, targetIndex, found[0]);
+
+	found[0].cost = 0.0f;
+	for (unsigned int edge : found[0].edges) {
+		found[0].cost += graph->get_edge_cost(edge, request.cost);
+	}
+
+	std::vector<std::vector<unsigned int> > foundEdges(1, found[0].edges);
+	std::sort(foundEdges[0].begin(), foundEdges[0].end());
+
+	// Keep a candidate if it has no loops, is within the stretch bound, and shares little
+	// enough with every route kept so far.
+	auto accept = [&](Path &candidate) {
+		clear_blocks();
+		for (unsigned int node : candidate.nodes) {
+			if (nodeBlocks[node] == currentBlock) {
+				return false;
+			}
+			nodeBlocks[node] = currentBlock;
+		}
+
+		candidate.cost = 0.0f;
+		for (unsigned int edge : candidate.edges) {
+			candidate.cost += graph->get_edge_cost(edge, request.cost);
+		}
+		if (candidate.cost > budget) {
+			return false;
+		}
+
+		for (const std::vector<unsigned int> &edges : foundEdges) {
+			float shared = 0.0f;
+			for (unsigned int edge : candidate.edges) {
+				if (std::binary_search(edges.begin(), edges.end(), edge)) {
+					shared += graph->get_edge_cost(edge, request.cost);
+				}
+			}
+			if (shared > request.maxSharing * candidate.cost) {
+				return false;
+			}
+		}
+
+		found.push_back(candidate);
+		foundEdges.push_back(candidate.edges);
+		std::sort(foundEdges.back().begin(), foundEdges.back().end());
+		return true;
+	};
+
+	// An edge is on a plateau if it is in both the forward and reverse trees. Each plateau is
+	// a chain ending at a node with no plateau edge towards the target, from which it is
+	// walked back to find its cost; the cheapest route through it passes through that end.
+	auto plateau_edge = [&](unsigned int node, unsigned int &next) {
+		if (reverseStamps[node] != currentReverseStamp || reverseParentEdges[node] == LOSMGraph::INVALID_INDEX) {
+			return false;
+		}
+		unsigned int edge = reverseParentEdges[node];
+		next = (edgeNodes[2 * edge] == node ? edgeNodes[2 * edge + 1] : edgeNodes[2 * edge]);
+		return (stamps[next] == currentStamp && parentEdges[next] == edge);
+	};
+
+	std::vector<std::pair<float, unsigned int> > plateaus;
+	for (unsigned int node : settled) {
+		unsigned int next = LOSMGraph::INVALID_INDEX;
+		if (reverseStamps[node] != currentReverseStamp || costs[node] + reverseCosts[node] > budget ||
+				plateau_edge(node, next)) {
+			continue;
+		}
+
+		unsigned int start = node;
+		while (parentEdges[start] != LOSMGraph::INVALID_INDEX) {
+			unsigned int edge = parentEdges[start];
+			unsigned int previous = (edgeNodes[2 * edge] == start ? edgeNodes[2 * edge + 1] : edgeNodes[2 * edge]);
+			if (!plateau_edge(previous, next) || next != start) {
+				break;
+			}
+			start = previous;
+		}
+
+		if (start != node) {
+			plateaus.push_back(std::make_pair(costs[node] - costs[start], node));
+		}
+	}
+
+	std::sort(plateaus.begin(), plateaus.end(), [](const std::pair<float, unsigned int> &a,
+			const std::pair<float, unsigned int> &b) {
+		return a.first > b.first || (a.first == b.first && a.second < b.second);
+	});
+
+	for (unsigned int i = 0; i < plateaus.size() && found.size() < request.maxRoutes; i++) {
+		unsigned int via = plateaus[i].second;
+
+		Path candidate;
+		candidate.nodes.push_back(sourceIndex);
+		candidate.deviation = 0;
+		append_path(sourceIndex, via, candidate);
+
+		for (unsigned int node = via; node != targetIndex; node = candidate.nodes.back()) {
+			unsigned int edge = reverseParentEdges[node];
+			candidate.edges.push_back(edge);
+			candidate.nodes.push_back(edgeNodes[2 * edge] == node ? edgeNodes[2 * edge + 1] : edgeNodes[2 * edge]);
+		}
+
+		accept(candidate);
+	}
+
+	// Penalize the edges of every route found, kept or not, so each search is pushed away from
+	// them. The penalties only raise costs, so the reverse costs still guide the search.
+	if (found.size() < request.maxRoutes && request.penalty > 0.0f) {
+		std::vector<unsigned int> penalized;
+		auto penalize = [&](const std::vector<unsigned int> &edges) {
+			for (unsigned int edge : edges) {
+				if (edgeFactors[edge] == 1.0f) {
+					penalized.push_back(edge);
+				}
+				edgeFactors[edge] *= 1.0f + request.penalty;
+			}
+		};
+
+		clear_blocks();
+		for (const Path &path : found) {
+			penalize(path.edges);
+		}
+
+		for (unsigned int i = 0; i < PENALTY_SEARCHES_PER_ROUTE * request.maxRoutes &&
+				found.size() < request.maxRoutes; i++) {
+			clear_blocks();
+			if (search_guided(sourceIndex, targetIndex, request.cost) == INFINITY) {
+				break;
+			}
+
+			Path candidate;
+			candidate.nodes.push_back(sourceIndex);
+			candidate.deviation = 0;
+			append_path(sourceIndex, targetIndex, candidate);
+
+			penalize(candidate.edges);
+			accept(candidate);
+		}
+
+		for (unsigned int edge : penalized) {
+			edgeFactors[edge] = 1.0f;
+		}
+	}
+
+	clear_blocks();
+
+	std::stable_sort(found.begin(), found.end(), [](const Path &a, const Path &b) {
+		return a.cost < b.cost;
+	});
+
+	routes.resize(found.size());
+	for (unsigned int i = 0; i < found.size(); i++) {
+		convert_path(found[i], routes[i]);
+	}
+}
+
+float LOSMQueryContext::search(unsigned int source, unsigned int target, LOSMCost cost)
+{
+	LOSM_INSTRUMENT(LOSMOperation::SEARCH);
+
+	// Invalidate every cost from the previous search by advancing the stamp. Only when the
+	// stamp wraps around do the stamps themselves need to be cleared.
+	currentStamp++;
+	if (currentStamp == 0) {
+		std::fill(stamps.begin(), stamps.end(), 0);
+		currentStamp = 1;
+	}
+
+	std::greater<std::pair<float, unsigned int> > compare;
+	heap.clear();
+
+	costs[source] = 0.0f;
+	parentEdges[source] = LOSMGraph::INVALID_INDEX;
+	stamps[source] = currentStamp;
+	heap.push_back(std::make_pair(0.0f, source));
+
+	while (!heap.empty()) {
+		std::pop_heap(heap.begin(), heap.end(), compare);
+		float nodeCost = heap.back().first;
+		unsigned int node = heap.back().second;
+		heap.pop_back();
+
+		// Skip stale entries which were superseded by a cheaper path.
+		if (nodeCost > costs[node]) {
+			continue;
+		}
+
+		if (node == target) {
+			return nodeCost;
+		}
+
+		for (unsigned int slot = graph->get_adjacency_begin(node); slot < graph->get_adjacency_end(node); slot++) {
+			unsigned int neighbor = graph->get_adjacent_node(slot);
+			unsigned int edge = graph->get_adjacent_edge(slot);
+			float neighborCost = nodeCost + graph->get_edge_cost(edge, cost);
+
+			if (stamps[neighbor] != currentStamp || neighborCost < costs[neighbor]) {
+				costs[neighbor] = neighborCost;
+				parentEdges[neighbor] = edge;
+				stamps[neighbor] = currentStamp;
+
+				heap.push_back(std::make_pair(neighborCost, neighbor));
+				std::push_heap(heap.begin(), heap.end(), compare);
+			}
+		}
+	}
+
+	return INFINITY;
+}
+
+float LOSMQueryContext::search_time_dependent(unsigned int source, unsigned int target,
+		const LOSMSpeedProfiles &profiles, float departure)
+{
+	LOSM_INSTRUMENT(LOSMOperation::SEARCH_TIME_DEPENDENT);
+
+	if (profiles.get_graph() != graph.get()) {
+		std::cerr << "Error[LOSMQueryContext::search_time_dependent]: The profiles are of a different graph." << std::endl;
+		throw LOSMException();
+	}
+
+	currentStamp++;
+	if (currentStamp == 0) {
+		std::fill(stamps.begin(), stamps.end(), 0);
+		currentStamp = 1;
+	}
+
+	const int *fixedX = graph->get_fixed_x_array();
+	const int *fixedY = graph->get_fixed_y_array();
+	float hoursPerMile = A_STAR_BOUND_FACTOR / profiles.get_max_speed();
+
+	// The heap is ordered by the travel time plus a lower bound on the rest, if there is a target.
+	auto bound = [&](unsigned int node) {
+		if (target == LOSMGraph::INVALID_INDEX) {
+			return 0.0f;
+		}
+		return haversine_distance(fixedX[node], fixedY[node], fixedX[target], fixedY[target]) * hoursPerMile;
+	};
+
+	std::greater<std::pair<float, unsigned int> > compare;
+	heap.clear();
+
+	costs[source] = 0.0f;
+	parentEdges[source] = LOSMGraph::INVALID_INDEX;
+	stamps[source] = currentStamp;
+	heap.push_back(std::make_pair(bound(source), source));
+
+	while (!heap.empty()) {
+		std::pop_heap(heap.begin(), heap.end(), compare);
+		float nodePriority = heap.back().first;
+		unsigned int node = heap.back().second;
+		heap.pop_back();
+
+		float nodeCost = costs[node];
+		if (nodePriority > nodeCost + bound(node)) {
+			continue;
+		}
+
+		if (node == target) {
+			return nodeCost;
+		}
+
+		// Since the profiles are FIFO, arriving at a node earlier never arrives anywhere later.
+		for (unsigned int slot = graph->get_adjacency_begin(node); slot < graph->get_adjacency_end(node); slot++) {
+			unsigned int neighbor = graph->get_adjacent_node(slot);
+			unsigned int edge = graph->get_adjacent_edge(slot);
+			float neighborCost = nodeCost + profiles.get_travel_time(edge, departure + nodeCost);
+
+			if (stamps[neighbor] != currentStamp || neighborCost < costs[neighbor]) {
+				costs[neighbor] = neighborCost;
+				parentEdges[neighbor] = edge;
+				stamps[neighbor] = currentStamp;
+
+				heap.push_back(std::make_pair(neighborCost + bound(neighbor), neighbor));
+				std::push_heap(heap.begin(), heap.end(), compare);
+			}
+		}
+	}
+
+	return INFINITY;
+}
+
+void LOSMQueryContext::search_bounded(unsigned int source, float budget, LOSMCost cost)
+{
+	LOSM_INSTRUMENT(LOSMOperation::SEARCH_BOUNDED);
+
+	currentStamp++;
+	if (currentStamp == 0) {
+		std::fill(stamps.begin(), stamps.end(), 0);
+		currentStamp = 1;
+	}
+
+	std::greater<std::pair<float, unsigned int> > compare;
+	heap.clear();
+	settled.clear();
+
+	if (!(budget >= 0.0f)) {
+		return;
+	}
+
+	costs[source] = 0.0f;
+	parentEdges[source] = LOSMGraph::INVALID_INDEX;
+	stamps[source] = currentStamp;
+	heap.push_back(std::make_pair(0.0f, source));
+
+	while (!heap.empty()) {
+		std::pop_heap(heap.begin(), heap.end(), compare);
+		float nodeCost = heap.back().first;
+		unsigned int node = heap.back().second;
+		heap.pop_back();
+
+		if (nodeCost > costs[node]) {
+			continue;
+		}
+
+		settled.push_back(node);
+
+		// Only nodes within the budget are ever stamped, so every stamped node is settled.
+		for (unsigned int slot = graph->get_adjacency_begin(node); slot < graph->get_adjacency_end(node); slot++) {
+			unsigned int neighbor = graph->get_adjacent_node(slot);
+			unsigned int edge = graph->get_adjacent_edge(slot);
+			float neighborCost = nodeCost + graph->get_edge_cost(edge, cost);
+
+			if (neighborCost <= budget && (stamps[neighbor] != currentStamp || neighborCost < costs[neighbor])) {
+				costs[neighbor] = neighborCost;
+				parentEdges[neighbor] = edge;
+				stamps[neighbor] = currentStamp;
+
+				heap.push_back(std::make_pair(neighborCost, neighbor));
+				std::push_heap(heap.begin(), heap.end(), compare);
+			}
+		}
+	}
+}
+
+const std::vector<unsigned int> &LOSMQueryContext::get_settled_nodes() const
+{
+	return settled;
+}
+
+float LOSMQueryContext::get_cost(unsigned int node) const
+{
+	if (stamps[node] != currentStamp) {
+		return INFINITY;
+	}
+	return costs[node];
+}
+
+unsigned int LOSMQueryContext::get_parent_edge(unsigned int node) const
+{
+	if (stamps[node] != currentStamp) {
+		return LOSMGraph::INVALID_INDEX;
+	}
+	return parentEdges[node];
+}
+
+void LOSMQueryContext::build_route(unsigned int source, unsigned int target, LOSMRoute &route) const
+{
+	// Follow the parent edges back from the target, then reverse them.
+	const unsigned int *edgeNodes = graph->get_edge_nodes_array();
+
+	unsigned int current = target;
+	route.nodes.push_back(graph->get_node(current));
+
+	while (current != source) {
+		unsigned int edge = parentEdges[current];
+		route.edges.push_back(graph->get_edge(edge));
+
+		unsigned int previous = edgeNodes[2 * edge];
+		if (previous == current) {
+			previous = edgeNodes[2 * edge + 1];
+		}
+
+		current = previous;
+		route.nodes.push_back(graph->get_node(current));
+	}
+
+	std::reverse(route.nodes.begin(), route.nodes.end());
+	std::reverse(route.edges.begin(), route.edges.end());
+}
+
+void LOSMQueryContext::search_reverse(unsigned int target, float budget, LOSMCost cost)
+{
+	// The reverse arrays are only allocated by the first query which needs them.
+	if (reverseCosts.empty()) {
+		reverseCosts.resize(graph->get_num_nodes(), INFINITY);
+		reverseParentEdges.resize(graph->get_num_nodes(), LOSMGraph::INVALID_INDEX);
+		reverseStamps.resize(graph->get_num_nodes(), 0);
+	}
+
+	currentReverseStamp++;
+	if (currentReverseStamp == 0) {
+		std::fill(reverseStamps.begin(), reverseStamps.end(), 0);
+		currentReverseStamp = 1;
+	}
+
+	std::greater<std::pair<float, unsigned int> > compare;
+	heap.clear();
+
+	reverseCosts[target] = 0.0f;
+	reverseParentEdges[target] = LOSMGraph::INVALID_INDEX;
+	reverseStamps[target] = currentReverseStamp;
+	heap.push_back(std::make_pair(0.0f, target));
+
+	// Edges are undirected, so the costs to the target are those from it.
+	while (!heap.empty()) {
+		std::pop_heap(heap.begin(), heap.end(), compare);
+		float nodeCost = heap.back().first;
+		unsigned int node = heap.back().second;
+		heap.pop_back();
+
+		if (nodeCost > reverseCosts[node]) {
+			continue;
+		}
+
+		for (unsigned int slot = graph->get_adjacency_begin(node); slot < graph->get_adjacency_end(node); slot++) {
+			unsigned int neighbor = graph->get_adjacent_node(slot);
+			unsigned int edge = graph->get_adjacent_edge(slot);
+			float neighborCost = nodeCost + graph->get_edge_cost(edge, cost);
+
+			if (neighborCost <= budget && (reverseStamps[neighbor] != currentReverseStamp ||
+					neighborCost < reverseCosts[neighbor])) {
+				reverseCosts[neighbor] = neighborCost;
+				reverseParentEdges[neighbor] = edge;
+				reverseStamps[neighbor] = currentReverseStamp;
+
+				heap.push_back(std::make_pair(neighborCost, neighbor));
+				std::push_heap(heap.begin(), heap.end(), compare);
+			}
+		}
+	}
+}
+
+float LOSMQueryContext::search_guided(unsigned int source, unsigned int target, LOSMCost cost)
+{
+	currentStamp++;
+	if (currentStamp == 0) {
+		std::fill(stamps.begin(), stamps.end(), 0);
+		currentStamp = 1;
+	}
+
+	auto bound = [this](unsigned int node) {
+		return reverseCosts[node] * GUIDED_BOUND_FACTOR;
+	};
+
+	std::greater<std::pair<float, unsigned int> > compare;
+	heap.clear();
+
+	costs[source] = 0.0f;
+	parentEdges[source] = LOSMGraph::INVALID_INDEX;
+	stamps[source] = currentStamp;
+	heap.push_back(std::make_pair(bound(source), source));
+
+	while (!heap.empty()) {
+		std::pop_heap(heap.begin(), heap.end(), compare);
+		float nodePriority = heap.back().first;
+		unsigned int node = heap.back().second;
+		heap.pop_back();
+
+		float nodeCost = costs[node];
+		if (nodePriority > nodeCost + bound(node)) {
+			continue;
+		}
+
+		if (node == target) {
+			return nodeCost;
+		}
+
+		for (unsigned int slot = graph->get_adjacency_begin(node); slot < graph->get_adjacency_end(node); slot++) {
+			unsigned int neighbor = graph->get_adjacent_node(slot);
+			unsigned int edge = graph->get_adjacent_edge(slot);
+
+			if (reverseStamps[neighbor] != currentReverseStamp || nodeBlocks[neighbor] == currentBlock ||
+					edgeBlocks[edge] == currentBlock) {
+				continue;
+			}
+
+			float neighborCost = nodeCost + graph->get_edge_cost(edge, cost) * edgeFactors[edge];
+
+			if (stamps[neighbor] != currentStamp || neighborCost < costs[neighbor]) {
+				costs[neighbor] = neighborCost;
+				parentEdges[neighbor] = edge;
+				stamps[neighbor] = currentStamp;
+
+				heap.push_back(std::make_pair(neighborCost + bound(neighbor), neighbor));
+				std::push_heap(heap.begin(), heap.end(), compare);
+			}
+		}
+	}
+
+	return INFINITY;
+}
+
+void LOSMQueryContext::append_path(unsigned int source, unsigned int target, Path &path) const
+{
+	const unsigned int *edgeNodes = graph->get_edge_nodes_array();
+	unsigned int first = path.edges.size();
+
+	// Follow the parent edges back from the target, then reverse the appended part.
+	for (unsigned int current = target; current != source; ) {
+		unsigned int edge = parentEdges[current];
+		path.edges.push_back(edge);
+		path.nodes.push_back(current);
+		current = (edgeNodes[2 * edge] == current ? edgeNodes[2 * edge + 1] : edgeNodes[2 * edge]);
+	}
+
+	std::reverse(path.edges.begin() + first, path.edges.end());
+	std::reverse(path.nodes.begin() + first + 1, path.nodes.end());
+}
+
+void LOSMQueryContext::clear_blocks()
+{
+	// The block arrays are only allocated by the first query which needs them.
+	if (nodeBlocks.empty()) {
+		nodeBlocks.resize(graph->get_num_nodes(), 0);
+		edgeBlocks.resize(graph->get_num_edges(), 0);
+		edgeFactors.resize(graph->get_num_edges(), 1.0f);
+	}
+
+	currentBlock++;
+	if (currentBlock == 0) {
+		std::fill(nodeBlocks.begin(), nodeBlocks.end(), 0);
+		std::fill(edgeBlocks.begin(), edgeBlocks.end(), 0);
+		currentBlock = 1;
+	}
+}
+
+void LOSMQueryContext::convert_path(const Path &path, LOSMRoute &route) const
+{
+	route.found = true;
+	route.cost = path.cost;
+
+	route.nodes.clear();
+	for (unsigned int node : path.nodes) {
+		route.nodes.push_back(graph->get_node(node));
+	}
+
+	route.edges.clear();
+	for (unsigned int edge : path.edges) {
+		route.edges.push_back(graph->get_edge(edge));
+	}
+}
+
+float LOSMQueryContext::get_objective_cost(const LOSMObjective &objective, unsigned int edge) const
+{
+	if (objective.edgeCosts != nullptr) {
+		return (*objective.edgeCosts)[edge];
+	}
+	return graph->get_edge_cost(edge, objective.cost);
+}
+
+bool LOSMQueryContext::compute_bounds(unsigned int source, unsigned int target,
+		const std::vector<LOSMObjective> &objectives, std::vector<float> &limits)
+{
+	unsigned int numNodes = graph->get_num_nodes();
+
+	if (bounds.size() < objectives.size() * numNodes) {
+		bounds.resize(objectives.size() * numNodes);
+	}
+	if (boundStamps.size() != numNodes) {
+		boundStamps.assign(numNodes, 0);
+		currentBoundStamp = 0;
+	}
+
+	currentBoundStamp++;
+	if (currentBoundStamp == 0) {
+		std::fill(boundStamps.begin(), boundStamps.end(), 0);
+		currentBoundStamp = 1;
+	}
+
+	std::greater<std::pair<float, unsigned int> > compare;
+
+	// The edges are undirected, so each bound is a search from the target. The first objective's
+	// search stops once its limit is known and exceeded; the nodes it settled are the only ones
+	// on routes which meet it, so the later objectives' searches stay among them.
+	for (unsigned int i = 0; i < objectives.size(); i++) {
+		currentStamp++;
+		if (currentStamp == 0) {
+			std::fill(stamps.begin(), stamps.end(), 0);
+			currentStamp = 1;
+		}
+
+		heap.clear();
+		settled.clear();
+
+		costs[target] = 0.0f;
+		stamps[target] = currentStamp;
+		heap.push_back(std::make_pair(0.0f, target));
+
+		while (!heap.empty()) {
+			std::pop_heap(heap.begin(), heap.end(), compare);
+			float nodeCost = heap.back().first;
+			unsigned int node = heap.back().second;
+			heap.pop_back();
+
+			if (nodeCost > costs[node]) {
+				continue;
+			}
+
+			if (i == 0) {
+				if (nodeCost > limits[0]) {
+					break;
+				}
+
+				if (node == source) {
+					limits[0] = nodeCost + objectives[0].slack + LEXICOGRAPHIC_TOLERANCE * std::max(1.0f, nodeCost);
+				}
+			}
+
+			settled.push_back(node);
+
+			for (unsigned int slot = graph->get_adjacency_begin(node); slot < graph->get_adjacency_end(node); slot++) {
+				unsigned int neighbor = graph->get_adjacent_node(slot);
+				if (i > 0 && boundStamps[neighbor] != currentBoundStamp) {
+					continue;
+				}
+
+				float neighborCost = nodeCost + get_objective_cost(objectives[i], graph->get_adjacent_edge(slot));
+				if (stamps[neighbor] != currentStamp || neighborCost < costs[neighbor]) {
+					costs[neighbor] = neighborCost;
+					stamps[neighbor] = currentStamp;
+
+					heap.push_back(std::make_pair(neighborCost, neighbor));
+					std::push_heap(heap.begin(), heap.end(), compare);
+				}
+			}
+		}
+
+		if (i == 0 && limits[0] == INFINITY) {
+			return false;
+		}
+
+		for (unsigned int node : settled) {
+			bounds[i * numNodes + node] = costs[node];
+			if (i == 0) {
+				boundStamps[node] = currentBoundStamp;
+			}
+		}
+	}
+
+	settled.clear();
+
+	return true;
+}
+
+unsigned int LOSMQueryContext::search_labels(unsigned int source, unsigned int target,
+		const std::vector<LOSMObjective> &objectives, unsigned int stage, const std::vector<float> &limits,
+		unsigned int maxLabels)
+{
+	unsigned int numNodes = graph->get_num_nodes();
+	unsigned int numObjectives = (unsigned int)objectives.size();
+
+	// The labels at each node are only valid for this stage.
+	currentStamp++;
+	if (currentStamp == 0) {
+		std::fill(stamps.begin(), stamps.end(), 0);
+		currentStamp = 1;
+	}
+
+	if (labelHeads.size() != numNodes) {
+		labelHeads.resize(numNodes);
+	}
+
+	std::greater<std::pair<float, unsigned int> > compare;
+	heap.clear();
+	labels.clear();
+	labelCosts.clear();
+
+	Label first = {source, LOSMGraph::INVALID_INDEX, LOSMGraph::INVALID_INDEX, LOSMGraph::INVALID_INDEX, true};
+	labels.push_back(first);
+	labelCosts.resize(numObjectives, 0.0f);
+	labelHeads[source] = 0;
+	stamps[source] = currentStamp;
+	heap.push_back(std::make_pair(bounds[stage * numNodes + source], 0));
+
+	std::vector<float> extended(stage + 1);
+
+	while (!heap.empty()) {
+		std::pop_heap(heap.begin(), heap.end(), compare);
+		unsigned int label = heap.back().second;
+		heap.pop_back();
+
+		if (!labels[label].live) {
+			continue;
+		}
+
+		unsigned int node = labels[label].node;
+		if (node == target) {
+			return label;
+		}
+
+		for (unsigned int slot = graph->get_adjacency_begin(node); slot < graph->get_adjacency_end(node); slot++) {
+			unsigned int neighbor = graph->get_adjacent_node(slot);
+			unsigned int edge = graph->get_adjacent_edge(slot);
+			if (boundStamps[neighbor] != currentBoundStamp) {
+				continue;
+			}
+
+			// Prune the extension if it can no longer meet an earlier objective's limit.
+			bool feasible = true;
+			for (unsigned int i = 0; i <= stage; i++) {
+				extended[i] = labelCosts[label * numObjectives + i] + get_objective_cost(objectives[i], edge);
+				if (i < stage && extended[i] + bounds[i * numNodes + neighbor] > limits[i]) {
+					feasible = false;
+					break;
+				}
+			}
+			if (!feasible) {
+				continue;
+			}
+
+			if (stamps[neighbor] != currentStamp) {
+				labelHeads[neighbor] = LOSMGraph::INVALID_INDEX;
+				stamps[neighbor] = currentStamp;
+			}
+
+			// Discard the extension if a label at the neighbor dominates it, and otherwise unlink
+			// the labels it dominates.
+			bool dominated = false;
+			unsigned int *link = &labelHeads[neighbor];
+
+			while (*link != LOSMGraph::INVALID_INDEX) {
+				const float *other = &labelCosts[*link * numObjectives];
+
+				bool otherDominates = true;
+				bool extendedDominates = true;
+				for (unsigned int i = 0; i <= stage; i++) {
+					otherDominates = otherDominates && (other[i] <= extended[i]);
+					extendedDominates = extendedDominates && (extended[i] <= other[i]);
+				}
+
+				if (otherDominates) {
+					dominated = true;
+					break;
+				}
+
+				if (extendedDominates) {
+					labels[*link].live = false;
+					*link = labels[*link].next;
+				} else {
+					link = &labels[*link].next;
+				}
+			}
+
+			if (dominated) {
+				continue;
+			}
+
+			if (maxLabels > 0 && labels.size() >= maxLabels) {
+				return LOSMGraph::INVALID_INDEX;
+			}
+
+			unsigned int extension = (unsigned int)labels.size();
+			Label next = {neighbor, label, edge, labelHeads[neighbor], true};
+			labels.push_back(next);
+			labelCosts.insert(labelCosts.end(), extended.begin(), extended.end());
+			labelCosts.resize(labelCosts.size() + numObjectives - extended.size(), 0.0f);
+			labelHeads[neighbor] = extension;
+
+			heap.push_back(std::make_pair(extended[stage] + bounds[stage * numNodes + neighbor], extension));
+			std::push_heap(heap.begin(), heap.end(), compare);
+		}
+	}
+
+	return LOSMGraph::INVALID_INDEX;
+}
@@ -0,0 +1,221 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "../include/losm_query_executor.h"
+#include "../include/losm_exception.h"
+
+#include <iostream>
+
+LOSMQueryExecutor::LOSMQueryExecutor(std::shared_ptr<const LOSMGraph> graph, unsigned int numThreads)
+{
+	if (graph == nullptr) {
+		std::cerr << "Error[LOSMQueryExecutor::LOSMQueryExecutor]: The graph provided was null." << std::endl;
+		throw LOSMException();
+	}
+
+	this->graph = graph;
+
+	pool.reset(new LOSMThreadPool(numThreads));
+
+	for (unsigned int i = 0; i < pool->get_num_threads(); i++) {
+		contexts.push_back(std::unique_ptr<LOSMQueryContext>(new LOSMQueryContext(graph)));
+	}
+}
+
+LOSMQueryExecutor::~LOSMQueryExecutor()
+{
+	pool.reset();
+}
+
+std::shared_ptr<const LOSMGraph> LOSMQueryExecutor::get_graph() const
+{
+	return graph;
+}
+
+std::future<std::vector<const LOSMNode *> > LOSMQueryExecutor::find_nearest_nodes(
+		const std::vector<LOSMNearestNodeRequest> &requests)
+{
+	std::shared_ptr<std::vector<LOSMNearestNodeRequest> > input(new std::vector<LOSMNearestNodeRequest>(requests));
+
+	return run_batch<const LOSMNode *>(input->size(),
+		[input](unsigned int i, LOSMQueryContext &context, const LOSMNode *&node) {
+			node = context.find_nearest_node((*input)[i].x, (*input)[i].y);
+		});
+}
+
+std::future<std::vector<LOSMEdgeProjection> > LOSMQueryExecutor::find_nearest_edges(
+		const std::vector<LOSMNearestNodeRequest> &requests, std::shared_ptr<const LOSMEdgeIndex> index)
+{
+	if (index == nullptr || index->get_graph() != graph) {
+		std::cerr << "Error[LOSMQueryExecutor::find_nearest_edges]: The index is not of this graph." << std::endl;
+		std::promise<std::vector<LOSMEdgeProjection> > promise;
+		promise.set_exception(std::make_exception_ptr(LOSMException()));
+		return promise.get_future();
+	}
+
+	std::shared_ptr<std::vector<LOSMNearestNodeRequest> > input(new std::vector<LOSMNearestNodeRequest>(requests));
+
+	return run_batch<LOSMEdgeProjection>(input->size(),
+		[input, index](unsigned int i, LOSMQueryContext &/* context */, LOSMEdgeProjection &projection) {
+			index->find_nearest_edge((*input)[i].x, (*input)[i].y, projection);
+		});
+}
+
+std::future<std::vector<LOSMRoute> > LOSMQueryExecutor::find_routes(const std::vector<LOSMRouteRequest> &requests)
+{
+	std::shared_ptr<std::vector<LOSMRouteRequest> > input(new std::vector<LOSMRouteRequest>(requests));
+
+	return run_batch<LOSMRoute>(input->size(),
+		[input](unsigned int i, LOSMQueryContext &context, LOSMRoute &route) {
+			const LOSMRouteRequest &request = (*input)[i];
+			context.find_route(request.source, request.target, request.cost, route);
+		});
+}
+
+std::future<std::vector<float> > LOSMQueryExecutor::find_distances(const std::vector<LOSMRouteRequest> &requests)
+{
+	std::shared_ptr<std::vector<LOSMRouteRequest> > input(new std::vector<LOSMRouteRequest>(requests));
+
+	return run_batch<float>(input->size(),
+		[input](unsigned int i, LOSMQueryContext &context, float &distance) {
+			const LOSMRouteRequest &request = (*input)[i];
+			distance = context.find_distance(request.source, request.target, request.cost);
+		});
+}
+
+std::future<void> LOSMQueryExecutor::find_routes(const std::vector<LOSMRouteRequest> &requests,
+		std::function<void (unsigned int, const LOSMRoute &)> callback)
+{
+	std::shared_ptr<std::vector<LOSMRouteRequest> > input(new std::vector<LOSMRouteRequest>(requests));
+
+	return run_batch(input->size(),
+		[input, callback](unsigned int i, LOSMQueryContext &context) {
+			const LOSMRouteRequest &request = (*input)[i];
+			LOSMRoute route;
+			context.find_route(request.source, request.target, request.cost, route);
+			callback(i, route);
+		});
+}
+
+std::future<void> LOSMQueryExecutor::find_distances(const std::vector<LOSMRouteRequest> &requests,
+		std::function<void (unsigned int, float)> callback)
+{
+	std::shared_ptr<std::vector<LOSMRouteRequest> > input(new std::vector<LOSMRouteRequest>(requests));
+
+	return run_batch(input->size(),
+		[input, callback](unsigned int i, LOSMQueryContext &context) {
+			const LOSMRouteRequest &request = (*input)[i];
+			callback(i, context.find_distance(request.source, request.target, request.cost));
+		});
+}
+
+std::future<std::vector<LOSMRoute> > LOSMQueryExecutor::find_time_dependent_routes(
+		const std::vector<LOSMTimeDependentRouteRequest> &requests,
+		std::shared_ptr<const LOSMSpeedProfiles> profiles)
+{
+	if (profiles == nullptr || profiles->get_graph() != graph.get()) {
+		std::cerr << "Error[LOSMQueryExecutor::find_time_dependent_routes]: The profiles are not of this graph." << std::endl;
+		std::promise<std::vector<LOSMRoute> > promise;
+		promise.set_exception(std::make_exception_ptr(LOSMException()));
+		return promise.get_future();
+	}
+
+	std::shared_ptr<std::vector<LOSMTimeDependentRouteRequest> > input(new std::vector<LOSMTimeDependentRouteRequest>(requests));
+
+	return run_batch<LOSMRoute>(input->size(),
+		[input, profiles](unsigned int i, LOSMQueryContext &context, LOSMRoute &route) {
+			const LOSMTimeDependentRouteRequest &request = (*input)[i];
+			context.find_time_dependent_route(request.source, request.target, *profiles, request.departure, route);
+		});
+}
+
+std::future<std::vector<LOSMReachability> > LOSMQueryExecutor::find_reachable(
+		const std::vector<LOSMReachabilityRequest> &requests)
+{
+	std::shared_ptr<std::vector<LOSMReachabilityRequest> > input(new std::vector<LOSMReachabilityRequest>(requests));
+
+	return run_batch<LOSMReachability>(input->size(),
+		[input](unsigned int i, LOSMQueryContext &context, LOSMReachability &reachability) {
+			context.find_reachable((*input)[i], reachability);
+		});
+}
+
+std::future<void> LOSMQueryExecutor::find_reachable(const std::vector<LOSMReachabilityRequest> &requests,
+		std::function<void (unsigned int, const LOSMReachability &)> callback)
+{
+	std::shared_ptr<std::vector<LOSMReachabilityRequest> > input(new std::vector<LOSMReachabilityRequest>(requests));
+
+	return run_batch(input->size(),
+		[input, callback](unsigned int i, LOSMQueryContext &context) {
+			LOSMReachability reachability;
+			context.find_reachable((*input)[i], reachability);
+			callback(i, reachability);
+		});
+}
+
+std::future<std::vector<LOSMLexicographicRoute> > LOSMQueryExecutor::find_lexicographic_routes(
+		const std::vector<LOSMLexicographicRequest> &requests)
+{
+	std::shared_ptr<std::vector<LOSMLexicographicRequest> > input(new std::vector<LOSMLexicographicRequest>(requests));
+
+	return run_batch<LOSMLexicographicRoute>(input->size(),
+		[input](unsigned int i, LOSMQueryContext &context, LOSMLexicographicRoute &route) {
+			context.find_lexicographic_route((*input)[i], route);
+		});
+}
+
+std::future<void> LOSMQueryExecutor::find_lexicographic_routes(const std::vector<LOSMLexicographicRequest> &requests,
+		std::function<void (unsigned int, const LOSMLexicographicRoute &)> callback)
+{
+	std::shared_ptr<std::vector<LOSMLexicographicRequest> > input(new std::vector<LOSMLexicographicRequest>(requests));
+
+	return run_batch(input->size(),
+		[input, callback](unsigned int i, LOSMQueryContext &context) {
+			LOSMLexicographicRoute route;
+			context.find_lexicographic_route((*input)[i], route);
+			callback(i, route);
+		});
+}
+
+std::future<std::vector<std::vector<LOSMRoute> > > LOSMQueryExecutor::find_k_shortest_routes(
+		const std::vector<LOSMKShortestRequest> &requests)
+{
+	std::shared_ptr<std::vector<LOSMKShortestRequest> > input(new std::vector<LOSMKShortestRequest>(requests));
+
+	return run_batch<std::vector<LOSMRoute> >(input->size(),
+		[input](unsigned int i, LOSMQueryContext &context, std::vector<LOSMRoute> &routes) {
+			context.find_k_shortest_routes((*input)[i], routes);
+		});
+}
+
+std::future<std::vector<std::vector<LOSMRoute> > > LOSMQueryExecutor::find_alternative_routes(
+		const std::vector<LOSMAlternativeRequest> &requests)
+{
+	std::shared_ptr<std::vector<LOSMAlternativeRequest> > input(new std::vector<LOSMAlternativeRequest>(requests));
+
+	return run_batch<std::vector<LOSMRoute> >(input->size(),
+		[input](unsigned int i, LOSMQueryContext &context, std::vector<LOSMRoute> &routes) {
+			context.find_alternative_routes((*input)[i], routes);
+		});
+}
@@ -0,0 +1,507 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "../include/losm_render_geometry.h"
+#include "../include/losm_exception.h"
+#include "../include/losm_utilities.h"
+#include "../include/losm.h"
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <utility>
+#include <cstdint>
+#include <cmath>
+
+/**
+ * The number of tiredness levels and autonomy states of an LMDP policy.
+ */
+static const unsigned int NUM_TIREDNESS_LEVELS = 2;
+static const unsigned int NUM_AUTONOMY_STATES = 2;
+
+/**
+ * The magic number at the start of a render geometry file.
+ */
+static const char RENDER_GEOMETRY_MAGIC[8] = {'L', 'O', 'S', 'M', 'R', 'G', '0', '1'};
+
+/**
+ * Write the contents of a vector to a stream.
+ * @param	stream	The stream.
+ * @param	values	The values to write.
+ */
+template <typename T>
+static void write_vector(std::ostream &stream, const std::vector<T> &values)
+{
+	if (!values.empty()) {
+		stream.write(reinterpret_cast<const char *>(values.data()), values.size() * sizeof(T));
+	}
+}
+
+LOSMRenderGeometry::LOSMRenderGeometry(std::shared_ptr<const LOSMGraph> graph, unsigned int tileResolution,
+		unsigned int numLevels, float tolerance) : graph(graph), tileResolution(tileResolution),
+		numLevels(numLevels)
+{
+	if (graph == nullptr || tileResolution == 0 || numLevels == 0) {
+		std::cerr << "Error[LOSMRenderGeometry::LOSMRenderGeometry]: Invalid graph, tile resolution, or number of levels." << std::endl;
+		throw LOSMException();
+	}
+
+	// Level 0 is exact, and each level after the first is four times coarser than the last.
+	tolerances.push_back(0.0f);
+	for (unsigned int level = 1; level < numLevels; level++) {
+		tolerances.push_back(tolerance * (float)(1 << (2 * (level - 1))));
+	}
+
+	// The bounds include the landmarks, as in the visualizer.
+	int minFixedX = 0;
+	int maxFixedX = 0;
+	int minFixedY = 0;
+	int maxFixedY = 0;
+	bool first = true;
+
+	const int *fixedX = graph->get_fixed_x_array();
+	const int *fixedY = graph->get_fixed_y_array();
+
+	for (unsigned int i = 0; i < graph->get_num_nodes(); i++) {
+		if (first || fixedX[i] < minFixedX) minFixedX = fixedX[i];
+		if (first || fixedX[i] > maxFixedX) maxFixedX = fixedX[i];
+		if (first || fixedY[i] < minFixedY) minFixedY = fixedY[i];
+		if (first || fixedY[i] > maxFixedY) maxFixedY = fixedY[i];
+		first = false;
+	}
+
+	if (graph->get_losm() != nullptr) {
+		for (const LOSMLandmark *landmark : graph->get_losm()->get_landmarks()) {
+			if (first || landmark->get_fixed_x() < minFixedX) minFixedX = landmark->get_fixed_x();
+			if (first || landmark->get_fixed_x() > maxFixedX) maxFixedX = landmark->get_fixed_x();
+			if (first || landmark->get_fixed_y() < minFixedY) minFixedY = landmark->get_fixed_y();
+			if (first || landmark->get_fixed_y() > maxFixedY) maxFixedY = landmark->get_fixed_y();
+			first = false;
+		}
+	}
+
+	minX = (float)fixed_point_to_degrees(minFixedX);
+	maxX = (float)fixed_point_to_degrees(maxFixedX);
+	minY = (float)fixed_point_to_degrees(minFixedY);
+	maxY = (float)fixed_point_to_degrees(maxFixedY);
+}
+
+LOSMRenderGeometry::~LOSMRenderGeometry()
+{ }
+
+unsigned int LOSMRenderGeometry::add_layer(const std::vector<unsigned int> &edgeColors)
+{
+	if (edgeColors.size() != graph->get_num_edges()) {
+		std::cerr << "Error[LOSMRenderGeometry::add_layer]: Expected " << graph->get_num_edges() <<
+				" edge colors, but " << edgeColors.size() << " were given." << std::endl;
+		throw LOSMException();
+	}
+
+	layers.push_back(edgeColors);
+	return (unsigned int)layers.size() - 1;
+}
+
+void LOSMRenderGeometry::add_policy_layers(std::string policyFilename, const LOSMRenderPalette &palette)
+{
+	// Every layer starts with the roads colored by their speed limit.
+	std::vector<unsigned int> roadColors(graph->get_num_edges());
+	const unsigned int *speedLimits = graph->get_speed_limit_array();
+	for (unsigned int i = 0; i < graph->get_num_edges(); i++) {
+		if (speedLimits[i] >= palette.autonomySpeedLimit) {
+			roadColors[i] = palette.autonomyCapableColor;
+		} else {
+			roadColors[i] = palette.roadColor;
+		}
+	}
+
+	std::vector<std::vector<unsigned int> > policyLayers(NUM_TIREDNESS_LEVELS * NUM_AUTONOMY_STATES, roadColors);
+
+	std::ifstream file(policyFilename);
+	if (!file.is_open()) {
+		std::cerr << "Error[LOSMRenderGeometry::add_policy_layers]: Failed to open the file '" <<
+				policyFilename << "'." << std::endl;
+		throw LOSMException();
+	}
+
+	std::string line;
+	int row = 1;
+
+	while (std::getline(file, line)) {
+		// Skip blank lines and comments.
+		trim_whitespace(line);
+		if (line.empty() || line[0] == '#') {
+			row++;
+			continue;
+		}
+
+		std::vector<std::string> items = split_string_by_comma(line);
+		if (items.size() < 6) {
+			std::cerr << "Error[LOSMRenderGeometry::add_policy_layers]: Incorrect number of comma-delimited items on line " <<
+					row << " in file '" << policyFilename << "'." << std::endl;
+			throw LOSMException();
+		}
+
+		unsigned long currentUID = 0;
+		unsigned long nextUID = 0;
+		unsigned int tiredness = 0;
+		unsigned int autonomy = 0;
+		bool nextAutonomy = false;
+
+		try {
+			currentUID = std::stoul(items[1]);
+			tiredness = std::stoul(items[2]);
+			autonomy = std::stoul(items[3]);
+			nextUID = std::stoul(items[4]);
+			nextAutonomy = (std::stoul(items[5]) == 1);
+		} catch (const std::exception &err) {
+			std::cerr << "Error[LOSMRenderGeometry::add_policy_layers]: Failed to convert an item to an integer on line " <<
+					row << " in file '" << policyFilename << "'." << std::endl;
+			throw LOSMException();
+		}
+
+		if (tiredness >= NUM_TIREDNESS_LEVELS || autonomy >= NUM_AUTONOMY_STATES) {
+			std::cerr << "Error[LOSMRenderGeometry::add_policy_layers]: Invalid tiredness or autonomy on line " <<
+					row << " in file '" << policyFilename << "'." << std::endl;
+			throw LOSMException();
+		}
+
+		// Color the edge the policy drives along next, if both nodes are in the graph.
+		unsigned int current = graph->find_node_index(currentUID);
+		unsigned int next = graph->find_node_index(nextUID);
+		if (current != LOSMGraph::INVALID_INDEX && next != LOSMGraph::INVALID_INDEX) {
+			for (unsigned int slot = graph->get_adjacency_begin(current); slot < graph->get_adjacency_end(current); slot++) {
+				if (graph->get_adjacent_node(slot) == next) {
+					policyLayers[tiredness * NUM_AUTONOMY_STATES + autonomy][graph->get_adjacent_edge(slot)] =
+							(nextAutonomy ? palette.policyAutonomyColor : palette.policyColor);
+					break;
+				}
+			}
+		}
+
+		row++;
+	}
+
+	for (const std::vector<unsigned int> &layer : policyLayers) {
+		add_layer(layer);
+	}
+}
+
+void LOSMRenderGeometry::build()
+{
+	unsigned int numTiles = tileResolution * tileResolution;
+	unsigned int numLayers = (unsigned int)layers.size();
+
+	positions.assign(numLevels * numTiles, std::vector<float>());
+	colors.assign(numLevels * numTiles * numLayers, std::vector<unsigned int>());
+
+	std::vector<std::vector<unsigned int> > chains;
+	std::vector<unsigned int> chainEdges;
+	find_chains(chains, chainEdges);
+
+	const int *fixedX = graph->get_fixed_x_array();
+	const int *fixedY = graph->get_fixed_y_array();
+
+	float scaleU = (maxY > minY ? 1.0f / (maxY - minY) : 1.0f);
+	float scaleV = (maxX > minX ? 1.0f / (maxX - minX) : 1.0f);
+
+	std::vector<float> points;
+	std::vector<unsigned int> kept;
+
+	for (unsigned int i = 0; i < chains.size(); i++) {
+		// Project the chain into the unit square.
+		points.clear();
+		for (unsigned int node : chains[i]) {
+			points.push_back(((float)fixed_point_to_degrees(fixedY[node]) - minY) * scaleU);
+			points.push_back((maxX - (float)fixed_point_to_degrees(fixedX[node])) * scaleV);
+		}
+
+		for (unsigned int level = 0; level < numLevels; level++) {
+			if (level == 0) {
+				kept.resize(chains[i].size());
+				for (unsigned int j = 0; j < kept.size(); j++) {
+					kept[j] = j;
+				}
+			} else {
+				simplify(points, tolerances[level], kept);
+			}
+
+			// Add each segment to every tile its bounding box overlaps.
+			for (unsigned int j = 0; j + 1 < kept.size(); j++) {
+				float u1 = points[2 * kept[j] + 0];
+				float v1 = points[2 * kept[j] + 1];
+				float u2 = points[2 * kept[j + 1] + 0];
+				float v2 = points[2 * kept[j + 1] + 1];
+
+				int maxTile = (int)tileResolution - 1;
+				int columnBegin = std::max(0, std::min(maxTile, (int)(std::min(u1, u2) * tileResolution)));
+				int columnEnd = std::max(0, std::min(maxTile, (int)(std::max(u1, u2) * tileResolution)));
+				int rowBegin = std::max(0, std::min(maxTile, (int)(std::min(v1, v2) * tileResolution)));
+				int rowEnd = std::max(0, std::min(maxTile, (int)(std::max(v1, v2) * tileResolution)));
+
+				for (int column = columnBegin; column <= columnEnd; column++) {
+					for (int row = rowBegin; row <= rowEnd; row++) {
+						unsigned int tile = level * numTiles + column * tileResolution + row;
+
+						positions[tile].push_back(u1);
+						positions[tile].push_back(v1);
+						positions[tile].push_back(u2);
+						positions[tile].push_back(v2);
+
+						for (unsigned int layer = 0; layer < numLayers; layer++) {
+							unsigned int color = layers[layer][chainEdges[i]];
+							colors[tile * numLayers + layer].push_back(color);
+							colors[tile * numLayers + layer].push_back(color);
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+void LOSMRenderGeometry::save(std::string filename) const
+{
+	unsigned int numTiles = tileResolution * tileResolution;
+	uint32_t numLayers = (uint32_t)layers.size();
+
+	if (positions.size() != numLevels * numTiles) {
+		std::cerr << "Error[LOSMRenderGeometry::save]: The geometry has not been built." << std::endl;
+		throw LOSMException();
+	}
+
+	std::ofstream file(filename, std::ios::binary);
+	if (!file.is_open()) {
+		std::cerr << "Error[LOSMRenderGeometry::save]: Failed to open the file '" << filename << "'." << std::endl;
+		throw LOSMException();
+	}
+
+	uint32_t counts[4] = {numLevels, tileResolution, numLayers, 0};
+	float bounds[4] = {minX, maxX, minY, maxY};
+
+	file.write(RENDER_GEOMETRY_MAGIC, sizeof(RENDER_GEOMETRY_MAGIC));
+	file.write(reinterpret_cast<const char *>(counts), sizeof(counts));
+	file.write(reinterpret_cast<const char *>(bounds), sizeof(bounds));
+	write_vector(file, tolerances);
+
+	// The tile table, with offsets from the start of the file.
+	std::vector<uint64_t> table(2 * positions.size());
+	uint64_t offset = sizeof(RENDER_GEOMETRY_MAGIC) + sizeof(counts) + sizeof(bounds) +
+			tolerances.size() * sizeof(float) + table.size() * sizeof(uint64_t);
+
+	for (unsigned int tile = 0; tile < positions.size(); tile++) {
+		uint64_t numVertices = positions[tile].size() / 2;
+		table[2 * tile + 0] = offset;
+		table[2 * tile + 1] = numVertices;
+		offset += numVertices * (2 * sizeof(float) + numLayers * sizeof(uint32_t));
+	}
+
+	write_vector(file, table);
+
+	for (unsigned int tile = 0; tile < positions.size(); tile++) {
+		write_vector(file, positions[tile]);
+		for (unsigned int layer = 0; layer < numLayers; layer++) {
+			write_vector(file, colors[tile * numLayers + layer]);
+		}
+	}
+
+	if (!file) {
+		std::cerr << "Error[LOSMRenderGeometry::save]: Failed to write the file '" << filename << "'." << std::endl;
+		throw LOSMException();
+	}
+}
+
+unsigned int LOSMRenderGeometry::get_num_layers() const
+{
+	return (unsigned int)layers.size();
+}
+
+unsigned int LOSMRenderGeometry::get_num_levels() const
+{
+	return numLevels;
+}
+
+unsigned int LOSMRenderGeometry::get_tile_resolution() const
+{
+	return tileResolution;
+}
+
+const std::vector<float> &LOSMRenderGeometry::get_positions(unsigned int level, unsigned int tile) const
+{
+	return positions[level * tileResolution * tileResolution + tile];
+}
+
+const std::vector<unsigned int> &LOSMRenderGeometry::get_colors(unsigned int level, unsigned int tile,
+		unsigned int layer) const
+{
+	return colors[(level * tileResolution * tileResolution + tile) * layers.size() + layer];
+}
+
+void LOSMRenderGeometry::find_chains(std::vector<std::vector<unsigned int> > &chains,
+		std::vector<unsigned int> &edges) const
+{
+	chains.clear();
+	edges.clear();
+
+	unsigned int numNodes = graph->get_num_nodes();
+	unsigned int numEdges = graph->get_num_edges();
+
+	// Two edges may only be merged if they have the same color in every layer.
+	auto sameColors = [this](unsigned int edge1, unsigned int edge2) {
+		for (const std::vector<unsigned int> &layer : layers) {
+			if (layer[edge1] != layer[edge2]) {
+				return false;
+			}
+		}
+		return true;
+	};
+
+	// A chain passes through a node if it has two distinct edges to other nodes with the same colors.
+	std::vector<bool> interior(numNodes, false);
+	for (unsigned int node = 0; node < numNodes; node++) {
+		unsigned int begin = graph->get_adjacency_begin(node);
+		if (graph->get_adjacency_end(node) - begin != 2) {
+			continue;
+		}
+
+		interior[node] = (graph->get_adjacent_node(begin) != node &&
+				graph->get_adjacent_node(begin + 1) != node &&
+				sameColors(graph->get_adjacent_edge(begin), graph->get_adjacent_edge(begin + 1)));
+	}
+
+	std::vector<bool> visited(numEdges, false);
+
+	// Walk from a node along an edge through interior nodes until the chain ends.
+	auto walk = [&](unsigned int start, unsigned int slot) {
+		std::vector<unsigned int> chain;
+		chain.push_back(start);
+
+		unsigned int edge = graph->get_adjacent_edge(slot);
+		unsigned int node = graph->get_adjacent_node(slot);
+		edges.push_back(edge);
+
+		while (true) {
+			visited[edge] = true;
+			chain.push_back(node);
+
+			if (!interior[node] || node == start) {
+				break;
+			}
+
+			unsigned int begin = graph->get_adjacency_begin(node);
+			unsigned int next = begin;
+			if (graph->get_adjacent_edge(begin) == edge) {
+				next = begin + 1;
+			}
+
+			edge = graph->get_adjacent_edge(next);
+			node = graph->get_adjacent_node(next);
+			if (visited[edge]) {
+				break;
+			}
+		}
+
+		chains.push_back(chain);
+	};
+
+	for (unsigned int node = 0; node < numNodes; node++) {
+		if (interior[node]) {
+			continue;
+		}
+
+		for (unsigned int slot = graph->get_adjacency_begin(node); slot < graph->get_adjacency_end(node); slot++) {
+			if (!visited[graph->get_adjacent_edge(slot)]) {
+				walk(node, slot);
+			}
+		}
+	}
+
+	// The remaining edges form cycles of interior nodes.
+	for (unsigned int node = 0; node < numNodes; node++) {
+		unsigned int slot = graph->get_adjacency_begin(node);
+		if (interior[node] && !visited[graph->get_adjacent_edge(slot)]) {
+			walk(node, slot);
+		}
+	}
+}
+
+void LOSMRenderGeometry::simplify(const std::vector<float> &points, float tolerance,
+		std::vector<unsigned int> &result)
+{
+	unsigned int numPoints = (unsigned int)(points.size() / 2);
+
+	std::vector<bool> keep(numPoints, false);
+	keep[0] = true;
+	keep[numPoints - 1] = true;
+
+	// Recursively keep the point farthest from each span, if it is beyond the tolerance.
+	std::vector<std::pair<unsigned int, unsigned int> > spans;
+	spans.push_back(std::make_pair(0, numPoints - 1));
+
+	while (!spans.empty()) {
+		unsigned int first = spans.back().first;
+		unsigned int last = spans.back().second;
+		spans.pop_back();
+
+		float u1 = points[2 * first + 0];
+		float v1 = points[2 * first + 1];
+		float du = points[2 * last + 0] - u1;
+		float dv = points[2 * last + 1] - v1;
+		float lengthSquared = du * du + dv * dv;
+
+		float farthestDistance = tolerance;
+		unsigned int farthest = first;
+
+		for (unsigned int i = first + 1; i < last; i++) {
+			float pu = points[2 * i + 0] - u1;
+			float pv = points[2 * i + 1] - v1;
+
+			// The distance to the segment, or to its start if it is degenerate (e.g., a cycle).
+			float distance = 0.0f;
+			if (lengthSquared > 0.0f) {
+				float t = std::max(0.0f, std::min(1.0f, (pu * du + pv * dv) / lengthSquared));
+				distance = std::hypot(pu - t * du, pv - t * dv);
+			} else {
+				distance = std::hypot(pu, pv);
+			}
+
+			if (distance > farthestDistance) {
+				farthestDistance = distance;
+				farthest = i;
+			}
+		}
+
+		if (farthest != first) {
+			keep[farthest] = true;
+			spans.push_back(std::make_pair(first, farthest));
+			spans.push_back(std::make_pair(farthest, last));
+		}
+	}
+
+	result.clear();
+	for (unsigned int i = 0; i < numPoints; i++) {
+		if (keep[i]) {
+			result.push_back(i);
+		}
+	}
+}
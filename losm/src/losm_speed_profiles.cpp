@@ -0,0 +1,194 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "../include/losm_speed_profiles.h"
+#include "../include/losm_exception.h"
+#include "../include/losm_utilities.h"
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <map>
+#include <cmath>
+
+const float LOSMSpeedProfiles::HOURS_PER_DAY = 24.0f;
+
+LOSMSpeedProfiles::LOSMSpeedProfiles(std::shared_ptr<const LOSMGraph> graph, std::string filename) :
+		graph(graph), numSlots(0), slotLength(HOURS_PER_DAY), maxSpeed(0.0f)
+{
+	if (graph == nullptr) {
+		std::cerr << "Error[LOSMSpeedProfiles::LOSMSpeedProfiles]: The graph provided was null." << std::endl;
+		throw LOSMException();
+	}
+
+	edgeProfiles.resize(graph->get_num_edges(), LOSMGraph::INVALID_INDEX);
+
+	// Edges without a profile travel at their speed limit.
+	const unsigned int *speedLimits = graph->get_speed_limit_array();
+	maxSpeed = (float)LOSMGraph::DEFAULT_SPEED_LIMIT;
+	for (unsigned int i = 0; i < graph->get_num_edges(); i++) {
+		maxSpeed = std::max(maxSpeed, (float)speedLimits[i]);
+	}
+
+	std::ifstream file(filename);
+	if (!file.is_open()) {
+		std::cerr << "Error[LOSMSpeedProfiles::LOSMSpeedProfiles]: Failed to open the file '" << filename << "'." << std::endl;
+		throw LOSMException();
+	}
+
+	std::map<std::vector<float>, unsigned int> profiles;
+	std::vector<float> speeds;
+	std::string line;
+	int row = 1;
+
+	while (std::getline(file, line)) {
+		std::vector<std::string> items = split_string_by_comma(line);
+
+		if (items.size() < 3 || (numSlots > 0 && items.size() != numSlots + 2)) {
+			std::cerr << "Error[LOSMSpeedProfiles::LOSMSpeedProfiles]: Incorrect number of comma-delimited items on line " <<
+					row << " in file '" << filename << "'." << std::endl;
+			throw LOSMException();
+		}
+
+		unsigned long uid1 = 0;
+		unsigned long uid2 = 0;
+		speeds.resize(items.size() - 2);
+
+		try {
+			uid1 = std::stoul(items[0]);
+			uid2 = std::stoul(items[1]);
+			for (unsigned int i = 0; i < speeds.size(); i++) {
+				speeds[i] = std::stof(items[i + 2]);
+			}
+		} catch (const std::exception &err) {
+			std::cerr << "Error[LOSMSpeedProfiles::LOSMSpeedProfiles]: Failed to convert an item to a number on line " <<
+					row << " in file '" << filename << "'." << std::endl;
+			throw LOSMException();
+		}
+
+		for (float speed : speeds) {
+			if (!(speed > 0.0f)) {
+				std::cerr << "Error[LOSMSpeedProfiles::LOSMSpeedProfiles]: Speeds must be positive on line " <<
+						row << " in file '" << filename << "'." << std::endl;
+				throw LOSMException();
+			}
+		}
+
+		if (numSlots == 0) {
+			numSlots = (unsigned int)speeds.size();
+			slotLength = HOURS_PER_DAY / (float)numSlots;
+		}
+
+		// Identical profiles are stored once.
+		auto result = profiles.insert(std::make_pair(speeds, (unsigned int)profiles.size()));
+		if (result.second) {
+			for (float speed : speeds) {
+				paces.push_back(1.0f / speed);
+				maxSpeed = std::max(maxSpeed, speed);
+			}
+		}
+
+		unsigned int node1 = graph->find_node_index(uid1);
+		unsigned int node2 = graph->find_node_index(uid2);
+		if (node1 == LOSMGraph::INVALID_INDEX || node2 == LOSMGraph::INVALID_INDEX) {
+			std::cerr << "Error[LOSMSpeedProfiles::LOSMSpeedProfiles]: Failed to find the nodes on line " <<
+					row << " in file '" << filename << "'." << std::endl;
+			throw LOSMException();
+		}
+
+		for (unsigned int slot = graph->get_adjacency_begin(node1); slot < graph->get_adjacency_end(node1); slot++) {
+			if (graph->get_adjacent_node(slot) == node2) {
+				edgeProfiles[graph->get_adjacent_edge(slot)] = result.first->second;
+			}
+		}
+
+		row++;
+	}
+}
+
+LOSMSpeedProfiles::~LOSMSpeedProfiles()
+{ }
+
+const LOSMGraph *LOSMSpeedProfiles::get_graph() const
+{
+	return graph.get();
+}
+
+unsigned int LOSMSpeedProfiles::get_num_slots() const
+{
+	return numSlots;
+}
+
+unsigned int LOSMSpeedProfiles::get_num_profiles() const
+{
+	if (numSlots == 0) {
+		return 0;
+	}
+	return (unsigned int)(paces.size() / numSlots);
+}
+
+unsigned int LOSMSpeedProfiles::get_profile(unsigned int edge) const
+{
+	return edgeProfiles[edge];
+}
+
+float LOSMSpeedProfiles::get_max_speed() const
+{
+	return maxSpeed;
+}
+
+float LOSMSpeedProfiles::get_travel_time(unsigned int edge, float departure) const
+{
+	unsigned int profile = edgeProfiles[edge];
+	if (profile == LOSMGraph::INVALID_INDEX) {
+		return graph->get_edge_cost(edge, LOSMCost::TRAVEL_TIME);
+	}
+
+	const float *pace = &paces[profile * numSlots];
+
+	// Drive through the slots in turn, each at its own pace, until the edge is covered.
+	double time = departure - HOURS_PER_DAY * std::floor(departure / HOURS_PER_DAY);
+	unsigned int slot = std::min(numSlots - 1, (unsigned int)(time / slotLength));
+	double slotEnd = (slot + 1) * (double)slotLength;
+	double remaining = graph->get_edge_cost(edge, LOSMCost::DISTANCE);
+	double travelTime = 0.0;
+
+	while (true) {
+		double covered = (slotEnd - time) / pace[slot];
+		if (covered >= remaining) {
+			return (float)(travelTime + remaining * pace[slot]);
+		}
+
+		remaining -= covered;
+		travelTime += slotEnd - time;
+		time = slotEnd;
+		slotEnd += slotLength;
+		slot = (slot + 1) % numSlots;
+	}
+}
+
+size_t LOSMSpeedProfiles::get_memory_usage() const
+{
+	return paces.capacity() * sizeof(float) + edgeProfiles.capacity() * sizeof(unsigned int);
+}
@@ -0,0 +1,342 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "../include/losm_subgraph.h"
+#include "../include/losm_exception.h"
+#include "../include/losm_utilities.h"
+
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+
+LOSMSubgraph::LOSMSubgraph(std::shared_ptr<const LOSMGraph> graph, float minX, float minY, float maxX, float maxY,
+		unsigned int expansionHops)
+{
+	if (graph == nullptr) {
+		std::cerr << "Error[LOSMSubgraph::LOSMSubgraph]: The graph provided was null." << std::endl;
+		throw LOSMException();
+	}
+
+	this->graph = graph;
+
+	extract(minX, minY, maxX, maxY, expansionHops);
+}
+
+LOSMSubgraph::LOSMSubgraph(std::shared_ptr<const LOSMGraph> graph,
+		const std::vector<std::pair<float, float> > &polygon, unsigned int expansionHops)
+{
+	if (graph == nullptr || polygon.size() < 3) {
+		std::cerr << "Error[LOSMSubgraph::LOSMSubgraph]: Invalid graph or polygon." << std::endl;
+		throw LOSMException();
+	}
+
+	this->graph = graph;
+
+	float minX = polygon[0].first;
+	float minY = polygon[0].second;
+	float maxX = polygon[0].first;
+	float maxY = polygon[0].second;
+
+	for (const std::pair<float, float> &vertex : polygon) {
+		polygonX.push_back(degrees_to_fixed_point(vertex.first));
+		polygonY.push_back(degrees_to_fixed_point(vertex.second));
+
+		minX = std::min(minX, vertex.first);
+		minY = std::min(minY, vertex.second);
+		maxX = std::max(maxX, vertex.first);
+		maxY = std::max(maxY, vertex.second);
+	}
+
+	extract(minX, minY, maxX, maxY, expansionHops);
+}
+
+LOSMSubgraph::~LOSMSubgraph()
+{ }
+
+const std::vector<unsigned int> &LOSMSubgraph::get_nodes() const
+{
+	return nodes;
+}
+
+const std::vector<unsigned int> &LOSMSubgraph::get_edges() const
+{
+	return edges;
+}
+
+const std::vector<const LOSMLandmark *> &LOSMSubgraph::get_landmarks() const
+{
+	return landmarks;
+}
+
+unsigned int LOSMSubgraph::get_degree(unsigned int node) const
+{
+	return degrees[node];
+}
+
+std::shared_ptr<LOSM> LOSMSubgraph::create_losm() const
+{
+	std::vector<const LOSMNode *> newNodes;
+	std::vector<const LOSMEdge *> newEdges;
+	std::vector<const LOSMLandmark *> newLandmarks;
+
+	std::unordered_map<unsigned int, const LOSMNode *> copies;
+
+	for (unsigned int i = 0; i < nodes.size(); i++) {
+		const LOSMNode *node = graph->get_node(nodes[i]);
+		const LOSMNode *copy = new LOSMNode(node->get_uid(), fixed_point_to_degrees(node->get_fixed_x()),
+				fixed_point_to_degrees(node->get_fixed_y()), degrees[i]);
+
+		newNodes.push_back(copy);
+		copies[nodes[i]] = copy;
+	}
+
+	const unsigned int *edgeNodes = graph->get_edge_nodes_array();
+
+	for (unsigned int edge : edges) {
+		const LOSMEdge *original = graph->get_edge(edge);
+		newEdges.push_back(new LOSMEdge(copies[edgeNodes[2 * edge + 0]], copies[edgeNodes[2 * edge + 1]],
+				original->get_name(), original->get_distance(), original->get_speed_limit(), original->get_lanes()));
+	}
+
+	for (const LOSMLandmark *landmark : landmarks) {
+		newLandmarks.push_back(new LOSMLandmark(landmark->get_uid(), fixed_point_to_degrees(landmark->get_fixed_x()),
+				fixed_point_to_degrees(landmark->get_fixed_y()), landmark->get_name()));
+	}
+
+	return std::make_shared<LOSM>(newNodes, newEdges, newLandmarks);
+}
+
+void LOSMSubgraph::save(std::string nodesFilename, std::string edgesFilename, std::string landmarksFilename) const
+{
+	const unsigned long *uids = graph->get_uid_array();
+	const int *fixedX = graph->get_fixed_x_array();
+	const int *fixedY = graph->get_fixed_y_array();
+	const unsigned int *edgeNodes = graph->get_edge_nodes_array();
+
+	std::ostringstream nodesFile;
+	std::ostringstream edgesFile;
+	std::ostringstream landmarksFile;
+
+	nodesFile << std::fixed << std::setprecision(7);
+	edgesFile << std::setprecision(std::numeric_limits<float>::max_digits10);
+	landmarksFile << std::fixed << std::setprecision(7);
+
+	for (unsigned int i = 0; i < nodes.size(); i++) {
+		nodesFile << uids[nodes[i]] << "," << fixed_point_to_degrees(fixedX[nodes[i]]) << "," <<
+				fixed_point_to_degrees(fixedY[nodes[i]]) << "," << degrees[i] << std::endl;
+	}
+
+	for (unsigned int edge : edges) {
+		const LOSMEdge *original = graph->get_edge(edge);
+		edgesFile << uids[edgeNodes[2 * edge + 0]] << "," << uids[edgeNodes[2 * edge + 1]] << "," <<
+				original->get_name() << "," << original->get_distance() << "," << original->get_speed_limit() <<
+				"," << original->get_lanes() << std::endl;
+	}
+
+	for (const LOSMLandmark *landmark : landmarks) {
+		landmarksFile << landmark->get_uid() << "," << fixed_point_to_degrees(landmark->get_fixed_x()) << "," <<
+				fixed_point_to_degrees(landmark->get_fixed_y()) << "," << landmark->get_name() << std::endl;
+	}
+
+	write_file(nodesFilename, nodesFile.str());
+	write_file(edgesFilename, edgesFile.str());
+	write_file(landmarksFilename, landmarksFile.str());
+}
+
+bool LOSMSubgraph::contains(int x, int y) const
+{
+	if (x < boxMinX || x > boxMaxX || y < boxMinY || y > boxMaxY) {
+		return false;
+	}
+
+	if (polygonX.empty()) {
+		return true;
+	}
+
+	// Count the crossings of a ray from the coordinate towards increasing x.
+	bool inside = false;
+
+	for (unsigned int i = 0, j = polygonX.size() - 1; i < polygonX.size(); j = i++) {
+		if ((polygonY[i] > y) == (polygonY[j] > y)) {
+			continue;
+		}
+
+		double crossing = polygonX[i] + (double)(y - polygonY[i]) * ((double)polygonX[j] - polygonX[i]) /
+				((double)polygonY[j] - polygonY[i]);
+		if (x < crossing) {
+			inside = !inside;
+		}
+	}
+
+	return inside;
+}
+
+void LOSMSubgraph::extract(float minX, float minY, float maxX, float maxY, unsigned int expansionHops)
+{
+	boxMinX = degrees_to_fixed_point(minX);
+	boxMinY = degrees_to_fixed_point(minY);
+	boxMaxX = degrees_to_fixed_point(maxX);
+	boxMaxY = degrees_to_fixed_point(maxY);
+
+	std::vector<unsigned int> candidates;
+	graph->find_nodes_in_box(minX, minY, maxX, maxY, candidates);
+
+	const int *fixedX = graph->get_fixed_x_array();
+	const int *fixedY = graph->get_fixed_y_array();
+
+	for (unsigned int node : candidates) {
+		if (contains(fixedX[node], fixedY[node])) {
+			nodes.push_back(node);
+		}
+	}
+
+	if (expansionHops > 0) {
+		expand(expansionHops);
+	}
+
+	std::sort(nodes.begin(), nodes.end());
+
+	// Collect the edges between the nodes kept from their first endpoints, and count the degrees
+	// like the Python converter, i.e., once for each endpoint.
+	std::unordered_map<unsigned int, unsigned int> positions;
+	positions.reserve(nodes.size());
+	for (unsigned int i = 0; i < nodes.size(); i++) {
+		positions[nodes[i]] = i;
+	}
+
+	const unsigned int *edgeNodes = graph->get_edge_nodes_array();
+
+	for (unsigned int node : nodes) {
+		for (unsigned int slot = graph->get_adjacency_begin(node); slot < graph->get_adjacency_end(node); slot++) {
+			unsigned int edge = graph->get_adjacent_edge(slot);
+			if (edgeNodes[2 * edge + 0] == node && positions.count(graph->get_adjacent_node(slot)) > 0) {
+				edges.push_back(edge);
+			}
+		}
+	}
+
+	// A self-loop appears twice in the adjacency of its node.
+	std::sort(edges.begin(), edges.end());
+	edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+	degrees.resize(nodes.size(), 0);
+	for (unsigned int edge : edges) {
+		degrees[positions[edgeNodes[2 * edge + 0]]]++;
+		degrees[positions[edgeNodes[2 * edge + 1]]]++;
+	}
+
+	// Like the nodes, the landmarks are found with a k-d tree, and kept in their original order.
+	std::vector<unsigned int> landmarkCandidates;
+	graph->find_landmarks_in_box(minX, minY, maxX, maxY, landmarkCandidates);
+	std::sort(landmarkCandidates.begin(), landmarkCandidates.end());
+
+	const std::vector<const LOSMLandmark *> &allLandmarks = graph->get_losm()->get_landmarks();
+
+	for (unsigned int landmark : landmarkCandidates) {
+		if (contains(allLandmarks[landmark]->get_fixed_x(), allLandmarks[landmark]->get_fixed_y())) {
+			landmarks.push_back(allLandmarks[landmark]);
+		}
+	}
+}
+
+void LOSMSubgraph::expand(unsigned int expansionHops)
+{
+	// Each node reached records the node within the region its route started from, the previous
+	// node on the route, and the number of edges from the region.
+	struct Reached {
+		unsigned int source;
+		unsigned int previous;
+		unsigned int hops;
+	};
+
+	std::unordered_map<unsigned int, Reached> reached;
+
+	// The pieces of the subgraph are kept as a union-find forest over the nodes within the region.
+	std::unordered_map<unsigned int, unsigned int> pieces;
+
+	auto find = [&pieces](unsigned int node) {
+		while (pieces[node] != node) {
+			pieces[node] = pieces[pieces[node]];
+			node = pieces[node];
+		}
+		return node;
+	};
+
+	for (unsigned int node : nodes) {
+		reached[node] = {node, LOSMGraph::INVALID_INDEX, 0};
+		pieces[node] = node;
+	}
+
+	for (unsigned int node : nodes) {
+		for (unsigned int slot = graph->get_adjacency_begin(node); slot < graph->get_adjacency_end(node); slot++) {
+			unsigned int neighbor = graph->get_adjacent_node(slot);
+			if (pieces.count(neighbor) > 0) {
+				pieces[find(node)] = find(neighbor);
+			}
+		}
+	}
+
+	// Search outwards from all nodes within the region at once. Wherever the searches from two
+	// pieces meet, both halves of the route between them are kept and the pieces are joined.
+	std::vector<unsigned int> queue(nodes);
+	std::unordered_set<unsigned int> added;
+
+	for (size_t i = 0; i < queue.size(); i++) {
+		unsigned int node = queue[i];
+		Reached current = reached[node];
+
+		for (unsigned int slot = graph->get_adjacency_begin(node); slot < graph->get_adjacency_end(node); slot++) {
+			unsigned int neighbor = graph->get_adjacent_node(slot);
+
+			std::unordered_map<unsigned int, Reached>::const_iterator other = reached.find(neighbor);
+			if (other == reached.end()) {
+				if (current.hops < expansionHops) {
+					reached[neighbor] = {current.source, node, current.hops + 1};
+					queue.push_back(neighbor);
+				}
+				continue;
+			}
+
+			unsigned int piece = find(current.source);
+			unsigned int otherPiece = find(other->second.source);
+			if (piece == otherPiece) {
+				continue;
+			}
+
+			pieces[piece] = otherPiece;
+
+			for (unsigned int end : {node, neighbor}) {
+				while (reached[end].hops > 0 && added.insert(end).second) {
+					end = reached[end].previous;
+				}
+			}
+		}
+	}
+
+	nodes.insert(nodes.end(), added.begin(), added.end());
+}
@@ -0,0 +1,232 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "../include/losm_thread_pool.h"
+
+#include <algorithm>
+
+// The pool and worker index of the calling thread, if it is a worker.
+static thread_local const LOSMThreadPool *currentPool = nullptr;
+static thread_local unsigned int currentWorker = 0;
+
+LOSMThreadPool::LOSMThreadPool(unsigned int numThreads)
+{
+	if (numThreads == 0) {
+		numThreads = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	pending = 0;
+	nextQueue = 0;
+	stopping = false;
+
+	for (unsigned int i = 0; i < numThreads; i++) {
+		queues.push_back(std::unique_ptr<Queue>(new Queue()));
+	}
+
+	for (unsigned int i = 0; i < numThreads; i++) {
+		threads.push_back(std::thread(&LOSMThreadPool::run, this, i));
+	}
+}
+
+LOSMThreadPool::~LOSMThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		stopping = true;
+	}
+	sleepCondition.notify_all();
+
+	for (std::thread &thread : threads) {
+		thread.join();
+	}
+}
+
+unsigned int LOSMThreadPool::get_num_threads() const
+{
+	return threads.size();
+}
+
+unsigned int LOSMThreadPool::get_worker_index() const
+{
+	if (currentPool != this) {
+		return threads.size();
+	}
+	return currentWorker;
+}
+
+void LOSMThreadPool::execute(std::function<void ()> task)
+{
+	unsigned int worker = get_worker_index();
+	if (worker >= queues.size()) {
+		worker = nextQueue.fetch_add(1) % queues.size();
+	}
+
+	// Count the task under the sleep mutex so that a worker cannot miss it while going to sleep,
+	// and before pushing it so that a worker taking it never decrements the count below zero.
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		pending++;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(queues[worker]->mutex);
+		queues[worker]->tasks.push_back(task);
+	}
+
+	sleepCondition.notify_one();
+}
+
+void LOSMThreadPool::parallel_for_async(unsigned int count, std::function<void (unsigned int, unsigned int)> f,
+		std::function<void ()> done)
+{
+	if (count == 0) {
+		execute(done);
+		return;
+	}
+
+	// A few chunks per worker balance the load without paying for one task per index.
+	unsigned int chunkSize = std::max(1u, count / (unsigned int)(8 * threads.size()));
+	unsigned int numChunks = (count + chunkSize - 1) / chunkSize;
+
+	std::shared_ptr<std::atomic<unsigned int> > remaining(new std::atomic<unsigned int>(numChunks));
+
+	for (unsigned int chunk = 0; chunk < numChunks; chunk++) {
+		unsigned int first = chunk * chunkSize;
+		unsigned int last = std::min(count, first + chunkSize);
+
+		execute([this, first, last, f, done, remaining]() {
+			unsigned int worker = get_worker_index();
+			for (unsigned int i = first; i < last; i++) {
+				f(i, worker);
+			}
+			if (remaining->fetch_sub(1) == 1) {
+				done();
+			}
+		});
+	}
+}
+
+void LOSMThreadPool::parallel_for(unsigned int count, std::function<void (unsigned int, unsigned int)> f)
+{
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::atomic<bool> finished(false);
+
+	parallel_for_async(count, f, [&mutex, &condition, &finished]() {
+		std::lock_guard<std::mutex> lock(mutex);
+		finished = true;
+		condition.notify_all();
+	});
+
+	unsigned int worker = get_worker_index();
+
+	// A worker must keep running tasks while it waits, since the chunks may be in its own queue.
+	if (worker < threads.size()) {
+		std::function<void ()> task;
+		while (!finished) {
+			if (take(worker, task)) {
+				task();
+			} else {
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	std::unique_lock<std::mutex> lock(mutex);
+	condition.wait(lock, [&finished]() { return finished.load(); });
+}
+
+void LOSMThreadPool::dispatch(unsigned int count, std::function<void (unsigned int, unsigned int)> f,
+		std::function<void (std::exception_ptr)> done)
+{
+	// Only the first exception is kept; the remaining indices still run so that any state
+	// the workers share with f is left consistent.
+	std::shared_ptr<std::mutex> errorMutex(new std::mutex());
+	std::shared_ptr<std::exception_ptr> error(new std::exception_ptr());
+
+	parallel_for_async(count,
+		[f, errorMutex, error](unsigned int i, unsigned int worker) {
+			try {
+				f(i, worker);
+			} catch (...) {
+				std::lock_guard<std::mutex> lock(*errorMutex);
+				if (!*error) {
+					*error = std::current_exception();
+				}
+			}
+		},
+		[done, error]() {
+			done(*error);
+		});
+}
+
+void LOSMThreadPool::run(unsigned int worker)
+{
+	currentPool = this;
+	currentWorker = worker;
+
+	std::function<void ()> task;
+
+	while (true) {
+		if (take(worker, task)) {
+			task();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		sleepCondition.wait(lock, [this]() { return stopping || pending > 0; });
+		if (stopping && pending == 0) {
+			break;
+		}
+	}
+}
+
+bool LOSMThreadPool::take(unsigned int worker, std::function<void ()> &task)
+{
+	// First, take the newest task of the worker's own queue.
+	{
+		Queue &queue = *queues[worker];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.tasks.empty()) {
+			task = std::move(queue.tasks.back());
+			queue.tasks.pop_back();
+			pending--;
+			return true;
+		}
+	}
+
+	// Otherwise, steal the oldest task of another worker.
+	for (unsigned int i = 1; i < queues.size(); i++) {
+		Queue &queue = *queues[(worker + i) % queues.size()];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.tasks.empty()) {
+			task = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+			pending--;
+			return true;
+		}
+	}
+
+	return false;
+}
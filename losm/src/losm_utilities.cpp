@@ -23,6 +23,15 @@
 
 
 #include "../include/losm_utilities.h"
+#include "../include/losm_exception.h"
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cerrno>
+#include <utility>
 
 void trim_whitespace(std::string &item)
 {
@@ -62,3 +71,83 @@ std::vector<std::string> split_string_by_comma(std::string item)
 
 	return items;
 }
+
+bool parse_unsigned(const std::string &item, unsigned long &value)
+{
+	if (item.empty() || item[0] == '-') {
+		return false;
+	}
+
+	char *end = nullptr;
+	errno = 0;
+	value = std::strtoul(item.c_str(), &end, 10);
+	return (errno == 0 && *end == '\0');
+}
+
+bool parse_double(const std::string &item, double &value)
+{
+	char *end = nullptr;
+	errno = 0;
+	value = std::strtod(item.c_str(), &end);
+	return (!item.empty() && errno == 0 && *end == '\0');
+}
+
+void write_file(std::string filename, const std::string &contents)
+{
+	std::ofstream file(filename);
+	if (!file.is_open()) {
+		std::cerr << "Error[write_file]: Failed to open the file '" << filename << "'." << std::endl;
+		throw LOSMException();
+	}
+
+	file << contents;
+
+	if (!file) {
+		std::cerr << "Error[write_file]: Failed to write the file '" << filename << "'." << std::endl;
+		throw LOSMException();
+	}
+}
+
+bool is_valid_coordinate(double x, double y)
+{
+	return (x >= -90.0 && x <= 90.0 && y >= -180.0 && y <= 180.0);
+}
+
+int degrees_to_fixed_point(double degrees)
+{
+	// Rounding a value beyond the range of an int, or not a number, is undefined.
+	if (!(degrees == degrees)) {
+		return 0;
+	}
+	degrees = std::max(-180.0, std::min(180.0, degrees));
+
+	return (int)std::lround(degrees * LOSM_FIXED_POINT_SCALE);
+}
+
+double fixed_point_to_degrees(int fixed)
+{
+	return (double)fixed / LOSM_FIXED_POINT_SCALE;
+}
+
+uint32_t hilbert_index(uint32_t x, uint32_t y)
+{
+	const uint32_t n = 1 << 16;
+	uint32_t d = 0;
+
+	for (uint32_t s = n / 2; s > 0; s /= 2) {
+		uint32_t rx = (x & s) > 0;
+		uint32_t ry = (y & s) > 0;
+		d += s * s * ((3 * rx) ^ ry);
+
+		// Rotate the quadrant so the curve is continuous.
+		if (ry == 0) {
+			if (rx == 1) {
+				x = n - 1 - x;
+				y = n - 1 - y;
+			}
+			std::swap(x, y);
+		}
+	}
+
+	return d;
+}
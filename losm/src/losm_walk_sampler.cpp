@@ -0,0 +1,280 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "../include/losm_walk_sampler.h"
+#include "../include/losm_exception.h"
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <future>
+#include <algorithm>
+#include <cstring>
+
+const unsigned int LOSMWalkSampler::WALKS_PER_TASK;
+const size_t LOSMWalkSampler::SAVE_CHUNK_SIZE;
+const char LOSMWalkSampler::SAVED_MAGIC[8] = {'L', 'O', 'S', 'M', 'R', 'W', '0', '1'};
+
+/**
+ * The header at the start of a saved file. It is followed by one record per walk.
+ */
+struct LOSMWalkFileHeader {
+	char magic[8];
+	uint32_t numWalks;
+	uint32_t length;
+	uint32_t numNodes;
+	uint32_t numEdges;
+	uint64_t seed;
+};
+
+/**
+ * Scramble a 64-bit value, with the output function of SplitMix64.
+ * @param	value	The value.
+ * @return	The scrambled value.
+ */
+static uint64_t mix(uint64_t value)
+{
+	value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+	return value ^ (value >> 31);
+}
+
+/**
+ * Get a counter-based random number, i.e., the counter-th output of SplitMix64 seeded with a key.
+ * @param	key		The key of the stream, e.g., of one walk.
+ * @param	counter	The position in the stream.
+ * @return	The random number.
+ */
+static uint64_t get_random(uint64_t key, uint64_t counter)
+{
+	return mix(key + (counter + 1) * 0x9E3779B97F4A7C15ULL);
+}
+
+/**
+ * Map a random number uniformly onto [0, count), with a multiplication instead of a division.
+ * @param	random	The random number.
+ * @param	count	The number of values.
+ * @return	The value.
+ */
+static uint64_t scale_random(uint64_t random, uint64_t count)
+{
+	return ((random >> 32) * count) >> 32;
+}
+
+LOSMWalkSampler::LOSMWalkSampler(std::shared_ptr<const LOSMGraph> graph, unsigned int numThreads) : graph(graph)
+{
+	if (graph == nullptr) {
+		std::cerr << "Error[LOSMWalkSampler::LOSMWalkSampler]: The graph provided was null." << std::endl;
+		throw LOSMException();
+	}
+
+	pool.reset(new LOSMThreadPool(numThreads));
+}
+
+LOSMWalkSampler::~LOSMWalkSampler()
+{
+	pool.reset();
+}
+
+std::shared_ptr<const LOSMGraph> LOSMWalkSampler::get_graph() const
+{
+	return graph;
+}
+
+void LOSMWalkSampler::sample(const LOSMWalkRequest &request, unsigned int *nodes, unsigned int *edges)
+{
+	check_request(request);
+
+	unsigned int numTasks = (request.numWalks + WALKS_PER_TASK - 1) / WALKS_PER_TASK;
+
+	pool->parallel_for(numTasks, [&](unsigned int task, unsigned int /* worker */) {
+		unsigned int last = std::min(request.numWalks, (task + 1) * WALKS_PER_TASK);
+
+		for (unsigned int walk = task * WALKS_PER_TASK; walk < last; walk++) {
+			sample_walk(request, walk, nodes + (size_t)walk * (request.length + 1),
+					(edges != nullptr) ? edges + (size_t)walk * request.length : nullptr);
+		}
+	});
+}
+
+void LOSMWalkSampler::save(const LOSMWalkRequest &request, std::string filename)
+{
+	check_request(request);
+
+	std::ofstream file(filename, std::ios::binary);
+	if (!file.is_open()) {
+		std::cerr << "Error[LOSMWalkSampler::save]: Failed to open the file '" << filename << "'." << std::endl;
+		throw LOSMException();
+	}
+
+	LOSMWalkFileHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, SAVED_MAGIC, sizeof(SAVED_MAGIC));
+	header.numWalks = request.numWalks;
+	header.length = request.length;
+	header.numNodes = graph->get_num_nodes();
+	header.numEdges = graph->get_num_edges();
+	header.seed = request.seed;
+
+	file.write((const char *)&header, sizeof(header));
+
+	size_t recordSize = 2 * (size_t)request.length + 1;
+	unsigned int walksPerChunk = (unsigned int)std::max((size_t)1,
+			std::min((size_t)request.numWalks, SAVE_CHUNK_SIZE / (recordSize * sizeof(unsigned int))));
+
+	// Sample each chunk into one buffer while the previous chunk is written from the other.
+	std::vector<unsigned int> buffers[2];
+	unsigned int previousCount = 0;
+
+	for (unsigned int first = 0, chunk = 0; first < request.numWalks; first += walksPerChunk, chunk++) {
+		unsigned int count = std::min(walksPerChunk, request.numWalks - first);
+		std::vector<unsigned int> &buffer = buffers[chunk % 2];
+		buffer.resize(count * recordSize);
+
+		std::promise<void> finished;
+		unsigned int numTasks = (count + WALKS_PER_TASK - 1) / WALKS_PER_TASK;
+
+		pool->parallel_for_async(numTasks, [&request, &buffer, first, count, recordSize, this](unsigned int task,
+				unsigned int /* worker */) {
+			unsigned int last = std::min(count, (task + 1) * WALKS_PER_TASK);
+
+			for (unsigned int i = task * WALKS_PER_TASK; i < last; i++) {
+				unsigned int *record = buffer.data() + i * recordSize;
+				sample_walk(request, first + i, record, record + request.length + 1);
+			}
+		}, [&finished]() {
+			finished.set_value();
+		});
+
+		if (chunk > 0) {
+			file.write((const char *)buffers[(chunk - 1) % 2].data(), previousCount * recordSize * sizeof(unsigned int));
+		}
+
+		finished.get_future().wait();
+		previousCount = count;
+	}
+
+	if (request.numWalks > 0) {
+		file.write((const char *)buffers[((request.numWalks - 1) / walksPerChunk) % 2].data(),
+				previousCount * recordSize * sizeof(unsigned int));
+	}
+
+	if (!file) {
+		std::cerr << "Error[LOSMWalkSampler::save]: Failed to write the file '" << filename << "'." << std::endl;
+		throw LOSMException();
+	}
+}
+
+void LOSMWalkSampler::check_request(const LOSMWalkRequest &request) const
+{
+	if (request.sources == nullptr) {
+		if (request.numWalks > 0 && graph->get_num_nodes() == 0) {
+			std::cerr << "Error[LOSMWalkSampler::check_request]: The graph has no nodes to start walks at." << std::endl;
+			throw LOSMException();
+		}
+		return;
+	}
+
+	for (unsigned int i = 0; i < request.numWalks; i++) {
+		if (request.sources[i] >= graph->get_num_nodes()) {
+			std::cerr << "Error[LOSMWalkSampler::check_request]: The source " << request.sources[i] <<
+					" of walk " << i << " does not exist." << std::endl;
+			throw LOSMException();
+		}
+	}
+}
+
+void LOSMWalkSampler::sample_walk(const LOSMWalkRequest &request, unsigned int walk, unsigned int *nodes,
+		unsigned int *edges) const
+{
+	const unsigned int *offsets = graph->get_adjacency_offsets_array();
+	const unsigned int *neighbors = graph->get_adjacent_nodes_array();
+	const unsigned int *adjacentEdges = graph->get_adjacent_edges_array();
+	const unsigned int *speedLimits = graph->get_speed_limit_array();
+
+	// The weight of an adjacency slot, or zero if it leads back to the excluded node.
+	auto weigh = [&](unsigned int slot, unsigned int excluded) -> uint64_t {
+		if (neighbors[slot] == excluded) {
+			return 0;
+		}
+		if (request.bias == LOSMWalkBias::UNIFORM) {
+			return 1;
+		}
+		unsigned int speedLimit = speedLimits[adjacentEdges[slot]];
+		return (speedLimit == 0) ? LOSMGraph::DEFAULT_SPEED_LIMIT : speedLimit;
+	};
+
+	uint64_t key = mix(request.seed + mix(walk));
+
+	unsigned int current = (request.sources != nullptr) ? request.sources[walk] :
+			(unsigned int)scale_random(get_random(key, 0), graph->get_num_nodes());
+	unsigned int previous = LOSMGraph::INVALID_INDEX;
+
+	nodes[0] = current;
+
+	unsigned int step = 0;
+	for (; step < request.length; step++) {
+		unsigned int begin = offsets[current];
+		unsigned int end = offsets[current + 1];
+		if (begin == end) {
+			break;
+		}
+
+		unsigned int excluded = request.nonBacktracking ? previous : LOSMGraph::INVALID_INDEX;
+
+		uint64_t total = 0;
+		for (unsigned int slot = begin; slot < end; slot++) {
+			total += weigh(slot, excluded);
+		}
+
+		// At a dead end, the only way on is back.
+		if (total == 0) {
+			excluded = LOSMGraph::INVALID_INDEX;
+			for (unsigned int slot = begin; slot < end; slot++) {
+				total += weigh(slot, excluded);
+			}
+		}
+
+		uint64_t target = scale_random(get_random(key, step + 1), total);
+
+		unsigned int slot = begin;
+		for (uint64_t weight = weigh(slot, excluded); target >= weight; weight = weigh(++slot, excluded)) {
+			target -= weight;
+		}
+
+		previous = current;
+		current = neighbors[slot];
+
+		nodes[step + 1] = current;
+		if (edges != nullptr) {
+			edges[step] = adjacentEdges[slot];
+		}
+	}
+
+	// Pad the rest of a walk which stopped at a node without edges.
+	for (unsigned int i = step; i < request.length; i++) {
+		nodes[i + 1] = LOSMGraph::INVALID_INDEX;
+		if (edges != nullptr) {
+			edges[i] = LOSMGraph::INVALID_INDEX;
+		}
+	}
+}
@@ -0,0 +1,907 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2014 Kyle Wray
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "../../../losm/include/losm.h"
+#include "../../../losm/include/losm_graph.h"
+#include "../../../losm/include/losm_query_context.h"
+#include "../../../losm/include/losm_walk_sampler.h"
+#include "../../../losm/include/losm_index_cache.h"
+#include "../../../losm/include/losm_render_geometry.h"
+#include "../../../losm/include/losm_utilities.h"
+#include "../../../losm/include/losm_exception.h"
+
+#include <memory>
+#include <vector>
+#include <mutex>
+#include <string>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <type_traits>
+
+/**
+ * The Python object of a LOSMGraph. Its query contexts are pooled, so that Python threads may
+ * query concurrently once the GIL is released.
+ */
+struct GraphObject {
+	PyObject_HEAD
+
+	/**
+	 * The graph.
+	 */
+	std::shared_ptr<const LOSMGraph> *graph;
+
+	/**
+	 * The query contexts not currently in use, and the mutex which guards them.
+	 */
+	std::vector<LOSMQueryContext *> *contexts;
+	std::mutex *contextsMutex;
+
+	/**
+	 * Whether __init__ has loaded the graph. Views and queries may still use the graph, so it is
+	 * only ever replaced once, while it is the shared empty graph.
+	 */
+	bool initialized;
+};
+
+/**
+ * The Python object of a read-only array, either viewing the memory of a graph or owning the
+ * result of a batched query, which exports it through the buffer protocol.
+ */
+struct ArrayObject {
+	PyObject_HEAD
+
+	/**
+	 * The object which owns the memory, kept alive by the array, or null if the array owns it.
+	 */
+	PyObject *owner;
+
+	/**
+	 * The memory, if the array owns it.
+	 */
+	std::vector<char> *storage;
+
+	/**
+	 * The first element.
+	 */
+	const void *data;
+
+	/**
+	 * The struct module format of each element, and its size (in bytes).
+	 */
+	const char *format;
+	Py_ssize_t itemSize;
+
+	/**
+	 * The number of dimensions (one or two), and the shape and strides of each.
+	 */
+	int numDimensions;
+	Py_ssize_t shape[2];
+	Py_ssize_t strides[2];
+};
+
+static PyTypeObject ArrayType = {PyVarObject_HEAD_INIT(NULL, 0)};
+static PyTypeObject GraphType = {PyVarObject_HEAD_INIT(NULL, 0)};
+
+/**
+ * Get the struct module format of an element type.
+ * @return	The format.
+ */
+template <typename T> static const char *get_format();
+template <> const char *get_format<int>() { return "i"; }
+template <> const char *get_format<unsigned int>() { return "I"; }
+template <> const char *get_format<unsigned long>() { return "L"; }
+template <> const char *get_format<float>() { return "f"; }
+
+/**
+ * Create a memoryview of an array, without copying it.
+ * @param	owner		The object which owns the memory, or null to copy it into the array.
+ * @param	data		The first element.
+ * @param	rows		The number of rows.
+ * @param	columns		The number of columns, or zero for a one-dimensional array.
+ * @return	The memoryview, or null with an exception set.
+ */
+template <typename T>
+static PyObject *create_view(PyObject *owner, const T *data, Py_ssize_t rows, Py_ssize_t columns = 0)
+{
+	ArrayObject *array = PyObject_New(ArrayObject, &ArrayType);
+	if (array == nullptr) {
+		return nullptr;
+	}
+
+	Py_ssize_t count = rows * std::max((Py_ssize_t)1, columns);
+
+	array->owner = owner;
+	array->storage = nullptr;
+	array->data = data;
+
+	if (owner != nullptr) {
+		Py_INCREF(owner);
+	} else {
+		array->storage = new std::vector<char>((const char *)data, (const char *)(data + count));
+		array->data = array->storage->data();
+	}
+
+	array->format = get_format<T>();
+	array->itemSize = sizeof(T);
+	array->numDimensions = (columns == 0) ? 1 : 2;
+	array->shape[0] = rows;
+	array->shape[1] = columns;
+	array->strides[0] = (columns == 0) ? sizeof(T) : columns * sizeof(T);
+	array->strides[1] = sizeof(T);
+
+	PyObject *view = PyMemoryView_FromObject((PyObject *)array);
+	Py_DECREF(array);
+
+	return view;
+}
+
+static void array_dealloc(ArrayObject *self)
+{
+	Py_XDECREF(self->owner);
+	delete self->storage;
+	PyObject_Del(self);
+}
+
+static int array_get_buffer(ArrayObject *self, Py_buffer *view, int flags)
+{
+	if ((flags & PyBUF_WRITABLE) == PyBUF_WRITABLE) {
+		PyErr_SetString(PyExc_BufferError, "LOSM arrays are read-only.");
+		view->obj = nullptr;
+		return -1;
+	}
+
+	view->buf = (void *)self->data;
+	view->obj = (PyObject *)self;
+	Py_INCREF(self);
+
+	view->len = self->shape[0] * self->itemSize * ((self->numDimensions == 2) ? self->shape[1] : 1);
+	view->readonly = 1;
+	view->itemsize = self->itemSize;
+	view->format = ((flags & PyBUF_FORMAT) == PyBUF_FORMAT) ? (char *)self->format : nullptr;
+	view->ndim = self->numDimensions;
+	view->shape = self->shape;
+	view->strides = self->strides;
+	view->suboffsets = nullptr;
+	view->internal = nullptr;
+
+	return 0;
+}
+
+static PyBufferProcs arrayBufferProcs = {(getbufferproc)array_get_buffer, nullptr};
+
+/**
+ * Parse the name of a cost.
+ * @param	name	The name, "distance" or "travel_time".
+ * @param	cost	The cost. This will be modified.
+ * @return	True if the name was valid, false otherwise with an exception set.
+ */
+static bool parse_cost(const char *name, LOSMCost &cost)
+{
+	if (name == nullptr || std::strcmp(name, "distance") == 0) {
+		cost = LOSMCost::DISTANCE;
+	} else if (std::strcmp(name, "travel_time") == 0) {
+		cost = LOSMCost::TRAVEL_TIME;
+	} else {
+		PyErr_Format(PyExc_ValueError, "Unknown cost '%s'; expected 'distance' or 'travel_time'.", name);
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Take a query context out of a graph's pool, creating one if none is free.
+ * @param	self	The graph.
+ * @return	The query context.
+ */
+static LOSMQueryContext *acquire_context(GraphObject *self)
+{
+	{
+		std::lock_guard<std::mutex> lock(*self->contextsMutex);
+		if (!self->contexts->empty()) {
+			LOSMQueryContext *context = self->contexts->back();
+			self->contexts->pop_back();
+			return context;
+		}
+	}
+
+	return new LOSMQueryContext(*self->graph);
+}
+
+/**
+ * Return a query context to a graph's pool.
+ * @param	self	The graph.
+ * @param	context	The query context.
+ */
+static void release_context(GraphObject *self, LOSMQueryContext *context)
+{
+	// A context acquired before the graph was initialized belongs to the empty graph.
+	if (context->get_graph() != self->graph->get()) {
+		delete context;
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(*self->contextsMutex);
+	self->contexts->push_back(context);
+}
+
+/**
+ * Get the graph of every object which was never initialized. It lives until the process exits,
+ * so views and queries of it remain valid once the object is initialized.
+ * @return	The empty graph.
+ */
+static std::shared_ptr<const LOSMGraph> get_empty_graph()
+{
+	static std::shared_ptr<const LOSMGraph> graph(new LOSMGraph(std::make_shared<LOSM>()));
+	return graph;
+}
+
+/**
+ * Check that a node index belongs to a graph.
+ * @param	self	The graph.
+ * @param	node	The node index.
+ * @return	True if the index is valid, false otherwise with an exception set.
+ */
+static bool check_node(GraphObject *self, unsigned long node)
+{
+	if (node >= (*self->graph)->get_num_nodes()) {
+		PyErr_Format(PyExc_IndexError, "Node index %lu is out of range.", node);
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Convert a sequence of numbers into a vector.
+ * @param	sequence	The sequence, e.g., a list or a NumPy array.
+ * @param	result		The numbers. This will be modified.
+ * @return	True if the conversion succeeded, false otherwise with an exception set.
+ */
+template <typename T>
+static bool convert_sequence(PyObject *sequence, std::vector<T> &result)
+{
+	PyObject *fast = PySequence_Fast(sequence, "Expected a sequence of numbers.");
+	if (fast == nullptr) {
+		return false;
+	}
+
+	Py_ssize_t count = PySequence_Fast_GET_SIZE(fast);
+	result.resize(count);
+
+	for (Py_ssize_t i = 0; i < count; i++) {
+		PyObject *item = PySequence_Fast_GET_ITEM(fast, i);
+		if (std::is_floating_point<T>::value) {
+			result[i] = (T)PyFloat_AsDouble(item);
+		} else {
+			// Accept any integer-like object, e.g., a NumPy integer.
+			PyObject *index = PyNumber_Index(item);
+			if (index != nullptr) {
+				result[i] = (T)PyLong_AsUnsignedLong(index);
+				Py_DECREF(index);
+			}
+		}
+
+		if (PyErr_Occurred()) {
+			Py_DECREF(fast);
+			return false;
+		}
+	}
+
+	Py_DECREF(fast);
+	return true;
+}
+
+static int graph_init(GraphObject *self, PyObject *args, PyObject *kwargs)
+{
+	static const char *keywords[] = {"nodes_filename", "edges_filename", "landmarks_filename", "cache_directory", nullptr};
+
+	const char *nodesFilename = nullptr;
+	const char *edgesFilename = nullptr;
+	const char *landmarksFilename = nullptr;
+	const char *cacheDirectory = nullptr;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sss|z", (char **)keywords,
+			&nodesFilename, &edgesFilename, &landmarksFilename, &cacheDirectory)) {
+		return -1;
+	}
+
+	// Other threads may be using the graph, so it cannot be replaced. The flag is set while holding
+	// the GIL, before releasing it, so that concurrent calls cannot both load.
+	if (self->initialized) {
+		PyErr_SetString(PyExc_RuntimeError, "The graph is already initialized.");
+		return -1;
+	}
+	self->initialized = true;
+
+	std::string nodes(nodesFilename), edges(edgesFilename), landmarks(landmarksFilename);
+	std::string cache((cacheDirectory != nullptr) ? cacheDirectory : "");
+
+	std::shared_ptr<const LOSMGraph> graph;
+	std::string error;
+
+	// Loading only touches C++ objects, so other Python threads may run meanwhile.
+	Py_BEGIN_ALLOW_THREADS
+	try {
+		if (!cache.empty()) {
+			graph = LOSMIndexCache(cache).load(nodes, edges, landmarks);
+		} else {
+			std::shared_ptr<LOSM> losm(new LOSM(nodes, edges, landmarks));
+			graph = std::shared_ptr<const LOSMGraph>(new LOSMGraph(losm));
+		}
+	} catch (const LOSMException &err) {
+		error = "Failed to load the LOSM files.";
+	} catch (const std::exception &err) {
+		error = std::string("Failed to load the LOSM files: ") + err.what();
+	}
+	Py_END_ALLOW_THREADS
+
+	if (!error.empty()) {
+		self->initialized = false;
+		PyErr_SetString(PyExc_RuntimeError, error.c_str());
+		return -1;
+	}
+
+	// The pooled contexts belong to the empty graph. Contexts still in use are freed when released.
+	{
+		std::lock_guard<std::mutex> lock(*self->contextsMutex);
+		for (LOSMQueryContext *context : *self->contexts) {
+			delete context;
+		}
+		self->contexts->clear();
+	}
+
+	*self->graph = graph;
+
+	return 0;
+}
+
+static PyObject *graph_new(PyTypeObject *type, PyObject *args, PyObject *kwargs)
+{
+	GraphObject *self = (GraphObject *)type->tp_alloc(type, 0);
+	if (self != nullptr) {
+		// Start with an empty graph, so that an object which was never initialized is still valid.
+		self->graph = new std::shared_ptr<const LOSMGraph>(get_empty_graph());
+		self->contexts = new std::vector<LOSMQueryContext *>();
+		self->contextsMutex = new std::mutex();
+		self->initialized = false;
+	}
+	return (PyObject *)self;
+}
+
+static void graph_dealloc(GraphObject *self)
+{
+	for (LOSMQueryContext *context : *self->contexts) {
+		delete context;
+	}
+
+	delete self->contexts;
+	delete self->contextsMutex;
+	delete self->graph;
+
+	Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *graph_get_num_nodes(GraphObject *self, void *closure)
+{
+	return PyLong_FromUnsignedLong((*self->graph)->get_num_nodes());
+}
+
+static PyObject *graph_get_num_edges(GraphObject *self, void *closure)
+{
+	return PyLong_FromUnsignedLong((*self->graph)->get_num_edges());
+}
+
+static PyObject *graph_get_uids(GraphObject *self, void *closure)
+{
+	return create_view((PyObject *)self, (*self->graph)->get_uid_array(), (*self->graph)->get_num_nodes());
+}
+
+static PyObject *graph_get_fixed_x(GraphObject *self, void *closure)
+{
+	return create_view((PyObject *)self, (*self->graph)->get_fixed_x_array(), (*self->graph)->get_num_nodes());
+}
+
+static PyObject *graph_get_fixed_y(GraphObject *self, void *closure)
+{
+	return create_view((PyObject *)self, (*self->graph)->get_fixed_y_array(), (*self->graph)->get_num_nodes());
+}
+
+static PyObject *graph_get_edge_nodes(GraphObject *self, void *closure)
+{
+	return create_view((PyObject *)self, (*self->graph)->get_edge_nodes_array(), (*self->graph)->get_num_edges(), 2);
+}
+
+static PyObject *graph_get_edge_distances(GraphObject *self, void *closure)
+{
+	return create_view((PyObject *)self, (*self->graph)->get_edge_distances_array(), (*self->graph)->get_num_edges());
+}
+
+static PyObject *graph_get_edge_travel_times(GraphObject *self, void *closure)
+{
+	return create_view((PyObject *)self, (*self->graph)->get_edge_travel_times_array(), (*self->graph)->get_num_edges());
+}
+
+static PyObject *graph_get_speed_limits(GraphObject *self, void *closure)
+{
+	return create_view((PyObject *)self, (*self->graph)->get_speed_limit_array(), (*self->graph)->get_num_edges());
+}
+
+static PyObject *graph_get_lanes(GraphObject *self, void *closure)
+{
+	return create_view((PyObject *)self, (*self->graph)->get_lanes_array(), (*self->graph)->get_num_edges());
+}
+
+static PyObject *graph_get_adjacency_offsets(GraphObject *self, void *closure)
+{
+	return create_view((PyObject *)self, (*self->graph)->get_adjacency_offsets_array(), (*self->graph)->get_num_nodes() + 1);
+}
+
+static PyObject *graph_get_adjacent_nodes(GraphObject *self, void *closure)
+{
+	return create_view((PyObject *)self, (*self->graph)->get_adjacent_nodes_array(), 2 * (*self->graph)->get_num_edges());
+}
+
+static PyObject *graph_get_adjacent_edges(GraphObject *self, void *closure)
+{
+	return create_view((PyObject *)self, (*self->graph)->get_adjacent_edges_array(), 2 * (*self->graph)->get_num_edges());
+}
+
+static PyObject *graph_edge_name(GraphObject *self, PyObject *args)
+{
+	unsigned long edge = 0;
+	if (!PyArg_ParseTuple(args, "k", &edge)) {
+		return nullptr;
+	}
+
+	if (edge >= (*self->graph)->get_num_edges()) {
+		PyErr_Format(PyExc_IndexError, "Edge index %lu is out of range.", edge);
+		return nullptr;
+	}
+
+	return PyUnicode_FromString((*self->graph)->get_edge(edge)->get_name().c_str());
+}
+
+static PyObject *graph_find_node_index(GraphObject *self, PyObject *args)
+{
+	unsigned long uid = 0;
+	if (!PyArg_ParseTuple(args, "k", &uid)) {
+		return nullptr;
+	}
+
+	unsigned int node = (*self->graph)->find_node_index(uid);
+	if (node == LOSMGraph::INVALID_INDEX) {
+		Py_RETURN_NONE;
+	}
+
+	return PyLong_FromUnsignedLong(node);
+}
+
+static PyObject *graph_find_nearest_node(GraphObject *self, PyObject *args)
+{
+	float x = 0.0f, y = 0.0f;
+	if (!PyArg_ParseTuple(args, "ff", &x, &y)) {
+		return nullptr;
+	}
+
+	std::shared_ptr<const LOSMGraph> graph = *self->graph;
+	unsigned int node = LOSMGraph::INVALID_INDEX;
+
+	Py_BEGIN_ALLOW_THREADS
+	node = graph->find_nearest_node(x, y);
+	Py_END_ALLOW_THREADS
+
+	if (node == LOSMGraph::INVALID_INDEX) {
+		Py_RETURN_NONE;
+	}
+
+	return PyLong_FromUnsignedLong(node);
+}
+
+static PyObject *graph_find_nearest_nodes(GraphObject *self, PyObject *args)
+{
+	PyObject *xsObject = nullptr, *ysObject = nullptr;
+	if (!PyArg_ParseTuple(args, "OO", &xsObject, &ysObject)) {
+		return nullptr;
+	}
+
+	std::vector<float> xs, ys;
+	if (!convert_sequence(xsObject, xs) || !convert_sequence(ysObject, ys)) {
+		return nullptr;
+	}
+
+	if (xs.size() != ys.size()) {
+		PyErr_SetString(PyExc_ValueError, "The x and y coordinates must have the same length.");
+		return nullptr;
+	}
+
+	std::shared_ptr<const LOSMGraph> graph = *self->graph;
+	std::vector<unsigned int> nodes(xs.size());
+
+	Py_BEGIN_ALLOW_THREADS
+	for (unsigned int i = 0; i < xs.size(); i++) {
+		nodes[i] = graph->find_nearest_node(xs[i], ys[i]);
+	}
+	Py_END_ALLOW_THREADS
+
+	return create_view<unsigned int>(nullptr, nodes.data(), nodes.size());
+}
+
+static PyObject *graph_find_distance(GraphObject *self, PyObject *args)
+{
+	unsigned long source = 0, target = 0;
+	const char *costName = nullptr;
+	LOSMCost cost;
+
+	if (!PyArg_ParseTuple(args, "kk|s", &source, &target, &costName) || !parse_cost(costName, cost) ||
+			!check_node(self, source) || !check_node(self, target)) {
+		return nullptr;
+	}
+
+	LOSMQueryContext *context = acquire_context(self);
+	float result = INFINITY;
+
+	Py_BEGIN_ALLOW_THREADS
+	result = context->search(source, target, cost);
+	Py_END_ALLOW_THREADS
+
+	release_context(self, context);
+
+	return PyFloat_FromDouble(result);
+}
+
+static PyObject *graph_find_distances(GraphObject *self, PyObject *args)
+{
+	PyObject *sourcesObject = nullptr, *targetsObject = nullptr;
+	const char *costName = nullptr;
+	LOSMCost cost;
+
+	if (!PyArg_ParseTuple(args, "OO|s", &sourcesObject, &targetsObject, &costName) || !parse_cost(costName, cost)) {
+		return nullptr;
+	}
+
+	std::vector<unsigned int> sources, targets;
+	if (!convert_sequence(sourcesObject, sources) || !convert_sequence(targetsObject, targets)) {
+		return nullptr;
+	}
+
+	if (sources.size() != targets.size()) {
+		PyErr_SetString(PyExc_ValueError, "The sources and targets must have the same length.");
+		return nullptr;
+	}
+
+	for (unsigned int i = 0; i < sources.size(); i++) {
+		if (!check_node(self, sources[i]) || !check_node(self, targets[i])) {
+			return nullptr;
+		}
+	}
+
+	LOSMQueryContext *context = acquire_context(self);
+	std::vector<float> result(sources.size());
+
+	Py_BEGIN_ALLOW_THREADS
+	for (unsigned int i = 0; i < sources.size(); i++) {
+		result[i] = context->search(sources[i], targets[i], cost);
+	}
+	Py_END_ALLOW_THREADS
+
+	release_context(self, context);
+
+	return create_view<float>(nullptr, result.data(), result.size());
+}
+
+static PyObject *graph_find_route(GraphObject *self, PyObject *args)
+{
+	unsigned long source = 0, target = 0;
+	const char *costName = nullptr;
+	LOSMCost cost;
+
+	if (!PyArg_ParseTuple(args, "kk|s", &source, &target, &costName) || !parse_cost(costName, cost) ||
+			!check_node(self, source) || !check_node(self, target)) {
+		return nullptr;
+	}
+
+	const LOSMGraph *graph = self->graph->get();
+	LOSMQueryContext *context = acquire_context(self);
+	float result = INFINITY;
+	std::vector<unsigned int> nodes, edges;
+
+	Py_BEGIN_ALLOW_THREADS
+	result = context->search(source, target, cost);
+
+	// Follow the parent edges back from the target.
+	if (result != INFINITY) {
+		unsigned int current = target;
+		nodes.push_back(current);
+
+		while (current != source) {
+			unsigned int edge = context->get_parent_edge(current);
+			edges.push_back(edge);
+
+			const unsigned int *edgeNodes = graph->get_edge_nodes_array() + 2 * edge;
+			current = (edgeNodes[0] == current) ? edgeNodes[1] : edgeNodes[0];
+			nodes.push_back(current);
+		}
+
+		std::reverse(nodes.begin(), nodes.end());
+		std::reverse(edges.begin(), edges.end());
+	}
+	Py_END_ALLOW_THREADS
+
+	release_context(self, context);
+
+	if (result == INFINITY) {
+		Py_RETURN_NONE;
+	}
+
+	PyObject *nodesView = create_view<unsigned int>(nullptr, nodes.data(), nodes.size());
+	PyObject *edgesView = create_view<unsigned int>(nullptr, edges.data(), edges.size());
+	if (nodesView == nullptr || edgesView == nullptr) {
+		Py_XDECREF(nodesView);
+		Py_XDECREF(edgesView);
+		return nullptr;
+	}
+
+	return Py_BuildValue("(dNN)", (double)result, nodesView, edgesView);
+}
+
+static PyObject *graph_sample_walks(GraphObject *self, PyObject *args, PyObject *kwargs)
+{
+	static const char *keywords[] = {"num_walks", "length", "bias", "non_backtracking", "seed", "sources", "threads", nullptr};
+
+	unsigned int numWalks = 0, length = 0, numThreads = 0;
+	const char *biasName = nullptr;
+	int nonBacktracking = 0;
+	unsigned long long seed = 0;
+	PyObject *sourcesObject = Py_None;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "II|spKOI", (char **)keywords, &numWalks, &length,
+			&biasName, &nonBacktracking, &seed, &sourcesObject, &numThreads)) {
+		return nullptr;
+	}
+
+	LOSMWalkBias bias = LOSMWalkBias::UNIFORM;
+	if (biasName != nullptr && std::strcmp(biasName, "speed_limit") == 0) {
+		bias = LOSMWalkBias::SPEED_LIMIT;
+	} else if (biasName != nullptr && std::strcmp(biasName, "uniform") != 0) {
+		PyErr_Format(PyExc_ValueError, "Unknown bias '%s'; expected 'uniform' or 'speed_limit'.", biasName);
+		return nullptr;
+	}
+
+	if (length == 0) {
+		PyErr_SetString(PyExc_ValueError, "The length of the walks must be positive.");
+		return nullptr;
+	}
+
+	std::vector<unsigned int> sources;
+	if (sourcesObject != Py_None) {
+		if (!convert_sequence(sourcesObject, sources)) {
+			return nullptr;
+		}
+		if (sources.size() != numWalks) {
+			PyErr_SetString(PyExc_ValueError, "There must be one source for each walk.");
+			return nullptr;
+		}
+		for (unsigned int i = 0; i < sources.size(); i++) {
+			if (!check_node(self, sources[i])) {
+				return nullptr;
+			}
+		}
+	}
+
+	if (numWalks > 0 && (*self->graph)->get_num_nodes() == 0) {
+		PyErr_SetString(PyExc_ValueError, "The graph has no nodes to start walks at.");
+		return nullptr;
+	}
+
+	LOSMWalkRequest request;
+	request.numWalks = numWalks;
+	request.length = length;
+	request.bias = bias;
+	request.nonBacktracking = (nonBacktracking != 0);
+	request.seed = seed;
+	request.sources = (sourcesObject != Py_None) ? sources.data() : nullptr;
+
+	std::shared_ptr<const LOSMGraph> graph = *self->graph;
+	std::vector<unsigned int> nodes((size_t)numWalks * (length + 1));
+	std::vector<unsigned int> edges((size_t)numWalks * length);
+
+	Py_BEGIN_ALLOW_THREADS
+	LOSMWalkSampler sampler(graph, numThreads);
+	sampler.sample(request, nodes.data(), edges.data());
+	Py_END_ALLOW_THREADS
+
+	PyObject *nodesView = create_view<unsigned int>(nullptr, nodes.data(), numWalks, length + 1);
+	PyObject *edgesView = create_view<unsigned int>(nullptr, edges.data(), numWalks, length);
+	if (nodesView == nullptr || edgesView == nullptr) {
+		Py_XDECREF(nodesView);
+		Py_XDECREF(edgesView);
+		return nullptr;
+	}
+
+	return Py_BuildValue("(NN)", nodesView, edgesView);
+}
+
+static PyObject *graph_export_render_geometry(GraphObject *self, PyObject *args, PyObject *kwargs)
+{
+	static const char *keywords[] = {"filename", "policy_filename", "tile_resolution", "levels", "tolerance", nullptr};
+
+	const char *filename = nullptr;
+	const char *policyFilename = nullptr;
+	unsigned int tileResolution = 10, numLevels = 4;
+	float tolerance = 0.0005f;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s|zIIf", (char **)keywords, &filename, &policyFilename,
+			&tileResolution, &numLevels, &tolerance)) {
+		return nullptr;
+	}
+
+	if (tileResolution == 0 || numLevels == 0) {
+		PyErr_SetString(PyExc_ValueError, "The tile resolution and number of levels must be positive.");
+		return nullptr;
+	}
+
+	// The colors of the visualizer.
+	LOSMRenderPalette palette;
+	palette.roadColor = 0xFFFFFFFF;
+	palette.autonomyCapableColor = 0xF0F0FFFF;
+	palette.policyColor = 0x199619FF;
+	palette.policyAutonomyColor = 0x961996FF;
+	palette.autonomySpeedLimit = 30;
+
+	std::shared_ptr<const LOSMGraph> graph = *self->graph;
+	std::string output(filename);
+	std::string policy((policyFilename != nullptr) ? policyFilename : "");
+	std::string error;
+
+	Py_BEGIN_ALLOW_THREADS
+	try {
+		LOSMRenderGeometry geometry(graph, tileResolution, numLevels, tolerance);
+
+		// Without a policy, the only layer colors the roads by their speed limit.
+		if (!policy.empty()) {
+			geometry.add_policy_layers(policy, palette);
+		} else {
+			std::vector<unsigned int> edgeColors(graph->get_num_edges());
+			const unsigned int *speedLimits = graph->get_speed_limit_array();
+			for (unsigned int i = 0; i < graph->get_num_edges(); i++) {
+				if (speedLimits[i] >= palette.autonomySpeedLimit) {
+					edgeColors[i] = palette.autonomyCapableColor;
+				} else {
+					edgeColors[i] = palette.roadColor;
+				}
+			}
+			geometry.add_layer(edgeColors);
+		}
+
+		geometry.build();
+		geometry.save(output);
+	} catch (const LOSMException &err) {
+		error = "Failed to export the render geometry.";
+	} catch (const std::exception &err) {
+		error = std::string("Failed to export the render geometry: ") + err.what();
+	}
+	Py_END_ALLOW_THREADS
+
+	if (!error.empty()) {
+		PyErr_SetString(PyExc_RuntimeError, error.c_str());
+		return nullptr;
+	}
+
+	Py_RETURN_NONE;
+}
+
+static PyGetSetDef graphGetSet[] = {
+	{(char *)"num_nodes", (getter)graph_get_num_nodes, nullptr, (char *)"The number of nodes.", nullptr},
+	{(char *)"num_edges", (getter)graph_get_num_edges, nullptr, (char *)"The number of edges.", nullptr},
+	{(char *)"uids", (getter)graph_get_uids, nullptr, (char *)"The unique identifier of each node.", nullptr},
+	{(char *)"fixed_x", (getter)graph_get_fixed_x, nullptr, (char *)"The latitude of each node in fixed point (1e-7 degrees).", nullptr},
+	{(char *)"fixed_y", (getter)graph_get_fixed_y, nullptr, (char *)"The longitude of each node in fixed point (1e-7 degrees).", nullptr},
+	{(char *)"edge_nodes", (getter)graph_get_edge_nodes, nullptr, (char *)"The indices of the two nodes of each edge.", nullptr},
+	{(char *)"edge_distances", (getter)graph_get_edge_distances, nullptr, (char *)"The distance (in miles) of each edge.", nullptr},
+	{(char *)"edge_travel_times", (getter)graph_get_edge_travel_times, nullptr, (char *)"The travel time (in hours) of each edge.", nullptr},
+	{(char *)"speed_limits", (getter)graph_get_speed_limits, nullptr, (char *)"The speed limit of each edge.", nullptr},
+	{(char *)"lanes", (getter)graph_get_lanes, nullptr, (char *)"The number of lanes of each edge.", nullptr},
+	{(char *)"adjacency_offsets", (getter)graph_get_adjacency_offsets, nullptr, (char *)"The first adjacency slot of each node, followed by the number of slots.", nullptr},
+	{(char *)"adjacent_nodes", (getter)graph_get_adjacent_nodes, nullptr, (char *)"The neighboring node of each adjacency slot.", nullptr},
+	{(char *)"adjacent_edges", (getter)graph_get_adjacent_edges, nullptr, (char *)"The edge of each adjacency slot.", nullptr},
+	{nullptr}
+};
+
+static PyMethodDef graphMethods[] = {
+	{"edge_name", (PyCFunction)graph_edge_name, METH_VARARGS,
+			"edge_name(edge) -> The name of an edge."},
+	{"find_node_index", (PyCFunction)graph_find_node_index, METH_VARARGS,
+			"find_node_index(uid) -> The index of the node with a unique identifier, or None."},
+	{"find_nearest_node", (PyCFunction)graph_find_nearest_node, METH_VARARGS,
+			"find_nearest_node(x, y) -> The index of the node nearest to a latitude and longitude, or None."},
+	{"find_nearest_nodes", (PyCFunction)graph_find_nearest_nodes, METH_VARARGS,
+			"find_nearest_nodes(xs, ys) -> The index of the node nearest to each latitude and longitude."},
+	{"find_distance", (PyCFunction)graph_find_distance, METH_VARARGS,
+			"find_distance(source, target, cost='distance') -> The cost of the cheapest route, or infinity."},
+	{"find_distances", (PyCFunction)graph_find_distances, METH_VARARGS,
+			"find_distances(sources, targets, cost='distance') -> The cost of the cheapest route of each pair."},
+	{"find_route", (PyCFunction)graph_find_route, METH_VARARGS,
+			"find_route(source, target, cost='distance') -> (cost, nodes, edges) of the cheapest route, or None."},
+	{"sample_walks", (PyCFunction)graph_sample_walks, METH_VARARGS | METH_KEYWORDS,
+			"sample_walks(num_walks, length, bias='uniform', non_backtracking=False, seed=0, sources=None, threads=0) -> "
+			"(nodes, edges) of random walks, one row per walk. Bias is 'uniform' or 'speed_limit'. Rows of walks "
+			"which reach a node without edges end with 0xFFFFFFFF."},
+	{"export_render_geometry", (PyCFunction)graph_export_render_geometry, METH_VARARGS | METH_KEYWORDS,
+			"export_render_geometry(filename, policy_filename=None, tile_resolution=10, levels=4, tolerance=0.0005) -> "
+			"None. Write the tile-bucketed line geometry the visualizer draws, with the four (tiredness, autonomy) "
+			"layers of a policy, or one layer of roads without one."},
+	{nullptr}
+};
+
+static PyModuleDef losmModule = {
+	PyModuleDef_HEAD_INIT,
+	"losm_native",
+	"Native access to LOSM maps, with read-only views of the graph's arrays.",
+	-1,
+	nullptr
+};
+
+PyMODINIT_FUNC PyInit_losm_native()
+{
+	ArrayType.tp_name = "losm_native.Array";
+	ArrayType.tp_basicsize = sizeof(ArrayObject);
+	ArrayType.tp_dealloc = (destructor)array_dealloc;
+	ArrayType.tp_as_buffer = &arrayBufferProcs;
+	ArrayType.tp_flags = Py_TPFLAGS_DEFAULT;
+	ArrayType.tp_doc = "A read-only array exported through the buffer protocol.";
+
+	GraphType.tp_name = "losm_native.Graph";
+	GraphType.tp_basicsize = sizeof(GraphObject);
+	GraphType.tp_dealloc = (destructor)graph_dealloc;
+	GraphType.tp_flags = Py_TPFLAGS_DEFAULT;
+	GraphType.tp_doc = "Graph(nodes_filename, edges_filename, landmarks_filename, cache_directory=None)\n\n"
+			"A LOSM map loaded as a graph. Array attributes are read-only memoryviews of the graph's "
+			"memory, e.g., numpy.asarray(graph.edge_distances) does not copy.";
+	GraphType.tp_new = graph_new;
+	GraphType.tp_init = (initproc)graph_init;
+	GraphType.tp_getset = graphGetSet;
+	GraphType.tp_methods = graphMethods;
+
+	if (PyType_Ready(&ArrayType) < 0 || PyType_Ready(&GraphType) < 0) {
+		return nullptr;
+	}
+
+	PyObject *module = PyModule_Create(&losmModule);
+	if (module == nullptr) {
+		return nullptr;
+	}
+
+	Py_INCREF(&GraphType);
+	if (PyModule_AddObject(module, "Graph", (PyObject *)&GraphType) < 0 ||
+			PyModule_AddObject(module, "FIXED_POINT_SCALE", PyFloat_FromDouble(LOSM_FIXED_POINT_SCALE)) < 0) {
+		Py_DECREF(&GraphType);
+		Py_DECREF(module);
+		return nullptr;
+	}
+
+	return module;
+}
@@ -0,0 +1,43 @@
+""" The MIT License (MIT)
+
+    Copyright (c) 2015 Kyle Hollins Wray, University of Massachusetts
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of
+    this software and associated documentation files (the "Software"), to deal in
+    the Software without restriction, including without limitation the rights to
+    use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+    the Software, and to permit persons to whom the Software is furnished to do so,
+    subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+    FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+    COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+    IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+    CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+"""
+
+import glob
+import os
+
+from setuptools import setup, Extension
+
+thisFilePath = os.path.dirname(os.path.realpath(__file__))
+os.chdir(thisFilePath)
+
+# The extension is compiled together with the C++ library's sources.
+sources = ["losm_native.cpp"] + sorted(glob.glob(os.path.join("..", "..", "..", "losm", "src", "*.cpp")))
+
+losmNative = Extension("losm_native",
+                       sources=sources,
+                       extra_compile_args=["-std=c++11", "-pthread"],
+                       extra_link_args=["-pthread"],
+                       language="c++")
+
+setup(name="losm_native",
+      version="1.0",
+      description="Native access to LOSM maps, with read-only views of the graph's arrays.",
+      ext_modules=[losmNative])
@@ -67,6 +67,10 @@ class Policy(object):
         with open(policyFile, 'r') as f:
             reader = csv.reader(f, delimiter=',')
             for row in reader:
+                # Skip blank lines and comments.
+                if "".join(row).strip() == "" or row[0].lstrip().startswith("#"):
+                    continue
+
                 if len(row) != 7:
                     print("Failed to parse 7 arguments for policy line: '" + \
                         ",".join(row) + "'.")
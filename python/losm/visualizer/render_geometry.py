@@ -0,0 +1,99 @@
+""" The MIT License (MIT)
+
+    Copyright (c) 2015 Kyle Hollins Wray, University of Massachusetts
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of
+    this software and associated documentation files (the "Software"), to deal in
+    the Software without restriction, including without limitation the rights to
+    use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+    the Software, and to permit persons to whom the Software is furnished to do so,
+    subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+    FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+    COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+    IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+    CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+"""
+
+from __future__ import print_function
+
+import os
+import struct
+import sys
+import numpy as np
+
+
+RENDER_GEOMETRY_MAGIC = b"LOSMRG01"
+
+
+class RenderGeometry(object):
+    """ The tile-bucketed line geometry written by LOSMRenderGeometry::save in C++. """
+
+    def __init__(self, filename):
+        """ The constructor for the RenderGeometry class.
+
+            Parameters:
+                filename -- The render geometry file to load.
+        """
+
+        self.data = np.fromfile(filename, dtype=np.uint8)
+
+        if self.data[0:8].tobytes() != RENDER_GEOMETRY_MAGIC:
+            raise ValueError("Invalid render geometry file '" + filename + "'.")
+
+        self.numLevels, self.tileResolution, self.numLayers, _ = \
+                struct.unpack("=4I", self.data[8:24].tobytes())
+        self.bounds = struct.unpack("=4f", self.data[24:40].tobytes())
+        self.tolerances = np.frombuffer(self.data, dtype=np.float32,
+                                        count=self.numLevels, offset=40)
+
+        numTiles = self.numLevels * self.tileResolution * self.tileResolution
+        self.table = np.frombuffer(self.data, dtype=np.uint64, count=2 * numTiles,
+                                   offset=40 + 4 * self.numLevels).reshape((numTiles, 2))
+
+    def get_tile(self, level, column, row, layer):
+        """ Get the line list of one tile as views into the file's data.
+
+            Parameters:
+                level   -- The level of detail, with 0 the exact geometry.
+                column  -- The column of the tile, increasing with longitude.
+                row     -- The row of the tile, increasing southward.
+                layer   -- The layer of colors, e.g., a (tiredness, autonomy) policy.
+
+            Returns:
+                The (u, v) positions in the unit square, two per segment, as an n-by-2
+                array, and the 0xRRGGBBAA color of each vertex.
+        """
+
+        tile = (level * self.tileResolution + column) * self.tileResolution + row
+        offset, numVertices = int(self.table[tile, 0]), int(self.table[tile, 1])
+
+        positions = np.frombuffer(self.data, dtype=np.float32, count=2 * numVertices,
+                                  offset=offset).reshape((numVertices, 2))
+        colors = np.frombuffer(self.data, dtype=np.uint32, count=numVertices,
+                               offset=offset + 8 * numVertices + 4 * numVertices * layer)
+
+        return positions, colors
+
+
+if __name__ == "__main__":
+    if len(sys.argv) != 3 and len(sys.argv) != 4:
+        print("Command line arguments are as follows:")
+        print("python render_geometry.py <path to resources>/resources/<output prefix> <output geometry file> <optional, path and name of policy file>")
+        sys.exit(0)
+
+    # The export is done by the C++ library, through the native bindings.
+    thisFilePath = os.path.dirname(os.path.realpath(__file__))
+    sys.path.append(os.path.join(thisFilePath, "..", "bindings"))
+    import losm_native
+
+    prefix = sys.argv[1]
+    graph = losm_native.Graph(prefix + "nodes.dat", prefix + "edges.dat", prefix + "landmarks.dat")
+    graph.export_render_geometry(sys.argv[2], sys.argv[3] if len(sys.argv) == 4 else None)
+
+    print("Exported the render geometry to '" + sys.argv[2] + "'.")
@@ -37,6 +37,7 @@ import sys
 thisFilePath = os.path.dirname(os.path.realpath(__file__))
 sys.path.append(thisFilePath)
 from policy import *
+from render_geometry import *
 
 sys.path.append(os.path.join(thisFilePath, "..", "converter"))
 from losm_converter import *
@@ -52,13 +53,16 @@ RENDER_NORMAL_LINES = False
 
 AUTONOMY_SPEED_LIMIT_THRESHOLD = 30
 
+# The layout of SDL_Vertex: position, color (r, g, b, a), and texture coordinate.
+SDL_VERTEX_DTYPE = np.dtype([('position', np.float32, 2), ('color', np.uint8, 4), ('texCoord', np.float32, 2)])
+
 
 class LMDPVisualizer(object):
     """ Provide a graphical visualization of the LOSM objects and the policy produced
         by solving the corresponding LMDP.
     """
 
-    def __init__(self, highlight=dict(), width=1600, height=900, maxSize=1600, filePrefix=None, policyFile=None, fastRender=True):
+    def __init__(self, highlight=dict(), width=1600, height=900, maxSize=1600, filePrefix=None, policyFile=None, fastRender=True, geometryFile=None):
         """ The constructor for the LMDP class. Optionally, allow for the LOSM files
             to be loaded with the corresponding prefix. Also, optionally allow for
             the policy to be loaded.
@@ -70,6 +74,9 @@ class LMDPVisualizer(object):
                 maxSize     -- The max size in pixels of width or height of the window.
                 filePrefix  -- The prefix for the three LOSM files.
                 policyFile  -- The policy file to load.
+                fastRender  -- "1" to render the map once to cached textures.
+                geometryFile -- The render geometry file exported for the map (and policy),
+                                which is drawn directly instead of the LOSM objects.
         """
 
         # Important: This must match 'maxSize' because <reasons></reasons>.
@@ -117,6 +124,10 @@ class LMDPVisualizer(object):
         if policyFile != None:
             self.load_policy(policyFile)
 
+        self.geometry = None
+        if geometryFile != None:
+            self.geometry = RenderGeometry(geometryFile)
+
     def load_losm(self, filePrefix):
         """ Load the LOSM map given the file prefix.
 
@@ -216,6 +227,10 @@ class LMDPVisualizer(object):
             reader = csv.reader(f, delimiter=',')
 
             for row in reader:
+                # Skip blank lines and comments.
+                if "".join(row).strip() == "" or row[0].lstrip().startswith("#"):
+                    continue
+
                 if len(row) < 6:
                     print("Failed to parse >= 6 arguments for policy line: '" + \
                         ",".join(row) + "'.")
@@ -242,6 +257,10 @@ class LMDPVisualizer(object):
 
         renderer = sdl2.ext.Renderer(window)
 
+        # The render geometry is already batched, so it needs no cached textures.
+        if self.geometry != None:
+            self.fastRender = False
+
         if self.fastRender:
             self._create_map(renderer)
 
@@ -263,7 +282,10 @@ class LMDPVisualizer(object):
             renderer.color = sdl2.ext.Color(230, 230, 220)
             renderer.clear()
 
-            if self.fastRender:
+            if self.geometry != None:
+                self._render_geometry(renderer)
+                self._render_markers(renderer)
+            elif self.fastRender:
                 self._render_map_texture(renderer)
             else:
                 self._render_map(renderer)
@@ -605,6 +627,16 @@ class LMDPVisualizer(object):
                                         renderer.color.b,
                                         renderer.color.a)
 
+        self._render_markers(renderer)
+
+
+    def _render_markers(self, renderer):
+        """ Render the landmarks, and the selected and state nodes, to the window.
+
+            Parameters:
+                renderer -- The renderer object.
+        """
+
         for obj in self.losm.nodes + self.losm.landmarks:
             r = self._camera(obj.x, obj.y) + [int(self.markerSize), int(self.markerSize)]
 
@@ -653,6 +685,92 @@ class LMDPVisualizer(object):
                                         renderer.color.a)
 
 
+    def _render_geometry(self, renderer):
+        """ Render the roads, colored by the policy, from the render geometry. Each
+            visible tile is drawn in one batched call, at the coarsest level of detail
+            whose error is under a pixel.
+
+            Parameters:
+                renderer -- The renderer object.
+        """
+
+        scale = self.camera['scale']
+        resolution = self.geometry.tileResolution
+
+        layer = 0
+        if self.geometry.numLayers == NUM_TIREDNESS_LEVELS * 2:
+            layer = self.tiredness * 2 + int(self.autonomy)
+
+        pixel = 1.0 / (min(self.vwidth, self.vheight) * scale)
+        level = 0
+        for i, tolerance in enumerate(self.geometry.tolerances):
+            if tolerance <= pixel:
+                level = i
+
+        # The window's corners in the unit square, inverting the camera's transform.
+        uMin = (-self.vwidth / 2 / scale - self.camera['x'] + self.vwidth / 2) / self.vwidth
+        uMax = ((self.width - self.vwidth / 2) / scale - self.camera['x'] + self.vwidth / 2) / self.vwidth
+        vMin = (-self.vheight / 2 / scale - self.camera['y'] + self.vheight / 2) / self.vheight
+        vMax = ((self.height - self.vheight / 2) / scale - self.camera['y'] + self.vheight / 2) / self.vheight
+
+        halfWidth = max(1.0, self.roadLineWidth * scale / self.elementResolution) / 2.0
+
+        for column in range(max(0, int(math.floor(uMin * resolution))),
+                            min(resolution, int(math.floor(uMax * resolution)) + 1)):
+            for row in range(max(0, int(math.floor(vMin * resolution))),
+                             min(resolution, int(math.floor(vMax * resolution)) + 1)):
+                positions, colors = self.geometry.get_tile(level, column, row, layer)
+                if len(positions) == 0:
+                    continue
+
+                vertices = self._create_tile_vertices(positions, colors, halfWidth)
+                sdl2.SDL_RenderGeometry(renderer.renderer, None,
+                                        vertices.ctypes.data_as(ctypes.POINTER(sdl2.SDL_Vertex)),
+                                        len(vertices), None, 0)
+
+
+    def _create_tile_vertices(self, positions, colors, halfWidth):
+        """ Create the triangles of a tile's segments, as thick lines on the window.
+
+            Parameters:
+                positions   -- The (u, v) positions of the tile, two per segment.
+                colors      -- The 0xRRGGBBAA color of each position.
+                halfWidth   -- Half the width of the lines in pixels.
+
+            Returns:
+                The SDL_Vertex array of two triangles per segment.
+        """
+
+        scale = self.camera['scale']
+
+        points = np.empty(positions.shape, dtype=np.float32)
+        points[:, 0] = scale * (positions[:, 0] * self.vwidth - self.vwidth / 2 + self.camera['x']) + self.vwidth / 2
+        points[:, 1] = scale * (positions[:, 1] * self.vheight - self.vheight / 2 + self.camera['y']) + self.vheight / 2
+
+        start = points[0::2]
+        end = points[1::2]
+
+        direction = end - start
+        length = np.linalg.norm(direction, axis=1)
+        length[length == 0.0] = 1.0
+
+        normal = np.empty(direction.shape, dtype=np.float32)
+        normal[:, 0] = -direction[:, 1] * halfWidth / length
+        normal[:, 1] = direction[:, 0] * halfWidth / length
+
+        corners = np.stack((start + normal, start - normal, end + normal,
+                            end + normal, start - normal, end - normal), axis=1)
+
+        # Colors are stored as 0xRRGGBBAA, and SDL_Color is the bytes (r, g, b, a).
+        rgba = colors.astype('>u4').view(np.uint8).reshape((-1, 2, 4))
+
+        vertices = np.zeros(corners.shape[0] * 6, dtype=SDL_VERTEX_DTYPE)
+        vertices['position'] = corners.reshape((-1, 2))
+        vertices['color'] = rgba[:, [0, 0, 1, 1, 0, 1]].reshape((-1, 4))
+
+        return vertices
+
+
     def _render_policy(self, renderer):
         """ Render the policy on the map.
 
@@ -799,9 +917,9 @@ class LMDPVisualizer(object):
 
 
 if __name__ == "__main__":
-    if len(sys.argv) != 5 and len(sys.argv) != 6:
+    if len(sys.argv) < 5 or len(sys.argv) > 7:
         print("Command line arguments are as follows:")
-        print("python losm_visualizer.py <window width (px)> <window height (px)> <0/1 - real-time render (vs cached texture)> <path to resources>/resources/<output prefix> <path and name of policy file>")
+        print("python losm_visualizer.py <window width (px)> <window height (px)> <0/1 - real-time render (vs cached texture)> <path to resources>/resources/<output prefix> <path and name of policy file> <optional, render geometry file from render_geometry.py>")
         sys.exit(0)
 
     h = dict()
@@ -832,6 +950,11 @@ if __name__ == "__main__":
                         fastRender=sys.argv[3], highlight=h, filePrefix=sys.argv[4], \
                         policyFile=sys.argv[5])
         v.execute()
+    elif len(sys.argv) == 7:
+        v = LMDPVisualizer(width=width, height=height, maxSize=maxSize, \
+                        fastRender=sys.argv[3], highlight=h, filePrefix=sys.argv[4], \
+                        policyFile=sys.argv[5], geometryFile=sys.argv[6])
+        v.execute()
     else:
         print("python visualizer.py " +
               "<0 or 1 for fast render > " +